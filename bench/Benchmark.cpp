@@ -0,0 +1,326 @@
+#include "Benchmark.hpp"
+
+#include <splitspace/Engine.hpp>
+#include <splitspace/Config.hpp>
+#include <splitspace/LogManager.hpp>
+#include <splitspace/WindowManager.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/ResourceManager.hpp>
+#include <splitspace/GpuProfiler.hpp>
+#include <splitspace/Scene.hpp>
+#include <splitspace/Camera.hpp>
+#include <splitspace/ForwardRenderTechnique.hpp>
+#include <splitspace/GraphRenderTechnique.hpp>
+#include <splitspace/DefferedRenderTechnique.hpp>
+
+#include <glm/gtc/constants.hpp>
+
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <cmath>
+
+using json = nlohmann::json;
+
+namespace splitspace {
+
+Benchmark::Benchmark(Engine *e): m_engine(e),
+                                 m_logManager(e->logManager),
+                                 m_renderManager(e->renderManager),
+                                 m_resManager(e->resManager)
+{}
+
+bool Benchmark::loadCases(const std::string &path) {
+    std::ifstream f(path);
+    if(!f.is_open()) {
+        m_logManager->logErr("(Benchmark) Error opening "+path);
+        return false;
+    }
+
+    json jbench;
+    try {
+        f >> jbench;
+    } catch(std::invalid_argument e) {
+        m_logManager->logErr("(Benchmark) "+path+":");
+        m_logManager->logErr("\tParse error: "+std::string(e.what()));
+        return false;
+    }
+
+    BenchmarkCase defaults;
+    if(!jbench["defaults"].is_null() && !readCase(jbench["defaults"], defaults)) {
+        return false;
+    }
+
+    auto jcases = jbench["cases"];
+    if(!jcases.is_array()) {
+        m_logManager->logErr("(Benchmark) "+path+": \"cases\" array expected");
+        return false;
+    }
+    m_cases.clear();
+    for(auto it = jcases.begin();it!=jcases.end();it++) {
+        auto jc = (*it);
+        BenchmarkCase c = defaults;
+        if(!readCase(jc, c)) {
+            return false;
+        }
+        if(c.name.empty()) {
+            m_logManager->logErr("(Benchmark) "+path+": expected case name");
+            return false;
+        }
+        m_cases.push_back(c);
+    }
+    return true;
+}
+
+bool Benchmark::readCase(json &j, BenchmarkCase &c) {
+    try {
+        if(!j["name"].is_null()) {
+            c.name = j["name"];
+        }
+        if(!j["objects"].is_null()) {
+            c.scene.objects = j["objects"];
+        }
+        if(!j["meshes"].is_null()) {
+            c.scene.meshes = j["meshes"];
+        }
+        if(!j["materials"].is_null()) {
+            c.scene.materials = j["materials"];
+        }
+        if(!j["lights"].is_null()) {
+            c.scene.lights = j["lights"];
+        }
+        if(!j["spacing"].is_null()) {
+            c.scene.spacing = float(j["spacing"]);
+        }
+        if(!j["technique"].is_null()) {
+            std::string technique = j["technique"];
+            if(technique == "forward") {
+                c.deferred = false;
+            } else if(technique == "deferred") {
+                c.deferred = true;
+            } else {
+                m_logManager->logErr("(Benchmark) Unknown technique \""+technique+"\"");
+                return false;
+            }
+        }
+        if(!j["renderGraph"].is_null()) {
+            c.renderGraph = j["renderGraph"];
+        }
+        if(!j["frames"].is_null()) {
+            c.frames = j["frames"];
+        }
+        if(!j["warmUpFrames"].is_null()) {
+            c.warmUpFrames = j["warmUpFrames"];
+        }
+        if(!j["perFrame"].is_null()) {
+            c.perFrame = j["perFrame"];
+        }
+    } catch(std::domain_error e) {
+        m_logManager->logErr("(Benchmark) \""+c.name+"\":");
+        m_logManager->logErr("\tParse error: "+std::string(e.what()));
+        return false;
+    }
+    if(c.frames<1 || c.scene.objects<0 || c.scene.lights<0) {
+        m_logManager->logErr("(Benchmark) \""+c.name+"\": frames must be at least 1, "
+                             "object and light counts can not be negative");
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::run(const BenchmarkCase &c, json &result) {
+    using namespace std::chrono;
+    if(!SyntheticScene::create(m_resManager, c.name, c.scene)) {
+        m_logManager->logErr("(Benchmark) Failed to create scene \""+c.name+"\"");
+        return false;
+    }
+    Scene *scene = static_cast<Scene *>(m_resManager->loadResource(c.name));
+    if(!scene) {
+        m_logManager->logErr("(Benchmark) Failed to load scene \""+c.name+"\"");
+        return false;
+    }
+
+    RenderTechnique *rt = nullptr;
+    if(!c.renderGraph.empty()) {
+        rt = new GraphRenderTechnique(m_engine, c.renderGraph);
+    } else if(c.deferred) {
+        rt = new DefferedRenderTechnique(m_engine);
+    } else {
+        rt = new ForwardRenderTechnique(m_engine);
+    }
+    if(!rt || !rt->init()) {
+        m_logManager->logErr("(Benchmark) Failed to init render technique for \""+c.name+"\"");
+        if(rt) {
+            delete rt;
+        }
+        m_resManager->unloadResource(c.name);
+        m_resManager->releaseUnloaded();
+        return false;
+    }
+
+    const WindowConfig &window = m_engine->config->window;
+    LookatCamera camera(window.width, window.height, glm::pi<float>()/3.f, 0.1f, 1000.f);
+    camera.init();
+    rt->setScene(scene);
+    rt->setViewCamera(&camera);
+    m_renderManager->setRenderTechnique(rt);
+    m_renderManager->setScene(scene);
+    m_renderManager->setCamera(&camera);
+
+    // Counters go through TimingHistory as well, it only keeps samples
+    TimingHistory cpuTimes(c.frames);
+    TimingHistory gpuTimes(c.frames);
+    TimingHistory drawCalls(c.frames);
+    TimingHistory stateChanges(c.frames);
+    TimingHistory triangles(c.frames);
+    TimingHistory primitives(c.frames);
+    TimingHistory scales(c.frames);
+    std::map<std::string, TimingHistory> passTimes;
+    json perFrame = json::array();
+
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+    GLStateCache &state = m_renderManager->getGLState();
+    // Orbit wide enough to keep the whole grid in view
+    const float distance = SyntheticScene::getRadius(c.scene)*1.5f+5.f;
+    // GPU results are read back late, so they are matched to the measured
+    // frame they belong to by profiler frame index
+    const int warmUp = std::max(c.warmUpFrames, GPU_PROFILER_FRAMES);
+    std::uint64_t firstGpuFrame = 0;
+    std::uint64_t seenGpuFrames = profiler->getCollectedFrames();
+    auto collectGpu = [&]() {
+        if(profiler->getCollectedFrames() == seenGpuFrames) {
+            return;
+        }
+        seenGpuFrames = profiler->getCollectedFrames();
+        std::uint64_t frame = profiler->getLastCollectedFrame();
+        if(frame<firstGpuFrame) {
+            return;
+        }
+        gpuTimes.add(profiler->getFrameTimes().getLast());
+        // Only passes timed in that frame, the profiler keeps every pass it saw
+        for(const auto &s : profiler->getLastFramePasses()) {
+            const std::string &name = profiler->getPassName(s.pass);
+            auto it = passTimes.find(name);
+            if(it==passTimes.end()) {
+                it = passTimes.insert(std::make_pair(name, TimingHistory(c.frames))).first;
+            }
+            it->second.add(s.ms);
+        }
+        if(profiler->hasPipelineStats()) {
+            primitives.add(profiler->getPipelineStat(PIPELINE_STAT_PRIMITIVES));
+        }
+        std::size_t index = frame-firstGpuFrame;
+        if(c.perFrame && index<perFrame.size()) {
+            perFrame[index]["gpuMs"] = profiler->getFrameTimes().getLast();
+        }
+    };
+    for(int i = -warmUp;i<c.frames;i++) {
+        float a = 2.f*glm::pi<float>()*std::max(i, 0)/c.frames;
+        camera.setPosition(glm::vec3(std::cos(a)*distance, distance*0.5f, std::sin(a)*distance));
+        camera.setLookPosition(glm::vec3(0));
+        camera.update(BENCH_FRAME_STEP);
+        m_engine->windowManager->collectEvents();
+
+        if(i == 0) {
+            firstGpuFrame = profiler->getBegunFrames();
+        }
+        steady_clock::time_point start = steady_clock::now();
+        scene->update(BENCH_FRAME_STEP);
+        rt->update(BENCH_FRAME_STEP);
+        m_renderManager->render();
+        double cpuMs = duration<double, std::milli>(steady_clock::now()-start).count();
+        if(i<0) {
+            continue;
+        }
+
+        cpuTimes.add(cpuMs);
+        drawCalls.add(m_renderManager->getFrameDrawCalls());
+        stateChanges.add(state.getFrameIssued());
+        triangles.add(m_renderManager->getFrameTriangles());
+        scales.add(rt->getResolutionScale());
+
+        if(c.perFrame) {
+            json frame;
+            frame["cpuMs"] = cpuMs;
+            frame["gpuMs"] = nullptr;
+            frame["drawCalls"] = m_renderManager->getFrameDrawCalls();
+            frame["stateChanges"] = state.getFrameIssued();
+            frame["triangles"] = m_renderManager->getFrameTriangles();
+            frame["resolutionScale"] = rt->getResolutionScale();
+            perFrame.push_back(frame);
+        }
+        // The sample read back this frame belongs to an earlier one
+        collectGpu();
+    }
+    // The last frames are still in flight
+    while(profiler->collectOldest()) {
+        collectGpu();
+    }
+
+    m_renderManager->setRenderTechnique(nullptr);
+    m_renderManager->setScene(nullptr);
+    m_renderManager->setCamera(nullptr);
+    delete rt;
+    m_resManager->unloadResource(c.name);
+    m_resManager->releaseUnloaded();
+
+    result["name"] = c.name;
+    result["technique"] = c.deferred?"deferred":"forward";
+    if(!c.renderGraph.empty()) {
+        result["technique"] = "graph";
+        result["renderGraph"] = c.renderGraph;
+    }
+    result["objects"] = c.scene.objects;
+    result["meshes"] = c.scene.meshes;
+    result["materials"] = c.scene.materials;
+    result["lights"] = c.scene.lights;
+    result["frames"] = c.frames;
+    result["warmUpFrames"] = warmUp;
+    result["cpuFrameMs"] = summarize(cpuTimes);
+    result["gpuFrameMs"] = summarize(gpuTimes);
+    json jpasses;
+    for(const auto &pass : passTimes) {
+        jpasses[pass.first] = summarize(pass.second);
+    }
+    result["gpuPassMs"] = jpasses;
+    result["drawCalls"] = summarize(drawCalls);
+    result["stateChanges"] = summarize(stateChanges);
+    result["triangles"] = summarize(triangles);
+    result["resolutionScale"] = summarize(scales);
+    if(primitives.size()) {
+        result["gpuPrimitives"] = summarize(primitives);
+    }
+    if(c.perFrame) {
+        result["perFrame"] = perFrame;
+    }
+    m_logManager->logInfo("(Benchmark) "+c.name+": CPU frame time "+cpuTimes.describe());
+    return true;
+}
+
+bool Benchmark::runAll(json &results) {
+    results = json::array();
+    bool ok = true;
+    for(const auto &c : m_cases) {
+        json result;
+        if(!run(c, result)) {
+            ok = false;
+            continue;
+        }
+        results.push_back(result);
+    }
+    return ok;
+}
+
+json Benchmark::summarize(const TimingHistory &samples) {
+    json j;
+    j["avg"] = samples.getAverage();
+    j["min"] = samples.getMin();
+    j["max"] = samples.getMax();
+    j["p50"] = samples.getPercentile(50);
+    j["p95"] = samples.getPercentile(95);
+    j["p99"] = samples.getPercentile(99);
+    return j;
+}
+
+} // namespace splitspace
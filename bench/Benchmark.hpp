@@ -0,0 +1,74 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "SyntheticScene.hpp"
+
+#include <splitspace/Timing.hpp>
+
+#include "json/json.hpp"
+
+#include <string>
+#include <vector>
+
+namespace splitspace {
+
+class Engine;
+class LogManager;
+class RenderManager;
+class ResourceManager;
+
+// Fixed step the scene and camera advance by, so runs are reproducible
+const float BENCH_FRAME_STEP = 1.f/60.f;
+
+struct BenchmarkCase {
+    BenchmarkCase(): deferred(false),
+                     frames(300),
+                     warmUpFrames(30),
+                     perFrame(false)
+    {}
+    // Also names the scene, must be unique in a run
+    std::string name;
+    SyntheticSceneParams scene;
+    bool deferred;
+    // Render graph of the shader library to draw with instead
+    std::string renderGraph;
+    // Measured frames, the camera makes one orbit in this many
+    int frames;
+    // Drawn first and not measured, lets shader variants and GPU queries settle
+    int warmUpFrames;
+    // Write samples of every frame besides the summaries
+    bool perFrame;
+};
+
+// Draws synthetic scenes with a scripted camera and collects CPU and
+// GPU frame times, draw calls, state changes and triangles per frame.
+// Frames are driven directly, without the engine main loop.
+class Benchmark {
+public:
+    Benchmark(Engine *e);
+
+    // Reads the "cases" array, keys a case leaves out come from "defaults"
+    bool loadCases(const std::string &path);
+    const std::vector<BenchmarkCase> &getCases() const { return m_cases; }
+
+    bool run(const BenchmarkCase &c, nlohmann::json &result);
+    // Cases that fail are logged and left out of the results
+    bool runAll(nlohmann::json &results);
+
+    // Average, min, max and percentiles of the samples
+    static nlohmann::json summarize(const TimingHistory &samples);
+
+private:
+    bool readCase(nlohmann::json &j, BenchmarkCase &c);
+
+private:
+    Engine *m_engine;
+    LogManager *m_logManager;
+    RenderManager *m_renderManager;
+    ResourceManager *m_resManager;
+    std::vector<BenchmarkCase> m_cases;
+};
+
+} // namespace splitspace
+
+#endif // BENCHMARK_HPP
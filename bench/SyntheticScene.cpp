@@ -0,0 +1,144 @@
+#include "SyntheticScene.hpp"
+
+#include <splitspace/ResourceManager.hpp>
+#include <splitspace/Scene.hpp>
+#include <splitspace/Object.hpp>
+#include <splitspace/Material.hpp>
+#include <splitspace/Mesh.hpp>
+#include <splitspace/Light.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace splitspace {
+
+static float saturate(float x) {
+    return std::min(std::max(x, 0.f), 1.f);
+}
+
+static glm::vec3 getHueColor(float hue) {
+    return glm::vec3(saturate(std::fabs(hue*6.f-3.f)-1.f),
+                     saturate(2.f-std::fabs(hue*6.f-2.f)),
+                     saturate(2.f-std::fabs(hue*6.f-4.f)));
+}
+
+SceneManifest *SyntheticScene::create(ResourceManager *rm, const std::string &name,
+                                      const SyntheticSceneParams &params) {
+    if(!rm || name.empty() || rm->getManifest(name)) {
+        return nullptr;
+    }
+
+    SceneManifest *scene = new SceneManifest;
+    scene->name = name;
+
+    std::vector<MeshManifest *> meshes;
+    for(int i = 0;i<std::max(params.meshes, 1);i++) {
+        std::string meshName = getMeshName(i);
+        MeshManifest *mesh = static_cast<MeshManifest *>(rm->getManifest(meshName));
+        if(!mesh) {
+            mesh = new MeshManifest;
+            mesh->name = meshName;
+            mesh->loadMaterial = false;
+            rm->addManifest(mesh);
+        }
+        meshes.push_back(mesh);
+    }
+
+    std::vector<MaterialManifest *> materials;
+    const int numMaterials = std::max(params.materials, 1);
+    for(int i = 0;i<numMaterials;i++) {
+        MaterialManifest *mat = new MaterialManifest;
+        mat->name = name+"_material"+std::to_string(i);
+        mat->ambient = glm::vec3(0.1f);
+        mat->diffuse = glm::vec4(getHueColor(float(i)/numMaterials), 1.f);
+        mat->specular = glm::vec3(0.5f);
+        mat->diffuseMap = nullptr;
+        mat->normalMap = nullptr;
+        mat->repeatX = mat->repeatY = 1;
+        mat->filtering = TEX_FILTER_NEAREST;
+        mat->mipmappingEnabled = false;
+        mat->usage = TEX_DIFFUSE;
+        if(!rm->addManifest(mat)) {
+            delete mat;
+            delete scene;
+            return nullptr;
+        }
+        materials.push_back(mat);
+    }
+
+    for(int i = 0;i<params.objects;i++) {
+        ObjectManifest *obj = new ObjectManifest;
+        obj->name = name+"_object"+std::to_string(i);
+        obj->meshManifest = meshes[getMeshIndex(params, i)];
+        obj->materialManifest = materials[getMaterialIndex(params, i)];
+        obj->pos = getObjectPosition(params, i);
+        obj->rot = glm::vec3(0);
+        obj->scale = glm::vec3(1);
+        if(!rm->addManifest(obj)) {
+            delete obj;
+            delete scene;
+            return nullptr;
+        }
+        scene->objects.push_back(obj);
+    }
+
+    const float radius = getRadius(params);
+    for(int i = 0;i<params.lights;i++) {
+        float a = 2.f*glm::pi<float>()*i/params.lights;
+        LightManifest *light = new LightManifest;
+        light->name = name+"_light"+std::to_string(i);
+        light->lightType = LIGHT_POINT;
+        light->pos = glm::vec3(std::cos(a)*radius*0.5f, 2.f, std::sin(a)*radius*0.5f);
+        light->rot = glm::vec3(0);
+        light->scale = glm::vec3(1);
+        light->diffuse = getHueColor(float(i)/params.lights);
+        light->specular = glm::vec3(1.f);
+        light->power = 1.f;
+        light->attenuation = glm::vec3(1.f, 0.09f, 0.032f);
+        if(!rm->addManifest(light)) {
+            delete light;
+            delete scene;
+            return nullptr;
+        }
+        scene->lights.push_back(light);
+    }
+
+    if(!rm->addManifest(scene)) {
+        delete scene;
+        return nullptr;
+    }
+    return scene;
+}
+
+int SyntheticScene::getGridSide(int objects) {
+    int side = 1;
+    while(side*side<objects) {
+        side++;
+    }
+    return side;
+}
+
+float SyntheticScene::getRadius(const SyntheticSceneParams &params) {
+    return 0.5f*(getGridSide(params.objects)-1)*params.spacing;
+}
+
+glm::vec3 SyntheticScene::getObjectPosition(const SyntheticSceneParams &params, int i) {
+    int side = getGridSide(params.objects);
+    float r = getRadius(params);
+    return glm::vec3((i%side)*params.spacing-r, 0.f, (i/side)*params.spacing-r);
+}
+
+std::string SyntheticScene::getMeshName(int mesh) {
+    return "__sphere_"+std::to_string(MESH_SPHERE_MIN_SEGMENTS*(mesh+2))+"__";
+}
+
+int SyntheticScene::getMeshIndex(const SyntheticSceneParams &params, int i) {
+    return i%std::max(params.meshes, 1);
+}
+
+int SyntheticScene::getMaterialIndex(const SyntheticSceneParams &params, int i) {
+    return (i/std::max(params.meshes, 1))%std::max(params.materials, 1);
+}
+
+} // namespace splitspace
@@ -0,0 +1,51 @@
+#ifndef SYNTHETIC_SCENE_HPP
+#define SYNTHETIC_SCENE_HPP
+
+#include <glm/vec3.hpp>
+
+#include <string>
+
+namespace splitspace {
+
+class ResourceManager;
+struct SceneManifest;
+
+struct SyntheticSceneParams {
+    SyntheticSceneParams(): objects(1000),
+                            meshes(4),
+                            materials(16),
+                            lights(8),
+                            spacing(2.f)
+    {}
+    int objects;
+    // Generated spheres of increasing detail
+    int meshes;
+    // Untextured, each of its own colour
+    int materials;
+    // Point lights circling above the objects
+    int lights;
+    // Distance between neighbouring objects
+    float spacing;
+};
+
+// Builds scene manifests from parameters instead of a scene file.
+// Objects are laid out on a square grid in the XZ plane, meshes and
+// materials are spread so that neighbours rarely share both.
+class SyntheticScene {
+public:
+    // Manifests are named after the scene and owned by the resource manager
+    static SceneManifest *create(ResourceManager *rm, const std::string &name,
+                                 const SyntheticSceneParams &params);
+
+    static int getGridSide(int objects);
+    // Half of the grid extent along X and Z
+    static float getRadius(const SyntheticSceneParams &params);
+    static glm::vec3 getObjectPosition(const SyntheticSceneParams &params, int i);
+    static std::string getMeshName(int mesh);
+    static int getMeshIndex(const SyntheticSceneParams &params, int i);
+    static int getMaterialIndex(const SyntheticSceneParams &params, int i);
+};
+
+} // namespace splitspace
+
+#endif // SYNTHETIC_SCENE_HPP
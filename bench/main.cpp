@@ -0,0 +1,79 @@
+#include "Benchmark.hpp"
+
+#include <splitspace/Engine.hpp>
+#include <splitspace/Config.hpp>
+#include <splitspace/RenderManager.hpp>
+
+#include <GL/glew.h>
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+using json = nlohmann::json;
+using namespace splitspace;
+
+static void printUsage(const char *name) {
+    std::cerr << "Usage: " << name << " [-c engine.json] [-o results.json] cases.json" << std::endl;
+}
+
+static std::string getGLString(GLenum name) {
+    const GLubyte *str = glGetString(name);
+    return str?reinterpret_cast<const char *>(str):"";
+}
+
+int main(int argc, char **argv) {
+    std::string engineConfig = "data/main.json";
+    std::string output;
+    std::string cases;
+    for(int i = 1;i<argc;i++) {
+        if(!std::strcmp(argv[i], "-c") && i+1<argc) {
+            engineConfig = argv[++i];
+        } else if(!std::strcmp(argv[i], "-o") && i+1<argc) {
+            output = argv[++i];
+        } else if(argv[i][0]!='-' && cases.empty()) {
+            cases = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(cases.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Engine engine;
+    if(!engine.init(engineConfig)) {
+        std::cerr << "Failed to init engine" << std::endl;
+        return 1;
+    }
+
+    Benchmark bench(&engine);
+    if(!bench.loadCases(cases)) {
+        return 1;
+    }
+
+    json results;
+    bool ok = bench.runAll(results);
+
+    json report;
+    report["renderer"] = getGLString(GL_RENDERER);
+    report["glVersion"] = getGLString(GL_VERSION);
+    report["width"] = engine.config->window.width;
+    report["height"] = engine.config->window.height;
+    report["headless"] = engine.renderManager->isHeadless();
+    report["cases"] = results;
+
+    if(output.empty()) {
+        std::cout << report.dump(4) << std::endl;
+    } else {
+        std::ofstream out(output);
+        if(!out.is_open()) {
+            std::cerr << "Error opening " << output << std::endl;
+            return 1;
+        }
+        out << report.dump(4) << std::endl;
+    }
+    return ok?0:1;
+}
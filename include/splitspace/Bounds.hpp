@@ -0,0 +1,77 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
+
+#include <cstddef>
+
+namespace splitspace {
+
+struct AABB {
+    AABB(): min(0), max(0)
+    {}
+    AABB(const glm::vec3 &mn, const glm::vec3 &mx): min(mn), max(mx)
+    {}
+
+    glm::vec3 getCenter() const { return (min+max)*0.5f; }
+    glm::vec3 getExtents() const { return (max-min)*0.5f; }
+    float getSurfaceArea() const;
+
+    void merge(const AABB &b);
+    void merge(const glm::vec3 &p);
+    bool intersects(const AABB &b) const;
+    bool operator==(const AABB &b) const { return min == b.min && max == b.max; }
+    bool operator!=(const AABB &b) const { return !(*this == b); }
+
+    // Bounds of the box transformed by affine matrix m
+    AABB transform(const glm::mat4 &m) const;
+
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+struct BoundingSphere {
+    BoundingSphere(): center(0), radius(0)
+    {}
+    BoundingSphere(const glm::vec3 &c, float r): center(c), radius(r)
+    {}
+
+    // Conservative for non-uniform scale
+    BoundingSphere transform(const glm::mat4 &m) const;
+
+    glm::vec3 center;
+    float radius;
+};
+
+enum FrustumPlane {
+    FRUSTUM_LEFT,
+    FRUSTUM_RIGHT,
+    FRUSTUM_BOTTOM,
+    FRUSTUM_TOP,
+    FRUSTUM_NEAR,
+    FRUSTUM_FAR,
+
+    FRUSTUM_NUM_PLANES
+};
+
+// Planes point inwards, xyz is unit normal and w the distance,
+// so dot(plane.xyz, p)+plane.w is a signed distance to the plane
+struct Frustum {
+    void extract(const glm::mat4 &viewProj);
+
+    bool intersects(const BoundingSphere &s) const;
+    bool intersects(const AABB &b) const;
+
+    glm::vec4 planes[FRUSTUM_NUM_PLANES];
+};
+
+// Positions are read with given stride in bytes
+AABB computeAABB(const void *positions, std::size_t count, std::size_t stride);
+BoundingSphere computeBoundingSphere(const void *positions, std::size_t count,
+                                     std::size_t stride);
+
+} // namespace splitspace
+
+#endif // BOUNDS_HPP
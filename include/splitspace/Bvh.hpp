@@ -0,0 +1,79 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <splitspace/Bounds.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+struct BvhNode {
+    AABB bounds;
+    // Interior nodes: index of the left child, right one follows it.
+    // Leaves: index of the first item in the item list
+    std::uint32_t first;
+    std::uint32_t count;
+    std::uint32_t parent;
+
+    bool isLeaf() const { return count>0; }
+};
+
+// Bounding volume hierarchy over item AABBs. Items are identified
+// by their index in the array passed to build().
+//
+// Built top-down with binned SAH; moved items are refitted in place,
+// which keeps the topology, so quality is tracked as SAH cost relative
+// to the one right after build.
+class Bvh {
+public:
+    Bvh();
+
+    void build(const std::vector<AABB> &bounds);
+    void clear();
+
+    // Changes bounds of the item, tree is fixed up by refit()
+    void update(std::uint32_t item, const AABB &bounds);
+    // Returns number of nodes whose bounds changed
+    std::size_t refit();
+
+    float getCost() const;
+    float getBuildCost() const { return m_buildCost; }
+    bool needsRebuild(float maxCostRatio = 1.5f) const;
+
+    // Items fully inside go to `inside`, items of leaves crossing
+    // the frustum go to `partial` and still need a precise test
+    void cullFrustum(const Frustum &f, std::vector<std::uint32_t> &inside,
+                     std::vector<std::uint32_t> &partial) const;
+    void query(const AABB &box, std::vector<std::uint32_t> &items) const;
+
+    std::size_t getNumItems() const { return m_itemBounds.size(); }
+    std::size_t getNumNodes() const { return m_nodes.size(); }
+    const std::vector<BvhNode> &getNodes() const { return m_nodes; }
+    const AABB &getItemBounds(std::uint32_t item) const { return m_itemBounds[item]; }
+    bool empty() const { return m_nodes.empty(); }
+
+private:
+    void buildNode(std::uint32_t node, std::uint32_t begin, std::uint32_t end,
+                   const std::vector<glm::vec3> &centroids);
+    void makeLeaf(std::uint32_t node, std::uint32_t begin, std::uint32_t end);
+    void collectLeaves(std::uint32_t node, std::vector<std::uint32_t> &items) const;
+    void setNodeBounds(std::uint32_t node, const AABB &bounds);
+    float getNodeCost(const BvhNode &n) const;
+
+private:
+    std::vector<BvhNode> m_nodes;
+    std::vector<std::uint32_t> m_items;
+    std::vector<AABB> m_itemBounds;
+    std::vector<std::uint32_t> m_itemLeaf;
+    std::vector<std::uint32_t> m_dirtyLeaves;
+    std::vector<std::uint8_t> m_leafDirty;
+
+    // Sum of area*cost of every node, kept up to date by refit
+    double m_areaCost;
+    float m_buildCost;
+};
+
+} // namespace splitspace
+
+#endif // BVH_HPP
@@ -1,6 +1,8 @@
 #ifndef CAMERA_HPP
 #define CAMERA_HPP
 
+#include <splitspace/Bounds.hpp>
+
 #include <glm/matrix.hpp>
 
 namespace splitspace {
@@ -18,12 +20,20 @@ public:
     void setRotation(const glm::vec3 &rot) { m_rotation = rot; }
 
     const glm::mat4 &getVP() const { return m_viewProj; }
+    const glm::mat4 &getView() const { return m_viewMat; }
+    const glm::mat4 &getProj() const { return m_projMat; }
     const glm::vec3 &getPosition() const { return m_position; }
     const glm::vec3 &getRotation() const { return m_rotation; }
+    float getNear() const { return m_near; }
+    float getFar() const { return m_far; }
+    // World space planes of the view frustum, updated with VP
+    const Frustum &getFrustum() const { return m_frustum; }
 
 protected:
     glm::mat4 m_viewProj;
+    glm::mat4 m_viewMat;
     glm::mat4 m_projMat;
+    Frustum m_frustum;
     glm::vec3 m_position;
     glm::vec3 m_rotation;
 
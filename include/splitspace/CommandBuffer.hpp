@@ -0,0 +1,66 @@
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include <glm/matrix.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+class Material;
+
+enum CommandType {
+    CMD_BIND_PROGRAM,
+    CMD_BIND_VERTEX_ARRAY,
+    CMD_SET_MATERIAL,
+    CMD_SET_MATRIX,
+    CMD_SET_DEPTH_WRITE,
+    CMD_DRAW,
+    CMD_DRAW_INSTANCED
+};
+
+struct Command {
+    CommandType type;
+    // Handle, uniform slot, vertex count or flag
+    std::uint32_t arg0;
+    // Instance count or index of the matrix payload
+    std::uint32_t arg1;
+    const Material *material;
+};
+
+// List of render commands recorded without touching the graphics API,
+// so slices of a frame can be recorded on any thread. The thread owning
+// the context replays them in order. Handles and uniform slots are
+// opaque to the buffer, their meaning is up to the replaying side.
+class CommandBuffer {
+public:
+    CommandBuffer();
+
+    void clear();
+
+    void bindProgram(std::uint32_t program);
+    void bindVertexArray(std::uint32_t vao);
+    void setMaterial(const Material *material);
+    void setMatrix(std::uint32_t slot, const glm::mat4 &m);
+    void setDepthWrite(bool enabled);
+    void draw(std::uint32_t numVerts);
+    void drawInstanced(std::uint32_t numVerts, std::uint32_t numInstances);
+
+    const std::vector<Command> &getCommands() const { return m_commands; }
+    const glm::mat4 &getMatrix(std::uint32_t index) const { return m_matrices[index]; }
+    std::size_t size() const { return m_commands.size(); }
+    bool empty() const { return m_commands.empty(); }
+
+private:
+    void push(CommandType type, std::uint32_t arg0, std::uint32_t arg1 = 0,
+              const Material *material = nullptr);
+
+private:
+    std::vector<Command> m_commands;
+    std::vector<glm::mat4> m_matrices;
+};
+
+} // namespace splitspace
+
+#endif // COMMAND_BUFFER_HPP
@@ -14,6 +14,9 @@ struct WindowConfig {
     bool fullscreen;
     std::string caption;
     bool vsync;
+    // No window, the GL context comes from EGL and frames
+    // are drawn into an offscreen framebuffer of the same size
+    bool headless;
 };
 
 struct LoggingConfig {
@@ -21,6 +24,40 @@ struct LoggingConfig {
     std::string logFile;
 };
 
+struct RenderConfig {
+    // Skip objects hidden last frame with GPU occlusion queries
+    bool occlusionQueries;
+    // Cull and draw opaque objects from compute shaders on GL 4.3+
+    bool gpuCulling;
+    // Bin local lights into view frustum clusters for shaders reading
+    // them from texture buffers
+    bool clusteredLights;
+    // GL context lives on its own thread fed with prepared frames,
+    // takes over from loop.pipelined
+    bool renderThread;
+    // Directory for linked program binaries, empty disables the cache
+    std::string programCache;
+    // Render at a fraction of the window size picked from GPU frame
+    // times, then upscale to the window
+    bool dynamicResolution;
+    float minResolutionScale;
+    float maxResolutionScale;
+    // GPU milliseconds per frame the scale aims at
+    float targetFrameTime;
+    // "bilinear" or "sharpen"
+    std::string upscaleFilter;
+};
+
+struct LoopConfig {
+    // Simulation step in seconds
+    float timestep;
+    // Steps simulated per frame at most when catching up
+    int maxSteps;
+    // Simulate the next frame on a worker while the current one is drawn,
+    // update listeners then run off the GL thread
+    bool pipelined;
+};
+
 class Config {
 public:
     Config();
@@ -30,6 +67,8 @@ public:
     
     WindowConfig window;
     LoggingConfig log;
+    RenderConfig render;
+    LoopConfig loop;
 
     std::vector<std::string> scenes;
     std::vector<std::string> matLibs;
@@ -38,6 +77,8 @@ public:
 private:
     void fillDefaultWindow();
     void fillDefaultLog();
+    void fillDefaultRender();
+    void fillDefaultLoop();
 
 };
 
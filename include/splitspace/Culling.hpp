@@ -0,0 +1,45 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <splitspace/Bounds.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+// Tests batches of bounding spheres against a frustum.
+// Spheres are kept in SoA form so the kernel checks
+// 8 (AVX) or 4 (SSE) of them against a plane at once.
+class FrustumCuller {
+public:
+    FrustumCuller();
+
+    void clear();
+    // Returns index of the sphere in the batch
+    std::size_t add(const BoundingSphere &s);
+    std::size_t size() const { return m_count; }
+
+    // Fills visibility flag for every added sphere,
+    // returns number of visible ones
+    std::size_t cull(const Frustum &f);
+
+    bool isVisible(std::size_t i) const { return m_visible[i]!=0; }
+
+    static int getBatchWidth();
+
+private:
+    void cullScalar(const Frustum &f, std::size_t begin);
+
+private:
+    std::size_t m_count;
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<float> m_radius;
+    std::vector<std::uint8_t> m_visible;
+};
+
+} // namespace splitspace
+
+#endif // CULLING_HPP
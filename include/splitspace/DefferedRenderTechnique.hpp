@@ -9,29 +9,60 @@ namespace splitspace {
 
 class Material;
 class Mesh;
+class Light;
+class RenderManager;
 
+// First pass writes albedo with specular intensity in alpha and
+// octahedral-encoded world normal, position comes from depth.
+// Light is accumulated in its own target, depth-tested against a copy
+// of the G-buffer depth so the original can be sampled meanwhile.
 enum GBUfferTarget {
-    GBUFFER_POSITION,
+    GBUFFER_ALBEDO_SPEC,
     GBUFFER_NORMAL,
-    GBUFFER_COLOR,
+    GBUFFER_LIGHT,
 
     GBUFFER_NUM_TARGETS
 };
 
+// Texture units G-buffer is sampled from in the lighting pass
+enum GBufferUnit {
+    GBUFFER_UNIT_ALBEDO_SPEC,
+    GBUFFER_UNIT_NORMAL,
+    GBUFFER_UNIT_DEPTH
+};
+
 class GBuffer {
 public:
+    GBuffer(RenderManager *rm);
+
     bool init(int w, int h);
 
+    // Geometry pass targets
     void bindWrite();
+    // Light accumulation target with the w x h corner of the geometry
+    // depth copied in, G-buffer is bound for sampling
+    void bindLighting(int w, int h);
     void bindRead();
+    // Copies accumulated light to the default framebuffer
+    void blitToScreen();
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    GLuint getTarget(GBUfferTarget target) const { return m_buffers[target]; }
 
     void destroy();
 
 private:
+    RenderManager *m_renderManager;
     GLuint m_buffers[GBUFFER_NUM_TARGETS];
 
     GLuint m_depthBuffer;
     GLuint m_fbo;
+    // Stencil of light volumes lives here as well
+    GLuint m_lightDepth;
+    GLuint m_lightFbo;
+    int m_width;
+    int m_height;
 };
 
 class DefferedRenderTechnique: public RenderTechnique {
@@ -41,13 +72,48 @@ public:
 
     bool init();
     void update(float dt);
-    void render();
     void destroy();
 
+    // What the light shaders do to get a world position from depth. NDC
+    // span the render viewport, which is a corner of the G-buffer below
+    // full scale, G-buffer texels are fetched at fragCoord/G-buffer size.
+    static glm::vec3 reconstructPosition(const glm::mat4 &invViewProj, const glm::vec2 &fragCoord,
+                                         float depth, const glm::vec2 &viewportSize);
+
+protected:
+    void render();
+    Shader *getSceneShader() const;
+
+private:
+    struct LightProgram {
+        GLuint program;
+        GLint mvp;
+        GLint invViewProj;
+        GLint gbufferSize;
+        GLint viewportSize;
+        GLint lightIndex;
+    };
+
+    bool createLightProgram(LightProgram &p, const char *fsSrc);
+    void setupLightProgram(const LightProgram &p, const glm::mat4 &mvp);
+    void renderLights();
+    // Lights [first; first+count) are in the light block from index 0
+    void renderLightBatch(std::size_t first, std::size_t count);
+    void drawVolume(const LightProgram &p, const glm::mat4 &mvp, int lightIndex);
+
 private:
     GBuffer *m_gbuffer;
     Shader *m_firstPass;
-    Shader *m_secondPass;
+
+    // Full-screen pass for ambient and sun lights
+    LightProgram m_ambientProgram;
+    // Point and spot lights, drawn as stencil-tested volumes
+    LightProgram m_volumeProgram;
+    LightProgram m_stencilProgram;
+
+    Mesh *m_volumeMesh;
+    GLuint m_screenVao;
+    GLuint m_screenVbo;
 };
 
 } // namepsace splitspace
@@ -0,0 +1,53 @@
+#ifndef DYNAMIC_RESOLUTION_HPP
+#define DYNAMIC_RESOLUTION_HPP
+
+namespace splitspace {
+
+// Scales change in steps, small changes are not worth the blur they cause
+const float RESOLUTION_SCALE_STEP = 0.05f;
+// Fraction of the target frame time the scale aims at after a change
+const float RESOLUTION_HEADROOM = 0.9f;
+const float RESOLUTION_SMOOTHING = 0.1f;
+
+// Picks the fraction of full resolution to render at from measured GPU
+// frame times. Frames over budget lower the scale at once, by the ratio
+// of the time it takes, assuming GPU time follows the pixel count.
+// The scale goes up one step at a time, once the average says the next
+// step still fits. Results of frames drawn before a change are skipped.
+class DynamicResolution {
+public:
+    // latency is how many frames late GPU times arrive
+    DynamicResolution(float minScale, float maxScale, float targetMs, int latency = 0);
+
+    // GPU time of the oldest frame not yet reported
+    void addFrameTime(double gpuMs);
+
+    float getScale() const { return m_scale; }
+    float getMinScale() const { return m_minScale; }
+    float getMaxScale() const { return m_maxScale; }
+    float getTargetTime() const { return m_targetMs; }
+    // Changes of the scale so far
+    int getNumChanges() const { return m_numChanges; }
+
+    // Size of a full size target at the current scale, at least 1x1
+    void getSize(int fullW, int fullH, int &w, int &h) const;
+    // Size of a full size target at the largest scale
+    void getMaxSize(int fullW, int fullH, int &w, int &h) const;
+
+private:
+    void setScale(float scale);
+
+private:
+    float m_minScale;
+    float m_maxScale;
+    float m_targetMs;
+    int m_latency;
+    float m_scale;
+    double m_average;
+    int m_skipFrames;
+    int m_numChanges;
+};
+
+} // namespace splitspace
+
+#endif // DYNAMIC_RESOLUTION_HPP
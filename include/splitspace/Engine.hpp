@@ -1,6 +1,8 @@
 #ifndef ENGINE_HPP
 #define ENGINE_HPP
 
+#include <splitspace/Timing.hpp>
+
 #include <string>
 
 namespace splitspace {
@@ -14,6 +16,7 @@ class SceneManager;
 class ResourceManager;
 class RenderManager;
 class PhysicsManager;
+class JobManager;
 class Config;
 
 class Engine {
@@ -21,7 +24,7 @@ public:
     Engine();
     ~Engine();
 
-    bool init();
+    bool init(const std::string &configPath = "data/main.json");
 
     void mainLoop();
 
@@ -29,8 +32,13 @@ public:
 
     void logStats();
 
+    // Interpolation alpha of the frame being rendered
+    float getAlpha() const { return m_alpha; }
+    const TimingHistory &getFrameTimes() const { return m_frameTimes; }
+
 private:
     bool initLog();
+    bool initJobs();
     bool initEvents();
     bool initWindow();
     bool initResources();
@@ -47,13 +55,16 @@ public:
     ResourceManager *resManager;
     RenderManager *renderManager;
     PhysicsManager *physManager;
+    JobManager *jobManager;
 
     Config *config;
 
 private:
     bool m_quit;
-    float m_avgFrameTime;
+    float m_alpha;
     int m_totalFrames;
+    TimingHistory m_frameTimes;
+    std::uint64_t m_droppedSteps;
 
 
 };
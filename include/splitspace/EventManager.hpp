@@ -65,12 +65,23 @@ struct MouseEvent: public Event {
     KeyState state;
 };
 
+// Emitted once per fixed simulation step, times are in seconds.
+// With loop.pipelined set listeners run on a job worker thread while
+// the previous frame is drawn, so they must not touch GL state.
 struct UpdateEvent: public Event {
-    UpdateEvent(float dt):
+    UpdateEvent(float dt, float frameDt = 0, float a = 0):
           Event(EV_UPDATE, EVM_GAME),
-          delta(dt)
+          delta(dt),
+          frameDelta(frameDt),
+          alpha(a)
     {}
+    // Fixed simulation step
     float delta;
+    // Real time since the previous frame
+    float frameDelta;
+    // Fraction of a step carried over to the next frame, rendering
+    // may interpolate between the last two steps with it
+    float alpha;
 };
 
 class EventListener {
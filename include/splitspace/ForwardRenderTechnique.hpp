@@ -2,12 +2,22 @@
 #define FWD_RENDER_TECHNIQUE_HPP
 
 #include <splitspace/RenderTechnique.hpp>
+#include <splitspace/LightClusters.hpp>
+#include <splitspace/UniformBuffers.hpp>
 
 namespace splitspace {
 
 class Material;
 class Mesh;
 
+enum ClusterBuffer {
+    CLUSTER_BUFFER_LIGHTS,
+    CLUSTER_BUFFER_GRID,
+    CLUSTER_BUFFER_INDICES,
+
+    CLUSTER_NUM_BUFFERS
+};
+
 class ForwardRenderTechnique: public RenderTechnique {
 public:
     ForwardRenderTechnique(Engine *e);
@@ -15,11 +25,40 @@ public:
 
     bool init();
     void update(float dt);
-    void render();
     void destroy();
 
+protected:
+    void render();
+    Shader *getSceneShader() const;
+
+private:
+    bool initClusters();
+    void destroyClusters();
+    // Bins scene lights and uploads them for the current camera
+    void updateClusters();
+    bool uploadClusterBuffer(ClusterBuffer b, const void *data, std::size_t size);
+
+    // Color and depth-stencil of the maximum size, drawn to instead
+    // of the screen with dynamic resolution
+    bool createSceneTarget();
+    void destroySceneTarget();
+    void drawScene();
+
 private:
     Shader *m_shader;
+
+    bool m_clusteredLights;
+    LightClusterer m_clusterer;
+    glm::mat4 m_clusterProj;
+    std::vector<LightUniforms> m_clusterLights;
+    std::size_t m_maxClusterTexels;
+    GLuint m_clusterBuffers[CLUSTER_NUM_BUFFERS];
+    GLuint m_clusterTextures[CLUSTER_NUM_BUFFERS];
+    std::size_t m_clusterCapacity[CLUSTER_NUM_BUFFERS];
+
+    GLuint m_sceneFbo;
+    GLuint m_sceneColor;
+    GLuint m_sceneDepth;
 };
 
 } // namespace splitspace
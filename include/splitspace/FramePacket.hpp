@@ -0,0 +1,55 @@
+#ifndef FRAME_PACKET_HPP
+#define FRAME_PACKET_HPP
+
+#include <splitspace/RenderQueue.hpp>
+#include <splitspace/UniformBuffers.hpp>
+#include <splitspace/Bounds.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+// Packets in flight, one simulated while the other is drawn
+const int FRAME_PACKETS = 2;
+
+// Camera state a frame is rendered with
+struct FrameView {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    Frustum frustum;
+    glm::vec3 position;
+    float near;
+    float far;
+};
+
+// Everything the render side reads to submit one frame, captured from the
+// scene when its simulation is done. Render items point into worlds, so the
+// scene may already be updated for the next frame while this one is drawn.
+struct FramePacket {
+    FramePacket(): frame(0),
+                   valid(false),
+                   numVisible(0),
+                   numCulled(0),
+                   numOccluded(0)
+    {}
+
+    std::uint64_t frame;
+    // False until a scene and camera were captured
+    bool valid;
+
+    FrameView view;
+    std::vector<LightUniforms> lights;
+    // Indexed like the scene render list
+    std::vector<glm::mat4> worlds;
+    RenderQueue queue;
+
+    std::size_t numVisible;
+    std::size_t numCulled;
+    std::size_t numOccluded;
+};
+
+} // namespace splitspace
+
+#endif // FRAME_PACKET_HPP
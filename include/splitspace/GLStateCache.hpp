@@ -0,0 +1,99 @@
+#ifndef GL_STATE_CACHE_HPP
+#define GL_STATE_CACHE_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstdint>
+
+namespace splitspace {
+
+const int GL_STATE_MAX_TEXTURE_UNITS = 16;
+const int GL_STATE_MAX_UNIFORM_BUFFERS = 8;
+
+// Shadow copy of GL binding state. Calls which would not change
+// the state are skipped, so all binds must go through the cache
+// once it is in use.
+class GLStateCache {
+public:
+    GLStateCache();
+
+    // Forgets everything, next call of each kind reaches GL
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindTexture(int unit, GLenum target, GLuint texture);
+    void bindSampler(int unit, GLuint sampler);
+    // GL_FRAMEBUFFER binds both draw and read targets
+    void bindFramebuffer(GLenum target, GLuint fbo);
+    void bindUniformBuffer(GLuint index, GLuint buffer);
+    void bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    void setBlend(bool enabled);
+    void setBlendFunc(GLenum src, GLenum dst);
+    void setDepthTest(bool enabled);
+    void setDepthMask(bool enabled);
+    void setDepthFunc(GLenum func);
+    void setCullFace(bool enabled);
+    void setCullFaceMode(GLenum mode);
+    void setStencilTest(bool enabled);
+    // Same mask for all color channels
+    void setColorMask(bool enabled);
+
+    // Deleted names may be reused by GL for new objects
+    void onDeleteProgram(GLuint program);
+    void onDeleteVertexArray(GLuint vao);
+    void onDeleteTexture(GLuint texture);
+    void onDeleteSampler(GLuint sampler);
+    void onDeleteFramebuffer(GLuint fbo);
+    void onDeleteBuffer(GLuint buffer);
+
+    void beginFrame();
+    std::uint64_t getFrameIssued() const { return m_frameIssued; }
+    std::uint64_t getFrameSkipped() const { return m_frameSkipped; }
+    std::uint64_t getTotalIssued() const { return m_totalIssued; }
+    std::uint64_t getTotalSkipped() const { return m_totalSkipped; }
+
+private:
+    bool changed(GLuint &cached, GLuint value);
+    void setCap(GLenum cap, GLuint &cached, bool enabled);
+    void activeTexture(int unit);
+
+private:
+    struct UniformBufferBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLuint m_program;
+    GLuint m_vao;
+    GLuint m_activeUnit;
+    GLuint m_textures[GL_STATE_MAX_TEXTURE_UNITS];
+    GLuint m_textureTargets[GL_STATE_MAX_TEXTURE_UNITS];
+    GLuint m_samplers[GL_STATE_MAX_TEXTURE_UNITS];
+    GLuint m_drawFramebuffer;
+    GLuint m_readFramebuffer;
+    UniformBufferBinding m_uniformBuffers[GL_STATE_MAX_UNIFORM_BUFFERS];
+
+    GLuint m_blend;
+    GLuint m_blendSrc;
+    GLuint m_blendDst;
+    GLuint m_depthTest;
+    GLuint m_depthMask;
+    GLuint m_depthFunc;
+    GLuint m_cullFace;
+    GLuint m_cullFaceMode;
+    GLuint m_colorMask;
+    GLuint m_stencilTest;
+
+    std::uint64_t m_frameIssued;
+    std::uint64_t m_frameSkipped;
+    std::uint64_t m_totalIssued;
+    std::uint64_t m_totalSkipped;
+};
+
+} // namespace splitspace
+
+#endif // GL_STATE_CACHE_HPP
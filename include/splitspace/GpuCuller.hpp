@@ -0,0 +1,125 @@
+#ifndef GPU_CULLER_HPP
+#define GPU_CULLER_HPP
+
+#include <splitspace/Bounds.hpp>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/matrix.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+class Engine;
+class RenderManager;
+class LogManager;
+class Object;
+class Material;
+class Mesh;
+
+const int GPU_CULL_GROUP_SIZE = 64;
+// Instance counts are read back this many frames after culling
+const int GPU_CULL_READBACK_FRAMES = 3;
+
+// GPU-driven frustum culling for GL 4.3+. Bounds and transforms of
+// opaque objects stay in a storage buffer, only objects whose bounds
+// changed are uploaded again. A compute shader appends transforms of
+// visible objects to the instance range of their bucket and counts
+// them into an indirect draw command, one per material and mesh.
+class GpuCuller {
+public:
+    GpuCuller(Engine *e);
+    ~GpuCuller();
+
+    static bool isSupported();
+
+    bool init();
+    void destroy();
+
+    // Rebuilds buckets if the list or the material, mesh or transparency
+    // of an object changed, uploads moved objects otherwise
+    void update(const std::vector<const Object *> &objects);
+    void cull(const Frustum &frustum);
+
+    std::size_t getNumBuckets() const { return m_buckets.size(); }
+    const Material *getBucketMaterial(std::size_t bucket) const { return m_buckets[bucket].material; }
+    void drawBucket(std::size_t bucket);
+
+    // Indices of transparent objects, they need sorting on the CPU
+    const std::vector<std::uint32_t> &getTransparentItems() const { return m_transparentItems; }
+    std::size_t getNumObjects() const { return m_gpuObjects.size(); }
+    // Of the latest frame read back, GPU_CULL_READBACK_FRAMES behind
+    std::size_t getNumVisible() const { return m_numVisible; }
+    std::size_t getNumCulled() const { return m_numCulled; }
+
+private:
+    // std430 layout of objects in the compute shader
+    struct CullObject {
+        glm::vec4 sphere;
+        glm::mat4 world;
+        std::uint32_t bucket;
+        std::uint32_t pad[3];
+    };
+
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    struct Bucket {
+        const Material *material;
+        const Mesh *mesh;
+    };
+
+    // What an object's bucket was picked from
+    struct ObjectState {
+        const Material *material;
+        const Mesh *mesh;
+        bool transparent;
+    };
+
+    static ObjectState getState(const Object *o);
+    bool stateChanged(const std::vector<const Object *> &objects) const;
+    void rebuild(const std::vector<const Object *> &objects);
+    void fillObject(CullObject &co, const Object *o, std::uint32_t bucket);
+    void destroyBuffers();
+    // Copies this frame's commands and reads the oldest copy if the GPU is done with it
+    void readBack();
+
+private:
+    RenderManager *m_renderManager;
+    LogManager *m_logManager;
+
+    GLuint m_program;
+    GLint m_planesLocation;
+    GLint m_numObjectsLocation;
+
+    GLuint m_objectBuffer;
+    GLuint m_commandBuffer;
+    GLuint m_instanceBuffer;
+
+    std::vector<const Object *> m_objects;
+    std::vector<unsigned> m_boundsVersions;
+    std::vector<ObjectState> m_objectStates;
+    // Render list index of each object in the object buffer
+    std::vector<std::uint32_t> m_gpuObjects;
+    std::vector<CullObject> m_cullObjects;
+    std::vector<std::uint32_t> m_transparentItems;
+    std::vector<Bucket> m_buckets;
+    std::vector<DrawCommand> m_commands;
+
+    GLuint m_readbackBuffers[GPU_CULL_READBACK_FRAMES];
+    GLsync m_readbackFences[GPU_CULL_READBACK_FRAMES];
+    std::uint64_t m_frame;
+    std::vector<DrawCommand> m_readbackCommands;
+    std::size_t m_numVisible;
+    std::size_t m_numCulled;
+};
+
+} // namespace splitspace
+
+#endif // GPU_CULLER_HPP
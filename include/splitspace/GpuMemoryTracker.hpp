@@ -0,0 +1,65 @@
+#ifndef GPU_MEMORY_TRACKER_HPP
+#define GPU_MEMORY_TRACKER_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+namespace splitspace {
+
+enum GpuMemoryCategory {
+    GPU_MEM_TEXTURE,
+    GPU_MEM_RENDERTARGET,
+    GPU_MEM_VERTEX_BUFFER,
+    GPU_MEM_INDEX_BUFFER,
+    GPU_MEM_UNIFORM_BUFFER,
+    GPU_MEM_STORAGE_BUFFER,
+    GPU_MEM_TEXTURE_BUFFER,
+    GPU_MEM_OTHER,
+
+    GPU_MEM_NUM_CATEGORIES
+};
+
+// Keeps CPU-side account of GPU allocations, so no GL round-trips are
+// needed to know how much memory the engine occupies. Allocations are made
+// on the GL thread while stats may be read from the main one, so every
+// call is locked.
+class GpuMemoryTracker {
+public:
+    GpuMemoryTracker();
+
+    static int getBytesPerPixel(GLenum internalFormat);
+    static int getMipLevels(int w, int h);
+    static std::uint64_t getTextureSize(GLenum internalFormat, int w, int h, int mipLevels = 1);
+
+    static const char *getCategoryName(GpuMemoryCategory c);
+
+    // Registers (or resizes) allocation of GL object `name`
+    void allocate(GpuMemoryCategory c, GLuint name, std::uint64_t bytes);
+    void release(GpuMemoryCategory c, GLuint name);
+
+    std::uint64_t getUsed(GpuMemoryCategory c) const;
+    std::uint64_t getTotalUsed() const;
+    std::uint64_t getPeakUsed() const;
+
+    std::uint64_t getResourceSize(GpuMemoryCategory c, GLuint name) const;
+    std::size_t getResourceCount(GpuMemoryCategory c) const;
+
+private:
+    // Called with m_mutex locked
+    void releaseLocked(GpuMemoryCategory c, GLuint name);
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<GLuint, std::uint64_t> m_resources[GPU_MEM_NUM_CATEGORIES];
+    std::uint64_t m_used[GPU_MEM_NUM_CATEGORIES];
+    std::uint64_t m_totalUsed;
+    std::uint64_t m_peakUsed;
+};
+
+} // namespace splitspace
+
+#endif // GPU_MEMORY_TRACKER_HPP
@@ -0,0 +1,122 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <splitspace/Timing.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace splitspace {
+
+class RenderManager;
+class LogManager;
+
+// Frames in flight, results are read this many frames late
+const int GPU_PROFILER_FRAMES = 3;
+enum PipelineStat {
+    PIPELINE_STAT_VERTICES,
+    PIPELINE_STAT_PRIMITIVES,
+    PIPELINE_STAT_FRAGMENTS,
+
+    PIPELINE_NUM_STATS
+};
+
+struct GpuPassSample {
+    std::size_t pass;
+    double ms;
+};
+
+// Measures GPU time of render passes with GL_TIMESTAMP queries.
+// Every frame uses its own set of queries, which is read back
+// GPU_PROFILER_FRAMES frames later without waiting for the GPU.
+// Passes may nest, each one is timed from its begin to its end.
+class GpuProfiler {
+public:
+    GpuProfiler(RenderManager *rm, LogManager *lm);
+    ~GpuProfiler();
+
+    // Pipeline statistics are collected when ARB_pipeline_statistics_query is there
+    bool init();
+    void destroy();
+
+    void beginFrame();
+    void endFrame();
+    // Waits for the oldest frame still in flight and reads it back,
+    // false once every frame is collected
+    bool collectOldest();
+
+    void beginPass(const std::string &name);
+    void endPass();
+
+    std::size_t getNumPasses() const { return m_passNames.size(); }
+    const std::string &getPassName(std::size_t pass) const { return m_passNames[pass]; }
+    const TimingHistory &getPassTimes(std::size_t pass) const { return m_passTimes[pass]; }
+    // nullptr if no pass of that name ran yet
+    const TimingHistory *findPassTimes(const std::string &name) const;
+    // From the start of the first pass to the end of the last
+    const TimingHistory &getFrameTimes() const { return m_frameTimes; }
+
+    bool hasPipelineStats() const { return m_pipelineStats; }
+    // Of the latest frame read back
+    std::uint64_t getPipelineStat(PipelineStat s) const { return m_lastStats[s]; }
+    // Frames whose results were not ready in time
+    std::uint64_t getDroppedFrames() const { return m_droppedFrames; }
+    // Frames whose results were read back, grows by one with every new sample
+    std::uint64_t getCollectedFrames() const { return m_collectedFrames; }
+    // Frames begun so far, the next beginFrame() is given this index
+    std::uint64_t getBegunFrames() const { return m_begunFrames; }
+    // Index of the frame the latest samples belong to
+    std::uint64_t getLastCollectedFrame() const { return m_lastCollectedFrame; }
+    // Passes timed in that frame, getPassTimes() also holds passes of older frames
+    const std::vector<GpuPassSample> &getLastFramePasses() const { return m_lastFramePasses; }
+
+    void logStats();
+
+private:
+    struct PassQuery {
+        std::size_t pass;
+        GLuint begin;
+        GLuint end;
+    };
+
+    struct FrameQueries {
+        std::vector<GLuint> timestamps;
+        std::size_t numTimestamps;
+        std::vector<PassQuery> passes;
+        GLuint stats[PIPELINE_NUM_STATS];
+        std::uint64_t frame;
+        bool pending;
+    };
+
+    GLuint timestamp(FrameQueries &f);
+    std::size_t findPass(const std::string &name);
+    void collect(FrameQueries &f, bool wait = false);
+
+private:
+    RenderManager *m_renderManager;
+    LogManager *m_logManager;
+    bool m_initialized;
+    bool m_pipelineStats;
+
+    FrameQueries m_frames[GPU_PROFILER_FRAMES];
+    int m_currentFrame;
+    std::vector<std::size_t> m_openPasses;
+
+    std::vector<std::string> m_passNames;
+    std::vector<TimingHistory> m_passTimes;
+    std::vector<GpuPassSample> m_lastFramePasses;
+    TimingHistory m_frameTimes;
+    std::uint64_t m_lastStats[PIPELINE_NUM_STATS];
+    std::uint64_t m_droppedFrames;
+    std::uint64_t m_collectedFrames;
+    std::uint64_t m_begunFrames;
+    std::uint64_t m_lastCollectedFrame;
+};
+
+} // namespace splitspace
+
+#endif // GPU_PROFILER_HPP
@@ -0,0 +1,60 @@
+#ifndef GRAPH_RENDER_TECHNIQUE_HPP
+#define GRAPH_RENDER_TECHNIQUE_HPP
+
+#include <splitspace/RenderTechnique.hpp>
+#include <splitspace/RenderGraph.hpp>
+
+#include <string>
+#include <vector>
+
+namespace splitspace {
+
+class RenderTargetPool;
+
+// Runs a render graph of the shader library. Scene passes draw the
+// render queue, all of them with one shader, fullscreen passes draw a
+// screen triangle sampling their inputs. Targets are drawn at the render
+// size times their scale, the graph upscales when writing the backbuffer.
+// Fullscreen shaders get uvScale for their texcoords and have to clamp
+// the result to uvMax, past it linear filtering reads undrawn texels.
+class GraphRenderTechnique: public RenderTechnique {
+public:
+    GraphRenderTechnique(Engine *e, const std::string &graph);
+    ~GraphRenderTechnique();
+
+    bool init();
+    void update(float dt);
+    void destroy();
+
+    const RenderGraph &getGraph() const { return m_graph; }
+
+protected:
+    void render();
+    Shader *getSceneShader() const;
+
+private:
+    bool loadShaders();
+    bool createScreenTriangle();
+    // False if the pass has no framebuffer and is skipped
+    bool bindPassTarget(const GraphPass &pass);
+    void drawScenePass();
+    void drawFullscreenPass(std::size_t index);
+
+private:
+    std::string m_graphName;
+    RenderGraph m_graph;
+    RenderTargetPool *m_pool;
+
+    // For every live pass
+    std::vector<Shader *> m_passShaders;
+    std::vector<GLint> m_uvScale;
+    std::vector<GLint> m_uvMax;
+    Shader *m_sceneShader;
+
+    GLuint m_screenVao;
+    GLuint m_screenVbo;
+};
+
+} // namespace splitspace
+
+#endif // GRAPH_RENDER_TECHNIQUE_HPP
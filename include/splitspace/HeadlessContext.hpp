@@ -0,0 +1,38 @@
+#ifndef HEADLESS_CONTEXT_HPP
+#define HEADLESS_CONTEXT_HPP
+
+#include <EGL/egl.h>
+
+namespace splitspace {
+
+class LogManager;
+
+// GL 3.3 core context created through EGL without a window or display
+// server, e.g. on Mesa llvmpipe. Uses the surfaceless platform and
+// context where available, a 1x1 pbuffer otherwise. There is no default
+// framebuffer worth drawing to, RenderManager renders into an FBO.
+class HeadlessContext {
+public:
+    HeadlessContext(LogManager *lm);
+    ~HeadlessContext();
+
+    bool init();
+    void destroy();
+
+    // On the calling thread
+    bool makeCurrent();
+    void release();
+
+private:
+    bool hasExtension(EGLDisplay display, const char *name) const;
+
+private:
+    LogManager *m_logManager;
+    EGLDisplay m_display;
+    EGLContext m_context;
+    EGLSurface m_surface;
+};
+
+} // namespace splitspace
+
+#endif // HEADLESS_CONTEXT_HPP
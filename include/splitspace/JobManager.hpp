@@ -0,0 +1,76 @@
+#ifndef JOB_MANAGER_HPP
+#define JOB_MANAGER_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace splitspace {
+
+class LogManager;
+
+// Persistent pool of worker threads for data-parallel loops and
+// a single background task.
+// The calling thread takes part in the work, so a pool with
+// no workers degrades to a plain loop.
+class JobManager {
+public:
+    typedef std::function<void (std::size_t begin, std::size_t end)> RangeFunc;
+    typedef std::function<void ()> Task;
+
+    JobManager(LogManager *logManager);
+    ~JobManager();
+
+    // numWorkers < 0 picks one less than hardware threads
+    bool init(int numWorkers = -1);
+    void destroy();
+
+    // Runs fn over [0; count) split into chunks of `grain` items,
+    // returns when all chunks are done. Nested calls run inline.
+    void parallelFor(std::size_t count, std::size_t grain, const RangeFunc &fn);
+
+    // Runs task on a worker while the caller goes on, one task at a time.
+    // The task may use parallelFor. Without workers it runs inline.
+    void runAsync(const Task &task);
+    // Returns when the task given to runAsync is done
+    void waitAsync();
+
+    // Including the calling thread
+    int getNumThreads() const { return m_workers.size()+1; }
+
+private:
+    void workerLoop();
+    void runChunks();
+
+private:
+    LogManager *m_logManager;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_submitMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_doneCond;
+    unsigned m_generation;
+    bool m_quit;
+
+    const RangeFunc *m_func;
+    std::size_t m_count;
+    std::size_t m_grain;
+    std::atomic<std::size_t> m_nextChunk;
+    std::size_t m_numChunks;
+    std::atomic<std::size_t> m_chunksDone;
+    int m_activeWorkers;
+
+    Task m_asyncTask;
+    // Set from runAsync until the task is taken by a worker
+    bool m_asyncQueued;
+    // Set from runAsync until the task is done
+    bool m_asyncBusy;
+};
+
+} // namespace splitspace
+
+#endif // JOB_MANAGER_HPP
@@ -41,6 +41,10 @@ public:
     float getPower() const { return m_power; }
     float getSpotLightCutoff() const { return m_spotLightCutoff; }
     const glm::vec3 &getAttenuation() const { return m_attenuation; }
+    // Distance at which the light drops below 1/256 of its intensity,
+    // infinity if attenuation never gets there
+    float getRange() const { return getRange(m_diffuse, m_power, m_attenuation); }
+    static float getRange(const glm::vec3 &diffuse, float power, const glm::vec3 &attenuation);
 
     void setDiffuse(const glm::vec3 &c) { m_diffuse = c; }
     void setSpecular(const glm::vec3 &c) { m_specular = c;}
@@ -0,0 +1,118 @@
+#ifndef LIGHT_CLUSTERS_HPP
+#define LIGHT_CLUSTERS_HPP
+
+#include <splitspace/Bounds.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+class JobManager;
+
+const int CLUSTER_DIM_X = 16;
+const int CLUSTER_DIM_Y = 9;
+const int CLUSTER_DIM_Z = 24;
+
+// Texture units clustered light buffers are bound to
+enum ClusterTextureUnit {
+    CLUSTER_UNIT_LIGHTS = 4,
+    CLUSTER_UNIT_GRID,
+    CLUSTER_UNIT_INDICES
+};
+
+// Bins local lights into a grid of clusters dividing the view frustum,
+// screen-space tiles in x and y and exponential depth slices in z.
+// Each depth slice is binned by one job, lights are tested against
+// cluster bounds in batches of 8 (AVX) or 4 (SSE).
+//
+// Everything is in view space, camera looks down -z.
+// Cluster (x, y, z) has index (z*dimY+y)*dimX+x.
+class LightClusterer {
+public:
+    LightClusterer(int dimX = CLUSTER_DIM_X, int dimY = CLUSTER_DIM_Y, int dimZ = CLUSTER_DIM_Z);
+
+    // Symmetric perspective projection, near and far are positive depths
+    void setProjection(const glm::mat4 &proj, float near, float far);
+
+    void clear();
+    // Returns index of the light in the batch
+    std::size_t addPointLight(const glm::vec3 &pos, float radius);
+    // cosCutoff is cosine of the half angle of the cone
+    std::size_t addSpotLight(const glm::vec3 &pos, float radius,
+                             const glm::vec3 &dir, float cosCutoff);
+    std::size_t getNumLights() const { return m_x.size(); }
+
+    // Clusters past the limit are left with less lights than they need
+    void setMaxIndices(std::size_t maxIndices) { m_maxIndices = maxIndices; }
+
+    // jobs may be null to bin on the calling thread
+    void bin(JobManager *jobs);
+
+    // -1 when the point lies outside the frustum
+    int getClusterIndex(const glm::vec3 &pos) const;
+    const AABB &getClusterBounds(int cluster) const { return m_clusterBounds[cluster]; }
+    int getNumClusters() const { return m_dimX*m_dimY*m_dimZ; }
+    int getDimX() const { return m_dimX; }
+    int getDimY() const { return m_dimY; }
+    int getDimZ() const { return m_dimZ; }
+
+    // Slice of a depth d is floor(log(d)*scale+bias)
+    float getDepthScale() const { return m_depthScale; }
+    float getDepthBias() const { return m_depthBias; }
+
+    // Offset into indices and light count of every cluster
+    const std::vector<std::uint32_t> &getGrid() const { return m_grid; }
+    const std::vector<std::uint32_t> &getIndices() const { return m_indices; }
+    std::uint32_t getOffset(int cluster) const { return m_grid[cluster*2]; }
+    std::uint32_t getCount(int cluster) const { return m_grid[cluster*2+1]; }
+
+private:
+    struct Slice {
+        // Lights touching the slice, gathered from the batch
+        std::vector<std::uint32_t> lights;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        std::vector<std::uint8_t> hits;
+        std::vector<std::uint32_t> indices;
+    };
+
+    void binSlice(int z);
+    bool coneIntersects(std::uint32_t light, const AABB &box) const;
+
+    static void testSpheres(const float *x, const float *y, const float *z, const float *r,
+                            std::size_t count, const AABB &box, std::uint8_t *hits);
+
+private:
+    int m_dimX;
+    int m_dimY;
+    int m_dimZ;
+    float m_depthScale;
+    float m_depthBias;
+    float m_scaleX;
+    float m_scaleY;
+    float m_near;
+    float m_far;
+    std::size_t m_maxIndices;
+
+    std::vector<AABB> m_clusterBounds;
+    std::vector<AABB> m_sliceBounds;
+
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<float> m_radius;
+    // Spot lights only, cutoff is -1 for point lights
+    std::vector<glm::vec3> m_dir;
+    std::vector<float> m_cosCutoff;
+
+    std::vector<Slice> m_slices;
+    std::vector<std::uint32_t> m_grid;
+    std::vector<std::uint32_t> m_indices;
+};
+
+} // namespace splitspace
+
+#endif // LIGHT_CLUSTERS_HPP
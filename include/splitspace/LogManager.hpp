@@ -3,6 +3,7 @@
 
 #include <string>
 #include <fstream>
+#include <mutex>
 
 namespace splitspace {
 
@@ -28,6 +29,8 @@ public:
 private:
     LogLevel m_logLevel;
     std::ofstream m_sink;
+    // Render and worker threads log too
+    std::mutex m_mutex;
 };
 
 } // namespace splitspace
@@ -37,6 +37,9 @@ public:
 
     Texture *getDiffuseMap() const { return m_diffuseMap; }
     Texture *getNormalMap() const { return m_normalMap; }
+    GLuint getSampler() const { return m_samplerId; }
+
+    bool isTransparent() const;
 
 private:
     Texture *m_diffuseMap;
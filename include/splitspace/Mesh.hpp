@@ -3,13 +3,20 @@
 
 #include <splitspace/Resource.hpp>
 #include <splitspace/RenderManager.hpp>
+#include <splitspace/Bounds.hpp>
 
 namespace splitspace {
 
+// "__sphere_<segments>__" names a generated UV sphere
+const int MESH_SPHERE_MIN_SEGMENTS = 4;
+
 struct MeshManifest: public ResourceManifest {
-    MeshManifest(): ResourceManifest(RES_MESH)
+    MeshManifest(): ResourceManifest(RES_MESH),
+                    keepPositions(false)
     {}
     bool loadMaterial;
+    // Keep a CPU copy of vertex positions, e.g. for occlusion culling
+    bool keepPositions;
 };
 
 class Mesh: public Resource {
@@ -25,9 +32,20 @@ public:
 
     std::size_t getNumVerts() const { return m_numVerts; }
 
+    // Model space bounds
+    const AABB &getAABB() const { return m_aabb; }
+    const BoundingSphere &getBoundingSphere() const { return m_boundingSphere; }
+
+    // Triangle list, empty unless the manifest asks to keep positions
+    const std::vector<glm::vec3> &getPositions() const { return m_positions; }
+
+    // Segments of a generated sphere name, 0 for any other name
+    static int getSphereSegments(const std::string &name);
+
 private:
     bool createPlane();
     bool createCube();
+    bool createSphere(int segments);
 
 private:
     GLuint m_vbo;
@@ -35,6 +53,10 @@ private:
     GLuint m_vao;
 
     std::size_t m_numVerts;
+
+    AABB m_aabb;
+    BoundingSphere m_boundingSphere;
+    std::vector<glm::vec3> m_positions;
 };
 
 } // namepsace splitspace
@@ -2,6 +2,7 @@
 #define OBJECT_HPP
 
 #include <splitspace/Entity.hpp>
+#include <splitspace/Bounds.hpp>
 
 namespace splitspace {
 
@@ -12,10 +13,13 @@ class Material;
 class Mesh;
 
 struct ObjectManifest: public EntityManifest {
-    ObjectManifest(): EntityManifest(RES_OBJECT)
+    ObjectManifest(): EntityManifest(RES_OBJECT),
+                      occluder(false)
     {}
     MaterialManifest *materialManifest;
     MeshManifest *meshManifest;
+    // Rasterized for CPU occlusion culling of other objects
+    bool occluder;
 };
 
 class Object: public Entity {
@@ -25,12 +29,28 @@ public:
     virtual bool load();
     virtual void unload();
 
+    virtual void update(float dt);
+
     const Mesh *getMesh() const { return m_mesh; }
     const Material *getMaterial() const { return m_material; }
+    bool isOccluder() const;
+
+    // World space bounds, refreshed with the transform
+    const AABB &getWorldAABB() const { return m_worldAABB; }
+    const BoundingSphere &getWorldBoundingSphere() const { return m_worldSphere; }
+    // Incremented whenever world bounds change
+    unsigned getBoundsVersion() const { return m_boundsVersion; }
+
+private:
+    void updateBounds();
 
 private:
     Material *m_material;
     Mesh *m_mesh;
+
+    AABB m_worldAABB;
+    BoundingSphere m_worldSphere;
+    unsigned m_boundsVersion;
 };
 
 } // namespace splitspace
@@ -0,0 +1,76 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+#include <splitspace/Bounds.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+class JobManager;
+
+const int OCCLUSION_TILE_SIZE = 32;
+
+// CPU occlusion culling. Occluder triangles are rasterized into
+// a small depth buffer split into tiles, each tile is filled by
+// one job. Bounds are tested against a max-depth pyramid built
+// on top of it.
+//
+// Depth is NDC z remapped to [0; 1], nearer is smaller.
+class OcclusionCuller {
+public:
+    // Sizes are rounded up to whole tiles
+    OcclusionCuller(int width = 256, int height = 128);
+
+    void beginFrame(const glm::mat4 &viewProj);
+
+    // Triangle list with positions read at given stride in bytes
+    void addOccluder(const void *positions, std::size_t numVerts, std::size_t stride,
+                     const glm::mat4 &world);
+
+    // jobs may be null to rasterize on the calling thread
+    void rasterize(JobManager *jobs);
+
+    bool isVisible(const AABB &worldBounds) const;
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    float getDepth(int x, int y) const { return m_hiz[0][y*m_width+x]; }
+    std::size_t getNumTriangles() const { return m_triangles.size(); }
+    std::size_t getNumLevels() const { return m_hiz.size(); }
+
+private:
+    struct Triangle {
+        // Screen space x, y in pixels and depth
+        glm::vec3 v[3];
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    void rasterizeTile(int tile);
+    void rasterizeTriangle(const Triangle &t, int x0, int y0, int x1, int y1);
+    void buildPyramid();
+
+private:
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+
+    glm::mat4 m_viewProj;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<std::uint32_t>> m_tileBins;
+
+    // Level 0 is the depth buffer, each next one keeps
+    // the farthest depth of 2x2 texels of the previous
+    std::vector<std::vector<float>> m_hiz;
+    std::vector<int> m_levelWidth;
+    std::vector<int> m_levelHeight;
+};
+
+} // namespace splitspace
+
+#endif // OCCLUSION_CULLER_HPP
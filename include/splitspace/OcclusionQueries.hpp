@@ -0,0 +1,89 @@
+#ifndef OCCLUSION_QUERIES_HPP
+#define OCCLUSION_QUERIES_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/matrix.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace splitspace {
+
+class Engine;
+class RenderManager;
+class ResourceManager;
+class LogManager;
+class Object;
+class Mesh;
+
+// GPU occlusion queries with temporal coherence. Objects visible
+// last frame are drawn inside a query, the rest are tested with
+// their bounding box against that depth and drawn under conditional
+// render. Results are read back a frame late and never waited for.
+class OcclusionQueries {
+public:
+    OcclusionQueries(Engine *e);
+    ~OcclusionQueries();
+
+    bool init();
+    void destroy();
+
+    // Collects results which are already available
+    void beginFrame();
+
+    // Drops all per-object state, e.g. on scene change
+    void reset();
+
+    // Last available result says no samples passed
+    bool isHidden(const Object *o) const;
+
+    // Counts samples of the draws until endQuery(),
+    // returns false if the previous query is still in flight
+    bool beginQuery(const Object *o);
+    void endQuery();
+
+    // Box draws with color and depth writes off, returns false
+    // if the object can not be tested and should be drawn anyway
+    void beginBoundsPass(const glm::mat4 &viewProj, const glm::vec3 &viewPos);
+    bool queryBounds(const Object *o);
+    void endBoundsPass();
+
+    // Draws until endConditionalRender() are skipped by the GPU
+    // if the bounds of o were hidden
+    void beginConditionalRender(const Object *o);
+    void endConditionalRender();
+
+    std::size_t getFrameQueries() const { return m_frameQueries; }
+
+private:
+    struct QueryState {
+        GLuint query;
+        bool visible;
+        bool pending;
+    };
+
+    QueryState *getState(const Object *o);
+
+private:
+    Engine *m_engine;
+    RenderManager *m_renderManager;
+    ResourceManager *m_resManager;
+    LogManager *m_logManager;
+
+    std::vector<QueryState> m_states;
+    std::unordered_map<const Object *, std::uint32_t> m_stateIds;
+
+    Mesh *m_box;
+    GLuint m_program;
+    GLint m_mvpLocation;
+    glm::mat4 m_viewProj;
+    glm::vec3 m_viewPos;
+
+    std::size_t m_frameQueries;
+};
+
+} // namespace splitspace
+
+#endif // OCCLUSION_QUERIES_HPP
@@ -0,0 +1,65 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+class LogManager;
+
+// FNV-1a offset basis
+const std::uint64_t PROGRAM_HASH_SEED = 14695981039346656037ULL;
+
+// Keeps linked program binaries on disk between runs. Entries are keyed by
+// a hash of everything the binary depends on: full source of every stage,
+// output bindings and the driver vendor, renderer and version. A binary
+// the driver rejects is dropped and the program is built from source.
+class ProgramCache {
+public:
+    ProgramCache(LogManager *lm, const std::string &dir);
+
+    // Fails when the driver offers no program binary formats
+    bool init();
+
+    static std::uint64_t hash(const std::string &data, std::uint64_t seed = PROGRAM_HASH_SEED);
+    // Driver identity is appended to the parts
+    std::uint64_t makeKey(const std::vector<std::string> &parts) const;
+
+    // Links program from the cached binary, false on a miss or a stale entry
+    bool load(std::uint64_t key, GLuint program);
+    // Before linking, so the driver keeps the binary
+    static void prepare(GLuint program);
+    void store(std::uint64_t key, GLuint program);
+
+    std::string getEntryPath(std::uint64_t key) const;
+    static bool readEntry(const std::string &path, std::uint64_t key,
+                          GLenum &format, std::vector<char> &binary);
+    static bool writeEntry(const std::string &path, std::uint64_t key,
+                           GLenum format, const std::vector<char> &binary);
+    // Creates missing directories along the path
+    static bool makeDirs(const std::string &dir);
+
+    std::size_t getHits() const { return m_hits; }
+    std::size_t getMisses() const { return m_misses; }
+    std::size_t getStale() const { return m_stale; }
+
+    void logStats();
+
+private:
+    LogManager *m_logManager;
+    std::string m_dir;
+    std::string m_driver;
+
+    std::size_t m_hits;
+    std::size_t m_misses;
+    std::size_t m_stale;
+};
+
+} // namespace splitspace
+
+#endif // PROGRAM_CACHE_HPP
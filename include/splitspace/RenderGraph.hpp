@@ -0,0 +1,122 @@
+#ifndef RENDER_GRAPH_HPP
+#define RENDER_GRAPH_HPP
+
+#include <splitspace/Resource.hpp>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <string>
+
+namespace splitspace {
+
+class LogManager;
+
+// Reserved texture name passes write to draw to the screen
+const char * const RENDER_GRAPH_BACKBUFFER = "backbuffer";
+
+enum GraphPassType {
+    GRAPH_PASS_UNKNOWN,
+    // Draws the render queue with the pass shader
+    GRAPH_PASS_SCENE,
+    // One screen triangle, inputs are bound to samplers of the same name
+    GRAPH_PASS_FULLSCREEN
+};
+
+struct RenderGraphFormat {
+    const char *name;
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+};
+
+struct GraphTextureDesc {
+    std::string name;
+    GLenum internalFormat;
+    // Of the render size
+    float scale;
+};
+
+struct GraphPassDesc {
+    std::string name;
+    GraphPassType type;
+    std::string shader;
+    std::vector<std::string> inputs;
+    // Depth formats go to the depth attachment, at most one per pass
+    std::vector<std::string> outputs;
+    // Outputs are cleared first, otherwise earlier contents are kept
+    bool clear;
+};
+
+// Passes in submission order and the textures they exchange,
+// declared with "renderGraphs" of the shader library
+struct RenderGraphManifest: public ResourceManifest {
+    RenderGraphManifest(): ResourceManifest(RES_RENDER_GRAPH)
+    {}
+    std::vector<GraphTextureDesc> textures;
+    std::vector<GraphPassDesc> passes;
+};
+
+// Texture backing one or more graph textures
+struct GraphTarget {
+    GLenum internalFormat;
+    float scale;
+};
+
+struct GraphPass {
+    // Into the manifest passes
+    std::size_t desc;
+    std::vector<int> inputs;
+    std::vector<int> colorOutputs;
+    int depthOutput;
+    bool toBackbuffer;
+};
+
+// Compiles a graph manifest for execution. Passes not contributing to
+// the backbuffer are culled. Textures live from the first to the last
+// live pass using them, textures of the same format and scale whose
+// lifetimes do not overlap share one target.
+class RenderGraph {
+public:
+    RenderGraph(LogManager *lm);
+
+    // Fails on unknown textures, reads before writes and pass outputs
+    // which can not be attached together
+    bool compile(const RenderGraphManifest *manifest);
+    void clear();
+
+    const RenderGraphManifest *getManifest() const { return m_manifest; }
+    // Live passes in submission order
+    const std::vector<GraphPass> &getPasses() const { return m_passes; }
+    const std::vector<GraphTarget> &getTargets() const { return m_targets; }
+    // Target of a graph texture, -1 if no live pass uses it
+    int getTarget(const std::string &texture) const;
+    std::size_t getNumScenePasses() const;
+    std::size_t getNumCulled() const { return m_numCulled; }
+
+    // nullptr for unknown formats
+    static const RenderGraphFormat *findFormat(const std::string &name);
+    static const RenderGraphFormat *findFormat(GLenum internalFormat);
+    static bool isDepthFormat(GLenum internalFormat);
+    static GraphPassType getPassTypeFromName(const std::string &name);
+
+private:
+    int findTexture(const std::string &name) const;
+    bool validate();
+    void cull(std::vector<bool> &live);
+    void assignTargets(const std::vector<bool> &live);
+
+private:
+    LogManager *m_logManager;
+    const RenderGraphManifest *m_manifest;
+    std::vector<GraphPass> m_passes;
+    std::vector<GraphTarget> m_targets;
+    // Target of every manifest texture
+    std::vector<int> m_textureTargets;
+    std::size_t m_numCulled;
+};
+
+} // namespace splitspace
+
+#endif // RENDER_GRAPH_HPP
@@ -1,8 +1,14 @@
 #ifndef RENDER_MANAGER_HPP
 #define RENDER_MANAGER_HPP
 
+#include <splitspace/GpuMemoryTracker.hpp>
+#include <splitspace/GLStateCache.hpp>
+#include <splitspace/GpuProfiler.hpp>
+
 #include <SDL2/SDL.h>
 #include <vector>
+#include <functional>
+#include <cstdint>
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <glm/vec2.hpp>
@@ -17,6 +23,11 @@ class LogManager;
 class ResourceManager;
 class SceneManager;
 class RenderTechnique;
+class UniformBuffers;
+class RenderThread;
+class ProgramCache;
+class HeadlessContext;
+struct FramePacket;
 
 class Texture;
 class Shader;
@@ -51,6 +62,12 @@ enum TextureUsage {
     TEX_RENDERTARGET
 };
 
+// Per-instance world matrix occupies four consecutive locations
+enum InstanceAttrib {
+    INSTANCE_ATTRIB_WORLD = 3,
+    INSTANCE_ATTRIB_NUM = 4
+};
+
 struct Vertex3DT {
     glm::vec3 pos;
     glm::vec2 texcoord;
@@ -67,6 +84,18 @@ struct Vertex3DTN {
     glm::vec3 normal;
 };
 
+// Program handed to the driver by beginShader(), the stages are compiled
+// and linked in the background where parallel compilation is supported
+struct PendingProgram {
+    PendingProgram(): program(0), vs(0), fs(0), cacheKey(0), cached(false) {}
+    GLuint program;
+    GLuint vs;
+    GLuint fs;
+    std::uint64_t cacheKey;
+    // linked from the program cache, nothing to wait for
+    bool cached;
+};
+
 struct MeshData;
 struct TextureData;
 struct ShaderData;
@@ -79,10 +108,32 @@ public:
     RenderManager(Engine *e);
     ~RenderManager();
 
-    bool init(bool vsync);
+    // Program binaries are cached in programCacheDir unless it is empty
+    bool init(bool vsync, const std::string &programCacheDir = "");
+    // Prepares and draws a frame on the calling thread
     void render();
+    // Split of render() for the pipelined loop, prepareFrame()
+    // may run on any thread, renderFrame() only on the GL thread
+    void prepareFrame(FramePacket &packet);
+    void renderFrame(const FramePacket &packet);
+    FramePacket &getFramePacket(int i);
     void destroy();
 
+    // Moves the GL context to a dedicated thread, frames are then
+    // sent with queueFrame() instead of render()
+    bool startRenderThread();
+    void stopRenderThread();
+    bool hasRenderThread() const;
+    // Frames handed to the render thread and drawn by it, both stay 0
+    // while frames are drawn on the calling thread
+    std::uint64_t getSubmittedFrames() const;
+    std::uint64_t getCompletedFrames() const;
+    // Prepares a packet on the calling thread and queues it for drawing,
+    // blocks while the render thread is a full queue behind
+    void queueFrame();
+    // Runs fn where the GL context is current and waits for it
+    bool callOnGLThread(const std::function<bool ()> &fn);
+
     void setRenderTechnique(RenderTechnique *rt);
     RenderTechnique *getRenderTechnique() const { return m_renderTechnique; }
 
@@ -93,27 +144,132 @@ public:
     bool createSampler(bool useMipmaps, TextureFiltering filtering, GLuint &smaplerName);
     bool createMesh(const void *vData, VertexFormat format, int numVerts, GLuint &vboName, GLuint &vaoName);
     bool createShader(const char *vsSrc, const char *fsSrc,int vsVer,
-                      int fsVer, const int numOutputs, GLuint &glName);
+                      int fsVer, const int numOutputs, GLuint &glName,
+                      bool withSupport = true);
+    bool createComputeShader(const char *src, int ver, GLuint &glName);
+    // createShader() split for parallel compilation: begin a batch of programs,
+    // then finish them, at best once isShaderReady(). GL thread only.
+    // defines are injected right after the #version line of both stages.
+    bool beginShader(const char *vsSrc, const char *fsSrc, int vsVer,
+                     int fsVer, const int numOutputs, PendingProgram &pending,
+                     bool withSupport = true, const std::string &defines = "");
+    bool isShaderReady(const PendingProgram &pending) const;
+    // Blocks until the program is linked, releases pending either way
+    bool finishShader(PendingProgram &pending, GLuint &glName);
+    // Drops a program nobody is going to wait for
+    void cancelShader(PendingProgram &pending);
+    // Degenerate draw with the program bound, drivers finish
+    // deferred compilation on first draw instead of in a frame
+    void warmUpProgram(GLuint program);
+    bool hasParallelCompile() const { return m_parallelCompile; }
+    bool createUniformBuffer(std::size_t size, GLuint &bufferName);
+    // Shader storage buffer, also used as indirect draw buffer
+    bool createStorageBuffer(std::size_t size, const void *data, GLuint &bufferName);
+    void updateStorageBuffer(GLuint buffer, std::size_t offset, std::size_t size, const void *data);
+    // Buffer read by shaders as a samplerBuffer of given format
+    bool createTextureBuffer(GLenum internalFormat, std::size_t size,
+                             GLuint &bufferName, GLuint &texName);
+    void updateTextureBuffer(GLuint buffer, std::size_t offset, std::size_t size, const void *data);
+    bool createQuery(GLuint &queryName);
+    void updateUniformBuffer(GLuint buffer, std::size_t offset, std::size_t size, const void *data);
+
+    // Streams per-instance world matrices for the current frame,
+    // returns offset of the data within the instance buffer
+    GLintptr pushInstanceData(const glm::mat4 *worlds, std::size_t count);
+    void bindInstanceData(GLuint vao, GLintptr offset);
+    // Sources per-instance world matrices of vao from another buffer
+    void bindInstanceBuffer(GLuint vao, GLuint buffer, GLintptr offset);
+    // Disables the instance attributes of vao after an instanced draw,
+    // so plain draws of the mesh do not source them
+    void unbindInstanceData(GLuint vao);
+
+    void drawArrays(GLsizei numVerts);
+    void drawArraysInstanced(GLsizei numVerts, GLsizei numInstances);
+    // Command at offset in the buffer bound to GL_DRAW_INDIRECT_BUFFER,
+    // its counts live on the GPU so triangles are passed in when known
+    void drawArraysIndirect(GLintptr offset, std::uint64_t triangles = 0);
 
     void destroyMesh(GLuint &vao, GLuint &vbo);
     void destroyTexture(GLuint &texId);
     void destroySampler(GLuint &sampler);
     void destroyShader(GLuint &progId);
+    void destroyUniformBuffer(GLuint &buffer);
+    void destroyStorageBuffer(GLuint &buffer);
+    void destroyTextureBuffer(GLuint &buffer, GLuint &texName);
+    void destroyQuery(GLuint &query);
+    // Drops the uniform buffer slot of an unloaded material
+    void releaseMaterial(const Material *mat);
 
     void logStats();
     int getFrameDrawCalls() const { return m_frameDrawCalls; }
     int getTotalDrawCalls() const { return m_totalDrawCalls; }
+    // Indirect draws are counted on the GPU and not included
+    std::uint64_t getFrameTriangles() const { return m_frameTriangles; }
+
+    void addCullingStats(std::size_t visible, std::size_t culled, std::size_t occluded);
+    std::size_t getFrameVisibleObjects() const { return m_frameVisibleObjects; }
+    std::size_t getFrameCulledObjects() const { return m_frameCulledObjects; }
+    std::size_t getFrameOccludedObjects() const { return m_frameOccludedObjects; }
+
+    // hidden counts objects drawn under conditional render
+    void addOcclusionQueryStats(std::size_t queries, std::size_t hidden);
+    std::size_t getFrameOcclusionQueries() const { return m_frameOcclusionQueries; }
+    std::size_t getFrameQueryHidden() const { return m_frameQueryHidden; }
+
+    GpuMemoryTracker &getGpuMemory() { return m_gpuMemory; }
+    const GpuMemoryTracker &getGpuMemory() const { return m_gpuMemory; }
+
+    UniformBuffers *getUniformBuffers() const { return m_uniformBuffers; }
+    GpuProfiler *getGpuProfiler() const { return m_gpuProfiler; }
+    // CPU time spent in render(), including the swap
+    const TimingHistory &getCpuFrameTimes() const { return m_cpuFrameTimes; }
+
+    GLStateCache &getGLState() { return m_glState; }
+
+    // Stands in for framebuffer 0, the offscreen target in headless mode
+    GLuint getDefaultFramebuffer() const { return m_offscreenFbo; }
+    bool isHeadless() const { return m_headless!=nullptr; }
+    // RGBA rows of the last frame drawn offscreen, bottom row first.
+    // Headless only, the back buffer of a window is gone after the swap.
+    bool readFrame(std::vector<std::uint8_t> &rgba, int &w, int &h);
 
 private:
     void setupGL();
 
+    bool createWindowContext(bool vsync);
+    bool makeContextCurrent();
+    void releaseContext();
+    bool createOffscreenTarget(int w, int h);
+    void destroyOffscreenTarget();
+
+    bool createInstanceBuffer(std::size_t capacity);
+    // Detaches last frame's instance data from the buffer instead of
+    // waiting for the GPU, the buffer name and size are kept
+    void orphanInstanceBuffer();
+    void destroyInstanceBuffer();
+
     bool createVAOAndVBO(GLuint &vao, GLuint &vbo);
     void destroyVAOAndVBO(GLuint &vao, GLuint &vbo);
 
-    bool compileShader(GLuint shader, const char *src, int ver);
-    bool linkProgram(GLuint program, GLuint vs, GLuint fs);
+    // Resource calls made off the render thread are forwarded to it
+    bool isOffGLThread() const;
+    void releaseTexture(GLuint &texId);
+    void releaseSampler(GLuint &sampler);
+    void releaseMesh(GLuint &vao, GLuint &vbo);
+    void releaseShader(GLuint &progId);
+    void releaseUniformBuffer(GLuint &buffer);
+    void releaseStorageBuffer(GLuint &buffer);
+    void releaseTextureBuffer(GLuint &buffer, GLuint &texName);
+    void releaseQuery(GLuint &query);
 
-    std::size_t getTextureSize(const GLuint texId);
+    // Shader support code is only shared by the graphics stages
+    bool compileShader(GLuint shader, const char *src, int ver, bool withSupport = true);
+    void submitShader(GLuint shader, const char *src, int ver,
+                      bool withSupport, const std::string &defines);
+    bool checkCompileStatus(GLuint shader);
+    void releasePending(PendingProgram &pending);
+    bool linkProgram(GLuint program, GLuint cs);
+    bool checkLinkStatus(GLuint program);
 
     void beginFrame();
     void endFrame();
@@ -124,21 +280,51 @@ private:
     ResourceManager *m_resManager;
     SDL_GLContext m_context;
     SDL_Window *m_window;
+    HeadlessContext *m_headless;
+    GLuint m_offscreenFbo;
+    GLuint m_offscreenColor;
+    GLuint m_offscreenDepth;
+    int m_offscreenWidth;
+    int m_offscreenHeight;
 
     int m_frameDrawCalls;
+    std::uint64_t m_frameTriangles;
     int m_totalDrawCalls;
+    std::size_t m_frameVisibleObjects;
+    std::size_t m_frameCulledObjects;
+    std::size_t m_frameOccludedObjects;
+    std::uint64_t m_totalCulledObjects;
+    std::uint64_t m_totalOccludedObjects;
+    std::size_t m_frameOcclusionQueries;
+    std::size_t m_frameQueryHidden;
+    std::uint64_t m_totalOcclusionQueries;
+    std::uint64_t m_totalQueryHidden;
     int m_totalShaders;
     int m_totalMeshes;
     int m_totalTextures;
-    int m_totalFrames;
-    float m_averageFrameTime;
-    int m_memoryUsed;
+    TimingHistory m_cpuFrameTimes;
+    GpuMemoryTracker m_gpuMemory;
+    GLStateCache m_glState;
+
+    UniformBuffers *m_uniformBuffers;
+    GpuProfiler *m_gpuProfiler;
+    ProgramCache *m_programCache;
+    bool m_parallelCompile;
+    GLuint m_warmUpVao;
+
+    GLuint m_instanceBuffer;
+    std::size_t m_instanceCapacity;
+    std::size_t m_instanceOffset;
 
     Scene *m_scene;
     Shader *m_shader;
     Camera *m_camera;
 
     RenderTechnique *m_renderTechnique;
+    FramePacket *m_framePackets;
+    std::uint64_t m_preparedFrames;
+    RenderThread *m_renderThread;
+    int m_queuedPacket;
 };
 
 } // namespace splitspace
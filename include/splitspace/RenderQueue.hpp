@@ -0,0 +1,91 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+
+#include <splitspace/ShaderVariant.hpp>
+
+namespace splitspace {
+
+class Object;
+class Material;
+class Mesh;
+
+enum RenderPass {
+    RENDER_PASS_OPAQUE,
+    RENDER_PASS_TRANSPARENT,
+
+    RENDER_PASS_NUM
+};
+
+struct RenderItem {
+    std::uint64_t key;
+    const Object *object;
+    const Material *material;
+    const Mesh *mesh;
+    // Object transform or its snapshot in a FramePacket
+    const glm::mat4 *world;
+    ShaderVariantKey variant;
+};
+
+// Per-frame list of draws ordered by 64-bit sort keys.
+//
+// Opaque key:      pass:2 | program:10 | material:14 | mesh:14 | depth:24
+// Transparent key: pass:2 | ~depth:24  | program:10 | material:14 | mesh:14
+//
+// Opaque items are grouped by state and go front-to-back inside a group,
+// transparent ones are strictly back-to-front.
+class RenderQueue {
+public:
+    RenderQueue();
+
+    void clear();
+
+    // depth is view distance normalised to [0; 1] between camera planes,
+    // world defaults to the live transform of the object.
+    // Each variant of a program sorts as a program of its own.
+    void push(RenderPass pass, std::uint32_t program, const Object *o, float depth,
+              const glm::mat4 *world = nullptr, ShaderVariantKey variant = 0);
+
+    void sort();
+
+    const std::vector<RenderItem> &getItems() const { return m_items; }
+    std::size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+    static RenderPass getPass(std::uint64_t key) {
+        return static_cast<RenderPass>(key>>62);
+    }
+
+    static std::uint64_t makeKey(RenderPass pass, std::uint32_t program, std::uint32_t material,
+                                 std::uint32_t mesh, float depth);
+
+private:
+    struct SortEntry {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    template<class T>
+    static std::uint32_t getId(std::unordered_map<T, std::uint32_t> &ids, T key);
+
+private:
+    std::vector<RenderItem> m_items;
+    std::vector<RenderItem> m_sorted;
+    std::vector<SortEntry> m_entries;
+    std::vector<SortEntry> m_scratch;
+
+    // Dense ids keep pointers and GL names within their key bits,
+    // assigned in push order and reset by clear()
+    std::unordered_map<std::uint64_t, std::uint32_t> m_programIds;
+    std::unordered_map<const Material *, std::uint32_t> m_materialIds;
+    std::unordered_map<const Mesh *, std::uint32_t> m_meshIds;
+};
+
+} // namespace splitspace
+
+#endif // RENDER_QUEUE_HPP
@@ -0,0 +1,67 @@
+#ifndef RENDER_TARGET_POOL_HPP
+#define RENDER_TARGET_POOL_HPP
+
+#include <splitspace/RenderGraph.hpp>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <vector>
+#include <map>
+
+namespace splitspace {
+
+class RenderManager;
+class LogManager;
+
+// Textures backing render graph targets and framebuffers of the
+// attachment sets passes draw to. Targets which share a texture
+// (aliased by the graph) share its memory as well.
+class RenderTargetPool {
+public:
+    RenderTargetPool(RenderManager *rm, LogManager *lm);
+    ~RenderTargetPool();
+
+    // Sizes targets to w x h times their scale. Textures of the previous
+    // allocation with matching format and size are reused, the rest is freed.
+    bool allocate(const std::vector<GraphTarget> &targets, int w, int h);
+    void destroy();
+
+    GLuint getTexture(int target) const;
+    int getWidth(int target) const;
+    int getHeight(int target) const;
+
+    // Created on first use, color targets go to consecutive draw buffers.
+    // Returns 0 if the attachments are not framebuffer complete.
+    GLuint getFramebuffer(const std::vector<int> &colors, int depth);
+
+    std::size_t getNumTextures() const { return m_textures.size(); }
+    std::size_t getNumFramebuffers() const { return m_framebuffers.size(); }
+
+private:
+    struct PoolTexture {
+        GLuint texture;
+        GLenum internalFormat;
+        int width;
+        int height;
+        bool used;
+    };
+
+    int findTexture(GLenum internalFormat, int w, int h) const;
+    bool createTexture(GLenum internalFormat, int w, int h);
+    void destroyTexture(PoolTexture &t);
+    void destroyFramebuffers();
+
+private:
+    RenderManager *m_renderManager;
+    LogManager *m_logManager;
+    std::vector<PoolTexture> m_textures;
+    // Into m_textures, for every target
+    std::vector<int> m_targetTextures;
+    // Keyed by color targets followed by the depth target
+    std::map<std::vector<int>, GLuint> m_framebuffers;
+};
+
+} // namespace splitspace
+
+#endif // RENDER_TARGET_POOL_HPP
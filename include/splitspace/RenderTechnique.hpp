@@ -3,8 +3,14 @@
 
 #include <splitspace/Engine.hpp>
 #include <splitspace/LogManager.hpp>
+#include <splitspace/RenderQueue.hpp>
+#include <splitspace/FramePacket.hpp>
+#include <splitspace/Culling.hpp>
+#include <splitspace/OcclusionCuller.hpp>
+#include <splitspace/CommandBuffer.hpp>
 
 #include <vector>
+#include <glm/matrix.hpp>
 
 namespace splitspace {
 
@@ -18,34 +24,100 @@ class Camera;
 class Shader;
 class Material;
 class Mesh;
+class OcclusionQueries;
+class GpuCuller;
+class DynamicResolution;
+class Upscaler;
+
+// Render queue items recorded by one job
+const std::size_t RENDER_RECORD_SLICE = 256;
 
 class RenderTechnique {
 public:
     RenderTechnique(Engine *e): m_engine(e),
                                 m_renderManager(e->renderManager),
                                 m_logManager(e->logManager),
-                                m_resManager(e->resManager)
+                                m_resManager(e->resManager),
+                                m_scene(nullptr),
+                                m_viewCamera(nullptr),
+                                m_packet(nullptr),
+                                m_occlusionQueries(nullptr),
+                                m_gpuCuller(nullptr),
+                                m_resolution(nullptr),
+                                m_upscaler(nullptr),
+                                m_maxWidth(0),
+                                m_maxHeight(0),
+                                m_renderWidth(0),
+                                m_renderHeight(0),
+                                m_resolutionFrames(0)
     {}
 
     virtual ~RenderTechnique() {}
 
     virtual bool init() = 0;
     virtual void update(float dt) = 0;
-    virtual void render() = 0;
-
     virtual void destroy() = 0;
 
-    void setScene(Scene *scene) { m_scene = scene; }
+    // Captures camera, lights and transforms and builds the render queue.
+    // Runs on the simulation side, off the GL thread when the loop is pipelined
+    void prepare(FramePacket &packet);
+    // Draws a prepared packet, GL thread only
+    void submit(const FramePacket &packet);
+
+    void setScene(Scene *scene);
     Scene *getScene() const { return m_scene; }
 
     void setViewCamera(Camera *camera) { m_viewCamera = camera; }
     Camera *getViewCamera() const { return m_viewCamera; }
 
+    // Fraction of the window size frames are rendered at
+    float getResolutionScale() const;
+
 protected:
+    virtual void render() = 0;
+    // Shader the render queue is built for
+    virtual Shader *getSceneShader() const = 0;
+
     bool setupMaterial(Shader *shader, const Material *material);
     bool setupMesh(Shader *shader, const Mesh *mesh);
 
+    // Creates queries if enabled in config, techniques call it from init()
+    bool initOcclusionQueries();
+    void destroyOcclusionQueries();
+    // Picks GPU culling when GL 4.3 is available, for instanced shaders only
+    bool initGpuCulling();
+    void destroyGpuCulling();
+    bool useGpuCulling(const Shader *shader) const;
+    // Sets the render and maximum target sizes, with dynamic resolution
+    // enabled in config they follow the scale. Techniques call it from
+    // init() before creating targets, which are then created at the
+    // maximum size and drawn to with a viewport of the render size.
+    bool initDynamicResolution();
+    void destroyDynamicResolution();
+    // Stretches the render size corner of a maximum size target over the screen
+    void upscale(GLuint texture);
+
+    // With batchedLights only the first UBO_MAX_LIGHTS lights are uploaded,
+    // the technique uploads the rest itself
+    void updateUniformBuffers(bool batchedLights = false);
+    void buildRenderQueue(Shader *shader, FramePacket &packet);
+    void cullOccluded(const FramePacket &packet);
+    void drawRenderQueue(Shader *shader);
+    void drawRenderQueueInstanced(Shader *shader);
+    void drawRenderQueueQueried(Shader *shader);
+    void drawGpuCulled(Shader *shader);
+    // Binds the variant of the item when it differs from curShader
+    bool drawItem(Shader *shader, const RenderItem &item, Shader *&curShader,
+                  const Material *&curMaterial, const Mesh *&curMesh);
+
+    // Safe to call from worker threads, only reads the queue.
+    // Programs are recorded as shader variant keys.
+    void recordRenderQueue(std::size_t begin, std::size_t end, CommandBuffer &cb);
+    // GL thread only
+    void executeCommands(Shader *shader, const CommandBuffer &cb);
+
     void drawCall(std::size_t numVerts);
+    void drawCallInstanced(std::size_t numVerts, std::size_t numInstances);
 
 protected:
     Engine *m_engine;
@@ -54,6 +126,34 @@ protected:
     ResourceManager *m_resManager;
     Scene *m_scene;
     Camera *m_viewCamera;
+    // Packet being submitted, valid during render()
+    const FramePacket *m_packet;
+
+    FrustumCuller m_frustumCuller;
+    std::vector<std::uint32_t> m_visibleItems;
+    std::vector<std::uint32_t> m_partialItems;
+    OcclusionCuller m_occlusionCuller;
+    OcclusionQueries *m_occlusionQueries;
+    std::vector<std::uint32_t> m_hiddenItems;
+    std::vector<bool> m_queriedItems;
+    GpuCuller *m_gpuCuller;
+    std::vector<CommandBuffer> m_commandBuffers;
+    std::vector<glm::mat4> m_instanceData;
+
+    DynamicResolution *m_resolution;
+    Upscaler *m_upscaler;
+    int m_maxWidth;
+    int m_maxHeight;
+    // Viewport of the frame being rendered
+    int m_renderWidth;
+    int m_renderHeight;
+
+private:
+    // Feeds the newest GPU time to the controller and sets the viewport
+    void updateResolution();
+
+private:
+    std::uint64_t m_resolutionFrames;
 };
 
 } // namepsace splitspace
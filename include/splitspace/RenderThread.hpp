@@ -0,0 +1,77 @@
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <splitspace/FramePacket.hpp>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+namespace splitspace {
+
+// Thread owning the GL context. Prepared frame packets arrive through a
+// queue bounded by maxFrames, other GL work is posted as tasks which run
+// before the next frame. Deferred tasks wait until every frame submitted
+// before them is drawn, so GL objects those frames use stay alive.
+class RenderThread {
+public:
+    typedef std::function<void ()> Task;
+    typedef std::function<bool ()> Call;
+    typedef std::function<void (const FramePacket &packet)> FrameFunc;
+
+    RenderThread(const FrameFunc &drawFrame, int maxFrames = FRAME_PACKETS);
+    ~RenderThread();
+
+    // onStart and onStop run on the thread, they bind and release the context
+    bool start(const Task &onStart = Task(), const Task &onStop = Task());
+    // Draws the queued frames and runs pending tasks first
+    void stop();
+
+    bool isRunning() const { return m_thread.joinable(); }
+    bool isCurrent() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+    // Blocks while maxFrames frames are in flight, once it returns
+    // the packet used maxFrames frames ago may be prepared again
+    void waitForSlot();
+    // Packet has to stay untouched until waitForSlot() frees it
+    void submitFrame(const FramePacket *packet);
+
+    std::future<bool> post(const Call &call);
+    // Posts and waits, runs inline when called on the render thread
+    bool call(const Call &call);
+    void defer(const Task &task);
+
+    std::uint64_t getSubmittedFrames();
+    std::uint64_t getCompletedFrames();
+
+private:
+    void run(Task onStart, Task onStop);
+    // Called with m_mutex locked
+    void runDeferred(std::unique_lock<std::mutex> &lock, bool all);
+
+private:
+    FrameFunc m_drawFrame;
+    int m_maxFrames;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCond;
+    std::condition_variable m_frameDoneCond;
+    bool m_quit;
+
+    std::deque<const FramePacket *> m_frames;
+    std::deque<std::packaged_task<bool ()>> m_calls;
+    // Frame count a task waits for
+    std::vector<std::pair<std::uint64_t, Task>> m_deferred;
+    std::uint64_t m_submittedFrames;
+    std::uint64_t m_completedFrames;
+};
+
+} // namespace splitspace
+
+#endif // RENDER_THREAD_HPP
@@ -14,7 +14,8 @@ enum ResourceType {
     RES_MESH,
     RES_SHADER,
     RES_SCENE,
-    RES_LIGHT
+    RES_LIGHT,
+    RES_RENDER_GRAPH
 };
 
 struct ResourceManifest {
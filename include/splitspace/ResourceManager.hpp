@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <cstdint>
 
 namespace splitspace {
 
@@ -12,6 +13,7 @@ class LogManager;
 
 class Resource;
 class Material;
+class Mesh;
 
 struct ResourceManifest;
 struct TextureManifest;
@@ -26,6 +28,8 @@ public:
     bool loadShaderLib(const std::string &name);
 
     Material *loadDefaultMaterial();
+    // Built-in meshes such as __cube__, no scene has to reference them
+    Mesh *loadPrimitive(const std::string &name);
 
     bool loadShaderSupport(const std::string &path);
 
@@ -37,9 +41,13 @@ public:
     bool addManifest(ResourceManifest *rm);
     ResourceManifest *getManifest(const std::string &name);
     Resource *loadResource(const std::string &name);
+    // Frames in flight may still draw the resource, so it is unloaded
+    // by releaseUnloaded() once they are done
     bool unloadResource(const std::string &name);
 
     int collectGarbage();
+    // Called once per frame, `all` unloads without waiting for frames
+    void releaseUnloaded(bool all = false);
 
     void logStats();
 
@@ -60,6 +68,7 @@ public:
 
 private:
     TextureManifest *readTextureManifest(const std::string &name);
+    void deferUnload(Resource *res);
 
 private:
     Engine *m_engine;
@@ -67,6 +76,8 @@ private:
 
     std::map<std::string, Resource *> m_resourceCache;
     std::map<std::string, ResourceManifest *> m_resourceManifests;
+    // Render frame count a resource waits for
+    std::vector<std::pair<std::uint64_t, Resource *>> m_pendingUnloads;
 
     int m_totalResLoaded;
     int m_totalResFails;
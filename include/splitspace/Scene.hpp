@@ -2,9 +2,10 @@
 #define SCENE_HPP
 
 #include <splitspace/Resource.hpp>
+#include <splitspace/Bvh.hpp>
 
 #include <vector>
-#include <map>
+#include <future>
 
 namespace splitspace {
 
@@ -25,7 +26,7 @@ struct SceneManifest: public ResourceManifest {
     std::vector<LightManifest *> lights;
 };
 
-typedef std::map<const Material *, std::vector<const Object *> > RenderMap;
+typedef std::vector<const Object *> RenderList;
 typedef std::vector<const Light *> LightList;
 
 class Scene: public Resource {
@@ -39,19 +40,30 @@ public:
 
     Entity *getRootNode() const { return m_rootNode; }
 
-    const RenderMap &getRenderMap() const { return m_renderMap; }
+    const RenderList &getRenderList() const { return m_renderList; }
     const LightList &getLightList() const { return m_lightList; }
 
+    // Items of the BVH are indices into the render list
+    const Bvh *getBvh() const { return m_bvh; }
+
 private:
-    void updateRenderMap();
+    void updateRenderList();
+    void buildBvh();
+    void updateBvh();
 
 private:
     Entity *m_rootNode;
     ResourceManager *m_resManager;
     Engine *m_engine;
 
-    RenderMap m_renderMap;
+    RenderList m_renderList;
     LightList m_lightList;
+
+    Bvh *m_bvh;
+    std::vector<unsigned> m_boundsVersions;
+    // Snapshot of bounds the pending rebuild works with
+    std::vector<AABB> m_rebuildBounds;
+    std::future<Bvh *> m_bvhRebuild;
 };
 
 } // namespace splitspace
@@ -4,6 +4,9 @@
 #include <splitspace/Resource.hpp>
 #include <splitspace/RenderManager.hpp>
 #include <splitspace/Scene.hpp>
+#include <splitspace/UniformBuffers.hpp>
+#include <splitspace/LightClusters.hpp>
+#include <splitspace/ShaderVariant.hpp>
 
 #include <vector>
 #include <map>
@@ -23,6 +26,7 @@ enum ShaderUsage {
 enum UniformType {
     UNIFORM_UNKNOWN,
     UNIFORM_MVP_MAT,
+    UNIFORM_VP_MAT,
 
     UNIFORM_TEX_DIFFUSE,
     UNIFORM_TEX_NORMAL,
@@ -30,11 +34,45 @@ enum UniformType {
     UNIFORM_LIGHT_STRUCT,
     UNIFORM_NUM_LIGHTS,
 
-    UNIFORM_MATERIAL_STRUCT
+    UNIFORM_MATERIAL_STRUCT,
+
+    // Texture buffers of clustered lights, see ClusterUniforms
+    UNIFORM_CLUSTER_LIGHTS,
+    UNIFORM_CLUSTER_GRID,
+    UNIFORM_CLUSTER_INDICES,
+
+    UNIFORM_NUM_TYPES
+};
+
+enum LightProperty {
+    LIGHT_PROP_POSITION,
+    LIGHT_PROP_ROTATION,
+    LIGHT_PROP_DIFFUSE,
+    LIGHT_PROP_SPECULAR,
+    LIGHT_PROP_SPOT_CUTOFF,
+    LIGHT_PROP_POWER,
+    LIGHT_PROP_ATTENUATION,
+    LIGHT_PROP_TYPE,
+
+    LIGHT_PROP_NUM
 };
 
+enum MaterialProperty {
+    MAT_PROP_AMBIENT,
+    MAT_PROP_DIFFUSE,
+    MAT_PROP_SPECULAR,
+    MAT_PROP_IS_TEXTURED,
+    MAT_PROP_TECHNIQUE,
+
+    MAT_PROP_NUM
+};
+
+// Size of the legacy light struct array, see LightBlock for more lights
+const int SHADER_MAX_LIGHTS = 8;
+
 struct ShaderManifest: public ResourceManifest {
-    ShaderManifest(): ResourceManifest(RES_SHADER)
+    ShaderManifest(): ResourceManifest(RES_SHADER),
+                      instanced(false)
     {}
     std::string vsName;
     std::string fsName;
@@ -42,61 +80,100 @@ struct ShaderManifest: public ResourceManifest {
     int fsVersion;
     VertexFormat inputFormat;
     int numOutputs;
+    // world matrices come from per-instance attributes
+    bool instanced;
+    // optional GLSL name -> type overrides, uniforms named after
+    // the type itself (e.g. _MVP_) are recognised without it
     std::map<std::string, UniformType> uniformMapping;
+    // Keywords a variant may define, see ShaderVariant
+    std::vector<std::string> keywords;
+    // Light counts with a NUM_LIGHTS variant, the shader
+    // should still stop at the light count of the frame
+    std::vector<int> lightCounts;
+    // Variants compiled together with the shader
+    std::vector<ShaderVariantKey> precompile;
 };
 
 class Shader: public Resource {
 public:
-    Shader(Engine *e, ShaderManifest *manifest);
+    Shader(Engine *e, ShaderManifest *manifest, ShaderVariantKey variant = 0);
 
     static VertexFormat getInputFormatFromString(const std::string &f);
     static UniformType getUniformTypeFromString(const std::string &u);
+    static LightProperty getLightPropertyFromString(const std::string &p);
+    static MaterialProperty getMaterialPropertyFromString(const std::string &p);
 
     virtual bool load();
     virtual void unload();
 
     void setNumLights(int num);
-    void setLight(int lightId, const Light *l);
+    void setLight(int lightId, const LightUniforms &l);
     void clearLights();
     void setMaterial(const Material *mat);
 
     void setMVP(const glm::mat4 &mvp);
+    void setVP(const glm::mat4 &vp);
 
     void updateMaterialUniform();
 
+    // Variant a material is drawn with, safe off the GL thread
+    ShaderVariantKey selectVariant(const Material *mat, int numLights) const;
+    // Starts compiling the variant on first use, this shader stands in
+    // until the variant is ready or if it fails. GL thread only.
+    Shader *getVariant(ShaderVariantKey key);
+    // Once per frame, finishes variants the driver is done with
+    void pollVariants();
+    ShaderVariantKey getVariantKey() const { return m_variant; }
+
     GLuint getProgramId() const { return m_programId; }
+    bool isInstanced() const;
+    bool hasUniformBlock(UniformBlockBinding b) const { return m_uniformBlocks&(1<<b); }
+    bool hasUniform(UniformType t) const { return m_uniforms[t].location>=0; }
+    bool usesClusteredLights() const;
+    int getNumLightSlots() const { return m_numLightSlots; }
 
 private:
+    bool readSources();
+    // Program compiles between the two, so variants are built in parallel
+    bool beginLoad(const std::string &vsSrc, const std::string &fsSrc);
+    bool finishLoad();
+    void beginVariant(ShaderVariantKey key);
+    void destroyVariants();
+
+    void resetUniforms();
     void initUniforms(const std::map<std::string, UniformType> &mapping);
-    void setUniform(GLint id, float val);
-    void setUniform(GLint id, int val);
-    void setUniform(GLint id, const glm::vec3 &val);
-    void setUniform(GLint id, const glm::vec4 &val);
-    void setUniform(GLint id, const glm::mat4 &val);
-
-
-private:
-    GLuint m_programId;
-
-    struct LightUniform {
-        std::string name;
-        std::vector<std::map<std::string, GLint>> locations;
+    void initUniformBlocks();
+    struct UniformInfo {
+        GLint location;
+        GLenum type;
     };
 
-    LightUniform m_lightUniform;
-
-    struct MaterialUniform {
-        std::string name;
-        std::map<std::string, GLint> locations;
-    };
+    void setUniform(const UniformInfo &u, float val);
+    void setUniform(const UniformInfo &u, int val);
+    void setUniform(const UniformInfo &u, const glm::vec3 &val);
+    void setUniform(const UniformInfo &u, const glm::vec4 &val);
+    void setUniform(const UniformInfo &u, const glm::mat4 &val);
 
-    MaterialUniform m_materialUniform;
 
-    struct GenericUniform {
-        std::string name;
-        GLint location;
-    };
-    std::map<UniformType, GenericUniform> m_genericUniforms;
+private:
+    Engine *m_engine;
+    GLuint m_programId;
+    PendingProgram m_pending;
+    int m_uniformBlocks;
+
+    UniformInfo m_uniforms[UNIFORM_NUM_TYPES];
+    UniformInfo m_lightUniforms[SHADER_MAX_LIGHTS][LIGHT_PROP_NUM];
+    UniformInfo m_materialUniforms[MAT_PROP_NUM];
+    int m_numLightSlots;
+    bool m_hasMaterialStruct;
+
+    ShaderVariantKey m_variant;
+    MaterialFeatureBits m_materialFeatures;
+    // Kept for variants compiled later
+    std::string m_vsSrc;
+    std::string m_fsSrc;
+    // nullptr marks a variant which failed to compile
+    std::map<ShaderVariantKey, Shader *> m_variants;
 };
 
 }
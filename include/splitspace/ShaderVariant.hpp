@@ -0,0 +1,64 @@
+#ifndef SHADER_VARIANT_HPP
+#define SHADER_VARIANT_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace splitspace {
+
+class Material;
+
+// Keyword bits in the low 24 bits, fixed light count in the top byte.
+// Key 0 is the shader compiled without defines, with all runtime branches.
+typedef std::uint32_t ShaderVariantKey;
+
+const int SHADER_MAX_KEYWORDS = 24;
+const int SHADER_VARIANT_LIGHTS_SHIFT = 24;
+const int SHADER_VARIANT_MAX_LIGHTS = 255;
+
+// Keywords set from the material being drawn
+const char * const SHADER_KEYWORD_TEXTURED = "TEXTURED";
+const char * const SHADER_KEYWORD_NORMAL_MAP = "NORMAL_MAP";
+
+// Bits the material keywords resolve to in a shader's keyword list,
+// 0 for keywords the shader does not declare
+struct MaterialFeatureBits {
+    MaterialFeatureBits(): textured(0),
+                           normalMap(0)
+    {}
+    std::uint32_t textured;
+    std::uint32_t normalMap;
+};
+
+// Variant keys and the defines each variant is compiled with. Keywords
+// are declared per shader, bit i of a key stands for the i-th keyword.
+// Every set keyword is defined as 1, a fixed light count as NUM_LIGHTS.
+class ShaderVariant {
+public:
+    static ShaderVariantKey makeKey(std::uint32_t features, int numLights);
+    static std::uint32_t getFeatures(ShaderVariantKey key) {
+        return key&((1u<<SHADER_VARIANT_LIGHTS_SHIFT)-1);
+    }
+    static int getNumLights(ShaderVariantKey key) {
+        return key>>SHADER_VARIANT_LIGHTS_SHIFT;
+    }
+
+    // Names the keyword list does not declare are ignored
+    static std::uint32_t getFeatureMask(const std::vector<std::string> &keywords,
+                                        const std::vector<std::string> &names);
+    // Looked up once per shader, so per item selection does not compare strings
+    static MaterialFeatureBits getMaterialFeatureBits(const std::vector<std::string> &keywords);
+    static std::uint32_t getMaterialFeatures(const MaterialFeatureBits &bits,
+                                             const Material *material);
+    // Smallest declared count holding numLights, 0 (the dynamic loop) if none does
+    static int pickLightCount(const std::vector<int> &counts, int numLights);
+
+    // Lines injected right after the #version header
+    static std::string getDefines(const std::vector<std::string> &keywords, ShaderVariantKey key);
+    static std::string describe(const std::vector<std::string> &keywords, ShaderVariantKey key);
+};
+
+} // namespace splitspace
+
+#endif // SHADER_VARIANT_HPP
@@ -0,0 +1,65 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace splitspace {
+
+const std::size_t TIMING_HISTORY_SIZE = 256;
+
+// Ring of the latest timing samples in milliseconds
+class TimingHistory {
+public:
+    TimingHistory(std::size_t capacity = TIMING_HISTORY_SIZE);
+
+    void add(double ms);
+    void clear();
+
+    std::size_t size() const { return m_samples.size(); }
+    double getLast() const { return m_last; }
+    double getAverage() const;
+    // Nearest-rank percentile, p in [0; 100]
+    double getPercentile(double p) const;
+    double getMin() const;
+    double getMax() const;
+    // Min, average, max and percentiles for logs
+    std::string describe() const;
+
+private:
+    std::size_t m_capacity;
+    std::size_t m_next;
+    double m_last;
+    std::vector<double> m_samples;
+};
+
+// Splits real frame time into fixed simulation steps. Time left over
+// is kept for the next frame, and its fraction of a step is the
+// alpha to interpolate rendered state with.
+class FixedTimestep {
+public:
+    // Steps past maxSteps per frame are dropped so a slow frame
+    // can not trigger even slower catch-up frames, a non-positive step
+    // falls back to the default one
+    FixedTimestep(double step = 1.0/60.0, int maxSteps = 5);
+
+    // Returns number of steps to simulate for frameTime seconds
+    int advance(double frameTime);
+
+    double getStep() const { return m_step; }
+    int getMaxSteps() const { return m_maxSteps; }
+    double getAlpha() const { return m_accumulator/m_step; }
+    std::uint64_t getDroppedSteps() const { return m_droppedSteps; }
+
+private:
+    double m_step;
+    int m_maxSteps;
+    double m_accumulator;
+    std::uint64_t m_droppedSteps;
+};
+
+} // namespace splitspace
+
+#endif // TIMING_HPP
@@ -0,0 +1,129 @@
+#ifndef UNIFORM_BUFFERS_HPP
+#define UNIFORM_BUFFERS_HPP
+
+#include <splitspace/Scene.hpp>
+#include <splitspace/Light.hpp>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <map>
+
+namespace splitspace {
+
+class RenderManager;
+class LogManager;
+class Material;
+
+enum UniformBlockBinding {
+    UBO_FRAME,
+    UBO_LIGHTS,
+    UBO_MATERIAL,
+    UBO_CLUSTERS,
+
+    UBO_NUM_BINDINGS
+};
+
+const int UBO_MAX_LIGHTS = 128;
+
+// std140 layouts of FrameBlock, LightBlock, MaterialBlock and ClusterBlock,
+// the GLSL side of the first two is LIGHT_COMMON in DefferedRenderTechnique.cpp
+struct FrameUniforms {
+    glm::mat4 viewProj;
+    glm::vec4 cameraPos;
+};
+
+struct LightUniforms {
+    glm::vec4 position;    // w - LightType
+    glm::vec4 rotation;    // w - spotLightCutoff
+    glm::vec4 diffuse;     // w - power
+    glm::vec4 specular;
+    glm::vec4 attenuation;
+};
+
+struct LightBlockUniforms {
+    GLint numLights;
+    GLint pad[3];
+    LightUniforms lights[UBO_MAX_LIGHTS];
+};
+
+struct MaterialUniforms {
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    GLint isTextured;
+    GLint technique;
+    GLint pad[2];
+};
+
+// Clustered lights are read from texture buffers: LightUniforms as
+// 5 RGBA32F texels per light, offset and count of every cluster as
+// RG32UI and light indices as R32UI. The first numGlobalLights lights
+// are not binned and are shaded on every fragment, indices count from
+// the light right after them.
+struct ClusterUniforms {
+    glm::uvec4 dims;        // w - numGlobalLights
+    glm::vec4 depthParams;  // near, far, slice scale, slice bias
+    glm::vec4 tileSize;     // xy - size of a tile in pixels
+};
+
+// Owns uniform buffers shared by all programs and keeps them bound
+// to fixed binding points.
+class UniformBuffers {
+public:
+    UniformBuffers(RenderManager *rm, LogManager *lm);
+    ~UniformBuffers();
+
+    bool init();
+    void destroy();
+
+    static const char *getBlockName(UniformBlockBinding b);
+
+    void updateFrame(const glm::mat4 &viewProj, const glm::vec3 &cameraPos);
+    // Uploads only lights which changed since the last call,
+    // lights past UBO_MAX_LIGHTS are dropped with a warning
+    void updateLights(const std::vector<LightUniforms> &lights);
+    // Uploads up to UBO_MAX_LIGHTS lights starting at first, for
+    // techniques which draw every light in batches
+    void updateLightBatch(const std::vector<LightUniforms> &lights, std::size_t first);
+    // Packs and uploads the material on first use and when its parameters change
+    void bindMaterial(const Material *mat);
+    // Frees the slot of an unloaded material for reuse
+    void releaseMaterial(const Material *mat);
+    void updateClusters(const ClusterUniforms &clusters);
+
+    static void packLight(LightUniforms &dst, const Light *l);
+    static LightType getLightType(const LightUniforms &l) {
+        return static_cast<LightType>(static_cast<int>(l.position.w));
+    }
+    static float getLightRange(const LightUniforms &l);
+
+private:
+    static void packMaterial(MaterialUniforms &dst, const Material *mat);
+
+    std::size_t addMaterial(const Material *mat);
+
+private:
+    RenderManager *m_renderManager;
+    LogManager *m_logManager;
+
+    GLuint m_buffers[UBO_NUM_BINDINGS];
+
+    LightBlockUniforms m_lightData;
+    bool m_lightsValid;
+    // Light count last warned about
+    std::size_t m_truncatedLights;
+
+    std::map<const Material *, std::size_t> m_materialSlots;
+    std::vector<std::size_t> m_freeMaterialSlots;
+    std::size_t m_numMaterialSlots;
+    std::size_t m_materialStride;
+    std::size_t m_materialCapacity;
+    std::vector<unsigned char> m_materialData;
+};
+
+} // namespace splitspace
+
+#endif // UNIFORM_BUFFERS_HPP
@@ -0,0 +1,55 @@
+#ifndef UPSCALER_HPP
+#define UPSCALER_HPP
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <string>
+
+namespace splitspace {
+
+class RenderManager;
+class LogManager;
+
+enum UpscaleFilter {
+    UPSCALE_UNKNOWN,
+    UPSCALE_BILINEAR,
+    // Bilinear with an unsharp mask clamped to the neighbourhood
+    UPSCALE_SHARPEN
+};
+
+// Stretches the rendered corner of a render target over the draw
+// framebuffer with one full-screen triangle. Samples are kept inside
+// the rendered area, the rest of the target holds stale pixels.
+class Upscaler {
+public:
+    Upscaler(RenderManager *rm, LogManager *lm);
+    ~Upscaler();
+
+    bool init(UpscaleFilter filter);
+    void destroy();
+
+    // Draws w x h texels at the origin of a texW x texH texture to a dstW x dstH viewport
+    void draw(GLuint texture, int w, int h, int texW, int texH, int dstW, int dstH);
+
+    UpscaleFilter getFilter() const { return m_filter; }
+
+    static UpscaleFilter getFilterFromName(const std::string &name);
+
+private:
+    RenderManager *m_renderManager;
+    LogManager *m_logManager;
+    UpscaleFilter m_filter;
+
+    GLuint m_program;
+    GLint m_uvScale;
+    GLint m_uvMax;
+    GLint m_texelSize;
+    GLuint m_sampler;
+    GLuint m_screenVao;
+    GLuint m_screenVbo;
+};
+
+} // namespace splitspace
+
+#endif // UPSCALER_HPP
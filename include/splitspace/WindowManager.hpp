@@ -16,18 +16,25 @@ public:
     WindowManager(Engine *e);
     ~WindowManager();
 
-    bool init(const char *caption, int w, int h, bool fs);
+    // Headless mode creates no window, only the event queue
+    bool init(const char *caption, int w, int h, bool fs, bool headless = false);
 
     void collectEvents();
 
     void destroy();
 
     SDL_Window *getSDLWindow() const { return m_window; }
+    bool isHeadless() const { return m_headless; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
 
 private:
     EventManager *m_evtMan;
     LogManager *m_logMan;
     SDL_Window *m_window;
+    bool m_headless;
+    int m_width;
+    int m_height;
     std::vector<SDL_Scancode> m_keysDown;
     bool m_leftButtonDown;
     bool m_rightButtonDown;
@@ -0,0 +1,122 @@
+#include <splitspace/Bounds.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+namespace splitspace {
+
+static const glm::vec3 &getPosition(const void *positions, std::size_t i, std::size_t stride) {
+    return *reinterpret_cast<const glm::vec3 *>(static_cast<const char *>(positions)+i*stride);
+}
+
+float AABB::getSurfaceArea() const {
+    glm::vec3 d = max-min;
+    return 2.f*(d.x*d.y+d.y*d.z+d.z*d.x);
+}
+
+void AABB::merge(const AABB &b) {
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+}
+
+void AABB::merge(const glm::vec3 &p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+}
+
+bool AABB::intersects(const AABB &b) const {
+    return min.x<=b.max.x && max.x>=b.min.x &&
+           min.y<=b.max.y && max.y>=b.min.y &&
+           min.z<=b.max.z && max.z>=b.min.z;
+}
+
+AABB AABB::transform(const glm::mat4 &m) const {
+    // Arvo's method: project the extents onto each world axis
+    glm::vec3 center = glm::vec3(m*glm::vec4(getCenter(), 1.f));
+    glm::vec3 extents = getExtents();
+    glm::vec3 worldExtents;
+    for(int i = 0;i<3;i++) {
+        worldExtents[i] = std::fabs(m[0][i])*extents.x+
+                          std::fabs(m[1][i])*extents.y+
+                          std::fabs(m[2][i])*extents.z;
+    }
+    return AABB(center-worldExtents, center+worldExtents);
+}
+
+BoundingSphere BoundingSphere::transform(const glm::mat4 &m) const {
+    float sx = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]));
+    float sy = glm::dot(glm::vec3(m[1]), glm::vec3(m[1]));
+    float sz = glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+    float scale = std::sqrt(glm::max(sx, glm::max(sy, sz)));
+    return BoundingSphere(glm::vec3(m*glm::vec4(center, 1.f)), radius*scale);
+}
+
+void Frustum::extract(const glm::mat4 &vp) {
+    // Gribb-Hartmann: planes are sums and differences of rows of vp
+    for(int i = 0;i<3;i++) {
+        glm::vec4 row(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+        glm::vec4 w(vp[0][3], vp[1][3], vp[2][3], vp[3][3]);
+        planes[2*i] = w+row;
+        planes[2*i+1] = w-row;
+    }
+
+    for(auto &p : planes) {
+        float len = glm::length(glm::vec3(p));
+        if(len>0) {
+            p = p/len;
+        }
+    }
+}
+
+bool Frustum::intersects(const BoundingSphere &s) const {
+    for(const auto &p : planes) {
+        if(glm::dot(glm::vec3(p), s.center)+p.w<-s.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const AABB &b) const {
+    glm::vec3 c = b.getCenter();
+    glm::vec3 e = b.getExtents();
+    for(const auto &p : planes) {
+        float r = e.x*std::fabs(p.x)+e.y*std::fabs(p.y)+e.z*std::fabs(p.z);
+        if(glm::dot(glm::vec3(p), c)+p.w<-r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AABB computeAABB(const void *positions, std::size_t count, std::size_t stride) {
+    if(!positions || !count) {
+        return AABB();
+    }
+
+    AABB box(getPosition(positions, 0, stride), getPosition(positions, 0, stride));
+    for(std::size_t i = 1;i<count;i++) {
+        box.merge(getPosition(positions, i, stride));
+    }
+    return box;
+}
+
+BoundingSphere computeBoundingSphere(const void *positions, std::size_t count,
+                                     std::size_t stride) {
+    if(!positions || !count) {
+        return BoundingSphere();
+    }
+
+    // Centered at the AABB center, tighter than the box diagonal
+    // for most meshes and cheap to build
+    glm::vec3 center = computeAABB(positions, count, stride).getCenter();
+    float radius2 = 0;
+    for(std::size_t i = 0;i<count;i++) {
+        glm::vec3 d = getPosition(positions, i, stride)-center;
+        radius2 = glm::max(radius2, glm::dot(d, d));
+    }
+    return BoundingSphere(center, std::sqrt(radius2));
+}
+
+} // namespace splitspace
@@ -0,0 +1,353 @@
+#include <splitspace/Bvh.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace splitspace {
+
+static const std::uint32_t BVH_NO_PARENT = ~0u;
+static const int BVH_NUM_BINS = 16;
+static const std::uint32_t BVH_MAX_LEAF_SIZE = 4;
+
+Bvh::Bvh(): m_areaCost(0),
+            m_buildCost(0)
+{}
+
+void Bvh::clear() {
+    m_nodes.clear();
+    m_items.clear();
+    m_itemBounds.clear();
+    m_itemLeaf.clear();
+    m_dirtyLeaves.clear();
+    m_leafDirty.clear();
+    m_areaCost = 0;
+    m_buildCost = 0;
+}
+
+void Bvh::build(const std::vector<AABB> &bounds) {
+    clear();
+    if(bounds.empty()) {
+        return;
+    }
+
+    std::uint32_t n = bounds.size();
+    m_itemBounds = bounds;
+    m_itemLeaf.resize(n);
+    m_items.resize(n);
+    std::vector<glm::vec3> centroids(n);
+    for(std::uint32_t i = 0;i<n;i++) {
+        m_items[i] = i;
+        centroids[i] = bounds[i].getCenter();
+    }
+
+    // Binary tree with at most n leaves never exceeds 2n-1 nodes
+    m_nodes.reserve(2*n);
+    m_nodes.push_back(BvhNode());
+    m_nodes[0].parent = BVH_NO_PARENT;
+    buildNode(0, 0, n, centroids);
+
+    m_leafDirty.assign(m_nodes.size(), 0);
+    for(const auto &node : m_nodes) {
+        m_areaCost+=getNodeCost(node);
+    }
+    m_buildCost = getCost();
+}
+
+void Bvh::buildNode(std::uint32_t node, std::uint32_t begin, std::uint32_t end,
+                    const std::vector<glm::vec3> &centroids) {
+    AABB bounds = m_itemBounds[m_items[begin]];
+    AABB centroidBounds(centroids[m_items[begin]], centroids[m_items[begin]]);
+    for(std::uint32_t i = begin+1;i<end;i++) {
+        bounds.merge(m_itemBounds[m_items[i]]);
+        centroidBounds.merge(centroids[m_items[i]]);
+    }
+    m_nodes[node].bounds = bounds;
+
+    std::uint32_t count = end-begin;
+    if(count == 1) {
+        makeLeaf(node, begin, end);
+        return;
+    }
+
+    struct Bin {
+        AABB bounds;
+        std::uint32_t count;
+    };
+
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+    glm::vec3 extent = centroidBounds.max-centroidBounds.min;
+
+    for(int axis = 0;axis<3;axis++) {
+        if(extent[axis]<=0) {
+            continue;
+        }
+
+        Bin bins[BVH_NUM_BINS];
+        for(auto &b : bins) {
+            b.count = 0;
+        }
+        float scale = BVH_NUM_BINS/extent[axis];
+        for(std::uint32_t i = begin;i<end;i++) {
+            std::uint32_t item = m_items[i];
+            int b = std::min(BVH_NUM_BINS-1,
+                             int((centroids[item][axis]-centroidBounds.min[axis])*scale));
+            if(bins[b].count++) {
+                bins[b].bounds.merge(m_itemBounds[item]);
+            } else {
+                bins[b].bounds = m_itemBounds[item];
+            }
+        }
+
+        // Sweep from the right to get area and count right of each split
+        float rightCost[BVH_NUM_BINS];
+        AABB acc;
+        std::uint32_t accCount = 0;
+        for(int b = BVH_NUM_BINS-1;b>0;b--) {
+            if(bins[b].count) {
+                if(accCount) {
+                    acc.merge(bins[b].bounds);
+                } else {
+                    acc = bins[b].bounds;
+                }
+                accCount+=bins[b].count;
+            }
+            rightCost[b] = accCount?acc.getSurfaceArea()*accCount:0;
+        }
+
+        accCount = 0;
+        for(int b = 0;b<BVH_NUM_BINS-1;b++) {
+            if(bins[b].count) {
+                if(accCount) {
+                    acc.merge(bins[b].bounds);
+                } else {
+                    acc = bins[b].bounds;
+                }
+                accCount+=bins[b].count;
+            }
+            if(!accCount || accCount == count) {
+                continue;
+            }
+            float cost = acc.getSurfaceArea()*accCount+rightCost[b+1];
+            if(cost<bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b+1;
+            }
+        }
+    }
+
+    // Costs relative to one item test, traversal costs the same
+    float area = bounds.getSurfaceArea();
+    float leafCost = area*count;
+    float splitCost = area+bestCost;
+
+    std::uint32_t mid;
+    if(bestAxis<0) {
+        // Coincident centroids, SAH can not separate them
+        if(count<=BVH_MAX_LEAF_SIZE) {
+            makeLeaf(node, begin, end);
+            return;
+        }
+        mid = begin+count/2;
+    } else {
+        if(count<=BVH_MAX_LEAF_SIZE && leafCost<=splitCost) {
+            makeLeaf(node, begin, end);
+            return;
+        }
+        float minC = centroidBounds.min[bestAxis];
+        float scale = BVH_NUM_BINS/extent[bestAxis];
+        auto midIt = std::partition(m_items.begin()+begin, m_items.begin()+end,
+                                    [&](std::uint32_t item) {
+            int b = std::min(BVH_NUM_BINS-1, int((centroids[item][bestAxis]-minC)*scale));
+            return b<bestSplit;
+        });
+        mid = midIt-m_items.begin();
+        if(mid == begin || mid == end) {
+            mid = begin+count/2;
+        }
+    }
+
+    std::uint32_t left = m_nodes.size();
+    m_nodes[node].first = left;
+    m_nodes[node].count = 0;
+    m_nodes.push_back(BvhNode());
+    m_nodes.push_back(BvhNode());
+    m_nodes[left].parent = node;
+    m_nodes[left+1].parent = node;
+
+    buildNode(left, begin, mid, centroids);
+    buildNode(left+1, mid, end, centroids);
+}
+
+void Bvh::makeLeaf(std::uint32_t node, std::uint32_t begin, std::uint32_t end) {
+    m_nodes[node].first = begin;
+    m_nodes[node].count = end-begin;
+    for(std::uint32_t i = begin;i<end;i++) {
+        m_itemLeaf[m_items[i]] = node;
+    }
+}
+
+void Bvh::update(std::uint32_t item, const AABB &bounds) {
+    if(item>=m_itemBounds.size()) {
+        return;
+    }
+
+    m_itemBounds[item] = bounds;
+    std::uint32_t leaf = m_itemLeaf[item];
+    if(!m_leafDirty[leaf]) {
+        m_leafDirty[leaf] = 1;
+        m_dirtyLeaves.push_back(leaf);
+    }
+}
+
+std::size_t Bvh::refit() {
+    std::size_t changed = 0;
+    for(auto leaf : m_dirtyLeaves) {
+        m_leafDirty[leaf] = 0;
+
+        const BvhNode &l = m_nodes[leaf];
+        AABB bounds = m_itemBounds[m_items[l.first]];
+        for(std::uint32_t i = l.first+1;i<l.first+l.count;i++) {
+            bounds.merge(m_itemBounds[m_items[i]]);
+        }
+
+        // Walk up until a node is not affected by the change
+        std::uint32_t node = leaf;
+        while(m_nodes[node].bounds!=bounds) {
+            setNodeBounds(node, bounds);
+            changed++;
+
+            node = m_nodes[node].parent;
+            if(node == BVH_NO_PARENT) {
+                break;
+            }
+            bounds = m_nodes[m_nodes[node].first].bounds;
+            bounds.merge(m_nodes[m_nodes[node].first+1].bounds);
+        }
+    }
+    m_dirtyLeaves.clear();
+    return changed;
+}
+
+void Bvh::setNodeBounds(std::uint32_t node, const AABB &bounds) {
+    BvhNode &n = m_nodes[node];
+    m_areaCost-=getNodeCost(n);
+    n.bounds = bounds;
+    m_areaCost+=getNodeCost(n);
+}
+
+float Bvh::getNodeCost(const BvhNode &n) const {
+    return n.bounds.getSurfaceArea()*(n.isLeaf()?n.count:1);
+}
+
+float Bvh::getCost() const {
+    if(m_nodes.empty()) {
+        return 0;
+    }
+    float rootArea = m_nodes[0].bounds.getSurfaceArea();
+    return rootArea>0?m_areaCost/rootArea:0;
+}
+
+bool Bvh::needsRebuild(float maxCostRatio) const {
+    return m_buildCost>0 && getCost()>m_buildCost*maxCostRatio;
+}
+
+void Bvh::collectLeaves(std::uint32_t node, std::vector<std::uint32_t> &items) const {
+    std::vector<std::uint32_t> stack;
+    stack.push_back(node);
+    while(!stack.empty()) {
+        const BvhNode &n = m_nodes[stack.back()];
+        stack.pop_back();
+        if(n.isLeaf()) {
+            items.insert(items.end(), m_items.begin()+n.first, m_items.begin()+n.first+n.count);
+        } else {
+            stack.push_back(n.first);
+            stack.push_back(n.first+1);
+        }
+    }
+}
+
+void Bvh::cullFrustum(const Frustum &f, std::vector<std::uint32_t> &inside,
+                      std::vector<std::uint32_t> &partial) const {
+    if(m_nodes.empty()) {
+        return;
+    }
+
+    struct Entry {
+        std::uint32_t node;
+        // Planes the node still crosses, children skip the rest
+        std::uint32_t planeMask;
+    };
+
+    const std::uint32_t allPlanes = (1<<FRUSTUM_NUM_PLANES)-1;
+    std::vector<Entry> stack;
+    stack.push_back(Entry{0, allPlanes});
+
+    while(!stack.empty()) {
+        Entry e = stack.back();
+        stack.pop_back();
+        const BvhNode &n = m_nodes[e.node];
+
+        glm::vec3 c = n.bounds.getCenter();
+        glm::vec3 ext = n.bounds.getExtents();
+        bool outside = false;
+        for(int p = 0;p<FRUSTUM_NUM_PLANES;p++) {
+            if(!(e.planeMask&(1<<p))) {
+                continue;
+            }
+            const glm::vec4 &plane = f.planes[p];
+            float r = ext.x*std::fabs(plane.x)+ext.y*std::fabs(plane.y)+ext.z*std::fabs(plane.z);
+            float d = plane.x*c.x+plane.y*c.y+plane.z*c.z+plane.w;
+            if(d<-r) {
+                outside = true;
+                break;
+            }
+            if(d>=r) {
+                e.planeMask&=~(1<<p);
+            }
+        }
+
+        if(outside) {
+            continue;
+        }
+        if(!e.planeMask) {
+            collectLeaves(e.node, inside);
+        } else if(n.isLeaf()) {
+            partial.insert(partial.end(), m_items.begin()+n.first, m_items.begin()+n.first+n.count);
+        } else {
+            stack.push_back(Entry{n.first, e.planeMask});
+            stack.push_back(Entry{n.first+1, e.planeMask});
+        }
+    }
+}
+
+void Bvh::query(const AABB &box, std::vector<std::uint32_t> &items) const {
+    if(m_nodes.empty()) {
+        return;
+    }
+
+    std::vector<std::uint32_t> stack;
+    stack.push_back(0);
+    while(!stack.empty()) {
+        const BvhNode &n = m_nodes[stack.back()];
+        stack.pop_back();
+        if(!n.bounds.intersects(box)) {
+            continue;
+        }
+        if(n.isLeaf()) {
+            for(std::uint32_t i = n.first;i<n.first+n.count;i++) {
+                if(m_itemBounds[m_items[i]].intersects(box)) {
+                    items.push_back(m_items[i]);
+                }
+            }
+        } else {
+            stack.push_back(n.first);
+            stack.push_back(n.first+1);
+        }
+    }
+}
+
+} // namespace splitspace
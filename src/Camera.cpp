@@ -10,6 +10,9 @@ Camera::Camera(float w, float h, float fov, float near, float far):
                m_width(w), m_height(h), m_fov(fov), m_near(near), m_far(far)
 {
     m_projMat = glm::perspective(m_fov, m_width/m_height, m_near, m_far);
+    m_viewMat = glm::mat4(1);
+    m_viewProj = m_projMat;
+    m_frustum.extract(m_viewProj);
 }
 
 FPSCamera::FPSCamera(float w, float h, float fov, float near, float far):
@@ -29,7 +32,9 @@ void FPSCamera::update(float dt) {
         m_position.z+=m_speed*dt*glm::cos(m_rotation.x*glm::pi<float>()/180.f);
     }
 
-    m_viewProj = m_projMat*glm::lookAt(prevPos, m_position, glm::vec3(0,1,0));
+    m_viewMat = glm::lookAt(prevPos, m_position, glm::vec3(0,1,0));
+    m_viewProj = m_projMat*m_viewMat;
+    m_frustum.extract(m_viewProj);
 }
 
 void FPSCamera::destroy() {
@@ -46,7 +51,9 @@ bool LookatCamera::init() {
 
 void LookatCamera::update(float dt) {
     static_cast<void>(dt);
-    m_viewProj = m_projMat*glm::lookAt(m_position, m_lookPos, glm::vec3(0, 1, 0));
+    m_viewMat = glm::lookAt(m_position, m_lookPos, glm::vec3(0, 1, 0));
+    m_viewProj = m_projMat*m_viewMat;
+    m_frustum.extract(m_viewProj);
 }
 
 void LookatCamera::destroy() {
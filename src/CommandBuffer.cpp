@@ -0,0 +1,52 @@
+#include <splitspace/CommandBuffer.hpp>
+
+namespace splitspace {
+
+CommandBuffer::CommandBuffer()
+{}
+
+void CommandBuffer::clear() {
+    m_commands.clear();
+    m_matrices.clear();
+}
+
+void CommandBuffer::push(CommandType type, std::uint32_t arg0, std::uint32_t arg1,
+                         const Material *material) {
+    Command c;
+    c.type = type;
+    c.arg0 = arg0;
+    c.arg1 = arg1;
+    c.material = material;
+    m_commands.push_back(c);
+}
+
+void CommandBuffer::bindProgram(std::uint32_t program) {
+    push(CMD_BIND_PROGRAM, program);
+}
+
+void CommandBuffer::bindVertexArray(std::uint32_t vao) {
+    push(CMD_BIND_VERTEX_ARRAY, vao);
+}
+
+void CommandBuffer::setMaterial(const Material *material) {
+    push(CMD_SET_MATERIAL, 0, 0, material);
+}
+
+void CommandBuffer::setMatrix(std::uint32_t slot, const glm::mat4 &m) {
+    push(CMD_SET_MATRIX, slot, m_matrices.size());
+    m_matrices.push_back(m);
+}
+
+void CommandBuffer::setDepthWrite(bool enabled) {
+    push(CMD_SET_DEPTH_WRITE, enabled);
+}
+
+void CommandBuffer::draw(std::uint32_t numVerts) {
+    push(CMD_DRAW, numVerts);
+}
+
+void CommandBuffer::drawInstanced(std::uint32_t numVerts, std::uint32_t numInstances) {
+    push(CMD_DRAW_INSTANCED, numVerts, numInstances);
+}
+
+} // namespace splitspace
@@ -43,6 +43,10 @@ bool Config::parse(const std::string &path) {
             window.fullscreen = jwindow["fullscreen"];
             window.vsync = jwindow["vsync"];
             window.caption = jwindow["caption"];
+            window.headless = false;
+            if(!jwindow["headless"].is_null()) {
+                window.headless = jwindow["headless"];
+            }
         }
 
         auto jlogging = jconfig["logging"];
@@ -63,6 +67,67 @@ bool Config::parse(const std::string &path) {
             else 
                 log.level = LOG_WARN; // default
         }
+
+        fillDefaultRender();
+        auto jrender = jconfig["render"];
+        if(!jrender.is_null()) {
+            if(!jrender.is_object()) {
+                std::cerr << "[" << path << "]" << " render should be object!" << std::endl;
+                return false;
+            }
+            if(!jrender["occlusionQueries"].is_null()) {
+                render.occlusionQueries = jrender["occlusionQueries"];
+            }
+            if(!jrender["gpuCulling"].is_null()) {
+                render.gpuCulling = jrender["gpuCulling"];
+            }
+            if(!jrender["clusteredLights"].is_null()) {
+                render.clusteredLights = jrender["clusteredLights"];
+            }
+            if(!jrender["renderThread"].is_null()) {
+                render.renderThread = jrender["renderThread"];
+            }
+            if(!jrender["programCache"].is_null()) {
+                render.programCache = jrender["programCache"];
+            }
+            if(!jrender["dynamicResolution"].is_null()) {
+                render.dynamicResolution = jrender["dynamicResolution"];
+            }
+            if(!jrender["minResolutionScale"].is_null()) {
+                render.minResolutionScale = float(jrender["minResolutionScale"]);
+            }
+            if(!jrender["maxResolutionScale"].is_null()) {
+                render.maxResolutionScale = float(jrender["maxResolutionScale"]);
+            }
+            if(!jrender["targetFrameTime"].is_null()) {
+                render.targetFrameTime = float(jrender["targetFrameTime"]);
+            }
+            if(!jrender["upscaleFilter"].is_null()) {
+                render.upscaleFilter = jrender["upscaleFilter"];
+            }
+        }
+
+        fillDefaultLoop();
+        auto jloop = jconfig["loop"];
+        if(!jloop.is_null()) {
+            if(!jloop.is_object()) {
+                std::cerr << "[" << path << "]" << " loop should be object!" << std::endl;
+                return false;
+            }
+            if(!jloop["timestep"].is_null()) {
+                loop.timestep = jloop["timestep"];
+                if(!(loop.timestep>0)) {
+                    std::cerr << "[" << path << "]" << " loop.timestep should be positive!" << std::endl;
+                    return false;
+                }
+            }
+            if(!jloop["maxSteps"].is_null()) {
+                loop.maxSteps = jloop["maxSteps"];
+            }
+            if(!jloop["pipelined"].is_null()) {
+                loop.pipelined = jloop["pipelined"];
+            }
+        }
     } catch(std::domain_error e) {
         std::cerr << "[" << path << "]" << " Parse error:" << e.what() << std::endl;
         return false;
@@ -114,11 +179,31 @@ void Config::fillDefaultWindow() {
     window.height = 480;
     window.fullscreen = false;
     window.vsync = false;
+    window.headless = false;
 }
 
 void Config::fillDefaultLog() {
     log.logFile = "";
     log.level = LOG_WARN;
 }
+
+void Config::fillDefaultRender() {
+    render.occlusionQueries = false;
+    render.gpuCulling = true;
+    render.clusteredLights = true;
+    render.renderThread = false;
+    render.programCache = "cache/programs";
+    render.dynamicResolution = false;
+    render.minResolutionScale = 0.5f;
+    render.maxResolutionScale = 1.f;
+    render.targetFrameTime = 16.f;
+    render.upscaleFilter = "bilinear";
+}
+
+void Config::fillDefaultLoop() {
+    loop.timestep = 1.f/60.f;
+    loop.maxSteps = 5;
+    loop.pipelined = false;
+}
 } // namespace splitspace
 
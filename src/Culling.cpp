@@ -0,0 +1,121 @@
+#include <splitspace/Culling.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SPLITSPACE_CULL_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPLITSPACE_CULL_WIDTH 4
+#else
+#define SPLITSPACE_CULL_WIDTH 1
+#endif
+
+namespace splitspace {
+
+FrustumCuller::FrustumCuller(): m_count(0)
+{}
+
+int FrustumCuller::getBatchWidth() {
+    return SPLITSPACE_CULL_WIDTH;
+}
+
+void FrustumCuller::clear() {
+    m_count = 0;
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_radius.clear();
+}
+
+std::size_t FrustumCuller::add(const BoundingSphere &s) {
+    m_x.push_back(s.center.x);
+    m_y.push_back(s.center.y);
+    m_z.push_back(s.center.z);
+    m_radius.push_back(s.radius);
+    return m_count++;
+}
+
+void FrustumCuller::cullScalar(const Frustum &f, std::size_t begin) {
+    for(std::size_t i = begin;i<m_count;i++) {
+        std::uint8_t visible = 1;
+        for(const auto &p : f.planes) {
+            if(p.x*m_x[i]+p.y*m_y[i]+p.z*m_z[i]+p.w<-m_radius[i]) {
+                visible = 0;
+                break;
+            }
+        }
+        m_visible[i] = visible;
+    }
+}
+
+std::size_t FrustumCuller::cull(const Frustum &f) {
+    m_visible.resize(m_count);
+    std::size_t batched = m_count-m_count%SPLITSPACE_CULL_WIDTH;
+
+#if SPLITSPACE_CULL_WIDTH == 8
+    __m256 px[FRUSTUM_NUM_PLANES], py[FRUSTUM_NUM_PLANES];
+    __m256 pz[FRUSTUM_NUM_PLANES], pw[FRUSTUM_NUM_PLANES];
+    for(int p = 0;p<FRUSTUM_NUM_PLANES;p++) {
+        px[p] = _mm256_set1_ps(f.planes[p].x);
+        py[p] = _mm256_set1_ps(f.planes[p].y);
+        pz[p] = _mm256_set1_ps(f.planes[p].z);
+        pw[p] = _mm256_set1_ps(f.planes[p].w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for(std::size_t i = 0;i<batched;i+=8) {
+        __m256 x = _mm256_loadu_ps(&m_x[i]);
+        __m256 y = _mm256_loadu_ps(&m_y[i]);
+        __m256 z = _mm256_loadu_ps(&m_z[i]);
+        __m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(&m_radius[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int p = 0;p<FRUSTUM_NUM_PLANES;p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+                                     _mm256_add_ps(_mm256_mul_ps(pz[p], z), pw[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for(int j = 0;j<8;j++) {
+            m_visible[i+j] = (mask>>j)&1;
+        }
+    }
+#elif SPLITSPACE_CULL_WIDTH == 4
+    __m128 px[FRUSTUM_NUM_PLANES], py[FRUSTUM_NUM_PLANES];
+    __m128 pz[FRUSTUM_NUM_PLANES], pw[FRUSTUM_NUM_PLANES];
+    for(int p = 0;p<FRUSTUM_NUM_PLANES;p++) {
+        px[p] = _mm_set1_ps(f.planes[p].x);
+        py[p] = _mm_set1_ps(f.planes[p].y);
+        pz[p] = _mm_set1_ps(f.planes[p].z);
+        pw[p] = _mm_set1_ps(f.planes[p].w);
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for(std::size_t i = 0;i<batched;i+=4) {
+        __m128 x = _mm_loadu_ps(&m_x[i]);
+        __m128 y = _mm_loadu_ps(&m_y[i]);
+        __m128 z = _mm_loadu_ps(&m_z[i]);
+        __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(&m_radius[i]));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(int p = 0;p<FRUSTUM_NUM_PLANES;p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                                  _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for(int j = 0;j<4;j++) {
+            m_visible[i+j] = (mask>>j)&1;
+        }
+    }
+#endif
+
+    // Tail which does not fill a whole batch
+    cullScalar(f, batched);
+
+    std::size_t numVisible = 0;
+    for(std::size_t i = 0;i<m_count;i++) {
+        numVisible+=m_visible[i];
+    }
+    return numVisible;
+}
+
+} // namespace splitspace
@@ -8,51 +8,284 @@
 #include <splitspace/Object.hpp>
 #include <splitspace/Mesh.hpp>
 #include <splitspace/Material.hpp>
+#include <splitspace/Light.hpp>
+#include <splitspace/Scene.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/UniformBuffers.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
 
 namespace splitspace {
 
+struct GBufferFormat {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+};
+
+// 4+4+4 bytes of color targets plus 4 of depth-stencil per pixel
+static const GBufferFormat GBUFFER_FORMATS[GBUFFER_NUM_TARGETS] = {
+    { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
+    { GL_RG16F, GL_RG, GL_HALF_FLOAT },
+    { GL_R11F_G11F_B10F, GL_RGB, GL_HALF_FLOAT }
+};
+
+static const char *MESH_VOLUME = "__cube__";
+
+static const char *LIGHT_VS =
+    "layout(location = 0) in vec3 inPos;\n"
+    "uniform mat4 volumeMVP;\n"
+    "void main() {\n"
+    "    gl_Position = volumeMVP*vec4(inPos, 1.0);\n"
+    "}\n";
+
+static const char *STENCIL_FS =
+    "void main() {\n"
+    "}\n";
+
+// Blocks follow FrameUniforms and LightBlockUniforms
+static const std::string LIGHT_COMMON =
+    "struct Light {\n"
+    "    vec4 position;\n"
+    "    vec4 rotation;\n"
+    "    vec4 diffuse;\n"
+    "    vec4 specular;\n"
+    "    vec4 attenuation;\n"
+    "};\n"
+    "layout(std140) uniform FrameBlock {\n"
+    "    mat4 viewProj;\n"
+    "    vec4 cameraPos;\n"
+    "};\n"
+    "layout(std140) uniform LightBlock {\n"
+    "    int numLights;\n"
+    "    Light lights["+std::to_string(UBO_MAX_LIGHTS)+"];\n"
+    "};\n"
+    "uniform sampler2D gAlbedoSpec;\n"
+    "uniform sampler2D gNormal;\n"
+    "uniform sampler2D gDepth;\n"
+    "uniform mat4 invViewProj;\n"
+    "uniform vec2 gbufferSize;\n"
+    "uniform vec2 viewportSize;\n"
+    "layout(location = 0) out vec4 lightOut;\n"
+    "vec3 decodeNormal(vec2 e) {\n"
+    "    vec3 n = vec3(e, 1.0-abs(e.x)-abs(e.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.x += n.x>=0.0?-t:t;\n"
+    "    n.y += n.y>=0.0?-t:t;\n"
+    "    return normalize(n);\n"
+    "}\n"
+    "vec3 shade(Light l, vec3 pos, vec3 n, vec3 albedo, float specular) {\n"
+    "    int type = int(l.position.w);\n"
+    "    vec3 color = l.diffuse.rgb*l.diffuse.w;\n"
+    "    if(type == "+std::to_string(LIGHT_AMBIENT)+") {\n"
+    "        return albedo*color;\n"
+    "    }\n"
+    "    vec3 toLight;\n"
+    "    float att = 1.0;\n"
+    "    if(type == "+std::to_string(LIGHT_SUN)+") {\n"
+    "        toLight = -normalize(l.rotation.xyz);\n"
+    "    } else {\n"
+    "        vec3 d = l.position.xyz-pos;\n"
+    "        float dist = length(d);\n"
+    "        toLight = d/dist;\n"
+    "        att = 1.0/max(dot(l.attenuation.xyz, vec3(1.0, dist, dist*dist)), 1e-4);\n"
+    "        if(type == "+std::to_string(LIGHT_SPOT)+" &&\n"
+    "           dot(-toLight, normalize(l.rotation.xyz))<l.rotation.w) {\n"
+    "            return vec3(0.0);\n"
+    "        }\n"
+    "    }\n"
+    "    float ndl = max(dot(n, toLight), 0.0);\n"
+    "    vec3 h = normalize(toLight+normalize(cameraPos.xyz-pos));\n"
+    "    float s = pow(max(dot(n, h), 0.0), 32.0)*specular*step(0.0, ndl);\n"
+    "    return (albedo*color*ndl+l.specular.rgb*l.diffuse.w*s)*att;\n"
+    "}\n"
+    "bool fetchGBuffer(out vec3 pos, out vec3 n, out vec4 albedoSpec) {\n"
+    "    vec2 uv = gl_FragCoord.xy/gbufferSize;\n"
+    "    float depth = texture(gDepth, uv).r;\n"
+    "    if(depth == 1.0) {\n"
+    "        return false;\n"
+    "    }\n"
+    "    vec2 screen = gl_FragCoord.xy/viewportSize;\n"
+    "    vec4 p = invViewProj*vec4(vec3(screen, depth)*2.0-1.0, 1.0);\n"
+    "    pos = p.xyz/p.w;\n"
+    "    n = decodeNormal(texture(gNormal, uv).xy);\n"
+    "    albedoSpec = texture(gAlbedoSpec, uv);\n"
+    "    return true;\n"
+    "}\n";
+
+static const std::string AMBIENT_FS = LIGHT_COMMON+
+    "void main() {\n"
+    "    vec3 pos, n;\n"
+    "    vec4 a;\n"
+    "    if(!fetchGBuffer(pos, n, a)) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    vec3 c = vec3(0.0);\n"
+    "    for(int i = 0;i<numLights;i++) {\n"
+    "        int type = int(lights[i].position.w);\n"
+    "        if(type == "+std::to_string(LIGHT_AMBIENT)+" || type == "+std::to_string(LIGHT_SUN)+") {\n"
+    "            c += shade(lights[i], pos, n, a.rgb, a.a);\n"
+    "        }\n"
+    "    }\n"
+    "    lightOut = vec4(c, 1.0);\n"
+    "}\n";
+
+static const std::string VOLUME_FS = LIGHT_COMMON+
+    "uniform int lightIndex;\n"
+    "void main() {\n"
+    "    vec3 pos, n;\n"
+    "    vec4 a;\n"
+    "    if(!fetchGBuffer(pos, n, a)) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    lightOut = vec4(shade(lights[lightIndex], pos, n, a.rgb, a.a), 1.0);\n"
+    "}\n";
+
+GBuffer::GBuffer(RenderManager *rm): m_renderManager(rm),
+                                     m_buffers(),
+                                     m_depthBuffer(0),
+                                     m_fbo(0),
+                                     m_lightDepth(0),
+                                     m_lightFbo(0),
+                                     m_width(0),
+                                     m_height(0)
+{}
+
 bool GBuffer::init(int w, int h) {
+    GLStateCache &state = m_renderManager->getGLState();
+    GpuMemoryTracker &mem = m_renderManager->getGpuMemory();
+    m_width = w;
+    m_height = h;
     glGenFramebuffers(1, &m_fbo);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glGenFramebuffers(1, &m_lightFbo);
 
     glGenTextures(GBUFFER_NUM_TARGETS, m_buffers);
 
-    std::vector<GLenum> drawBuffers;
-
     for(int i = 0;i<GBUFFER_NUM_TARGETS;i++) {
-        glBindTexture(GL_TEXTURE_2D, m_buffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, w, h, 0, GL_RGB, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+i, 
-                               GL_TEXTURE_2D, m_buffers[i], 0);
-        drawBuffers.push_back(GL_COLOR+GL_COLOR_ATTACHMENT0+i);
-    }
-
-    glGenTextures(1, &m_depthBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_depthBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, w, h, 0,
-                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
-                           GL_TEXTURE_2D, m_depthBuffer, 0);
-
-    glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+        const GBufferFormat &f = GBUFFER_FORMATS[i];
+        state.bindTexture(0, GL_TEXTURE_2D, m_buffers[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, f.internalFormat, w, h, 0, f.format, f.type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        mem.allocate(GPU_MEM_RENDERTARGET, m_buffers[i],
+                     GpuMemoryTracker::getTextureSize(f.internalFormat, w, h));
+    }
 
-    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        return false;
+    GLuint depthBuffers[2];
+    glGenTextures(2, depthBuffers);
+    m_depthBuffer = depthBuffers[0];
+    m_lightDepth = depthBuffers[1];
+    for(int i = 0;i<2;i++) {
+        state.bindTexture(0, GL_TEXTURE_2D, depthBuffers[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, w, h, 0,
+                     GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        mem.allocate(GPU_MEM_RENDERTARGET, depthBuffers[i],
+                     GpuMemoryTracker::getTextureSize(GL_DEPTH24_STENCIL8, w, h));
     }
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    return true;
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+GBUFFER_ALBEDO_SPEC,
+                           GL_TEXTURE_2D, m_buffers[GBUFFER_ALBEDO_SPEC], 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+GBUFFER_NORMAL,
+                           GL_TEXTURE_2D, m_buffers[GBUFFER_NORMAL], 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                           GL_TEXTURE_2D, m_depthBuffer, 0);
+    bindWrite();
+    bool complete = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_lightFbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, m_buffers[GBUFFER_LIGHT], 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                           GL_TEXTURE_2D, m_lightDepth, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    complete = complete && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_renderManager->getDefaultFramebuffer());
+    return complete;
 }
 
 void GBuffer::bindWrite() {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    static const GLenum drawBuffers[] = {
+        GL_COLOR_ATTACHMENT0+GBUFFER_ALBEDO_SPEC,
+        GL_COLOR_ATTACHMENT0+GBUFFER_NORMAL
+    };
+    m_renderManager->getGLState().bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glDrawBuffers(2, drawBuffers);
+}
+
+void GBuffer::bindLighting(int w, int h) {
+    GLStateCache &state = m_renderManager->getGLState();
+    state.bindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, m_lightFbo);
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Material samplers would override filtering of the targets
+    state.bindTexture(GBUFFER_UNIT_ALBEDO_SPEC, GL_TEXTURE_2D, m_buffers[GBUFFER_ALBEDO_SPEC]);
+    state.bindSampler(GBUFFER_UNIT_ALBEDO_SPEC, 0);
+    state.bindTexture(GBUFFER_UNIT_NORMAL, GL_TEXTURE_2D, m_buffers[GBUFFER_NORMAL]);
+    state.bindSampler(GBUFFER_UNIT_NORMAL, 0);
+    state.bindTexture(GBUFFER_UNIT_DEPTH, GL_TEXTURE_2D, m_depthBuffer);
+    state.bindSampler(GBUFFER_UNIT_DEPTH, 0);
 }
 
 void GBuffer::bindRead() {
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    m_renderManager->getGLState().bindFramebuffer(GL_READ_FRAMEBUFFER, m_lightFbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+void GBuffer::blitToScreen() {
+    bindRead();
+    m_renderManager->getGLState().bindFramebuffer(GL_DRAW_FRAMEBUFFER,
+                                                  m_renderManager->getDefaultFramebuffer());
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
 }
 
-DefferedRenderTechnique::DefferedRenderTechnique(Engine *e): RenderTechnique(e)
+void GBuffer::destroy() {
+    GpuMemoryTracker &mem = m_renderManager->getGpuMemory();
+    for(int i = 0;i<GBUFFER_NUM_TARGETS;i++) {
+        mem.release(GPU_MEM_RENDERTARGET, m_buffers[i]);
+    }
+    mem.release(GPU_MEM_RENDERTARGET, m_depthBuffer);
+    mem.release(GPU_MEM_RENDERTARGET, m_lightDepth);
+
+    if(m_fbo) {
+        GLStateCache &state = m_renderManager->getGLState();
+        for(int i = 0;i<GBUFFER_NUM_TARGETS;i++) {
+            state.onDeleteTexture(m_buffers[i]);
+        }
+        state.onDeleteTexture(m_depthBuffer);
+        state.onDeleteTexture(m_lightDepth);
+        state.onDeleteFramebuffer(m_fbo);
+        state.onDeleteFramebuffer(m_lightFbo);
+        glDeleteTextures(GBUFFER_NUM_TARGETS, m_buffers);
+        glDeleteTextures(1, &m_depthBuffer);
+        glDeleteTextures(1, &m_lightDepth);
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteFramebuffers(1, &m_lightFbo);
+        m_depthBuffer = 0;
+        m_lightDepth = 0;
+        m_fbo = 0;
+        m_lightFbo = 0;
+    }
+}
+
+DefferedRenderTechnique::DefferedRenderTechnique(Engine *e): RenderTechnique(e),
+                                                             m_gbuffer(nullptr),
+                                                             m_firstPass(nullptr),
+                                                             m_ambientProgram(),
+                                                             m_volumeProgram(),
+                                                             m_stencilProgram(),
+                                                             m_volumeMesh(nullptr),
+                                                             m_screenVao(0),
+                                                             m_screenVbo(0)
 {}
 
 DefferedRenderTechnique::~DefferedRenderTechnique() {
@@ -60,26 +293,82 @@ DefferedRenderTechnique::~DefferedRenderTechnique() {
 }
 
 bool DefferedRenderTechnique::init() {
-    m_gbuffer = new GBuffer();
-    int w = m_engine->config->window.width;
-    int h = m_engine->config->window.height;
+    if(!initDynamicResolution()) {
+        return false;
+    }
 
-    if(!m_gbuffer->init(w, h)) {
+    // Allocated once at the largest size, a smaller scale only shrinks the viewport
+    m_gbuffer = new GBuffer(m_renderManager);
+    if(!m_gbuffer->init(m_maxWidth, m_maxHeight)) {
         m_logManager->logErr("(GBuffer) Failed to create framebuffer");
         return false;
     }
 
     m_firstPass = static_cast<Shader *>(m_resManager->loadResource("defferedShader_pass1"));
     if(!m_firstPass) {
-        m_logManager->logErr("DefferedRenderTechnique) Failed to load first pass shader");
+        m_logManager->logErr("(DefferedRenderTechnique) Failed to load first pass shader");
         return false;
     }
 
-    m_secondPass = static_cast<Shader *>(m_resManager->loadResource("defferedShader_pass2"));
-    if(!m_firstPass) {
-        m_logManager->logErr("(DefferedRenderTechnique) Failed to load second pass shader");
+    if(!m_renderManager->createShader(LIGHT_VS, STENCIL_FS, 330, 330, 0,
+                                      m_stencilProgram.program, false)) {
+        m_logManager->logErr("(DefferedRenderTechnique) Failed to create stencil shader");
+        return false;
+    }
+    m_stencilProgram.mvp = glGetUniformLocation(m_stencilProgram.program, "volumeMVP");
+
+    if(!createLightProgram(m_ambientProgram, AMBIENT_FS.c_str()) ||
+       !createLightProgram(m_volumeProgram, VOLUME_FS.c_str())) {
+        m_logManager->logErr("(DefferedRenderTechnique) Failed to create lighting shaders");
+        return false;
+    }
+
+    m_volumeMesh = m_resManager->loadPrimitive(MESH_VOLUME);
+    if(!m_volumeMesh) {
+        m_logManager->logErr("(DefferedRenderTechnique) Failed to load light volume mesh");
+        return false;
+    }
+
+    // One triangle covering the screen, positions are already in clip space
+    static const Vertex3DT screenTriangle[] = {
+        { glm::vec3(-1,-1,0), glm::vec2(0,0) },
+        { glm::vec3(3,-1,0), glm::vec2(2,0) },
+        { glm::vec3(-1,3,0), glm::vec2(0,2) }
+    };
+    if(!m_renderManager->createMesh(screenTriangle, VERTEX_3DT, 3, m_screenVbo, m_screenVao)) {
+        m_logManager->logErr("(DefferedRenderTechnique) Failed to create screen triangle");
         return false;
     }
+
+    if(!initOcclusionQueries()) {
+        return false;
+    }
+    return initGpuCulling();
+}
+
+bool DefferedRenderTechnique::createLightProgram(LightProgram &p, const char *fsSrc) {
+    if(!m_renderManager->createShader(LIGHT_VS, fsSrc, 330, 330, 1, p.program, false)) {
+        return false;
+    }
+
+    GLuint frameBlock = glGetUniformBlockIndex(p.program, UniformBuffers::getBlockName(UBO_FRAME));
+    GLuint lightBlock = glGetUniformBlockIndex(p.program, UniformBuffers::getBlockName(UBO_LIGHTS));
+    if(frameBlock!=GL_INVALID_INDEX) {
+        glUniformBlockBinding(p.program, frameBlock, UBO_FRAME);
+    }
+    if(lightBlock!=GL_INVALID_INDEX) {
+        glUniformBlockBinding(p.program, lightBlock, UBO_LIGHTS);
+    }
+
+    m_renderManager->getGLState().useProgram(p.program);
+    glUniform1i(glGetUniformLocation(p.program, "gAlbedoSpec"), GBUFFER_UNIT_ALBEDO_SPEC);
+    glUniform1i(glGetUniformLocation(p.program, "gNormal"), GBUFFER_UNIT_NORMAL);
+    glUniform1i(glGetUniformLocation(p.program, "gDepth"), GBUFFER_UNIT_DEPTH);
+    p.mvp = glGetUniformLocation(p.program, "volumeMVP");
+    p.invViewProj = glGetUniformLocation(p.program, "invViewProj");
+    p.gbufferSize = glGetUniformLocation(p.program, "gbufferSize");
+    p.viewportSize = glGetUniformLocation(p.program, "viewportSize");
+    p.lightIndex = glGetUniformLocation(p.program, "lightIndex");
     return true;
 }
 
@@ -88,46 +377,194 @@ void DefferedRenderTechnique::update(float dt) {
 }
 
 void DefferedRenderTechnique::render() {
-    // First pass: render GBuffer (Position, Normal and Diffuse Color)
+    GLStateCache &state = m_renderManager->getGLState();
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+
+    // First pass: render G-buffer (albedo with specular and normal)
+    profiler->beginPass("clear");
     m_gbuffer->bindWrite();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    profiler->endPass();
 
-    // copypasted from ForwardRenderTechnique
-    // should do smth about it
-    if(!m_scene) {
+    if(!m_packet->valid) {
         return;
     }
 
-    glUseProgram(m_firstPass->getProgramId());
-    const auto &renderMap = m_scene->getRenderMap();
-    for(auto it : renderMap) {
-        if(it.first) {
-            if(!setupMaterial(m_firstPass, it.first)) {
-                m_logManager->logErr("Failed to setup material");
-                continue;
-            }
+    updateUniformBuffers(true);
+
+    profiler->beginPass("geometry");
+    state.useProgram(m_firstPass->getProgramId());
+    drawRenderQueue(m_firstPass);
+    profiler->endPass();
+
+    // Second pass: accumulate lights, then copy the result to the screen
+    profiler->beginPass("lighting");
+    m_gbuffer->bindLighting(m_renderWidth, m_renderHeight);
+    // Light volumes leave the stencil zeroed behind them, one clear a frame is enough
+    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    renderLights();
+    profiler->endPass();
+
+    profiler->beginPass("resolve");
+    if(m_resolution) {
+        upscale(m_gbuffer->getTarget(GBUFFER_LIGHT));
+    } else {
+        m_gbuffer->blitToScreen();
+    }
+    profiler->endPass();
+}
+
+glm::vec3 DefferedRenderTechnique::reconstructPosition(const glm::mat4 &invViewProj,
+                                                      const glm::vec2 &fragCoord, float depth,
+                                                      const glm::vec2 &viewportSize) {
+    glm::vec2 screen = fragCoord/viewportSize;
+    glm::vec4 p = invViewProj*glm::vec4(glm::vec3(screen, depth)*2.f-1.f, 1.f);
+    return glm::vec3(p)/p.w;
+}
+
+Shader *DefferedRenderTechnique::getSceneShader() const {
+    return m_firstPass;
+}
+
+void DefferedRenderTechnique::setupLightProgram(const LightProgram &p, const glm::mat4 &mvp) {
+    m_renderManager->getGLState().useProgram(p.program);
+    glUniformMatrix4fv(p.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    if(p.invViewProj>=0) {
+        glm::mat4 invVP = glm::inverse(m_packet->view.viewProj);
+        glUniformMatrix4fv(p.invViewProj, 1, GL_FALSE, glm::value_ptr(invVP));
+        // Below full scale the viewport is a corner of the G-buffer
+        glUniform2f(p.gbufferSize, m_gbuffer->getWidth(), m_gbuffer->getHeight());
+        glUniform2f(p.viewportSize, m_renderWidth, m_renderHeight);
+    }
+}
+
+void DefferedRenderTechnique::drawVolume(const LightProgram &p, const glm::mat4 &mvp,
+                                         int lightIndex) {
+    m_renderManager->getGLState().useProgram(p.program);
+    glUniformMatrix4fv(p.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+    if(p.lightIndex>=0) {
+        glUniform1i(p.lightIndex, lightIndex);
+    }
+    drawCall(m_volumeMesh->getNumVerts());
+}
+
+void DefferedRenderTechnique::renderLights() {
+    GLStateCache &state = m_renderManager->getGLState();
+
+    state.setDepthMask(false);
+    state.setBlend(true);
+    state.setBlendFunc(GL_ONE, GL_ONE);
+    state.setDepthTest(false);
+
+    // The light block holds UBO_MAX_LIGHTS lights, more are drawn in batches
+    // with the block refilled in between, the first one is already uploaded
+    UniformBuffers *ubo = m_renderManager->getUniformBuffers();
+    const std::vector<LightUniforms> &lights = m_packet->lights;
+    std::size_t first = 0;
+    do {
+        if(first>0) {
+            ubo->updateLightBatch(lights, first);
+        }
+        renderLightBatch(first, std::min<std::size_t>(lights.size()-first, UBO_MAX_LIGHTS));
+        first+=UBO_MAX_LIGHTS;
+    } while(first<lights.size());
+
+    state.setStencilTest(false);
+    state.setColorMask(true);
+    state.setCullFace(true);
+    state.setCullFaceMode(GL_BACK);
+    state.setDepthTest(true);
+    state.setDepthMask(true);
+    state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void DefferedRenderTechnique::renderLightBatch(std::size_t first, std::size_t count) {
+    GLStateCache &state = m_renderManager->getGLState();
+    const glm::mat4 &vp = m_packet->view.viewProj;
+    const glm::mat4 identity(1);
+
+    // Ambient and sun lights touch every pixel, one pass shades them all
+    state.setStencilTest(false);
+    state.setColorMask(true);
+    state.setDepthTest(false);
+    state.setCullFace(true);
+    state.setCullFaceMode(GL_BACK);
+    state.bindVertexArray(m_screenVao);
+    setupLightProgram(m_ambientProgram, identity);
+    drawCall(3);
+
+    setupLightProgram(m_volumeProgram, identity);
+    const std::vector<LightUniforms> &lights = m_packet->lights;
+    for(std::size_t i = 0;i<count;i++) {
+        const LightUniforms &l = lights[first+i];
+        LightType type = UniformBuffers::getLightType(l);
+        if(type!=LIGHT_POINT && type!=LIGHT_SPOT) {
+            continue;
         }
 
-        for(auto o : it.second) {
-            m_firstPass->setMVP(m_viewCamera->getVP()*o->getWorldMat());
-            if(!setupMesh(m_firstPass, o->getMesh())) {
-                m_logManager->logErr("Failed to setup mesh");
-                continue;
-            }
-            drawCall(o->getMesh()->getNumVerts());
+        float range = UniformBuffers::getLightRange(l);
+        if(range<=0) {
+            continue;
         }
-    }
+        if(std::isinf(range)) {
+            // Unbounded lights have no volume, shade the whole screen
+            state.setStencilTest(false);
+            state.setCullFace(true);
+            state.setCullFaceMode(GL_BACK);
+            state.bindVertexArray(m_screenVao);
+            state.useProgram(m_volumeProgram.program);
+            glUniformMatrix4fv(m_volumeProgram.mvp, 1, GL_FALSE, glm::value_ptr(identity));
+            glUniform1i(m_volumeProgram.lightIndex, i);
+            drawCall(3);
+            continue;
+        }
+
+        glm::mat4 world = glm::scale(glm::translate(glm::mat4(1), glm::vec3(l.position)),
+                                     glm::vec3(2*range));
+        glm::mat4 mvp = vp*world;
+        state.bindVertexArray(m_volumeMesh->getVAO());
+        state.setStencilTest(true);
 
-    // Second pass: render to default framebuffer (screen)
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Stencil pass: non-zero where geometry lies inside the volume
+        state.setColorMask(false);
+        state.setDepthTest(true);
+        state.setCullFace(false);
+        glStencilFunc(GL_ALWAYS, 0, 0);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        drawVolume(m_stencilProgram, mvp, -1);
 
-    // Use GBuffer to fetch positions, normals, and colors
-    m_gbuffer->bindRead();
+        // Light pass: back faces, so it works with the camera inside.
+        // They cover every marked pixel and reset it for the next light.
+        state.setColorMask(true);
+        state.setDepthTest(false);
+        state.setCullFace(true);
+        state.setCullFaceMode(GL_FRONT);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+        drawVolume(m_volumeProgram, mvp, i);
+    }
 }
 
 void DefferedRenderTechnique::destroy() {
-
+    destroyOcclusionQueries();
+    destroyGpuCulling();
+    destroyDynamicResolution();
+    if(m_gbuffer) {
+        m_gbuffer->destroy();
+        delete m_gbuffer;
+        m_gbuffer = nullptr;
+    }
+    m_renderManager->destroyShader(m_ambientProgram.program);
+    m_renderManager->destroyShader(m_volumeProgram.program);
+    m_renderManager->destroyShader(m_stencilProgram.program);
+    if(m_screenVao) {
+        m_renderManager->destroyMesh(m_screenVao, m_screenVbo);
+    }
+    if(m_volumeMesh) {
+        m_resManager->unloadResource(MESH_VOLUME);
+        m_volumeMesh = nullptr;
+    }
 }
 
 
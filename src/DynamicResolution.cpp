@@ -0,0 +1,64 @@
+#include <splitspace/DynamicResolution.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace splitspace {
+
+DynamicResolution::DynamicResolution(float minScale, float maxScale, float targetMs, int latency):
+                                     m_minScale(std::max(minScale, RESOLUTION_SCALE_STEP)),
+                                     m_maxScale(std::max(maxScale, m_minScale)),
+                                     m_targetMs(targetMs),
+                                     m_latency(std::max(latency, 0)),
+                                     m_scale(m_maxScale),
+                                     m_average(0),
+                                     m_skipFrames(0),
+                                     m_numChanges(0)
+{}
+
+void DynamicResolution::addFrameTime(double gpuMs) {
+    if(gpuMs<=0 || m_targetMs<=0) {
+        return;
+    }
+    if(m_skipFrames>0) {
+        m_skipFrames--;
+        return;
+    }
+    m_average = m_average>0?m_average+(gpuMs-m_average)*RESOLUTION_SMOOTHING:gpuMs;
+
+    if(gpuMs>m_targetMs) {
+        float scale = m_scale*std::sqrt(m_targetMs*RESOLUTION_HEADROOM/gpuMs);
+        // Round down to a step, the epsilon keeps exact steps from dropping one more
+        setScale(std::floor(scale/RESOLUTION_SCALE_STEP+1e-3f)*RESOLUTION_SCALE_STEP);
+        return;
+    }
+
+    float next = m_scale+RESOLUTION_SCALE_STEP;
+    float ratio = next/m_scale;
+    if(m_average*ratio*ratio<m_targetMs*RESOLUTION_HEADROOM) {
+        setScale(next);
+    }
+}
+
+void DynamicResolution::setScale(float scale) {
+    scale = std::min(std::max(scale, m_minScale), m_maxScale);
+    if(scale == m_scale) {
+        return;
+    }
+    m_scale = scale;
+    m_average = 0;
+    m_skipFrames = m_latency;
+    m_numChanges++;
+}
+
+void DynamicResolution::getSize(int fullW, int fullH, int &w, int &h) const {
+    w = std::max(int(fullW*m_scale+0.5f), 1);
+    h = std::max(int(fullH*m_scale+0.5f), 1);
+}
+
+void DynamicResolution::getMaxSize(int fullW, int fullH, int &w, int &h) const {
+    w = std::max(int(fullW*m_maxScale+0.5f), 1);
+    h = std::max(int(fullH*m_maxScale+0.5f), 1);
+}
+
+} // namespace splitspace
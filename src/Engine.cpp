@@ -5,6 +5,8 @@
 #include <splitspace/RenderManager.hpp>
 #include <splitspace/ResourceManager.hpp>
 #include <splitspace/PhysicsManager.hpp>
+#include <splitspace/JobManager.hpp>
+#include <splitspace/FramePacket.hpp>
 #include <splitspace/Config.hpp>
 
 #include <iostream>
@@ -18,10 +20,12 @@ Engine::Engine():   logManager(nullptr),
                     resManager(nullptr),
                     renderManager(nullptr),
                     physManager(nullptr),
+                    jobManager(nullptr),
                     config(nullptr),
                     m_quit(false),
-                    m_avgFrameTime(0),
-                    m_totalFrames(0)
+                    m_alpha(0),
+                    m_totalFrames(0),
+                    m_droppedSteps(0)
 
 {}
 
@@ -29,14 +33,16 @@ Engine::~Engine() {
     destroyManagers();
 }
 
-bool Engine::init() {
+bool Engine::init(const std::string &configPath) {
     config = new Config();
-    if(!config->parse("data/main.json")) {
-        std::cerr << "Error parsing data/main.json" << std::endl;
+    if(!config->parse(configPath)) {
+        std::cerr << "Error parsing " << configPath << std::endl;
         return false;
     }
     if(!initLog())
         return false;
+    if(!initJobs())
+        return false;
     if(!initEvents())
         return false;
     if(!initWindow())
@@ -53,19 +59,67 @@ bool Engine::init() {
 
 void Engine::mainLoop() {
     using namespace std::chrono;
-    Event *e = new UpdateEvent(1);
-    milliseconds cur, last = duration_cast<milliseconds>(
-                        system_clock::now().time_since_epoch());
+    FixedTimestep timestep(config->loop.timestep, config->loop.maxSteps);
+    steady_clock::time_point last = steady_clock::now();
+    double frameTime = 0;
+    auto simulate = [&]() {
+        int steps = timestep.advance(frameTime);
+        m_alpha = timestep.getAlpha();
+        for(int i = 0;i<steps;i++) {
+            UpdateEvent e(timestep.getStep(), frameTime, m_alpha);
+            eventManager->emitEvent(&e);
+        }
+    };
+
+    bool threaded = false;
+    if(config->render.renderThread) {
+        threaded = renderManager->startRenderThread();
+        if(!threaded) {
+            logManager->logWarn("(Engine) Render thread unavailable, rendering on the main thread");
+        }
+    }
+
+    // Pipelined frames are drawn one frame late: while packet N is
+    // submitted here, frame N+1 is simulated and prepared on a job worker.
+    // The first frame has nothing prepared and only clears the screen.
+    const bool pipelined = config->loop.pipelined && !threaded;
+    int packet = 0;
     while(!m_quit) {
-        cur = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-        windowManager->collectEvents();
-        eventManager->emitEvent(e);
-        renderManager->render();
-        int t = cur.count()-last.count();
+        steady_clock::time_point cur = steady_clock::now();
+        frameTime = duration<double>(cur-last).count();
         last = cur;
+
+        // Input is collected while nothing is being simulated
+        windowManager->collectEvents();
+        if(threaded) {
+            // Blocks only when the render thread falls a full queue behind
+            simulate();
+            renderManager->queueFrame();
+        } else if(pipelined) {
+            FramePacket &drawn = renderManager->getFramePacket(packet);
+            packet = (packet+1)%FRAME_PACKETS;
+            FramePacket &prepared = renderManager->getFramePacket(packet);
+            jobManager->runAsync([&]() {
+                simulate();
+                renderManager->prepareFrame(prepared);
+            });
+            renderManager->renderFrame(drawn);
+            jobManager->waitAsync();
+        } else {
+            simulate();
+            renderManager->render();
+        }
+
+        resManager->releaseUnloaded();
+
+        // First delta only covers loop setup
+        if(m_totalFrames>0) {
+            m_frameTimes.add(frameTime*1000.0);
+        }
         m_totalFrames++;
-        m_avgFrameTime = m_avgFrameTime*(1-1.f/m_totalFrames)+(float)t/(m_totalFrames);
     }
+    renderManager->stopRenderThread();
+    m_droppedSteps = timestep.getDroppedSteps();
 
     logStats();
     eventManager->logStats();
@@ -83,6 +137,15 @@ bool Engine::initLog() {
     return true;
 }
 
+bool Engine::initJobs() {
+    jobManager = new JobManager(logManager);
+    if(!jobManager) {
+        logManager->logErr("(Engine) Memory error");
+        return false;
+    }
+    return jobManager->init();
+}
+
 bool Engine::initEvents() {
     eventManager = new EventManager(logManager);
     if(!eventManager) {
@@ -99,7 +162,8 @@ bool Engine::initWindow() {
         return false;
     }
     if(!windowManager->init(config->window.caption.c_str(), config->window.width,
-                            config->window.height, config->window.fullscreen)) {
+                            config->window.height, config->window.fullscreen,
+                            config->window.headless)) {
         logManager->logErr("(Engine) Error initalising WindowManager");
         return false;
     }
@@ -138,7 +202,7 @@ bool Engine::initRendering() {
         return false;
     }
 
-    return renderManager->init(config->window.vsync);
+    return renderManager->init(config->window.vsync, config->render.programCache);
 }
 
 bool Engine::initPhysics() {
@@ -159,6 +223,8 @@ void Engine::destroyManagers() {
         delete renderManager;
     if(physManager)
         delete physManager;
+    if(jobManager)
+        delete jobManager;
     if(logManager)
         delete logManager;
     if(eventManager)
@@ -167,7 +233,9 @@ void Engine::destroyManagers() {
 
 void Engine::logStats() {
     logManager->logInfo("(Engine) STATS:");
-    logManager->logInfo("\t Average frame time: "+std::to_string(m_avgFrameTime));
+    logManager->logInfo("\t Frames: "+std::to_string(m_totalFrames));
+    logManager->logInfo("\t Frame time: "+m_frameTimes.describe());
+    logManager->logInfo("\t Simulation steps dropped: "+std::to_string(m_droppedSteps));
 }
 
 } // namespace splitspace
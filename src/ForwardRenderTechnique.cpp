@@ -8,11 +8,39 @@
 #include <splitspace/Mesh.hpp>
 #include <splitspace/Camera.hpp>
 #include <splitspace/Object.hpp>
+#include <splitspace/Light.hpp>
+#include <splitspace/Config.hpp>
+
+#include <algorithm>
+#include <cmath>
 
 namespace splitspace {
 
+struct ClusterBufferFormat {
+    GLenum internalFormat;
+    std::size_t texelSize;
+    int unit;
+};
+
+static const ClusterBufferFormat CLUSTER_FORMATS[CLUSTER_NUM_BUFFERS] = {
+    { GL_RGBA32F, sizeof(glm::vec4), CLUSTER_UNIT_LIGHTS },
+    { GL_RG32UI, 2*sizeof(std::uint32_t), CLUSTER_UNIT_GRID },
+    { GL_R32UI, sizeof(std::uint32_t), CLUSTER_UNIT_INDICES }
+};
+
+const std::size_t CLUSTER_TEXELS_PER_LIGHT = sizeof(LightUniforms)/sizeof(glm::vec4);
+
 ForwardRenderTechnique::ForwardRenderTechnique(Engine *e): RenderTechnique(e),
-                                                           m_shader(nullptr)
+                                                           m_shader(nullptr),
+                                                           m_clusteredLights(false),
+                                                           m_clusterProj(0),
+                                                           m_maxClusterTexels(0),
+                                                           m_clusterBuffers(),
+                                                           m_clusterTextures(),
+                                                           m_clusterCapacity(),
+                                                           m_sceneFbo(0),
+                                                           m_sceneColor(0),
+                                                           m_sceneDepth(0)
 {}
 
 ForwardRenderTechnique::~ForwardRenderTechnique() {
@@ -25,7 +53,20 @@ bool ForwardRenderTechnique::init() {
         return false;
     }
     m_shader = defaultShader;
-    return true;
+    if(!initClusters()) {
+        return false;
+    }
+    if(!initDynamicResolution()) {
+        return false;
+    }
+    if(m_resolution && !createSceneTarget()) {
+        m_logManager->logErr("(ForwardRenderTechnique) Failed to create scene target");
+        return false;
+    }
+    if(!initOcclusionQueries()) {
+        return false;
+    }
+    return initGpuCulling();
 }
 
 void ForwardRenderTechnique::update(float dt) {
@@ -33,40 +74,226 @@ void ForwardRenderTechnique::update(float dt) {
 }
 
 void ForwardRenderTechnique::render() {
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+    if(m_sceneFbo) {
+        m_renderManager->getGLState().bindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+    }
+    profiler->beginPass("clear");
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-    if(!m_scene) {
-        return;
+    profiler->endPass();
+    if(m_packet->valid) {
+        drawScene();
+    }
+
+    if(m_sceneFbo) {
+        profiler->beginPass("upscale");
+        upscale(m_sceneColor);
+        profiler->endPass();
     }
+}
 
-    glUseProgram(m_shader->getProgramId());
-    const auto &renderMap = m_scene->getRenderMap();
-    const auto &lightList = m_scene->getLightList();
-    int i = 0;
-    for(const auto &l : lightList) {
-        m_shader->setLight(i++, l);
-    }
-    m_shader->setNumLights(lightList.size());
-    for(auto it : renderMap) {
-        if(it.first) {
-            if(!setupMaterial(m_shader, it.first)) {
-                m_logManager->logErr("Failed to setup material");
-                continue;
-            }
+void ForwardRenderTechnique::drawScene() {
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+    updateUniformBuffers();
+
+    m_renderManager->getGLState().useProgram(m_shader->getProgramId());
+    if(m_clusteredLights && m_shader->usesClusteredLights()) {
+        updateClusters();
+    } else if(!m_shader->hasUniformBlock(UBO_LIGHTS)) {
+        const auto &lights = m_packet->lights;
+        for(std::size_t i = 0;i<lights.size();i++) {
+            m_shader->setLight(i, lights[i]);
         }
+        m_shader->setNumLights(lights.size());
+    }
+
+    profiler->beginPass("geometry");
+    drawRenderQueue(m_shader);
+    profiler->endPass();
+}
+
+bool ForwardRenderTechnique::initClusters() {
+    m_clusteredLights = m_engine->config->render.clusteredLights && m_shader->usesClusteredLights();
+    if(!m_clusteredLights) {
+        return true;
+    }
 
-        for(auto o : it.second) {
-            m_shader->setMVP(m_viewCamera->getVP()*o->getWorldMat());
-            if(!setupMesh(m_shader, o->getMesh())) {
-                m_logManager->logErr("Failed to setup mesh");
-                continue;
-            }
-            drawCall(o->getMesh()->getNumVerts());
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    m_maxClusterTexels = std::max(maxTexels, 65536);
+    m_clusterer.setMaxIndices(m_maxClusterTexels);
+
+    // Grid has fixed size, lights and indices grow on demand
+    const std::size_t initialSize[CLUSTER_NUM_BUFFERS] = {
+        64*sizeof(LightUniforms),
+        m_clusterer.getGrid().size()*sizeof(std::uint32_t),
+        4096*sizeof(std::uint32_t)
+    };
+    for(int i = 0;i<CLUSTER_NUM_BUFFERS;i++) {
+        if(!m_renderManager->createTextureBuffer(CLUSTER_FORMATS[i].internalFormat, initialSize[i],
+                                                 m_clusterBuffers[i], m_clusterTextures[i])) {
+            m_logManager->logErr("(ForwardRenderTechnique) Failed to create light cluster buffers");
+            return false;
         }
+        m_clusterCapacity[i] = initialSize[i];
+    }
+    return true;
+}
+
+void ForwardRenderTechnique::destroyClusters() {
+    for(int i = 0;i<CLUSTER_NUM_BUFFERS;i++) {
+        m_renderManager->destroyTextureBuffer(m_clusterBuffers[i], m_clusterTextures[i]);
+        m_clusterCapacity[i] = 0;
+    }
+    m_clusteredLights = false;
+}
+
+bool ForwardRenderTechnique::uploadClusterBuffer(ClusterBuffer b, const void *data, std::size_t size) {
+    if(size>m_clusterCapacity[b]) {
+        std::size_t capacity = std::max(size, m_clusterCapacity[b]*2);
+        m_renderManager->destroyTextureBuffer(m_clusterBuffers[b], m_clusterTextures[b]);
+        if(!m_renderManager->createTextureBuffer(CLUSTER_FORMATS[b].internalFormat, capacity,
+                                                 m_clusterBuffers[b], m_clusterTextures[b])) {
+            m_logManager->logErr("(ForwardRenderTechnique) Failed to grow light cluster buffer");
+            m_clusterCapacity[b] = 0;
+            return false;
+        }
+        m_clusterCapacity[b] = capacity;
+    }
+    m_renderManager->updateTextureBuffer(m_clusterBuffers[b], 0, size, data);
+    return true;
+}
+
+void ForwardRenderTechnique::updateClusters() {
+    const FrameView &view = m_packet->view;
+    if(view.proj!=m_clusterProj) {
+        m_clusterProj = view.proj;
+        m_clusterer.setProjection(m_clusterProj, view.near, view.far);
+    }
+
+    // Lights reaching every fragment are not binned and go first
+    const std::vector<LightUniforms> &lights = m_packet->lights;
+    m_clusterLights.clear();
+    m_clusterer.clear();
+    for(const auto &l : lights) {
+        LightType type = UniformBuffers::getLightType(l);
+        if(type == LIGHT_AMBIENT || type == LIGHT_SUN || std::isinf(UniformBuffers::getLightRange(l))) {
+            m_clusterLights.push_back(l);
+        }
+    }
+    const std::uint32_t numGlobalLights = m_clusterLights.size();
+
+    const std::size_t maxLights = m_maxClusterTexels/CLUSTER_TEXELS_PER_LIGHT;
+    for(const auto &l : lights) {
+        // Lights past the texture buffer limit are left out
+        if(m_clusterLights.size()>=maxLights) {
+            break;
+        }
+        LightType type = UniformBuffers::getLightType(l);
+        if(type!=LIGHT_POINT && type!=LIGHT_SPOT) {
+            continue;
+        }
+        float range = UniformBuffers::getLightRange(l);
+        if(range<=0 || std::isinf(range)) {
+            continue;
+        }
+
+        glm::vec3 pos = glm::vec3(view.view*glm::vec4(glm::vec3(l.position), 1.f));
+        if(type == LIGHT_SPOT) {
+            glm::vec3 dir = glm::normalize(glm::vec3(view.view*glm::vec4(glm::vec3(l.rotation), 0.f)));
+            m_clusterer.addSpotLight(pos, range, dir, l.rotation.w);
+        } else {
+            m_clusterer.addPointLight(pos, range);
+        }
+        m_clusterLights.push_back(l);
+    }
+
+    m_clusterer.bin(m_engine->jobManager);
+
+    const auto &grid = m_clusterer.getGrid();
+    const auto &indices = m_clusterer.getIndices();
+    uploadClusterBuffer(CLUSTER_BUFFER_LIGHTS, m_clusterLights.data(),
+                        m_clusterLights.size()*sizeof(LightUniforms));
+    uploadClusterBuffer(CLUSTER_BUFFER_GRID, grid.data(), grid.size()*sizeof(std::uint32_t));
+    uploadClusterBuffer(CLUSTER_BUFFER_INDICES, indices.data(),
+                        indices.size()*sizeof(std::uint32_t));
+
+    ClusterUniforms cu;
+    cu.dims = glm::uvec4(m_clusterer.getDimX(), m_clusterer.getDimY(),
+                         m_clusterer.getDimZ(), numGlobalLights);
+    cu.depthParams = glm::vec4(view.near, view.far,
+                               m_clusterer.getDepthScale(), m_clusterer.getDepthBias());
+    cu.tileSize = glm::vec4(float(m_renderWidth)/m_clusterer.getDimX(),
+                            float(m_renderHeight)/m_clusterer.getDimY(), 0, 0);
+    m_renderManager->getUniformBuffers()->updateClusters(cu);
+
+    GLStateCache &state = m_renderManager->getGLState();
+    for(int i = 0;i<CLUSTER_NUM_BUFFERS;i++) {
+        state.bindTexture(CLUSTER_FORMATS[i].unit, GL_TEXTURE_BUFFER, m_clusterTextures[i]);
+    }
+}
+
+Shader *ForwardRenderTechnique::getSceneShader() const {
+    return m_shader;
+}
+
+bool ForwardRenderTechnique::createSceneTarget() {
+    GLStateCache &state = m_renderManager->getGLState();
+    GpuMemoryTracker &mem = m_renderManager->getGpuMemory();
+    glGenFramebuffers(1, &m_sceneFbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+
+    glGenTextures(1, &m_sceneColor);
+    state.bindTexture(0, GL_TEXTURE_2D, m_sceneColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_maxWidth, m_maxHeight, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mem.allocate(GPU_MEM_RENDERTARGET, m_sceneColor,
+                 GpuMemoryTracker::getTextureSize(GL_RGBA8, m_maxWidth, m_maxHeight));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_sceneColor, 0);
+
+    glGenTextures(1, &m_sceneDepth);
+    state.bindTexture(0, GL_TEXTURE_2D, m_sceneDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, m_maxWidth, m_maxHeight, 0,
+                 GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mem.allocate(GPU_MEM_RENDERTARGET, m_sceneDepth,
+                 GpuMemoryTracker::getTextureSize(GL_DEPTH24_STENCIL8, m_maxWidth, m_maxHeight));
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                           GL_TEXTURE_2D, m_sceneDepth, 0);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_renderManager->getDefaultFramebuffer());
+    return complete;
+}
+
+void ForwardRenderTechnique::destroySceneTarget() {
+    if(!m_sceneFbo) {
+        return;
     }
+    GLStateCache &state = m_renderManager->getGLState();
+    GpuMemoryTracker &mem = m_renderManager->getGpuMemory();
+    mem.release(GPU_MEM_RENDERTARGET, m_sceneColor);
+    mem.release(GPU_MEM_RENDERTARGET, m_sceneDepth);
+    state.onDeleteTexture(m_sceneColor);
+    state.onDeleteTexture(m_sceneDepth);
+    state.onDeleteFramebuffer(m_sceneFbo);
+    glDeleteTextures(1, &m_sceneColor);
+    glDeleteTextures(1, &m_sceneDepth);
+    glDeleteFramebuffers(1, &m_sceneFbo);
+    m_sceneColor = 0;
+    m_sceneDepth = 0;
+    m_sceneFbo = 0;
 }
 
 void ForwardRenderTechnique::destroy() {
-    // ?
+    destroyClusters();
+    destroyOcclusionQueries();
+    destroyGpuCulling();
+    destroySceneTarget();
+    destroyDynamicResolution();
 }
 
 } // namepsace splitspace
@@ -0,0 +1,280 @@
+#include <splitspace/GLStateCache.hpp>
+
+namespace splitspace {
+
+// No valid GL name or enum has all bits set
+static const GLuint UNKNOWN_STATE = ~0u;
+
+GLStateCache::GLStateCache(): m_frameIssued(0),
+                              m_frameSkipped(0),
+                              m_totalIssued(0),
+                              m_totalSkipped(0)
+{
+    invalidate();
+}
+
+void GLStateCache::invalidate() {
+    m_program = UNKNOWN_STATE;
+    m_vao = UNKNOWN_STATE;
+    m_activeUnit = UNKNOWN_STATE;
+    for(int i = 0;i<GL_STATE_MAX_TEXTURE_UNITS;i++) {
+        m_textures[i] = UNKNOWN_STATE;
+        m_textureTargets[i] = UNKNOWN_STATE;
+        m_samplers[i] = UNKNOWN_STATE;
+    }
+    m_drawFramebuffer = UNKNOWN_STATE;
+    m_readFramebuffer = UNKNOWN_STATE;
+    for(int i = 0;i<GL_STATE_MAX_UNIFORM_BUFFERS;i++) {
+        m_uniformBuffers[i].buffer = UNKNOWN_STATE;
+        m_uniformBuffers[i].offset = 0;
+        m_uniformBuffers[i].size = 0;
+    }
+
+    m_blend = UNKNOWN_STATE;
+    m_blendSrc = UNKNOWN_STATE;
+    m_blendDst = UNKNOWN_STATE;
+    m_depthTest = UNKNOWN_STATE;
+    m_depthMask = UNKNOWN_STATE;
+    m_depthFunc = UNKNOWN_STATE;
+    m_cullFace = UNKNOWN_STATE;
+    m_cullFaceMode = UNKNOWN_STATE;
+    m_colorMask = UNKNOWN_STATE;
+    m_stencilTest = UNKNOWN_STATE;
+}
+
+bool GLStateCache::changed(GLuint &cached, GLuint value) {
+    if(cached == value) {
+        m_frameSkipped++;
+        m_totalSkipped++;
+        return false;
+    }
+    cached = value;
+    m_frameIssued++;
+    m_totalIssued++;
+    return true;
+}
+
+void GLStateCache::setCap(GLenum cap, GLuint &cached, bool enabled) {
+    if(!changed(cached, enabled)) {
+        return;
+    }
+    if(enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+}
+
+void GLStateCache::activeTexture(int unit) {
+    if(changed(m_activeUnit, unit)) {
+        glActiveTexture(GL_TEXTURE0+unit);
+    }
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if(changed(m_program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if(changed(m_vao, vao)) {
+        glBindVertexArray(vao);
+    }
+}
+
+void GLStateCache::bindTexture(int unit, GLenum target, GLuint texture) {
+    if(unit<0 || unit>=GL_STATE_MAX_TEXTURE_UNITS) {
+        activeTexture(unit);
+        glBindTexture(target, texture);
+        return;
+    }
+    if(m_textures[unit] == texture && m_textureTargets[unit] == target) {
+        m_frameSkipped++;
+        m_totalSkipped++;
+        return;
+    }
+
+    activeTexture(unit);
+    m_textures[unit] = texture;
+    m_textureTargets[unit] = target;
+    m_frameIssued++;
+    m_totalIssued++;
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindSampler(int unit, GLuint sampler) {
+    if(unit<0 || unit>=GL_STATE_MAX_TEXTURE_UNITS) {
+        glBindSampler(unit, sampler);
+        return;
+    }
+    if(changed(m_samplers[unit], sampler)) {
+        glBindSampler(unit, sampler);
+    }
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint fbo) {
+    switch(target) {
+        case GL_DRAW_FRAMEBUFFER:
+            if(changed(m_drawFramebuffer, fbo)) {
+                glBindFramebuffer(target, fbo);
+            }
+            break;
+        case GL_READ_FRAMEBUFFER:
+            if(changed(m_readFramebuffer, fbo)) {
+                glBindFramebuffer(target, fbo);
+            }
+            break;
+        default:
+            if(m_drawFramebuffer == fbo && m_readFramebuffer == fbo) {
+                m_frameSkipped++;
+                m_totalSkipped++;
+                return;
+            }
+            m_drawFramebuffer = fbo;
+            m_readFramebuffer = fbo;
+            m_frameIssued++;
+            m_totalIssued++;
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            break;
+    }
+}
+
+void GLStateCache::bindUniformBuffer(GLuint index, GLuint buffer) {
+    if(index>=GL_STATE_MAX_UNIFORM_BUFFERS) {
+        glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+        return;
+    }
+
+    // Whole-buffer bindings are cached with zero size
+    bindUniformBufferRange(index, buffer, 0, 0);
+}
+
+void GLStateCache::bindUniformBufferRange(GLuint index, GLuint buffer,
+                                          GLintptr offset, GLsizeiptr size) {
+    if(index<GL_STATE_MAX_UNIFORM_BUFFERS) {
+        UniformBufferBinding &b = m_uniformBuffers[index];
+        if(b.buffer == buffer && b.offset == offset && b.size == size) {
+            m_frameSkipped++;
+            m_totalSkipped++;
+            return;
+        }
+        b.buffer = buffer;
+        b.offset = offset;
+        b.size = size;
+    }
+
+    m_frameIssued++;
+    m_totalIssued++;
+    if(size) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+    } else {
+        glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+    }
+}
+
+void GLStateCache::setBlend(bool enabled) {
+    setCap(GL_BLEND, m_blend, enabled);
+}
+
+void GLStateCache::setBlendFunc(GLenum src, GLenum dst) {
+    if(m_blendSrc == src && m_blendDst == dst) {
+        m_frameSkipped++;
+        m_totalSkipped++;
+        return;
+    }
+    m_blendSrc = src;
+    m_blendDst = dst;
+    m_frameIssued++;
+    m_totalIssued++;
+    glBlendFunc(src, dst);
+}
+
+void GLStateCache::setDepthTest(bool enabled) {
+    setCap(GL_DEPTH_TEST, m_depthTest, enabled);
+}
+
+void GLStateCache::setDepthMask(bool enabled) {
+    if(changed(m_depthMask, enabled)) {
+        glDepthMask(enabled?GL_TRUE:GL_FALSE);
+    }
+}
+
+void GLStateCache::setDepthFunc(GLenum func) {
+    if(changed(m_depthFunc, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::setCullFace(bool enabled) {
+    setCap(GL_CULL_FACE, m_cullFace, enabled);
+}
+
+void GLStateCache::setCullFaceMode(GLenum mode) {
+    if(changed(m_cullFaceMode, mode)) {
+        glCullFace(mode);
+    }
+}
+
+void GLStateCache::setStencilTest(bool enabled) {
+    setCap(GL_STENCIL_TEST, m_stencilTest, enabled);
+}
+
+void GLStateCache::setColorMask(bool enabled) {
+    if(changed(m_colorMask, enabled)) {
+        GLboolean mask = enabled?GL_TRUE:GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
+
+void GLStateCache::onDeleteProgram(GLuint program) {
+    if(m_program == program) {
+        m_program = UNKNOWN_STATE;
+    }
+}
+
+void GLStateCache::onDeleteVertexArray(GLuint vao) {
+    if(m_vao == vao) {
+        m_vao = UNKNOWN_STATE;
+    }
+}
+
+void GLStateCache::onDeleteTexture(GLuint texture) {
+    for(int i = 0;i<GL_STATE_MAX_TEXTURE_UNITS;i++) {
+        if(m_textures[i] == texture) {
+            m_textures[i] = UNKNOWN_STATE;
+        }
+    }
+}
+
+void GLStateCache::onDeleteSampler(GLuint sampler) {
+    for(int i = 0;i<GL_STATE_MAX_TEXTURE_UNITS;i++) {
+        if(m_samplers[i] == sampler) {
+            m_samplers[i] = UNKNOWN_STATE;
+        }
+    }
+}
+
+void GLStateCache::onDeleteFramebuffer(GLuint fbo) {
+    if(m_drawFramebuffer == fbo) {
+        m_drawFramebuffer = UNKNOWN_STATE;
+    }
+    if(m_readFramebuffer == fbo) {
+        m_readFramebuffer = UNKNOWN_STATE;
+    }
+}
+
+void GLStateCache::onDeleteBuffer(GLuint buffer) {
+    for(int i = 0;i<GL_STATE_MAX_UNIFORM_BUFFERS;i++) {
+        if(m_uniformBuffers[i].buffer == buffer) {
+            m_uniformBuffers[i].buffer = UNKNOWN_STATE;
+        }
+    }
+}
+
+void GLStateCache::beginFrame() {
+    m_frameIssued = 0;
+    m_frameSkipped = 0;
+}
+
+} // namespace splitspace
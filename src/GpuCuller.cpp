@@ -0,0 +1,316 @@
+#include <splitspace/GpuCuller.hpp>
+#include <splitspace/Engine.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/LogManager.hpp>
+#include <splitspace/Object.hpp>
+#include <splitspace/Material.hpp>
+#include <splitspace/Mesh.hpp>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <map>
+#include <algorithm>
+
+namespace splitspace {
+
+static const char *CULL_CS =
+    "layout(local_size_x = 64) in;\n"
+    "struct CullObject {\n"
+    "    vec4 sphere;\n"
+    "    mat4 world;\n"
+    "    uint bucket;\n"
+    "};\n"
+    "struct DrawCommand {\n"
+    "    uint count;\n"
+    "    uint instanceCount;\n"
+    "    uint first;\n"
+    "    uint baseInstance;\n"
+    "};\n"
+    "layout(std430, binding = 0) readonly buffer Objects { CullObject objects[]; };\n"
+    "layout(std430, binding = 1) buffer Commands { DrawCommand commands[]; };\n"
+    "layout(std430, binding = 2) writeonly buffer Instances { mat4 worlds[]; };\n"
+    "uniform vec4 planes[6];\n"
+    "uniform uint numObjects;\n"
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if(i>=numObjects) {\n"
+    "        return;\n"
+    "    }\n"
+    "    vec4 s = objects[i].sphere;\n"
+    "    for(int p = 0;p<6;p++) {\n"
+    "        if(dot(planes[p].xyz, s.xyz)+planes[p].w<-s.w) {\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    uint b = objects[i].bucket;\n"
+    "    uint slot = atomicAdd(commands[b].instanceCount, 1u);\n"
+    "    worlds[commands[b].baseInstance+slot] = objects[i].world;\n"
+    "}\n";
+
+GpuCuller::GpuCuller(Engine *e): m_renderManager(e->renderManager),
+                                 m_logManager(e->logManager),
+                                 m_program(0),
+                                 m_planesLocation(-1),
+                                 m_numObjectsLocation(-1),
+                                 m_objectBuffer(0),
+                                 m_commandBuffer(0),
+                                 m_instanceBuffer(0),
+                                 m_readbackBuffers(),
+                                 m_readbackFences(),
+                                 m_frame(0),
+                                 m_numVisible(0),
+                                 m_numCulled(0)
+{}
+
+GpuCuller::~GpuCuller() {
+    destroy();
+}
+
+bool GpuCuller::isSupported() {
+    return GLEW_VERSION_4_3;
+}
+
+bool GpuCuller::init() {
+    if(!isSupported()) {
+        m_logManager->logInfo("(GpuCuller) GL 4.3 is not available");
+        return false;
+    }
+
+    if(!m_renderManager->createComputeShader(CULL_CS, 430, m_program)) {
+        m_logManager->logErr("(GpuCuller) Failed to create culling shader");
+        return false;
+    }
+    m_planesLocation = glGetUniformLocation(m_program, "planes");
+    m_numObjectsLocation = glGetUniformLocation(m_program, "numObjects");
+    return true;
+}
+
+void GpuCuller::destroy() {
+    destroyBuffers();
+    m_renderManager->destroyShader(m_program);
+    m_objects.clear();
+}
+
+void GpuCuller::destroyBuffers() {
+    m_renderManager->destroyStorageBuffer(m_objectBuffer);
+    m_renderManager->destroyStorageBuffer(m_commandBuffer);
+    m_renderManager->destroyStorageBuffer(m_instanceBuffer);
+    for(int i = 0;i<GPU_CULL_READBACK_FRAMES;i++) {
+        m_renderManager->destroyStorageBuffer(m_readbackBuffers[i]);
+        if(m_readbackFences[i]) {
+            glDeleteSync(m_readbackFences[i]);
+            m_readbackFences[i] = 0;
+        }
+    }
+    m_readbackCommands.clear();
+    m_frame = 0;
+}
+
+GpuCuller::ObjectState GpuCuller::getState(const Object *o) {
+    ObjectState s;
+    s.material = o->getMaterial();
+    s.mesh = o->getMesh();
+    s.transparent = s.material && s.material->isTransparent();
+    return s;
+}
+
+bool GpuCuller::stateChanged(const std::vector<const Object *> &objects) const {
+    for(std::size_t i = 0;i<objects.size();i++) {
+        ObjectState s = getState(objects[i]);
+        const ObjectState &old = m_objectStates[i];
+        if(s.material!=old.material || s.mesh!=old.mesh || s.transparent!=old.transparent) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GpuCuller::fillObject(CullObject &co, const Object *o, std::uint32_t bucket) {
+    const BoundingSphere &s = o->getWorldBoundingSphere();
+    co.sphere = glm::vec4(s.center, s.radius);
+    co.world = o->getWorldMat();
+    co.bucket = bucket;
+    co.pad[0] = co.pad[1] = co.pad[2] = 0;
+}
+
+void GpuCuller::rebuild(const std::vector<const Object *> &objects) {
+    destroyBuffers();
+    m_objects = objects;
+    m_boundsVersions.resize(objects.size());
+    m_objectStates.resize(objects.size());
+    m_gpuObjects.clear();
+    m_cullObjects.clear();
+    m_transparentItems.clear();
+    m_buckets.clear();
+    m_commands.clear();
+
+    std::map<std::pair<const Material *, const Mesh *>, std::uint32_t> bucketIds;
+    std::vector<std::uint32_t> objectBuckets;
+    for(std::uint32_t i = 0;i<objects.size();i++) {
+        const Object *o = objects[i];
+        m_boundsVersions[i] = o->getBoundsVersion();
+        m_objectStates[i] = getState(o);
+        if(!o->getMesh()) {
+            continue;
+        }
+        if(m_objectStates[i].transparent) {
+            m_transparentItems.push_back(i);
+            continue;
+        }
+
+        auto key = std::make_pair(o->getMaterial(), o->getMesh());
+        auto it = bucketIds.find(key);
+        std::uint32_t bucket;
+        if(it == bucketIds.end()) {
+            bucket = m_buckets.size();
+            bucketIds[key] = bucket;
+            m_buckets.push_back(Bucket{key.first, key.second});
+            m_commands.push_back(DrawCommand{GLuint(key.second->getNumVerts()), 0, 0, 0});
+        } else {
+            bucket = it->second;
+        }
+        m_gpuObjects.push_back(i);
+        objectBuckets.push_back(bucket);
+        // Capacity first, base instances are computed below
+        m_commands[bucket].baseInstance++;
+    }
+
+    GLuint base = 0;
+    for(auto &c : m_commands) {
+        GLuint count = c.baseInstance;
+        c.baseInstance = base;
+        base+=count;
+    }
+
+    m_cullObjects.resize(m_gpuObjects.size());
+    for(std::size_t i = 0;i<m_gpuObjects.size();i++) {
+        fillObject(m_cullObjects[i], objects[m_gpuObjects[i]], objectBuckets[i]);
+    }
+
+    if(m_gpuObjects.empty()) {
+        return;
+    }
+    if(!m_renderManager->createStorageBuffer(m_cullObjects.size()*sizeof(CullObject),
+                                             m_cullObjects.data(), m_objectBuffer) ||
+       !m_renderManager->createStorageBuffer(m_commands.size()*sizeof(DrawCommand),
+                                             m_commands.data(), m_commandBuffer) ||
+       !m_renderManager->createStorageBuffer(m_gpuObjects.size()*sizeof(glm::mat4),
+                                             nullptr, m_instanceBuffer)) {
+        m_logManager->logErr("(GpuCuller) Failed to create buffers");
+        destroyBuffers();
+        m_gpuObjects.clear();
+        m_buckets.clear();
+        m_commands.clear();
+        return;
+    }
+    // Culling works without them, only the stats are missing
+    for(int i = 0;i<GPU_CULL_READBACK_FRAMES;i++) {
+        if(!m_renderManager->createStorageBuffer(m_commands.size()*sizeof(DrawCommand),
+                                                 nullptr, m_readbackBuffers[i])) {
+            m_logManager->logWarn("(GpuCuller) Failed to create readback buffers");
+            break;
+        }
+    }
+}
+
+void GpuCuller::update(const std::vector<const Object *> &objects) {
+    if(objects!=m_objects || stateChanged(objects)) {
+        rebuild(objects);
+        return;
+    }
+
+    // Objects are uploaded as one range spanning all changed ones
+    std::size_t first = m_gpuObjects.size(), last = 0;
+    for(std::size_t i = 0;i<m_gpuObjects.size();i++) {
+        std::uint32_t item = m_gpuObjects[i];
+        const Object *o = objects[item];
+        if(o->getBoundsVersion() == m_boundsVersions[item]) {
+            continue;
+        }
+        m_boundsVersions[item] = o->getBoundsVersion();
+        fillObject(m_cullObjects[i], o, m_cullObjects[i].bucket);
+        first = std::min(first, i);
+        last = i;
+    }
+
+    if(first<=last && first<m_gpuObjects.size()) {
+        m_renderManager->updateStorageBuffer(m_objectBuffer, first*sizeof(CullObject),
+                                             (last-first+1)*sizeof(CullObject),
+                                             &m_cullObjects[first]);
+    }
+}
+
+void GpuCuller::cull(const Frustum &frustum) {
+    if(m_gpuObjects.empty()) {
+        return;
+    }
+
+    // Instance counts restart from zero
+    m_renderManager->updateStorageBuffer(m_commandBuffer, 0, m_commands.size()*sizeof(DrawCommand),
+                                         m_commands.data());
+
+    m_renderManager->getGLState().useProgram(m_program);
+    glUniform4fv(m_planesLocation, FRUSTUM_NUM_PLANES, glm::value_ptr(frustum.planes[0]));
+    glUniform1ui(m_numObjectsLocation, m_gpuObjects.size());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_instanceBuffer);
+
+    GLuint groups = (m_gpuObjects.size()+GPU_CULL_GROUP_SIZE-1)/GPU_CULL_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT);
+    readBack();
+}
+
+void GpuCuller::readBack() {
+    int slot = m_frame%GPU_CULL_READBACK_FRAMES;
+    m_frame++;
+    if(!m_readbackBuffers[slot]) {
+        return;
+    }
+    const std::size_t size = m_commands.size()*sizeof(DrawCommand);
+
+    // Counts are skipped for a frame rather than waited for
+    GLsync &fence = m_readbackFences[slot];
+    if(fence) {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            m_readbackCommands.resize(m_commands.size());
+            glBindBuffer(GL_COPY_READ_BUFFER, m_readbackBuffers[slot]);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, size, m_readbackCommands.data());
+            m_numVisible = 0;
+            for(const auto &c : m_readbackCommands) {
+                m_numVisible+=c.instanceCount;
+            }
+            m_numCulled = m_gpuObjects.size()-std::min(m_numVisible, m_gpuObjects.size());
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_readbackBuffers[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GpuCuller::drawBucket(std::size_t bucket) {
+    if(bucket>=m_buckets.size()) {
+        return;
+    }
+    m_renderManager->bindInstanceBuffer(m_buckets[bucket].mesh->getVAO(), m_instanceBuffer, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    // Triangle stats come from the latest read back counts
+    std::uint64_t triangles = 0;
+    if(bucket<m_readbackCommands.size()) {
+        const DrawCommand &c = m_readbackCommands[bucket];
+        triangles = static_cast<std::uint64_t>(c.count/3)*c.instanceCount;
+    }
+    m_renderManager->drawArraysIndirect(bucket*sizeof(DrawCommand), triangles);
+    m_renderManager->unbindInstanceData(m_buckets[bucket].mesh->getVAO());
+}
+
+} // namespace splitspace
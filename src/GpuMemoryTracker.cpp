@@ -0,0 +1,161 @@
+#include <splitspace/GpuMemoryTracker.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+GpuMemoryTracker::GpuMemoryTracker(): m_totalUsed(0),
+                                      m_peakUsed(0)
+{
+    for(int i = 0;i<GPU_MEM_NUM_CATEGORIES;i++) {
+        m_used[i] = 0;
+    }
+}
+
+int GpuMemoryTracker::getBytesPerPixel(GLenum internalFormat) {
+    switch(internalFormat) {
+        case GL_ALPHA:
+        case GL_RED:
+        case GL_R8:
+            return 1;
+        case GL_RG:
+        case GL_RG8:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        // 24-bit formats are padded to 32-bit texels by drivers
+        case GL_RGB:
+        case GL_RGB8:
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_RG16F:
+        case GL_R32F:
+        case GL_R32UI:
+        case GL_R11F_G11F_B10F:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_RG32UI:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA32F:
+        case GL_RGBA32UI:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+int GpuMemoryTracker::getMipLevels(int w, int h) {
+    int levels = 1;
+    int sz = std::max(w, h);
+    while(sz>1) {
+        sz>>=1;
+        levels++;
+    }
+    return levels;
+}
+
+std::uint64_t GpuMemoryTracker::getTextureSize(GLenum internalFormat, int w, int h, int mipLevels) {
+    if(w<=0 || h<=0) {
+        return 0;
+    }
+
+    std::uint64_t bpp = getBytesPerPixel(internalFormat);
+    std::uint64_t size = 0;
+    for(int level = 0;level<mipLevels;level++) {
+        std::uint64_t lw = std::max(1, w>>level);
+        std::uint64_t lh = std::max(1, h>>level);
+        size+=lw*lh*bpp;
+    }
+    return size;
+}
+
+const char *GpuMemoryTracker::getCategoryName(GpuMemoryCategory c) {
+    switch(c) {
+        case GPU_MEM_TEXTURE:
+            return "textures";
+        case GPU_MEM_RENDERTARGET:
+            return "render targets";
+        case GPU_MEM_VERTEX_BUFFER:
+            return "vertex buffers";
+        case GPU_MEM_INDEX_BUFFER:
+            return "index buffers";
+        case GPU_MEM_UNIFORM_BUFFER:
+            return "uniform buffers";
+        case GPU_MEM_STORAGE_BUFFER:
+            return "storage buffers";
+        case GPU_MEM_TEXTURE_BUFFER:
+            return "texture buffers";
+        case GPU_MEM_OTHER:
+            return "other";
+        default:
+            return "unknown";
+    }
+}
+
+void GpuMemoryTracker::allocate(GpuMemoryCategory c, GLuint name, std::uint64_t bytes) {
+    if(!name) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    releaseLocked(c, name);
+    m_resources[c][name] = bytes;
+    m_used[c]+=bytes;
+    m_totalUsed+=bytes;
+    m_peakUsed = std::max(m_peakUsed, m_totalUsed);
+}
+
+void GpuMemoryTracker::release(GpuMemoryCategory c, GLuint name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    releaseLocked(c, name);
+}
+
+void GpuMemoryTracker::releaseLocked(GpuMemoryCategory c, GLuint name) {
+    auto it = m_resources[c].find(name);
+    if(it == m_resources[c].end()) {
+        return;
+    }
+
+    m_used[c]-=it->second;
+    m_totalUsed-=it->second;
+    m_resources[c].erase(it);
+}
+
+std::uint64_t GpuMemoryTracker::getUsed(GpuMemoryCategory c) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_used[c];
+}
+
+std::uint64_t GpuMemoryTracker::getTotalUsed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalUsed;
+}
+
+std::uint64_t GpuMemoryTracker::getPeakUsed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_peakUsed;
+}
+
+std::size_t GpuMemoryTracker::getResourceCount(GpuMemoryCategory c) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_resources[c].size();
+}
+
+std::uint64_t GpuMemoryTracker::getResourceSize(GpuMemoryCategory c, GLuint name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_resources[c].find(name);
+    if(it == m_resources[c].end()) {
+        return 0;
+    }
+    return it->second;
+}
+
+} // namespace splitspace
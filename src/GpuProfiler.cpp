@@ -0,0 +1,245 @@
+#include <splitspace/GpuProfiler.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/LogManager.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+static const GLenum PIPELINE_STAT_TARGETS[PIPELINE_NUM_STATS] = {
+    GL_VERTICES_SUBMITTED_ARB,
+    GL_PRIMITIVES_SUBMITTED_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+};
+
+static const char *PIPELINE_STAT_NAMES[PIPELINE_NUM_STATS] = {
+    "vertices",
+    "primitives",
+    "fragment invocations"
+};
+
+GpuProfiler::GpuProfiler(RenderManager *rm, LogManager *lm): m_renderManager(rm),
+                                                             m_logManager(lm),
+                                                             m_initialized(false),
+                                                             m_pipelineStats(false),
+                                                             m_frames(),
+                                                             m_currentFrame(0),
+                                                             m_lastStats(),
+                                                             m_droppedFrames(0),
+                                                             m_collectedFrames(0),
+                                                             m_begunFrames(0),
+                                                             m_lastCollectedFrame(0)
+{}
+
+GpuProfiler::~GpuProfiler() {
+    destroy();
+}
+
+bool GpuProfiler::init() {
+    m_pipelineStats = GLEW_ARB_pipeline_statistics_query;
+    for(auto &f : m_frames) {
+        f.numTimestamps = 0;
+        f.frame = 0;
+        f.pending = false;
+        for(int s = 0;s<PIPELINE_NUM_STATS;s++) {
+            f.stats[s] = 0;
+            if(m_pipelineStats && !m_renderManager->createQuery(f.stats[s])) {
+                m_logManager->logWarn("(GpuProfiler) Pipeline statistics are not available");
+                m_pipelineStats = false;
+            }
+        }
+    }
+    m_initialized = true;
+    return true;
+}
+
+void GpuProfiler::destroy() {
+    for(auto &f : m_frames) {
+        for(auto &q : f.timestamps) {
+            m_renderManager->destroyQuery(q);
+        }
+        f.timestamps.clear();
+        f.passes.clear();
+        f.numTimestamps = 0;
+        f.pending = false;
+        for(auto &q : f.stats) {
+            m_renderManager->destroyQuery(q);
+        }
+    }
+    m_openPasses.clear();
+    m_initialized = false;
+}
+
+GLuint GpuProfiler::timestamp(FrameQueries &f) {
+    if(f.numTimestamps == f.timestamps.size()) {
+        GLuint q = 0;
+        if(!m_renderManager->createQuery(q)) {
+            return 0;
+        }
+        f.timestamps.push_back(q);
+    }
+    GLuint q = f.timestamps[f.numTimestamps++];
+    glQueryCounter(q, GL_TIMESTAMP);
+    return q;
+}
+
+std::size_t GpuProfiler::findPass(const std::string &name) {
+    auto it = std::find(m_passNames.begin(), m_passNames.end(), name);
+    if(it!=m_passNames.end()) {
+        return it-m_passNames.begin();
+    }
+    m_passNames.push_back(name);
+    m_passTimes.push_back(TimingHistory());
+    return m_passNames.size()-1;
+}
+
+const TimingHistory *GpuProfiler::findPassTimes(const std::string &name) const {
+    auto it = std::find(m_passNames.begin(), m_passNames.end(), name);
+    if(it==m_passNames.end()) {
+        return nullptr;
+    }
+    return &m_passTimes[it-m_passNames.begin()];
+}
+
+void GpuProfiler::collect(FrameQueries &f, bool wait) {
+    if(!f.pending) {
+        return;
+    }
+    f.pending = false;
+
+    // Queries complete in order, the last one being ready means all are
+    GLint available = wait;
+    if(!wait) {
+        glGetQueryObjectiv(f.timestamps[f.numTimestamps-1], GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if(!available) {
+        m_droppedFrames++;
+        return;
+    }
+
+    auto elapsed = [](GLuint begin, GLuint end) -> double {
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(begin, GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(end, GL_QUERY_RESULT, &t1);
+        return t1>t0?(t1-t0)/1e6:0.0;
+    };
+
+    m_frameTimes.add(elapsed(f.timestamps[0], f.timestamps[f.numTimestamps-1]));
+    m_lastFramePasses.clear();
+    for(const auto &p : f.passes) {
+        if(p.begin && p.end) {
+            GpuPassSample s;
+            s.pass = p.pass;
+            s.ms = elapsed(p.begin, p.end);
+            m_passTimes[p.pass].add(s.ms);
+            m_lastFramePasses.push_back(s);
+        }
+    }
+
+    // Statistics are not ordered with the timestamps, stale ones are kept
+    // for a frame rather than waited for
+    if(m_pipelineStats) {
+        bool ready = true;
+        for(int s = 0;s<PIPELINE_NUM_STATS && ready && !wait;s++) {
+            glGetQueryObjectiv(f.stats[s], GL_QUERY_RESULT_AVAILABLE, &available);
+            ready = available!=0;
+        }
+        for(int s = 0;s<PIPELINE_NUM_STATS && ready;s++) {
+            GLuint64 value = 0;
+            glGetQueryObjectui64v(f.stats[s], GL_QUERY_RESULT, &value);
+            m_lastStats[s] = value;
+        }
+    }
+    m_lastCollectedFrame = f.frame;
+    m_collectedFrames++;
+}
+
+bool GpuProfiler::collectOldest() {
+    FrameQueries *oldest = nullptr;
+    for(auto &f : m_frames) {
+        if(f.pending && (!oldest || f.frame<oldest->frame)) {
+            oldest = &f;
+        }
+    }
+    if(!oldest) {
+        return false;
+    }
+    collect(*oldest, true);
+    return true;
+}
+
+void GpuProfiler::beginFrame() {
+    if(!m_initialized) {
+        return;
+    }
+    m_currentFrame = (m_currentFrame+1)%GPU_PROFILER_FRAMES;
+    FrameQueries &f = m_frames[m_currentFrame];
+    collect(f);
+
+    f.numTimestamps = 0;
+    f.frame = m_begunFrames++;
+    f.passes.clear();
+    m_openPasses.clear();
+    timestamp(f);
+    if(m_pipelineStats) {
+        for(int s = 0;s<PIPELINE_NUM_STATS;s++) {
+            glBeginQuery(PIPELINE_STAT_TARGETS[s], f.stats[s]);
+        }
+    }
+}
+
+void GpuProfiler::endFrame() {
+    if(!m_initialized) {
+        return;
+    }
+    while(!m_openPasses.empty()) {
+        endPass();
+    }
+    FrameQueries &f = m_frames[m_currentFrame];
+    if(m_pipelineStats) {
+        for(int s = 0;s<PIPELINE_NUM_STATS;s++) {
+            glEndQuery(PIPELINE_STAT_TARGETS[s]);
+        }
+    }
+    timestamp(f);
+    f.pending = f.numTimestamps>=2;
+}
+
+void GpuProfiler::beginPass(const std::string &name) {
+    if(!m_initialized) {
+        return;
+    }
+    FrameQueries &f = m_frames[m_currentFrame];
+    PassQuery p;
+    p.pass = findPass(name);
+    p.begin = timestamp(f);
+    p.end = 0;
+    m_openPasses.push_back(f.passes.size());
+    f.passes.push_back(p);
+}
+
+void GpuProfiler::endPass() {
+    if(!m_initialized || m_openPasses.empty()) {
+        return;
+    }
+    FrameQueries &f = m_frames[m_currentFrame];
+    f.passes[m_openPasses.back()].end = timestamp(f);
+    m_openPasses.pop_back();
+}
+
+void GpuProfiler::logStats() {
+    m_logManager->logInfo("\t GPU frame time: "+m_frameTimes.describe()+" over "
+                          +std::to_string(m_frameTimes.size())+" frames, "
+                          +std::to_string(m_droppedFrames)+" dropped");
+    for(std::size_t i = 0;i<m_passNames.size();i++) {
+        m_logManager->logInfo("\t\t "+m_passNames[i]+": "+m_passTimes[i].describe());
+    }
+    if(m_pipelineStats) {
+        for(int s = 0;s<PIPELINE_NUM_STATS;s++) {
+            m_logManager->logInfo("\t\t "+std::string(PIPELINE_STAT_NAMES[s])+": "
+                                  +std::to_string(m_lastStats[s])+" last frame");
+        }
+    }
+}
+
+} // namespace splitspace
@@ -0,0 +1,249 @@
+#include <splitspace/GraphRenderTechnique.hpp>
+#include <splitspace/RenderTargetPool.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/ResourceManager.hpp>
+#include <splitspace/LogManager.hpp>
+#include <splitspace/Shader.hpp>
+#include <splitspace/Config.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+GraphRenderTechnique::GraphRenderTechnique(Engine *e, const std::string &graph):
+                                           RenderTechnique(e),
+                                           m_graphName(graph),
+                                           m_graph(e->logManager),
+                                           m_pool(nullptr),
+                                           m_sceneShader(nullptr),
+                                           m_screenVao(0),
+                                           m_screenVbo(0)
+{}
+
+GraphRenderTechnique::~GraphRenderTechnique() {
+    destroy();
+}
+
+bool GraphRenderTechnique::init() {
+    ResourceManifest *rm = m_resManager->getManifest(m_graphName);
+    if(!rm || rm->type!=RES_RENDER_GRAPH) {
+        m_logManager->logErr("(GraphRenderTechnique) No render graph \""+m_graphName+"\"");
+        return false;
+    }
+    if(!m_graph.compile(static_cast<RenderGraphManifest *>(rm))) {
+        return false;
+    }
+    if(!initDynamicResolution()) {
+        return false;
+    }
+
+    m_pool = new RenderTargetPool(m_renderManager, m_logManager);
+    if(!m_pool->allocate(m_graph.getTargets(), m_maxWidth, m_maxHeight)) {
+        m_logManager->logErr("(GraphRenderTechnique) Failed to allocate targets of "+m_graphName);
+        return false;
+    }
+    // Framebuffers are created up front so a bad one fails here, not mid-frame
+    for(const auto &pass : m_graph.getPasses()) {
+        if(!pass.toBackbuffer && !m_pool->getFramebuffer(pass.colorOutputs, pass.depthOutput)) {
+            m_logManager->logErr("(GraphRenderTechnique) "+m_graphName+": pass \""+
+                                 m_graph.getManifest()->passes[pass.desc].name+
+                                 "\" can not be drawn to");
+            return false;
+        }
+    }
+    if(!loadShaders() || !createScreenTriangle()) {
+        return false;
+    }
+    // Every scene pass would query against its own depth and count again
+    if(m_graph.getNumScenePasses()>1 && m_engine->config->render.occlusionQueries) {
+        m_logManager->logWarn("(GraphRenderTechnique) "+m_graphName+
+                              ": occlusion queries are disabled with several scene passes");
+    } else if(!initOcclusionQueries()) {
+        return false;
+    }
+    return initGpuCulling();
+}
+
+bool GraphRenderTechnique::loadShaders() {
+    const RenderGraphManifest *manifest = m_graph.getManifest();
+    GLStateCache &state = m_renderManager->getGLState();
+    for(const auto &pass : m_graph.getPasses()) {
+        const GraphPassDesc &desc = manifest->passes[pass.desc];
+        Shader *shader = static_cast<Shader *>(m_resManager->loadResource(desc.shader));
+        if(!shader) {
+            m_logManager->logErr("(GraphRenderTechnique) Failed to load shader of pass \""+desc.name+"\"");
+            return false;
+        }
+        m_passShaders.push_back(shader);
+        m_uvScale.push_back(-1);
+        m_uvMax.push_back(-1);
+
+        // The render queue is built for one shader
+        if(desc.type == GRAPH_PASS_SCENE) {
+            if(m_sceneShader && m_sceneShader!=shader) {
+                m_logManager->logErr("(GraphRenderTechnique) "+m_graphName+
+                                     ": scene passes must share one shader");
+                return false;
+            }
+            // Only the legacy and block lights are set up by graphs
+            if(shader->usesClusteredLights()) {
+                m_logManager->logErr("(GraphRenderTechnique) "+m_graphName+
+                                     ": scene shader \""+desc.shader+"\" uses clustered lights");
+                return false;
+            }
+            m_sceneShader = shader;
+            continue;
+        }
+
+        // Inputs go to texture units in the order they are listed
+        GLuint program = shader->getProgramId();
+        state.useProgram(program);
+        for(std::size_t i = 0;i<desc.inputs.size();i++) {
+            glUniform1i(glGetUniformLocation(program, desc.inputs[i].c_str()), i);
+        }
+        m_uvScale.back() = glGetUniformLocation(program, "uvScale");
+        m_uvMax.back() = glGetUniformLocation(program, "uvMax");
+    }
+    return true;
+}
+
+bool GraphRenderTechnique::createScreenTriangle() {
+    // Texcoords span [0; 2], uvScale maps them to the rendered area
+    static const Vertex3DT screenTriangle[] = {
+        { glm::vec3(-1,-1,0), glm::vec2(0,0) },
+        { glm::vec3(3,-1,0), glm::vec2(2,0) },
+        { glm::vec3(-1,3,0), glm::vec2(0,2) }
+    };
+    if(!m_renderManager->createMesh(screenTriangle, VERTEX_3DT, 3, m_screenVbo, m_screenVao)) {
+        m_logManager->logErr("(GraphRenderTechnique) Failed to create screen triangle");
+        return false;
+    }
+    return true;
+}
+
+void GraphRenderTechnique::update(float dt) {
+    static_cast<void>(dt);
+}
+
+void GraphRenderTechnique::render() {
+    GLStateCache &state = m_renderManager->getGLState();
+    if(!m_packet->valid) {
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_renderManager->getDefaultFramebuffer());
+        glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+        return;
+    }
+    updateUniformBuffers();
+
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+    const RenderGraphManifest *manifest = m_graph.getManifest();
+    const auto &passes = m_graph.getPasses();
+    for(std::size_t i = 0;i<passes.size();i++) {
+        const GraphPassDesc &desc = manifest->passes[passes[i].desc];
+        profiler->beginPass(desc.name.c_str());
+        if(!bindPassTarget(passes[i])) {
+            profiler->endPass();
+            continue;
+        }
+        if(desc.clear) {
+            state.setDepthMask(true);
+            glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+        }
+        if(desc.type == GRAPH_PASS_SCENE) {
+            drawScenePass();
+        } else {
+            drawFullscreenPass(i);
+        }
+        profiler->endPass();
+    }
+}
+
+bool GraphRenderTechnique::bindPassTarget(const GraphPass &pass) {
+    GLStateCache &state = m_renderManager->getGLState();
+    if(pass.toBackbuffer) {
+        const WindowConfig &window = m_engine->config->window;
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_renderManager->getDefaultFramebuffer());
+        glViewport(0, 0, window.width, window.height);
+        return true;
+    }
+
+    // Framebuffer 0 would be the window, not the pass outputs
+    GLuint fbo = m_pool->getFramebuffer(pass.colorOutputs, pass.depthOutput);
+    if(!fbo) {
+        return false;
+    }
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    // Outputs of a pass share one scale
+    int target = pass.colorOutputs.empty()?pass.depthOutput:pass.colorOutputs[0];
+    float scale = m_graph.getTargets()[target].scale;
+    glViewport(0, 0, std::max(1, int(m_renderWidth*scale)), std::max(1, int(m_renderHeight*scale)));
+    return true;
+}
+
+void GraphRenderTechnique::drawScenePass() {
+    m_renderManager->getGLState().useProgram(m_sceneShader->getProgramId());
+    if(!m_sceneShader->hasUniformBlock(UBO_LIGHTS)) {
+        const auto &lights = m_packet->lights;
+        for(std::size_t i = 0;i<lights.size();i++) {
+            m_sceneShader->setLight(i, lights[i]);
+        }
+        m_sceneShader->setNumLights(lights.size());
+    }
+    drawRenderQueue(m_sceneShader);
+}
+
+void GraphRenderTechnique::drawFullscreenPass(std::size_t index) {
+    GLStateCache &state = m_renderManager->getGLState();
+    const GraphPass &pass = m_graph.getPasses()[index];
+    state.useProgram(m_passShaders[index]->getProgramId());
+    for(std::size_t i = 0;i<pass.inputs.size();i++) {
+        state.bindTexture(i, GL_TEXTURE_2D, m_pool->getTexture(pass.inputs[i]));
+        state.bindSampler(i, 0);
+    }
+    // Only the render size corner of the targets is drawn
+    glUniform2f(m_uvScale[index], float(m_renderWidth)/m_maxWidth, float(m_renderHeight)/m_maxHeight);
+    // Half a texel inside the drawn area of the smallest input
+    glm::vec2 uvMax(1.f);
+    for(auto input : pass.inputs) {
+        float scale = m_graph.getTargets()[input].scale;
+        float w = std::max(1, int(m_renderWidth*scale));
+        float h = std::max(1, int(m_renderHeight*scale));
+        float texW = std::max(1, int(m_maxWidth*scale));
+        float texH = std::max(1, int(m_maxHeight*scale));
+        uvMax.x = std::min(uvMax.x, (w-0.5f)/texW);
+        uvMax.y = std::min(uvMax.y, (h-0.5f)/texH);
+    }
+    glUniform2f(m_uvMax[index], uvMax.x, uvMax.y);
+
+    state.setDepthTest(false);
+    state.setCullFace(false);
+    state.bindVertexArray(m_screenVao);
+    m_renderManager->drawArrays(3);
+    state.setCullFace(true);
+    state.setDepthTest(true);
+}
+
+Shader *GraphRenderTechnique::getSceneShader() const {
+    return m_sceneShader;
+}
+
+void GraphRenderTechnique::destroy() {
+    destroyOcclusionQueries();
+    destroyGpuCulling();
+    if(m_screenVao) {
+        m_renderManager->destroyMesh(m_screenVao, m_screenVbo);
+        m_screenVao = 0;
+        m_screenVbo = 0;
+    }
+    if(m_pool) {
+        delete m_pool;
+        m_pool = nullptr;
+    }
+    m_passShaders.clear();
+    m_uvScale.clear();
+    m_uvMax.clear();
+    m_sceneShader = nullptr;
+    m_graph.clear();
+    destroyDynamicResolution();
+}
+
+} // namespace splitspace
@@ -0,0 +1,140 @@
+#include <splitspace/HeadlessContext.hpp>
+#include <splitspace/LogManager.hpp>
+
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <string>
+
+namespace splitspace {
+
+HeadlessContext::HeadlessContext(LogManager *lm): m_logManager(lm),
+                                                  m_display(EGL_NO_DISPLAY),
+                                                  m_context(EGL_NO_CONTEXT),
+                                                  m_surface(EGL_NO_SURFACE)
+{}
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+bool HeadlessContext::hasExtension(EGLDisplay display, const char *name) const {
+    const char *exts = eglQueryString(display, EGL_EXTENSIONS);
+    if(!exts) {
+        return false;
+    }
+    // Whole words only, names may prefix each other
+    std::size_t len = std::strlen(name);
+    for(const char *p = std::strstr(exts, name);p;p = std::strstr(p+len, name)) {
+        if((p == exts || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeadlessContext::init() {
+    // Surfaceless platform needs neither X11 nor a GPU device node
+    if(hasExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if(getPlatformDisplay) {
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if(m_display == EGL_NO_DISPLAY) {
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major = 0, minor = 0;
+    if(m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+        m_logManager->logErr("(HeadlessContext) Failed to initialise EGL display");
+        m_display = EGL_NO_DISPLAY;
+        return false;
+    }
+    m_logManager->logInfo("(HeadlessContext) EGL "+std::to_string(major)+"."+std::to_string(minor)
+                          +", "+std::string(eglQueryString(m_display, EGL_VENDOR)));
+
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        m_logManager->logErr("(HeadlessContext) EGL display does not support desktop OpenGL");
+        destroy();
+        return false;
+    }
+
+    const bool surfaceless = hasExtension(m_display, "EGL_KHR_surfaceless_context");
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, surfaceless?0:EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if(!eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs) || numConfigs<1) {
+        m_logManager->logErr("(HeadlessContext) No suitable EGL config");
+        destroy();
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+    if(m_context == EGL_NO_CONTEXT) {
+        m_logManager->logErr("(HeadlessContext) Failed to create GL 3.3 core context");
+        destroy();
+        return false;
+    }
+
+    if(!surfaceless) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttribs);
+        if(m_surface == EGL_NO_SURFACE) {
+            m_logManager->logErr("(HeadlessContext) Failed to create pbuffer surface");
+            destroy();
+            return false;
+        }
+    }
+
+    if(!makeCurrent()) {
+        destroy();
+        return false;
+    }
+    m_logManager->logInfo(std::string("(HeadlessContext) Created ")+(surfaceless?"surfaceless":"pbuffer")
+                          +" GL 3.3 context");
+    return true;
+}
+
+bool HeadlessContext::makeCurrent() {
+    if(!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+        m_logManager->logErr("(HeadlessContext) Failed to make context current");
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::release() {
+    if(m_display!=EGL_NO_DISPLAY) {
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+}
+
+void HeadlessContext::destroy() {
+    if(m_display == EGL_NO_DISPLAY) {
+        return;
+    }
+    release();
+    if(m_surface!=EGL_NO_SURFACE) {
+        eglDestroySurface(m_display, m_surface);
+        m_surface = EGL_NO_SURFACE;
+    }
+    if(m_context!=EGL_NO_CONTEXT) {
+        eglDestroyContext(m_display, m_context);
+        m_context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(m_display);
+    m_display = EGL_NO_DISPLAY;
+}
+
+} // namespace splitspace
@@ -0,0 +1,171 @@
+#include <splitspace/JobManager.hpp>
+#include <splitspace/LogManager.hpp>
+
+namespace splitspace {
+
+// Set on threads running chunks, so nested loops do not deadlock
+static thread_local bool t_insideJob = false;
+
+JobManager::JobManager(LogManager *logManager): m_logManager(logManager),
+                                                m_generation(0),
+                                                m_quit(false),
+                                                m_func(nullptr),
+                                                m_count(0),
+                                                m_grain(1),
+                                                m_nextChunk(0),
+                                                m_numChunks(0),
+                                                m_chunksDone(0),
+                                                m_activeWorkers(0),
+                                                m_asyncQueued(false),
+                                                m_asyncBusy(false)
+{}
+
+JobManager::~JobManager() {
+    destroy();
+}
+
+bool JobManager::init(int numWorkers) {
+    if(numWorkers<0) {
+        numWorkers = static_cast<int>(std::thread::hardware_concurrency())-1;
+        if(numWorkers<0) {
+            numWorkers = 0;
+        }
+    }
+
+    m_quit = false;
+    for(int i = 0;i<numWorkers;i++) {
+        m_workers.push_back(std::thread(&JobManager::workerLoop, this));
+    }
+
+    if(m_logManager) {
+        m_logManager->logInfo("(JobManager) Started "+std::to_string(numWorkers)+" worker threads");
+    }
+    return true;
+}
+
+void JobManager::destroy() {
+    waitAsync();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wakeCond.notify_all();
+    for(auto &t : m_workers) {
+        t.join();
+    }
+    m_workers.clear();
+}
+
+void JobManager::runChunks() {
+    bool wasInside = t_insideJob;
+    t_insideJob = true;
+    for(;;) {
+        std::size_t chunk = m_nextChunk.fetch_add(1);
+        if(chunk>=m_numChunks) {
+            break;
+        }
+        std::size_t begin = chunk*m_grain;
+        std::size_t end = begin+m_grain<m_count?begin+m_grain:m_count;
+        (*m_func)(begin, end);
+
+        if(m_chunksDone.fetch_add(1)+1 == m_numChunks) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_doneCond.notify_all();
+        }
+    }
+    t_insideJob = wasInside;
+}
+
+void JobManager::workerLoop() {
+    unsigned seen = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCond.wait(lock, [&] {
+                return m_quit || m_asyncQueued || m_generation!=seen;
+            });
+            if(m_quit) {
+                return;
+            }
+            if(m_asyncQueued) {
+                Task task = std::move(m_asyncTask);
+                m_asyncTask = Task();
+                m_asyncQueued = false;
+                lock.unlock();
+                task();
+                lock.lock();
+                m_asyncBusy = false;
+                m_doneCond.notify_all();
+                continue;
+            }
+            seen = m_generation;
+            m_activeWorkers++;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(--m_activeWorkers == 0) {
+            m_doneCond.notify_all();
+        }
+    }
+}
+
+void JobManager::runAsync(const Task &task) {
+    waitAsync();
+    if(m_workers.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_asyncTask = task;
+        m_asyncQueued = true;
+        m_asyncBusy = true;
+    }
+    m_wakeCond.notify_all();
+}
+
+void JobManager::waitAsync() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [&] { return !m_asyncBusy; });
+}
+
+void JobManager::parallelFor(std::size_t count, std::size_t grain, const RangeFunc &fn) {
+    if(!count) {
+        return;
+    }
+    if(!grain) {
+        grain = 1;
+    }
+
+    std::size_t numChunks = (count+grain-1)/grain;
+    if(m_workers.empty() || numChunks == 1 || t_insideJob) {
+        fn(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &fn;
+        m_count = count;
+        m_grain = grain;
+        m_numChunks = numChunks;
+        m_nextChunk = 0;
+        m_chunksDone = 0;
+        m_generation++;
+    }
+    m_wakeCond.notify_all();
+
+    runChunks();
+
+    // Workers may still hold m_func after the last chunk is done,
+    // wait for them to leave before fn goes out of scope
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [&] {
+        return m_chunksDone == m_numChunks && m_activeWorkers == 0;
+    });
+}
+
+} // namespace splitspace
@@ -1,5 +1,9 @@
 #include <splitspace/Light.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace splitspace {
 
 Light::Light(Engine *e, LightManifest *manifest, Entity *parent):
@@ -27,6 +31,25 @@ void Light::update(float dt) {
     Entity::update(dt);
 }
 
+float Light::getRange(const glm::vec3 &diffuse, float power, const glm::vec3 &attenuation) {
+    const glm::vec3 &a = attenuation;
+    glm::vec3 c = diffuse*power;
+    float cutoff = std::max(c.x, std::max(c.y, c.z))*256.f;
+
+    // Solve a.x+a.y*d+a.z*d^2 = cutoff for d
+    if(a.z>0) {
+        float disc = a.y*a.y-4*a.z*(a.x-cutoff);
+        if(disc<0) {
+            return 0;
+        }
+        return std::max(0.f, (-a.y+std::sqrt(disc))/(2*a.z));
+    }
+    if(a.y>0) {
+        return std::max(0.f, (cutoff-a.x)/a.y);
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
 LightType Light::getTypeFromName(const std::string &name) {
     if(name == "ambient") {
         return LIGHT_AMBIENT;
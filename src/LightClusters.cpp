@@ -0,0 +1,261 @@
+#include <splitspace/LightClusters.hpp>
+#include <splitspace/JobManager.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SPLITSPACE_CLUSTER_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPLITSPACE_CLUSTER_WIDTH 4
+#else
+#define SPLITSPACE_CLUSTER_WIDTH 1
+#endif
+
+namespace splitspace {
+
+LightClusterer::LightClusterer(int dimX, int dimY, int dimZ): m_dimX(dimX),
+                                                              m_dimY(dimY),
+                                                              m_dimZ(dimZ),
+                                                              m_depthScale(0),
+                                                              m_depthBias(0),
+                                                              m_scaleX(1),
+                                                              m_scaleY(1),
+                                                              m_near(1),
+                                                              m_far(2),
+                                                              m_maxIndices(~std::size_t(0)),
+                                                              m_slices(dimZ),
+                                                              m_grid(dimX*dimY*dimZ*2, 0)
+{
+    setProjection(glm::mat4(1), 1.f, 2.f);
+}
+
+void LightClusterer::setProjection(const glm::mat4 &proj, float near, float far) {
+    m_clusterBounds.resize(getNumClusters());
+    m_sliceBounds.resize(m_dimZ);
+    m_scaleX = proj[0][0];
+    m_scaleY = proj[1][1];
+    m_near = near;
+    m_far = far;
+
+    float logRatio = std::log(far/near);
+    m_depthScale = m_dimZ/logRatio;
+    m_depthBias = -m_dimZ*std::log(near)/logRatio;
+
+    // View x at depth d maps to NDC x*proj[0][0]/d
+    const float invScaleX = 1.f/proj[0][0];
+    const float invScaleY = 1.f/proj[1][1];
+    for(int z = 0;z<m_dimZ;z++) {
+        float d0 = near*std::pow(far/near, float(z)/m_dimZ);
+        float d1 = near*std::pow(far/near, float(z+1)/m_dimZ);
+        m_sliceBounds[z] = AABB(glm::vec3(-d1*invScaleX, -d1*invScaleY, -d1),
+                                glm::vec3(d1*invScaleX, d1*invScaleY, -d0));
+
+        for(int y = 0;y<m_dimY;y++) {
+            float y0 = -1.f+2.f*y/m_dimY, y1 = -1.f+2.f*(y+1)/m_dimY;
+            for(int x = 0;x<m_dimX;x++) {
+                float x0 = -1.f+2.f*x/m_dimX, x1 = -1.f+2.f*(x+1)/m_dimX;
+                // Sides of the cluster are planes through the eye, so
+                // extremes are at either the near or the far face
+                AABB &b = m_clusterBounds[(z*m_dimY+y)*m_dimX+x];
+                b.min = glm::vec3(std::min(x0*d0, x0*d1)*invScaleX,
+                                  std::min(y0*d0, y0*d1)*invScaleY, -d1);
+                b.max = glm::vec3(std::max(x1*d0, x1*d1)*invScaleX,
+                                  std::max(y1*d0, y1*d1)*invScaleY, -d0);
+            }
+        }
+    }
+}
+
+void LightClusterer::clear() {
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_radius.clear();
+    m_dir.clear();
+    m_cosCutoff.clear();
+}
+
+std::size_t LightClusterer::addPointLight(const glm::vec3 &pos, float radius) {
+    return addSpotLight(pos, radius, glm::vec3(0, 0, -1), -1.f);
+}
+
+std::size_t LightClusterer::addSpotLight(const glm::vec3 &pos, float radius,
+                                         const glm::vec3 &dir, float cosCutoff) {
+    m_x.push_back(pos.x);
+    m_y.push_back(pos.y);
+    m_z.push_back(pos.z);
+    m_radius.push_back(radius);
+    m_dir.push_back(dir);
+    m_cosCutoff.push_back(cosCutoff);
+    return m_x.size()-1;
+}
+
+int LightClusterer::getClusterIndex(const glm::vec3 &pos) const {
+    float d = -pos.z;
+    if(d<m_near || d>m_far) {
+        return -1;
+    }
+    float nx = pos.x*m_scaleX/d, ny = pos.y*m_scaleY/d;
+    if(nx<-1.f || nx>1.f || ny<-1.f || ny>1.f) {
+        return -1;
+    }
+    int x = std::min(int((nx+1.f)*0.5f*m_dimX), m_dimX-1);
+    int y = std::min(int((ny+1.f)*0.5f*m_dimY), m_dimY-1);
+    int z = std::min(std::max(int(std::log(d)*m_depthScale+m_depthBias), 0), m_dimZ-1);
+    return (z*m_dimY+y)*m_dimX+x;
+}
+
+void LightClusterer::testSpheres(const float *x, const float *y, const float *z, const float *r,
+                                 std::size_t count, const AABB &box, std::uint8_t *hits) {
+    std::size_t batched = count-count%SPLITSPACE_CLUSTER_WIDTH;
+
+    // Squared distance from the center to the box against squared radius
+#if SPLITSPACE_CLUSTER_WIDTH == 8
+    const __m256 minX = _mm256_set1_ps(box.min.x), maxX = _mm256_set1_ps(box.max.x);
+    const __m256 minY = _mm256_set1_ps(box.min.y), maxY = _mm256_set1_ps(box.max.y);
+    const __m256 minZ = _mm256_set1_ps(box.min.z), maxZ = _mm256_set1_ps(box.max.z);
+    const __m256 zero = _mm256_setzero_ps();
+    for(std::size_t i = 0;i<batched;i+=8) {
+        __m256 cx = _mm256_loadu_ps(x+i);
+        __m256 cy = _mm256_loadu_ps(y+i);
+        __m256 cz = _mm256_loadu_ps(z+i);
+        __m256 rad = _mm256_loadu_ps(r+i);
+        __m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minX, cx), _mm256_sub_ps(cx, maxX)), zero);
+        __m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minY, cy), _mm256_sub_ps(cy, maxY)), zero);
+        __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(minZ, cz), _mm256_sub_ps(cz, maxZ)), zero);
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                 _mm256_mul_ps(dz, dz));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_mul_ps(rad, rad), _CMP_LE_OQ));
+        for(int j = 0;j<8;j++) {
+            hits[i+j] = (mask>>j)&1;
+        }
+    }
+#elif SPLITSPACE_CLUSTER_WIDTH == 4
+    const __m128 minX = _mm_set1_ps(box.min.x), maxX = _mm_set1_ps(box.max.x);
+    const __m128 minY = _mm_set1_ps(box.min.y), maxY = _mm_set1_ps(box.max.y);
+    const __m128 minZ = _mm_set1_ps(box.min.z), maxZ = _mm_set1_ps(box.max.z);
+    const __m128 zero = _mm_setzero_ps();
+    for(std::size_t i = 0;i<batched;i+=4) {
+        __m128 cx = _mm_loadu_ps(x+i);
+        __m128 cy = _mm_loadu_ps(y+i);
+        __m128 cz = _mm_loadu_ps(z+i);
+        __m128 rad = _mm_loadu_ps(r+i);
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, cx), _mm_sub_ps(cx, maxX)), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, cy), _mm_sub_ps(cy, maxY)), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, cz), _mm_sub_ps(cz, maxZ)), zero);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                              _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(d, _mm_mul_ps(rad, rad)));
+        for(int j = 0;j<4;j++) {
+            hits[i+j] = (mask>>j)&1;
+        }
+    }
+#endif
+
+    // Tail which does not fill a whole batch
+    for(std::size_t i = batched;i<count;i++) {
+        float dx = std::max(std::max(box.min.x-x[i], x[i]-box.max.x), 0.f);
+        float dy = std::max(std::max(box.min.y-y[i], y[i]-box.max.y), 0.f);
+        float dz = std::max(std::max(box.min.z-z[i], z[i]-box.max.z), 0.f);
+        hits[i] = dx*dx+dy*dy+dz*dz<=r[i]*r[i];
+    }
+}
+
+bool LightClusterer::coneIntersects(std::uint32_t light, const AABB &box) const {
+    float cosCutoff = m_cosCutoff[light];
+    if(cosCutoff<=-1.f) {
+        return true;
+    }
+
+    // Cone against bounding sphere of the cluster
+    glm::vec3 c = box.getCenter();
+    float clusterRadius = glm::length(box.getExtents());
+    glm::vec3 v = c-glm::vec3(m_x[light], m_y[light], m_z[light]);
+    float lenSq = glm::dot(v, v);
+    float along = glm::dot(v, m_dir[light]);
+    float sinCutoff = std::sqrt(std::max(0.f, 1.f-cosCutoff*cosCutoff));
+    float closest = cosCutoff*std::sqrt(std::max(0.f, lenSq-along*along))-along*sinCutoff;
+
+    return closest<=clusterRadius && along<=clusterRadius+m_radius[light] &&
+           along>=-clusterRadius;
+}
+
+void LightClusterer::binSlice(int z) {
+    Slice &s = m_slices[z];
+    const std::size_t numLights = m_x.size();
+
+    // Narrow down to lights touching the slice before testing clusters
+    s.hits.resize(numLights);
+    testSpheres(m_x.data(), m_y.data(), m_z.data(), m_radius.data(), numLights,
+                m_sliceBounds[z], s.hits.data());
+    s.lights.clear();
+    s.x.clear();
+    s.y.clear();
+    s.z.clear();
+    s.radius.clear();
+    for(std::size_t i = 0;i<numLights;i++) {
+        if(!s.hits[i]) {
+            continue;
+        }
+        s.lights.push_back(i);
+        s.x.push_back(m_x[i]);
+        s.y.push_back(m_y[i]);
+        s.z.push_back(m_z[i]);
+        s.radius.push_back(m_radius[i]);
+    }
+
+    // Offsets are relative to the slice until all slices are done
+    s.indices.clear();
+    const std::size_t numCandidates = s.lights.size();
+    for(int c = z*m_dimX*m_dimY;c<(z+1)*m_dimX*m_dimY;c++) {
+        const AABB &box = m_clusterBounds[c];
+        testSpheres(s.x.data(), s.y.data(), s.z.data(), s.radius.data(), numCandidates,
+                    box, s.hits.data());
+        std::uint32_t offset = s.indices.size();
+        for(std::size_t i = 0;i<numCandidates;i++) {
+            if(s.hits[i] && coneIntersects(s.lights[i], box)) {
+                s.indices.push_back(s.lights[i]);
+            }
+        }
+        m_grid[c*2] = offset;
+        m_grid[c*2+1] = s.indices.size()-offset;
+    }
+}
+
+void LightClusterer::bin(JobManager *jobs) {
+    if(jobs) {
+        jobs->parallelFor(m_dimZ, 1, [this](std::size_t begin, std::size_t end) {
+            for(std::size_t z = begin;z<end;z++) {
+                binSlice(z);
+            }
+        });
+    } else {
+        for(int z = 0;z<m_dimZ;z++) {
+            binSlice(z);
+        }
+    }
+
+    m_indices.clear();
+    const int perSlice = m_dimX*m_dimY;
+    for(int z = 0;z<m_dimZ;z++) {
+        const Slice &s = m_slices[z];
+        std::size_t base = m_indices.size();
+        std::size_t room = m_maxIndices>base?m_maxIndices-base:0;
+        std::size_t copied = std::min(room, s.indices.size());
+        m_indices.insert(m_indices.end(), s.indices.begin(), s.indices.begin()+copied);
+
+        for(int c = z*perSlice;c<(z+1)*perSlice;c++) {
+            std::uint32_t offset = std::min<std::size_t>(m_grid[c*2], copied);
+            std::uint32_t end = std::min<std::size_t>(m_grid[c*2]+m_grid[c*2+1], copied);
+            m_grid[c*2] = base+offset;
+            m_grid[c*2+1] = end-offset;
+        }
+    }
+}
+
+} // namespace splitspace
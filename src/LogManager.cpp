@@ -19,6 +19,7 @@ LogManager::~LogManager() {
 void LogManager::logErr(const std::string &str) {
     if(str.empty())
         return;
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::cerr << "[Error] " << str << "\n";
     if(m_sink.is_open())
         m_sink << "[Error] " << str << "\n";
@@ -27,6 +28,7 @@ void LogManager::logErr(const std::string &str) {
 void LogManager::logWarn(const std::string &str) {
     if(m_logLevel<LOG_WARN || str.empty())
         return;
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::cerr << "[Warning] " << str << "\n";
     if(m_sink.is_open())
         m_sink << "[Warning] " << str << "\n";
@@ -35,12 +37,14 @@ void LogManager::logWarn(const std::string &str) {
 void LogManager::logInfo(const std::string &str) {
     if(m_logLevel<LOG_INFO || str.empty())
         return;
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::cout << "[Info] " << str << "\n";
     if(m_sink.is_open())
         m_sink << "[Info] " << str << "\n";
 }
 
 void LogManager::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::cout << std::flush;
     std::cerr << std::flush;
     if(m_sink.is_open())
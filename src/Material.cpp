@@ -8,7 +8,8 @@ namespace splitspace {
 Material::Material(Engine *e, MaterialManifest *man):
                               Resource(e, man),
                               m_diffuseMap(nullptr),
-                              m_normalMap(nullptr)
+                              m_normalMap(nullptr),
+                              m_samplerId(0)
 {}
 
 bool Material::load() {
@@ -49,7 +50,16 @@ bool Material::load() {
     return true;
 }
 
+bool Material::isTransparent() const {
+    MaterialManifest *mm = static_cast<MaterialManifest *>(m_manifest);
+    return mm && mm->diffuse.w<1.f;
+}
+
 void Material::unload() {
+    if(m_samplerId) {
+        m_renderMan->destroySampler(m_samplerId);
+    }
+    m_renderMan->releaseMaterial(this);
     m_isLoaded = false;
 }
 
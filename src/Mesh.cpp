@@ -6,11 +6,15 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <glm/gtc/constants.hpp>
+
 namespace splitspace {
 
 Mesh::Mesh(Engine *e, MeshManifest *manifest): Resource(e, manifest),
                                                m_vbo(0),
-                                               m_ibo(0)
+                                               m_ibo(0),
+                                               m_vao(0),
+                                               m_numVerts(0)
 {}
 
 bool Mesh::load() {
@@ -31,6 +35,11 @@ bool Mesh::load() {
     if(m_manifest->name == "__cube__") {
         return createCube();
     }
+
+    int segments = getSphereSegments(m_manifest->name);
+    if(segments) {
+        return createSphere(segments);
+    }
          
     Assimp::Importer importer;
 
@@ -63,6 +72,16 @@ bool Mesh::load() {
     }
 
     m_numVerts = mesh->mNumVertices;
+    m_aabb = computeAABB(mesh->mVertices, m_numVerts, sizeof(aiVector3D));
+    m_boundingSphere = computeBoundingSphere(mesh->mVertices, m_numVerts, sizeof(aiVector3D));
+    if(static_cast<MeshManifest *>(m_manifest)->keepPositions) {
+        m_positions.resize(m_numVerts);
+        for(std::size_t i = 0;i<m_numVerts;i++) {
+            m_positions[i] = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y,
+                                       mesh->mVertices[i].z);
+        }
+    }
+
     void *vertexData = nullptr;
     switch(format) {
         case VERTEX_3DT: {
@@ -126,6 +145,7 @@ bool Mesh::load() {
 void Mesh::unload() {
     m_logMan->logInfo("(Mesh) Unloading "+m_manifest->name);
     m_renderMan->destroyMesh(m_vao, m_vbo);
+    m_positions.clear();
     m_isLoaded = false;
 }
 
@@ -141,12 +161,111 @@ bool Mesh::createPlane() {
         { vec3(0.5,0,0.5), vec2(1,0), vec3(0,1,0) }
     };
 
-    return m_renderMan->createMesh(verts, VERTEX_3DTN, 6, m_vbo, m_vao);
+    m_numVerts = 6;
+    m_aabb = computeAABB(verts, m_numVerts, sizeof(Vertex3DTN));
+    m_boundingSphere = computeBoundingSphere(verts, m_numVerts, sizeof(Vertex3DTN));
+    if(static_cast<MeshManifest *>(m_manifest)->keepPositions) {
+        for(const auto &v : verts) {
+            m_positions.push_back(v.pos);
+        }
+    }
+    return m_renderMan->createMesh(verts, VERTEX_3DTN, m_numVerts, m_vbo, m_vao);
 }
 
 bool Mesh::createCube() {
-    //TODO
-    return true;
+    using namespace glm;
+    static const vec3 normals[] = {
+        vec3(1,0,0), vec3(-1,0,0), vec3(0,1,0), vec3(0,-1,0), vec3(0,0,1), vec3(0,0,-1)
+    };
+    static const vec2 corners[] = {
+        vec2(0,0), vec2(1,0), vec2(1,1), vec2(0,0), vec2(1,1), vec2(0,1)
+    };
+
+    // Unit cube centered at origin, faces wound counter-clockwise from outside
+    std::vector<Vertex3DTN> verts;
+    for(const auto &n : normals) {
+        vec3 u = n.x!=0?vec3(0,0,-n.x):vec3(n.y+n.z, 0, 0);
+        vec3 v = cross(n, u);
+        for(const auto &c : corners) {
+            Vertex3DTN vert;
+            vert.pos = n*0.5f+u*(c.x-0.5f)+v*(c.y-0.5f);
+            vert.texcoord = c;
+            vert.normal = n;
+            verts.push_back(vert);
+        }
+    }
+
+    m_numVerts = verts.size();
+    m_aabb = computeAABB(verts.data(), m_numVerts, sizeof(Vertex3DTN));
+    m_boundingSphere = computeBoundingSphere(verts.data(), m_numVerts, sizeof(Vertex3DTN));
+    if(static_cast<MeshManifest *>(m_manifest)->keepPositions) {
+        for(const auto &v : verts) {
+            m_positions.push_back(v.pos);
+        }
+    }
+    return m_renderMan->createMesh(verts.data(), VERTEX_3DTN, m_numVerts, m_vbo, m_vao);
+}
+
+int Mesh::getSphereSegments(const std::string &name) {
+    const std::string prefix = "__sphere_";
+    if(name.size()<=prefix.size()+2 || name.compare(0, prefix.size(), prefix)!=0
+       || name.compare(name.size()-2, 2, "__")!=0) {
+        return 0;
+    }
+    std::string num = name.substr(prefix.size(), name.size()-prefix.size()-2);
+    if(num.find_first_not_of("0123456789")!=std::string::npos || num.size()>4) {
+        return 0;
+    }
+    int segments = std::stoi(num);
+    return segments>=MESH_SPHERE_MIN_SEGMENTS?segments:0;
+}
+
+bool Mesh::createSphere(int segments) {
+    using namespace glm;
+    const int rings = segments/2;
+    auto vertex = [&](int s, int r) {
+        float u = float(s)/segments;
+        float v = float(r)/rings;
+        float theta = u*2.f*pi<float>();
+        float phi = v*pi<float>();
+        Vertex3DTN vert;
+        vert.normal = vec3(glm::sin(phi)*glm::cos(theta), glm::cos(phi),
+                           -glm::sin(phi)*glm::sin(theta));
+        vert.pos = vert.normal*0.5f;
+        vert.texcoord = vec2(u, 1-v);
+        return vert;
+    };
+
+    // UV sphere of diameter 1 centered at origin, the pole rings are fans
+    std::vector<Vertex3DTN> verts;
+    for(int r = 0;r<rings;r++) {
+        for(int s = 0;s<segments;s++) {
+            Vertex3DTN a = vertex(s, r);
+            Vertex3DTN b = vertex(s, r+1);
+            Vertex3DTN c = vertex(s+1, r+1);
+            Vertex3DTN d = vertex(s+1, r);
+            if(r!=0) {
+                verts.push_back(a);
+                verts.push_back(b);
+                verts.push_back(d);
+            }
+            if(r!=rings-1) {
+                verts.push_back(d);
+                verts.push_back(b);
+                verts.push_back(c);
+            }
+        }
+    }
+
+    m_numVerts = verts.size();
+    m_aabb = computeAABB(verts.data(), m_numVerts, sizeof(Vertex3DTN));
+    m_boundingSphere = computeBoundingSphere(verts.data(), m_numVerts, sizeof(Vertex3DTN));
+    if(static_cast<MeshManifest *>(m_manifest)->keepPositions) {
+        for(const auto &v : verts) {
+            m_positions.push_back(v.pos);
+        }
+    }
+    return m_renderMan->createMesh(verts.data(), VERTEX_3DTN, m_numVerts, m_vbo, m_vao);
 }
 
 } // namespace splitspace
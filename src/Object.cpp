@@ -7,7 +7,10 @@
 namespace splitspace {
 
 Object::Object(Engine *e, ObjectManifest *man, Entity *parent):
-                                                Entity(e, man, parent)
+                                                Entity(e, man, parent),
+                                                m_material(nullptr),
+                                                m_mesh(nullptr),
+                                                m_boundsVersion(0)
 {}
 
 bool Object::load() {
@@ -44,10 +47,36 @@ bool Object::load() {
     if(!m_mesh) {
         return false;
     }
+
+    updateTransform();
+    updateBounds();
     m_isLoaded = true;
     return true;    
 }
 
+bool Object::isOccluder() const {
+    return m_manifest && static_cast<ObjectManifest *>(m_manifest)->occluder;
+}
+
+void Object::update(float dt) {
+    updateTransform();
+    updateBounds();
+    updateChildren(dt);
+}
+
+void Object::updateBounds() {
+    if(!m_mesh) {
+        return;
+    }
+
+    AABB aabb = m_mesh->getAABB().transform(m_world);
+    if(aabb!=m_worldAABB) {
+        m_worldAABB = aabb;
+        m_worldSphere = m_mesh->getBoundingSphere().transform(m_world);
+        m_boundsVersion++;
+    }
+}
+
 void Object::unload() {
     m_logMan->logInfo("(Object) Unloading "+m_manifest->name);
     m_isLoaded = false;
@@ -0,0 +1,278 @@
+#include <splitspace/OcclusionCuller.hpp>
+#include <splitspace/JobManager.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPLITSPACE_OCCLUSION_SSE
+#endif
+
+namespace splitspace {
+
+// Geometry closer than this in clip w is not rasterized, objects
+// reaching it are always visible
+static const float OCCLUSION_MIN_W = 1e-4f;
+
+OcclusionCuller::OcclusionCuller(int width, int height) {
+    m_tilesX = (std::max(width, 1)+OCCLUSION_TILE_SIZE-1)/OCCLUSION_TILE_SIZE;
+    m_tilesY = (std::max(height, 1)+OCCLUSION_TILE_SIZE-1)/OCCLUSION_TILE_SIZE;
+    m_width = m_tilesX*OCCLUSION_TILE_SIZE;
+    m_height = m_tilesY*OCCLUSION_TILE_SIZE;
+    m_tileBins.resize(m_tilesX*m_tilesY);
+
+    int w = m_width, h = m_height;
+    for(;;) {
+        m_hiz.push_back(std::vector<float>(w*h, 1.f));
+        m_levelWidth.push_back(w);
+        m_levelHeight.push_back(h);
+        if(w == 1 && h == 1) {
+            break;
+        }
+        w = (w+1)/2;
+        h = (h+1)/2;
+    }
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &viewProj) {
+    m_viewProj = viewProj;
+    m_triangles.clear();
+    for(auto &bin : m_tileBins) {
+        bin.clear();
+    }
+    std::fill(m_hiz[0].begin(), m_hiz[0].end(), 1.f);
+}
+
+void OcclusionCuller::addOccluder(const void *positions, std::size_t numVerts,
+                                  std::size_t stride, const glm::mat4 &world) {
+    glm::mat4 m = m_viewProj*world;
+    const char *data = static_cast<const char *>(positions);
+
+    for(std::size_t i = 0;i+2<numVerts;i+=3) {
+        Triangle t;
+        bool clipped = false;
+        for(int v = 0;v<3;v++) {
+            const glm::vec3 &p = *reinterpret_cast<const glm::vec3 *>(data+(i+v)*stride);
+            glm::vec4 clip = m*glm::vec4(p, 1.f);
+            // Dropping triangles crossing the near plane only loses occlusion
+            if(clip.w<OCCLUSION_MIN_W) {
+                clipped = true;
+                break;
+            }
+            float invW = 1.f/clip.w;
+            t.v[v] = glm::vec3((clip.x*invW*0.5f+0.5f)*m_width,
+                               (clip.y*invW*0.5f+0.5f)*m_height,
+                               clip.z*invW*0.5f+0.5f);
+        }
+        if(clipped) {
+            continue;
+        }
+
+        float area = (t.v[1].x-t.v[0].x)*(t.v[2].y-t.v[0].y)-
+                     (t.v[1].y-t.v[0].y)*(t.v[2].x-t.v[0].x);
+        if(area == 0) {
+            continue;
+        }
+        // Back faces occlude as well, keep one winding for the rasterizer
+        if(area<0) {
+            std::swap(t.v[1], t.v[2]);
+        }
+
+        float minX = std::min(t.v[0].x, std::min(t.v[1].x, t.v[2].x));
+        float maxX = std::max(t.v[0].x, std::max(t.v[1].x, t.v[2].x));
+        float minY = std::min(t.v[0].y, std::min(t.v[1].y, t.v[2].y));
+        float maxY = std::max(t.v[0].y, std::max(t.v[1].y, t.v[2].y));
+        t.minX = std::max(0, static_cast<int>(std::floor(minX)));
+        t.minY = std::max(0, static_cast<int>(std::floor(minY)));
+        t.maxX = std::min(m_width-1, static_cast<int>(std::floor(maxX)));
+        t.maxY = std::min(m_height-1, static_cast<int>(std::floor(maxY)));
+        if(t.minX>t.maxX || t.minY>t.maxY) {
+            continue;
+        }
+        m_triangles.push_back(t);
+    }
+}
+
+void OcclusionCuller::rasterize(JobManager *jobs) {
+    for(std::uint32_t i = 0;i<m_triangles.size();i++) {
+        const Triangle &t = m_triangles[i];
+        for(int ty = t.minY/OCCLUSION_TILE_SIZE;ty<=t.maxY/OCCLUSION_TILE_SIZE;ty++) {
+            for(int tx = t.minX/OCCLUSION_TILE_SIZE;tx<=t.maxX/OCCLUSION_TILE_SIZE;tx++) {
+                m_tileBins[ty*m_tilesX+tx].push_back(i);
+            }
+        }
+    }
+
+    // Tiles own disjoint parts of the depth buffer, no locking needed
+    JobManager::RangeFunc fn = [this](std::size_t begin, std::size_t end) {
+        for(std::size_t tile = begin;tile<end;tile++) {
+            rasterizeTile(tile);
+        }
+    };
+    if(jobs) {
+        jobs->parallelFor(m_tileBins.size(), 1, fn);
+    } else {
+        fn(0, m_tileBins.size());
+    }
+
+    buildPyramid();
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+    int x0 = (tile%m_tilesX)*OCCLUSION_TILE_SIZE;
+    int y0 = (tile/m_tilesX)*OCCLUSION_TILE_SIZE;
+    for(auto i : m_tileBins[tile]) {
+        const Triangle &t = m_triangles[i];
+        rasterizeTriangle(t, std::max(x0, t.minX), std::max(y0, t.minY),
+                          std::min(x0+OCCLUSION_TILE_SIZE-1, t.maxX),
+                          std::min(y0+OCCLUSION_TILE_SIZE-1, t.maxY));
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle &t, int x0, int y0, int x1, int y1) {
+    // Edge functions e(p) = a*p.x+b*p.y+c, positive inside
+    float a[3], b[3], c[3];
+    for(int e = 0;e<3;e++) {
+        const glm::vec3 &p = t.v[(e+1)%3];
+        const glm::vec3 &q = t.v[(e+2)%3];
+        a[e] = p.y-q.y;
+        b[e] = q.x-p.x;
+        c[e] = -(a[e]*p.x+b[e]*p.y);
+    }
+    float invArea = 1.f/(a[0]*t.v[0].x+b[0]*t.v[0].y+c[0]);
+    float dz1 = (t.v[1].z-t.v[0].z)*invArea;
+    float dz2 = (t.v[2].z-t.v[0].z)*invArea;
+    float *depth = m_hiz[0].data();
+
+#ifdef SPLITSPACE_OCCLUSION_SSE
+    // Tiles start at multiples of 4, so aligned groups stay inside the tile
+    x0&=~3;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 z0 = _mm_set1_ps(t.v[0].z);
+    const __m128 vdz1 = _mm_set1_ps(dz1);
+    const __m128 vdz2 = _mm_set1_ps(dz2);
+    __m128 va[3], step[3];
+    for(int e = 0;e<3;e++) {
+        va[e] = _mm_set1_ps(a[e]);
+        step[e] = _mm_set1_ps(a[e]*4.f);
+    }
+
+    for(int y = y0;y<=y1;y++) {
+        float py = y+0.5f;
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x0)), offsets);
+        __m128 w[3];
+        for(int e = 0;e<3;e++) {
+            w[e] = _mm_add_ps(_mm_mul_ps(va[e], px), _mm_set1_ps(b[e]*py+c[e]));
+        }
+
+        float *row = depth+y*m_width;
+        for(int x = x0;x<=x1;x+=4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w[0], zero),
+                                                  _mm_cmpge_ps(w[1], zero)),
+                                       _mm_cmpge_ps(w[2], zero));
+            if(_mm_movemask_ps(inside)) {
+                __m128 z = _mm_add_ps(z0, _mm_add_ps(_mm_mul_ps(w[1], vdz1),
+                                                     _mm_mul_ps(w[2], vdz2)));
+                __m128 old = _mm_loadu_ps(row+x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row+x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                                               _mm_andnot_ps(inside, old)));
+            }
+            for(int e = 0;e<3;e++) {
+                w[e] = _mm_add_ps(w[e], step[e]);
+            }
+        }
+    }
+#else
+    for(int y = y0;y<=y1;y++) {
+        float py = y+0.5f;
+        float *row = depth+y*m_width;
+        for(int x = x0;x<=x1;x++) {
+            float px = x+0.5f;
+            float w0 = a[0]*px+b[0]*py+c[0];
+            float w1 = a[1]*px+b[1]*py+c[1];
+            float w2 = a[2]*px+b[2]*py+c[2];
+            if(w0>=0 && w1>=0 && w2>=0) {
+                float z = t.v[0].z+w1*dz1+w2*dz2;
+                row[x] = std::min(row[x], z);
+            }
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::buildPyramid() {
+    for(std::size_t l = 1;l<m_hiz.size();l++) {
+        const std::vector<float> &src = m_hiz[l-1];
+        std::vector<float> &dst = m_hiz[l];
+        int sw = m_levelWidth[l-1], sh = m_levelHeight[l-1];
+        int w = m_levelWidth[l], h = m_levelHeight[l];
+        for(int y = 0;y<h;y++) {
+            int sy0 = 2*y, sy1 = std::min(2*y+1, sh-1);
+            for(int x = 0;x<w;x++) {
+                int sx0 = 2*x, sx1 = std::min(2*x+1, sw-1);
+                dst[y*w+x] = std::max(std::max(src[sy0*sw+sx0], src[sy0*sw+sx1]),
+                                      std::max(src[sy1*sw+sx0], src[sy1*sw+sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const AABB &b) const {
+    float minX = 1, minY = 1, maxX = -1, maxY = -1, minZ = 1;
+    for(int i = 0;i<8;i++) {
+        glm::vec4 corner((i&1)?b.max.x:b.min.x, (i&2)?b.max.y:b.min.y,
+                         (i&4)?b.max.z:b.min.z, 1.f);
+        glm::vec4 clip = m_viewProj*corner;
+        if(clip.w<OCCLUSION_MIN_W) {
+            return true;
+        }
+        float invW = 1.f/clip.w;
+        minX = std::min(minX, clip.x*invW);
+        maxX = std::max(maxX, clip.x*invW);
+        minY = std::min(minY, clip.y*invW);
+        maxY = std::max(maxY, clip.y*invW);
+        minZ = std::min(minZ, clip.z*invW);
+    }
+
+    float depth = minZ*0.5f+0.5f;
+    if(depth<=0) {
+        return true;
+    }
+
+    int x0 = static_cast<int>(std::floor((minX*0.5f+0.5f)*m_width));
+    int x1 = static_cast<int>(std::floor((maxX*0.5f+0.5f)*m_width));
+    int y0 = static_cast<int>(std::floor((minY*0.5f+0.5f)*m_height));
+    int y1 = static_cast<int>(std::floor((maxY*0.5f+0.5f)*m_height));
+    if(x1<0 || y1<0 || x0>=m_width || y0>=m_height) {
+        return false;
+    }
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, m_width-1);
+    y1 = std::min(y1, m_height-1);
+
+    // Coarsest level at which the rectangle spans at most 4x4 texels
+    std::size_t level = 0;
+    int size = std::max(x1-x0, y1-y0)+1;
+    while((size>>level)>4 && level+1<m_hiz.size()) {
+        level++;
+    }
+
+    const std::vector<float> &hiz = m_hiz[level];
+    int w = m_levelWidth[level];
+    for(int y = y0>>level;y<=(y1>>level);y++) {
+        for(int x = x0>>level;x<=(x1>>level);x++) {
+            if(hiz[y*w+x]>=depth) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace splitspace
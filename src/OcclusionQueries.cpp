@@ -0,0 +1,194 @@
+#include <splitspace/OcclusionQueries.hpp>
+#include <splitspace/Engine.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/ResourceManager.hpp>
+#include <splitspace/LogManager.hpp>
+#include <splitspace/Object.hpp>
+#include <splitspace/Mesh.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace splitspace {
+
+static const char *BOX_MESH = "__cube__";
+
+static const char *BOX_VS =
+    "layout(location = 0) in vec3 boxPos;\n"
+    "uniform mat4 boxMVP;\n"
+    "void main() {\n"
+    "    gl_Position = boxMVP*vec4(boxPos, 1.0);\n"
+    "}\n";
+
+static const char *BOX_FS =
+    "void main() {\n"
+    "}\n";
+
+// Boxes are inflated a bit so they do not z-fight with the object
+static const float BOX_MARGIN = 1e-2f;
+
+OcclusionQueries::OcclusionQueries(Engine *e): m_engine(e),
+                                               m_renderManager(e->renderManager),
+                                               m_resManager(e->resManager),
+                                               m_logManager(e->logManager),
+                                               m_box(nullptr),
+                                               m_program(0),
+                                               m_mvpLocation(-1),
+                                               m_frameQueries(0)
+{}
+
+OcclusionQueries::~OcclusionQueries() {
+    destroy();
+}
+
+bool OcclusionQueries::init() {
+    m_box = m_resManager->loadPrimitive(BOX_MESH);
+    if(!m_box) {
+        m_logManager->logErr("(OcclusionQueries) Failed to load box mesh");
+        return false;
+    }
+
+    if(!m_renderManager->createShader(BOX_VS, BOX_FS, 330, 330, 0, m_program)) {
+        m_logManager->logErr("(OcclusionQueries) Failed to create box shader");
+        return false;
+    }
+    m_mvpLocation = glGetUniformLocation(m_program, "boxMVP");
+    return true;
+}
+
+void OcclusionQueries::destroy() {
+    reset();
+    m_renderManager->destroyShader(m_program);
+    if(m_box) {
+        m_resManager->unloadResource(BOX_MESH);
+        m_box = nullptr;
+    }
+}
+
+void OcclusionQueries::reset() {
+    for(auto &s : m_states) {
+        m_renderManager->destroyQuery(s.query);
+    }
+    m_states.clear();
+    m_stateIds.clear();
+}
+
+void OcclusionQueries::beginFrame() {
+    m_frameQueries = 0;
+    for(auto &s : m_states) {
+        if(!s.pending) {
+            continue;
+        }
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(s.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available) {
+            GLuint passed = GL_FALSE;
+            glGetQueryObjectuiv(s.query, GL_QUERY_RESULT, &passed);
+            s.visible = passed!=GL_FALSE;
+            s.pending = false;
+        }
+    }
+}
+
+OcclusionQueries::QueryState *OcclusionQueries::getState(const Object *o) {
+    auto it = m_stateIds.find(o);
+    if(it!=m_stateIds.end()) {
+        return &m_states[it->second];
+    }
+
+    QueryState s;
+    if(!m_renderManager->createQuery(s.query)) {
+        return nullptr;
+    }
+    s.visible = true;
+    s.pending = false;
+    m_stateIds[o] = m_states.size();
+    m_states.push_back(s);
+    return &m_states.back();
+}
+
+bool OcclusionQueries::isHidden(const Object *o) const {
+    auto it = m_stateIds.find(o);
+    if(it == m_stateIds.end()) {
+        return false;
+    }
+    const QueryState &s = m_states[it->second];
+    return !s.visible && !s.pending;
+}
+
+bool OcclusionQueries::beginQuery(const Object *o) {
+    QueryState *s = getState(o);
+    if(!s || s->pending) {
+        return false;
+    }
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, s->query);
+    s->pending = true;
+    m_frameQueries++;
+    return true;
+}
+
+void OcclusionQueries::endQuery() {
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void OcclusionQueries::beginBoundsPass(const glm::mat4 &viewProj, const glm::vec3 &viewPos) {
+    m_viewProj = viewProj;
+    m_viewPos = viewPos;
+
+    GLStateCache &state = m_renderManager->getGLState();
+    state.useProgram(m_program);
+    state.bindVertexArray(m_box->getVAO());
+    state.setColorMask(false);
+    state.setDepthMask(false);
+    // Back faces still count when the near plane cuts the box
+    state.setCullFace(false);
+}
+
+bool OcclusionQueries::queryBounds(const Object *o) {
+    QueryState *s = getState(o);
+    if(!s || s->pending) {
+        return false;
+    }
+
+    AABB box = o->getWorldAABB();
+    box.min-=glm::vec3(BOX_MARGIN);
+    box.max+=glm::vec3(BOX_MARGIN);
+    // Faces of a box around the camera may all be clipped away
+    if(box.intersects(AABB(m_viewPos, m_viewPos))) {
+        s->visible = true;
+        return false;
+    }
+
+    glm::mat4 world = glm::scale(glm::translate(glm::mat4(1), box.getCenter()),
+                                 box.max-box.min);
+    glm::mat4 mvp = m_viewProj*world;
+    glUniformMatrix4fv(m_mvpLocation, 1, GL_FALSE, glm::value_ptr(mvp));
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, s->query);
+    m_renderManager->drawArrays(m_box->getNumVerts());
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    s->pending = true;
+    m_frameQueries++;
+    return true;
+}
+
+void OcclusionQueries::endBoundsPass() {
+    GLStateCache &state = m_renderManager->getGLState();
+    state.setColorMask(true);
+    state.setDepthMask(true);
+    state.setCullFace(true);
+}
+
+void OcclusionQueries::beginConditionalRender(const Object *o) {
+    auto it = m_stateIds.find(o);
+    if(it!=m_stateIds.end()) {
+        // Waits on the GPU only, the CPU keeps submitting
+        glBeginConditionalRender(m_states[it->second].query, GL_QUERY_WAIT);
+    }
+}
+
+void OcclusionQueries::endConditionalRender() {
+    glEndConditionalRender();
+}
+
+} // namespace splitspace
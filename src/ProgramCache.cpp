@@ -0,0 +1,201 @@
+#include <splitspace/ProgramCache.hpp>
+#include <splitspace/LogManager.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <sys/stat.h>
+
+namespace splitspace {
+
+static const std::uint64_t FNV_PRIME = 1099511628211ULL;
+static const std::uint32_t ENTRY_MAGIC = 0x42505353; // "SSPB"
+static const std::uint32_t ENTRY_VERSION = 1;
+
+struct EntryHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t size;
+};
+
+ProgramCache::ProgramCache(LogManager *lm, const std::string &dir): m_logManager(lm),
+                                                                    m_dir(dir),
+                                                                    m_hits(0),
+                                                                    m_misses(0),
+                                                                    m_stale(0)
+{
+    if(!m_dir.empty() && m_dir.back()!='/') {
+        m_dir+='/';
+    }
+}
+
+bool ProgramCache::init() {
+    if(!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        m_logManager->logInfo("(ProgramCache) Program binaries are not supported");
+        return false;
+    }
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if(numFormats<=0) {
+        m_logManager->logInfo("(ProgramCache) Driver offers no program binary formats");
+        return false;
+    }
+    if(!makeDirs(m_dir)) {
+        m_logManager->logWarn("(ProgramCache) Failed to create "+m_dir);
+        return false;
+    }
+
+    auto getString = [](GLenum name) -> std::string {
+        const GLubyte *s = glGetString(name);
+        return s?reinterpret_cast<const char *>(s):"";
+    };
+    m_driver = getString(GL_VENDOR)+"\n"+getString(GL_RENDERER)+"\n"+getString(GL_VERSION);
+    return true;
+}
+
+std::uint64_t ProgramCache::hash(const std::string &data, std::uint64_t seed) {
+    std::uint64_t h = seed;
+    for(unsigned char c : data) {
+        h^=c;
+        h*=FNV_PRIME;
+    }
+    return h;
+}
+
+std::uint64_t ProgramCache::makeKey(const std::vector<std::string> &parts) const {
+    // Lengths keep ("ab", "c") and ("a", "bc") apart
+    std::uint64_t h = PROGRAM_HASH_SEED;
+    for(const auto &p : parts) {
+        h = hash(std::to_string(p.size())+":", h);
+        h = hash(p, h);
+    }
+    return hash(m_driver, h);
+}
+
+std::string ProgramCache::getEntryPath(std::uint64_t key) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return m_dir+name+".bin";
+}
+
+bool ProgramCache::readEntry(const std::string &path, std::uint64_t key,
+                             GLenum &format, std::vector<char> &binary) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in.is_open()) {
+        return false;
+    }
+    EntryHeader h;
+    if(!in.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        return false;
+    }
+    if(h.magic!=ENTRY_MAGIC || h.version!=ENTRY_VERSION || h.key!=key || !h.size) {
+        return false;
+    }
+    // A corrupt size must not turn into a huge allocation
+    std::streamoff body = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff end = in.tellg();
+    if(body<0 || end-body<static_cast<std::streamoff>(h.size)) {
+        return false;
+    }
+    in.seekg(body);
+    binary.resize(h.size);
+    if(!in.read(binary.data(), h.size)) {
+        return false;
+    }
+    format = h.format;
+    return true;
+}
+
+bool ProgramCache::writeEntry(const std::string &path, std::uint64_t key,
+                              GLenum format, const std::vector<char> &binary) {
+    EntryHeader h;
+    h.magic = ENTRY_MAGIC;
+    h.version = ENTRY_VERSION;
+    h.key = key;
+    h.format = format;
+    h.size = binary.size();
+
+    // Readers never see a half written entry
+    std::string tmpPath = path+".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!out.is_open()) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(binary.data(), binary.size());
+        if(!out) {
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool ProgramCache::makeDirs(const std::string &dir) {
+    for(std::size_t i = 1;i<=dir.size();i++) {
+        if(i<dir.size() && dir[i]!='/') {
+            continue;
+        }
+        std::string sub = dir.substr(0, i);
+        if(mkdir(sub.c_str(), 0755) && errno!=EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProgramCache::load(std::uint64_t key, GLuint program) {
+    std::string path = getEntryPath(key);
+    GLenum format = 0;
+    std::vector<char> binary;
+    if(!readEntry(path, key, format, binary)) {
+        m_misses++;
+        return false;
+    }
+
+    glProgramBinary(program, format, binary.data(), binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if(linked!=GL_TRUE) {
+        // Usually a driver update the key did not catch
+        m_logManager->logInfo("(ProgramCache) Dropping stale entry "+path);
+        std::remove(path.c_str());
+        m_stale++;
+        return false;
+    }
+    m_hits++;
+    return true;
+}
+
+void ProgramCache::prepare(GLuint program) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(std::uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length<=0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::string path = getEntryPath(key);
+    if(!writeEntry(path, key, format, binary)) {
+        m_logManager->logWarn("(ProgramCache) Failed to write "+path);
+    }
+}
+
+void ProgramCache::logStats() {
+    m_logManager->logInfo("\t Program cache: "+std::to_string(m_hits)+" hits, "
+                          +std::to_string(m_misses)+" misses, "
+                          +std::to_string(m_stale)+" stale");
+}
+
+} // namespace splitspace
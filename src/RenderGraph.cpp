@@ -0,0 +1,325 @@
+#include <splitspace/RenderGraph.hpp>
+#include <splitspace/LogManager.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+static const RenderGraphFormat GRAPH_FORMATS[] = {
+    { "rgba8", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
+    { "rgba16f", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT },
+    { "rgba32f", GL_RGBA32F, GL_RGBA, GL_FLOAT },
+    { "rg16f", GL_RG16F, GL_RG, GL_HALF_FLOAT },
+    { "r11g11b10f", GL_R11F_G11F_B10F, GL_RGB, GL_HALF_FLOAT },
+    { "r8", GL_R8, GL_RED, GL_UNSIGNED_BYTE },
+    { "r16f", GL_R16F, GL_RED, GL_HALF_FLOAT },
+    { "r32f", GL_R32F, GL_RED, GL_FLOAT },
+    { "depth24stencil8", GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8 },
+    { "depth32f", GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT }
+};
+
+RenderGraph::RenderGraph(LogManager *lm): m_logManager(lm),
+                                          m_manifest(nullptr),
+                                          m_numCulled(0)
+{}
+
+bool RenderGraph::compile(const RenderGraphManifest *manifest) {
+    clear();
+    if(!manifest) {
+        return false;
+    }
+    m_manifest = manifest;
+    if(!validate()) {
+        clear();
+        return false;
+    }
+
+    std::vector<bool> live;
+    cull(live);
+    assignTargets(live);
+    if(m_passes.empty()) {
+        m_logManager->logErr("(RenderGraph) "+m_manifest->name+": nothing is drawn to the "+
+                             RENDER_GRAPH_BACKBUFFER);
+        clear();
+        return false;
+    }
+    m_logManager->logInfo("(RenderGraph) "+m_manifest->name+": "+std::to_string(m_passes.size())
+                          +" passes, "+std::to_string(m_numCulled)+" culled, "
+                          +std::to_string(m_manifest->textures.size())+" textures in "
+                          +std::to_string(m_targets.size())+" targets");
+    return true;
+}
+
+void RenderGraph::clear() {
+    m_manifest = nullptr;
+    m_passes.clear();
+    m_targets.clear();
+    m_textureTargets.clear();
+    m_numCulled = 0;
+}
+
+int RenderGraph::getTarget(const std::string &texture) const {
+    int t = findTexture(texture);
+    if(t<0 || std::size_t(t)>=m_textureTargets.size()) {
+        return -1;
+    }
+    return m_textureTargets[t];
+}
+
+std::size_t RenderGraph::getNumScenePasses() const {
+    std::size_t n = 0;
+    for(const auto &pass : m_passes) {
+        if(m_manifest->passes[pass.desc].type == GRAPH_PASS_SCENE) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int RenderGraph::findTexture(const std::string &name) const {
+    if(!m_manifest) {
+        return -1;
+    }
+    const auto &textures = m_manifest->textures;
+    for(std::size_t i = 0;i<textures.size();i++) {
+        if(textures[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RenderGraph::validate() {
+    const std::string &graph = m_manifest->name;
+    const auto &textures = m_manifest->textures;
+    for(std::size_t i = 0;i<textures.size();i++) {
+        const GraphTextureDesc &t = textures[i];
+        if(t.name == RENDER_GRAPH_BACKBUFFER || findTexture(t.name)!=int(i)) {
+            m_logManager->logErr("(RenderGraph) "+graph+": texture name \""+t.name+"\" is taken");
+            return false;
+        }
+        if(!findFormat(t.internalFormat) || t.scale<=0) {
+            m_logManager->logErr("(RenderGraph) "+graph+": bad format or scale of \""+t.name+"\"");
+            return false;
+        }
+    }
+
+    std::vector<bool> written(textures.size(), false);
+    for(const auto &p : m_manifest->passes) {
+        const std::string where = "(RenderGraph) "+graph+": pass \""+p.name+"\"";
+        if(p.type == GRAPH_PASS_UNKNOWN || p.shader.empty()) {
+            m_logManager->logErr(where+" needs a known type and a shader");
+            return false;
+        }
+        if(p.outputs.empty()) {
+            m_logManager->logErr(where+" has no outputs");
+            return false;
+        }
+        for(const auto &in : p.inputs) {
+            int t = findTexture(in);
+            if(t<0) {
+                m_logManager->logErr(where+" reads unknown texture \""+in+"\"");
+                return false;
+            }
+            if(!written[t]) {
+                m_logManager->logErr(where+" reads \""+in+"\" before it is written");
+                return false;
+            }
+            // Sampling a texture while drawing to it is undefined in GL
+            if(std::find(p.outputs.begin(), p.outputs.end(), in)!=p.outputs.end()) {
+                m_logManager->logErr(where+" reads and writes \""+in+"\"");
+                return false;
+            }
+        }
+
+        int numDepth = 0;
+        float scale = 0;
+        for(const auto &out : p.outputs) {
+            if(out == RENDER_GRAPH_BACKBUFFER) {
+                if(p.outputs.size()>1) {
+                    m_logManager->logErr(where+" writes other textures with the "+
+                                         RENDER_GRAPH_BACKBUFFER);
+                    return false;
+                }
+                continue;
+            }
+            int t = findTexture(out);
+            if(t<0) {
+                m_logManager->logErr(where+" writes unknown texture \""+out+"\"");
+                return false;
+            }
+            if(isDepthFormat(textures[t].internalFormat)) {
+                numDepth++;
+            }
+            if(scale>0 && textures[t].scale!=scale) {
+                m_logManager->logErr(where+" writes textures of different scale");
+                return false;
+            }
+            scale = textures[t].scale;
+            written[t] = true;
+        }
+        if(numDepth>1) {
+            m_logManager->logErr(where+" writes more than one depth texture");
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderGraph::cull(std::vector<bool> &live) {
+    const auto &passes = m_manifest->passes;
+    live.assign(passes.size(), false);
+    std::vector<bool> needed(m_manifest->textures.size(), false);
+    m_numCulled = 0;
+    for(std::size_t i = passes.size();i-->0;) {
+        const GraphPassDesc &p = passes[i];
+        for(const auto &out : p.outputs) {
+            int t = findTexture(out);
+            if(out == RENDER_GRAPH_BACKBUFFER || (t>=0 && needed[t])) {
+                live[i] = true;
+            }
+        }
+        if(!live[i]) {
+            m_numCulled++;
+            continue;
+        }
+        // Cleared outputs do not need earlier writers, drawing over
+        // kept contents needs them
+        for(const auto &out : p.outputs) {
+            int t = findTexture(out);
+            if(t>=0) {
+                needed[t] = !p.clear;
+            }
+        }
+        for(const auto &in : p.inputs) {
+            needed[findTexture(in)] = true;
+        }
+    }
+}
+
+void RenderGraph::assignTargets(const std::vector<bool> &live) {
+    const auto &textures = m_manifest->textures;
+    const auto &passes = m_manifest->passes;
+
+    // Lifetimes in live pass indices
+    std::vector<int> first(textures.size(), -1);
+    std::vector<int> last(textures.size(), -1);
+    int index = 0;
+    for(std::size_t i = 0;i<passes.size();i++) {
+        if(!live[i]) {
+            continue;
+        }
+        auto use = [&](const std::string &name) {
+            int t = findTexture(name);
+            if(t<0) {
+                return;
+            }
+            if(first[t]<0) {
+                first[t] = index;
+            }
+            last[t] = index;
+        };
+        for(const auto &in : passes[i].inputs) {
+            use(in);
+        }
+        for(const auto &out : passes[i].outputs) {
+            use(out);
+        }
+        index++;
+    }
+
+    std::vector<std::size_t> order;
+    for(std::size_t t = 0;t<textures.size();t++) {
+        if(first[t]>=0) {
+            order.push_back(t);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return first[a]<first[b];
+    });
+
+    // Greedy: the first target of the same kind free by then is reused
+    m_textureTargets.assign(textures.size(), -1);
+    std::vector<int> targetLast;
+    for(auto t : order) {
+        const GraphTextureDesc &desc = textures[t];
+        int target = -1;
+        for(std::size_t i = 0;i<m_targets.size();i++) {
+            if(m_targets[i].internalFormat == desc.internalFormat &&
+               m_targets[i].scale == desc.scale && targetLast[i]<first[t]) {
+                target = i;
+                break;
+            }
+        }
+        if(target<0) {
+            GraphTarget gt;
+            gt.internalFormat = desc.internalFormat;
+            gt.scale = desc.scale;
+            m_targets.push_back(gt);
+            targetLast.push_back(-1);
+            target = m_targets.size()-1;
+        }
+        targetLast[target] = last[t];
+        m_textureTargets[t] = target;
+    }
+
+    for(std::size_t i = 0;i<passes.size();i++) {
+        if(!live[i]) {
+            continue;
+        }
+        GraphPass pass;
+        pass.desc = i;
+        pass.depthOutput = -1;
+        pass.toBackbuffer = false;
+        for(const auto &in : passes[i].inputs) {
+            pass.inputs.push_back(m_textureTargets[findTexture(in)]);
+        }
+        for(const auto &out : passes[i].outputs) {
+            if(out == RENDER_GRAPH_BACKBUFFER) {
+                pass.toBackbuffer = true;
+                continue;
+            }
+            int t = findTexture(out);
+            if(isDepthFormat(textures[t].internalFormat)) {
+                pass.depthOutput = m_textureTargets[t];
+            } else {
+                pass.colorOutputs.push_back(m_textureTargets[t]);
+            }
+        }
+        m_passes.push_back(pass);
+    }
+}
+
+const RenderGraphFormat *RenderGraph::findFormat(const std::string &name) {
+    for(const auto &f : GRAPH_FORMATS) {
+        if(name == f.name) {
+            return &f;
+        }
+    }
+    return nullptr;
+}
+
+const RenderGraphFormat *RenderGraph::findFormat(GLenum internalFormat) {
+    for(const auto &f : GRAPH_FORMATS) {
+        if(internalFormat == f.internalFormat) {
+            return &f;
+        }
+    }
+    return nullptr;
+}
+
+bool RenderGraph::isDepthFormat(GLenum internalFormat) {
+    return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH_COMPONENT32F;
+}
+
+GraphPassType RenderGraph::getPassTypeFromName(const std::string &name) {
+    if(name == "scene") {
+        return GRAPH_PASS_SCENE;
+    } else if(name == "fullscreen") {
+        return GRAPH_PASS_FULLSCREEN;
+    } else {
+        return GRAPH_PASS_UNKNOWN;
+    }
+}
+
+} // namespace splitspace
@@ -9,35 +9,149 @@
 #include <splitspace/Camera.hpp>
 #include <splitspace/Mesh.hpp>
 #include <splitspace/RenderTechnique.hpp>
+#include <splitspace/UniformBuffers.hpp>
+#include <splitspace/FramePacket.hpp>
+#include <splitspace/RenderThread.hpp>
+#include <splitspace/ProgramCache.hpp>
+#include <splitspace/HeadlessContext.hpp>
 
 #include <chrono>
 
+static std::string toMegabytes(std::uint64_t bytes) {
+    return std::to_string(static_cast<double>(bytes)/(1<<20));
+}
 
 namespace splitspace {
 RenderManager::RenderManager(Engine *e): m_winManager(e->windowManager),
                                          m_logManager(e->logManager),
                                          m_resManager(e->resManager),
+                                         m_context(nullptr),
                                          m_window(m_winManager->getSDLWindow()),
+                                         m_headless(nullptr),
+                                         m_offscreenFbo(0),
+                                         m_offscreenColor(0),
+                                         m_offscreenDepth(0),
+                                         m_offscreenWidth(0),
+                                         m_offscreenHeight(0),
                                          m_frameDrawCalls(0),
+                                         m_frameTriangles(0),
                                          m_totalDrawCalls(0),
+                                         m_frameVisibleObjects(0),
+                                         m_frameCulledObjects(0),
+                                         m_frameOccludedObjects(0),
+                                         m_totalCulledObjects(0),
+                                         m_totalOccludedObjects(0),
+                                         m_frameOcclusionQueries(0),
+                                         m_frameQueryHidden(0),
+                                         m_totalOcclusionQueries(0),
+                                         m_totalQueryHidden(0),
                                          m_totalShaders(0),
                                          m_totalMeshes(0),
                                          m_totalTextures(0),
-                                         m_totalFrames(0),
-                                         m_averageFrameTime(0),
-                                         m_memoryUsed(0),
+                                         m_uniformBuffers(nullptr),
+                                         m_gpuProfiler(nullptr),
+                                         m_programCache(nullptr),
+                                         m_parallelCompile(false),
+                                         m_warmUpVao(0),
+                                         m_instanceBuffer(0),
+                                         m_instanceCapacity(0),
+                                         m_instanceOffset(0),
                                          m_scene(nullptr),
                                          m_shader(nullptr),
                                          m_camera(nullptr),
-                                         m_renderTechnique(nullptr)
+                                         m_renderTechnique(nullptr),
+                                         m_framePackets(new FramePacket[FRAME_PACKETS]),
+                                         m_preparedFrames(0),
+                                         m_renderThread(nullptr),
+                                         m_queuedPacket(0)
 
 {}
 
 RenderManager::~RenderManager() {
+    stopRenderThread();
     destroy();
+    delete[] m_framePackets;
+}
+
+bool RenderManager::init(bool vsync, const std::string &programCacheDir) {
+    if(m_winManager->isHeadless()) {
+        m_headless = new HeadlessContext(m_logManager);
+        if(!m_headless->init()) {
+            m_logManager->logErr("(RenderManager) Error creating headless GL context");
+            return false;
+        }
+    } else if(!createWindowContext(vsync)) {
+        return false;
+    }
+
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX misses the X display, GL entry points load regardless
+    if(m_headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) {
+        glewStatus = GLEW_OK;
+    }
+#endif
+    if(glewStatus != GLEW_OK) {
+        m_logManager->logInfo("(RenderManager) Failed to initialise GLEW");
+        return false;
+    }
+    
+    m_logManager->logInfo("(RenderManager) Created GL 3.3 context");
+
+    setupGL();
+    if(m_headless && !createOffscreenTarget(m_winManager->getWidth(), m_winManager->getHeight())) {
+        return false;
+    }
+
+    if(!createInstanceBuffer(1024*sizeof(glm::mat4))) {
+        return false;
+    }
+
+    m_uniformBuffers = new UniformBuffers(this, m_logManager);
+    if(!m_uniformBuffers->init()) {
+        return false;
+    }
+
+    m_gpuProfiler = new GpuProfiler(this, m_logManager);
+    if(!m_gpuProfiler->init()) {
+        return false;
+    }
+
+    // Let the driver compile and link on its own threads, status queries
+    // then only block when the program is not done yet
+    if(GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        m_parallelCompile = true;
+    } else if(GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        m_parallelCompile = true;
+    }
+
+    // No attributes, every vertex sits at the origin
+    glGenVertexArrays(1, &m_warmUpVao);
+
+    if(!programCacheDir.empty()) {
+        // Not fatal, programs are then always built from source
+        m_programCache = new ProgramCache(m_logManager, programCacheDir);
+        if(!m_programCache->init()) {
+            delete m_programCache;
+            m_programCache = nullptr;
+        }
+    }
+
+    m_shader = static_cast<Shader*>(m_resManager->loadResource(m_resManager->getDefaultShader()));
+    if(!m_shader) {
+        m_logManager->logErr("(RenderManager) Failed to load default shader "+
+                             m_resManager->getDefaultShader());
+        return false;
+    }
+
+    m_glState.useProgram(m_shader->getProgramId());
+
+    return true;
 }
 
-bool RenderManager::init(bool vsync) {
+bool RenderManager::createWindowContext(bool vsync) {
     m_context = SDL_GL_CreateContext(m_winManager->getSDLWindow());
     if(!m_context) {
         m_logManager->logErr("(RenderManager) Error creating GL context");
@@ -63,15 +177,7 @@ bool RenderManager::init(bool vsync) {
         m_logManager->logErr("(RenderManager) Error initialising OpenGL 3.3 context:"
                            +std::string(SDL_GetError()));
         return false;
-    } 
-    
-    if(glewInit() != GLEW_OK) {
-        m_logManager->logInfo("(RenderManager) Failed to initialise GLEW");
-        return false;
     }
-    
-    m_logManager->logInfo("(RenderManager) Created GL 3.3 context");
-
 
     if(vsync) {
         if(SDL_GL_SetSwapInterval(-1)) {
@@ -87,18 +193,92 @@ bool RenderManager::init(bool vsync) {
     } else {
         SDL_GL_SetSwapInterval(0);
     }
+    return true;
+}
 
-    setupGL();
+bool RenderManager::makeContextCurrent() {
+    if(m_headless) {
+        return m_headless->makeCurrent();
+    }
+    if(SDL_GL_MakeCurrent(m_winManager->getSDLWindow(), m_context)) {
+        m_logManager->logErr("(RenderManager) Failed to bind GL context: "+std::string(SDL_GetError()));
+        return false;
+    }
+    return true;
+}
 
-    m_shader = static_cast<Shader*>(m_resManager->loadResource(m_resManager->getDefaultShader()));
-    if(!m_shader) {
-        m_logManager->logErr("(RenderManager) Failed to load default shader "+
-                             m_resManager->getDefaultShader());
+void RenderManager::releaseContext() {
+    if(m_headless) {
+        m_headless->release();
+    } else {
+        SDL_GL_MakeCurrent(m_winManager->getSDLWindow(), nullptr);
+    }
+}
+
+bool RenderManager::createOffscreenTarget(int w, int h) {
+    glGenFramebuffers(1, &m_offscreenFbo);
+    glGenRenderbuffers(1, &m_offscreenColor);
+    glGenRenderbuffers(1, &m_offscreenDepth);
+
+    // Same formats the window asks for, stencil is used by light volumes
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    m_glState.bindFramebuffer(GL_FRAMEBUFFER, m_offscreenFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreenColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_offscreenDepth);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE) {
+        m_logManager->logErr("(RenderManager) Offscreen framebuffer is incomplete");
+        destroyOffscreenTarget();
         return false;
     }
 
-    glUseProgram(m_shader->getProgramId());
+    // Surfaceless contexts start with an empty viewport
+    glViewport(0, 0, w, h);
+    m_offscreenWidth = w;
+    m_offscreenHeight = h;
+    // Renderbuffer names would clash with render target textures
+    m_gpuMemory.allocate(GPU_MEM_OTHER, m_offscreenColor, GpuMemoryTracker::getTextureSize(GL_RGBA8, w, h));
+    m_gpuMemory.allocate(GPU_MEM_OTHER, m_offscreenDepth,
+                         GpuMemoryTracker::getTextureSize(GL_DEPTH24_STENCIL8, w, h));
+    return true;
+}
+
+void RenderManager::destroyOffscreenTarget() {
+    if(m_offscreenFbo) {
+        m_glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_offscreenFbo);
+        m_offscreenFbo = 0;
+    }
+    if(m_offscreenColor) {
+        m_gpuMemory.release(GPU_MEM_OTHER, m_offscreenColor);
+        glDeleteRenderbuffers(1, &m_offscreenColor);
+        m_offscreenColor = 0;
+    }
+    if(m_offscreenDepth) {
+        m_gpuMemory.release(GPU_MEM_OTHER, m_offscreenDepth);
+        glDeleteRenderbuffers(1, &m_offscreenDepth);
+        m_offscreenDepth = 0;
+    }
+    m_offscreenWidth = m_offscreenHeight = 0;
+}
 
+bool RenderManager::readFrame(std::vector<std::uint8_t> &rgba, int &w, int &h) {
+    if(!m_offscreenFbo) {
+        return false;
+    }
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return readFrame(rgba, w, h); });
+    }
+    w = m_offscreenWidth;
+    h = m_offscreenHeight;
+    rgba.resize(static_cast<std::size_t>(w)*h*4);
+    m_glState.bindFramebuffer(GL_READ_FRAMEBUFFER, m_offscreenFbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
     return true;
 }
 
@@ -107,6 +287,9 @@ void RenderManager::setRenderTechnique(RenderTechnique *rt) {
 }
     
 bool RenderManager::createTexture(const void *data, ImageFormat format, int w, int h, GLuint &glName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createTexture(data, format, w, h, glName); });
+    }
     glName = 0;
     glGenTextures(1, &glName);
     if(!glName) {
@@ -114,7 +297,7 @@ bool RenderManager::createTexture(const void *data, ImageFormat format, int w, i
         return false;
     }
 
-    glBindTexture(GL_TEXTURE_2D, glName);
+    m_glState.bindTexture(0, GL_TEXTURE_2D, glName);
 
     GLint glformat;
     switch(format) {
@@ -124,12 +307,12 @@ bool RenderManager::createTexture(const void *data, ImageFormat format, int w, i
         case IMAGE_RGB:
             glformat = GL_RGB;
         break;
+        case IMAGE_RGBA:
             glformat = GL_RGBA;
         break;
         default:
             m_logManager->logErr("(RenderManager) Unknown image format specified");
             destroyTexture(glName);
-            glBindTexture(GL_TEXTURE_2D, 0);
             return false;
     }
     
@@ -137,52 +320,35 @@ bool RenderManager::createTexture(const void *data, ImageFormat format, int w, i
     
     glGenerateMipmap(GL_TEXTURE_2D);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    m_memoryUsed+=getTextureSize(glName);
+    m_gpuMemory.allocate(GPU_MEM_TEXTURE, glName,
+                         GpuMemoryTracker::getTextureSize(glformat, w, h,
+                                                   GpuMemoryTracker::getMipLevels(w, h)));
     m_totalTextures++;
     return true;
 }
 
-std::size_t RenderManager::getTextureSize(const GLuint texId) {
-    if(!glIsTexture(texId)) {
-        return 0;
-    }
-  
-    glBindTexture(GL_TEXTURE_2D, texId);
-
-    GLint tw = 0, th = 0, tf = 0;
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &tw);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &th);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &tf);
-    
-    int depth = 0;
-
-    switch(tf) {
-        case GL_ALPHA:
-            depth = 1;
-        break;
-        case GL_RGB:
-            depth = 3;
-        break;
-        case GL_RGBA:
-            depth = 4;
-        break;
+void RenderManager::destroyTexture(GLuint &texId) {
+    if(hasRenderThread()) {
+        GLuint name = texId;
+        texId = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseTexture(n); });
+        return;
     }
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    return tw*th*depth;
-
+    releaseTexture(texId);
 }
-    
-void RenderManager::destroyTexture(GLuint &texId) {
+
+void RenderManager::releaseTexture(GLuint &texId) {
+    m_gpuMemory.release(GPU_MEM_TEXTURE, texId);
+    m_glState.onDeleteTexture(texId);
     glDeleteTextures(1, &texId);
     texId = 0;
 }
 
 bool RenderManager::createSampler(bool useMipmaps, TextureFiltering filtering, 
                                                             GLuint &samplerName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createSampler(useMipmaps, filtering, samplerName); });
+    }
 
     samplerName = 0;
     glGenSamplers(1, &samplerName); 
@@ -202,7 +368,7 @@ bool RenderManager::createSampler(bool useMipmaps, TextureFiltering filtering,
             minFilter = GL_NEAREST;
         }
     } else {
-       magFilter = GL_NEAREST; 
+        magFilter = GL_LINEAR;
         if(useMipmaps) {
             minFilter = GL_LINEAR_MIPMAP_LINEAR;
         } else {
@@ -220,8 +386,19 @@ bool RenderManager::createSampler(bool useMipmaps, TextureFiltering filtering,
 }
 
 void RenderManager::destroySampler(GLuint &sampler) {
-    if(glIsTexture(sampler)) {
-        glDeleteTextures(1, &sampler);
+    if(hasRenderThread()) {
+        GLuint name = sampler;
+        sampler = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseSampler(n); });
+        return;
+    }
+    releaseSampler(sampler);
+}
+
+void RenderManager::releaseSampler(GLuint &sampler) {
+    if(glIsSampler(sampler)) {
+        m_glState.onDeleteSampler(sampler);
+        glDeleteSamplers(1, &sampler);
         sampler = 0;
     } else {
         m_logManager->logWarn("(RenderManager) Trying to destroy GL object which does not appear to be of Sampler type");
@@ -229,6 +406,9 @@ void RenderManager::destroySampler(GLuint &sampler) {
 }
 
 bool RenderManager::createMesh(const void *vData, VertexFormat format, int numVerts, GLuint &vboName, GLuint &vaoName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createMesh(vData, format, numVerts, vboName, vaoName); });
+    }
     if(!vData || numVerts<=0) {
         return false;
     }
@@ -238,30 +418,30 @@ bool RenderManager::createMesh(const void *vData, VertexFormat format, int numVe
         return false;
     }
 
-    glBindVertexArray(vaoName);
+    m_glState.bindVertexArray(vaoName);
     glBindBuffer(GL_ARRAY_BUFFER, vboName);
-    GLint bsize = 0;
+    std::uint64_t bsize = 0;
     //TODO: eliminate magic numbers and sync C++ and GLSL
     switch(format) {
         case VERTEX_3DT:
-            glBufferData(GL_ARRAY_BUFFER, numVerts*sizeof(Vertex3DT),
-                         vData, GL_STATIC_DRAW);
+            bsize = numVerts*sizeof(Vertex3DT);
+            glBufferData(GL_ARRAY_BUFFER, bsize, vData, GL_STATIC_DRAW);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3DT), (void*)offsetof(Vertex3DT, pos));
             glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3DT), (void*)offsetof(Vertex3DT, texcoord));
             glEnableVertexAttribArray(0);
             glEnableVertexAttribArray(1);
         break;
         case VERTEX_3DN:
-            glBufferData(GL_ARRAY_BUFFER, numVerts*sizeof(Vertex3DN),
-                         vData, GL_STATIC_DRAW);
+            bsize = numVerts*sizeof(Vertex3DN);
+            glBufferData(GL_ARRAY_BUFFER, bsize, vData, GL_STATIC_DRAW);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3DN), (void*)offsetof(Vertex3DN, pos));
             glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3DN), (void*)offsetof(Vertex3DN, normal));
             glEnableVertexAttribArray(0);
             glEnableVertexAttribArray(1);
         break;
         case VERTEX_3DTN:
-            glBufferData(GL_ARRAY_BUFFER, numVerts*sizeof(Vertex3DTN),
-                         vData, GL_STATIC_DRAW);
+            bsize = numVerts*sizeof(Vertex3DTN);
+            glBufferData(GL_ARRAY_BUFFER, bsize, vData, GL_STATIC_DRAW);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3DTN), (void*)offsetof(Vertex3DTN, pos));
             glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3DTN), (void*)offsetof(Vertex3DTN, texcoord));
             glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3DTN), (void*)offsetof(Vertex3DTN, normal));
@@ -277,23 +457,156 @@ bool RenderManager::createMesh(const void *vData, VertexFormat format, int numVe
 
     }
 
-    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bsize);
-    m_memoryUsed+=bsize;
+    m_gpuMemory.allocate(GPU_MEM_VERTEX_BUFFER, vboName, bsize);
     m_totalMeshes++;
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     return true;
 }
 
+bool RenderManager::createInstanceBuffer(std::size_t capacity) {
+    if(!m_instanceBuffer) {
+        glGenBuffers(1, &m_instanceBuffer);
+        if(!m_instanceBuffer) {
+            m_logManager->logErr("(RenderManager) Failed to create instance buffer");
+            return false;
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instanceCapacity = capacity;
+    m_instanceOffset = 0;
+    m_gpuMemory.allocate(GPU_MEM_VERTEX_BUFFER, m_instanceBuffer, capacity);
+    return true;
+}
+
+void RenderManager::destroyInstanceBuffer() {
+    if(m_instanceBuffer) {
+        m_gpuMemory.release(GPU_MEM_VERTEX_BUFFER, m_instanceBuffer);
+        m_glState.onDeleteBuffer(m_instanceBuffer);
+        glDeleteBuffers(1, &m_instanceBuffer);
+        m_instanceBuffer = 0;
+        m_instanceCapacity = 0;
+    }
+}
+
+GLintptr RenderManager::pushInstanceData(const glm::mat4 *worlds, std::size_t count) {
+    std::size_t size = count*sizeof(glm::mat4);
+    if(m_instanceOffset+size>m_instanceCapacity) {
+        // Reallocation orphans the old store, draws already issued keep it
+        std::size_t capacity = m_instanceCapacity*2;
+        if(capacity<size) {
+            capacity = size;
+        }
+        if(!createInstanceBuffer(capacity)) {
+            return 0;
+        }
+    }
+
+    GLintptr offset = m_instanceOffset;
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, worlds);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instanceOffset+=size;
+    return offset;
+}
+
+void RenderManager::bindInstanceData(GLuint vao, GLintptr offset) {
+    bindInstanceBuffer(vao, m_instanceBuffer, offset);
+}
+
+void RenderManager::bindInstanceBuffer(GLuint vao, GLuint buffer, GLintptr offset) {
+    m_glState.bindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for(int i = 0;i<INSTANCE_ATTRIB_NUM;i++) {
+        GLuint loc = INSTANCE_ATTRIB_WORLD+i;
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(offset+i*sizeof(glm::vec4)));
+        glVertexAttribDivisor(loc, 1);
+        glEnableVertexAttribArray(loc);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderManager::unbindInstanceData(GLuint vao) {
+    m_glState.bindVertexArray(vao);
+    for(int i = 0;i<INSTANCE_ATTRIB_NUM;i++) {
+        GLuint loc = INSTANCE_ATTRIB_WORLD+i;
+        glDisableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 0);
+    }
+}
+
+void RenderManager::orphanInstanceBuffer() {
+    if(!m_instanceOffset) {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instanceOffset = 0;
+}
+
+void RenderManager::drawArrays(GLsizei numVerts) {
+    glDrawArrays(GL_TRIANGLES, 0, numVerts);
+    m_frameTriangles+=numVerts/3;
+    m_frameDrawCalls++;
+    m_totalDrawCalls++;
+}
+
+void RenderManager::drawArraysInstanced(GLsizei numVerts, GLsizei numInstances) {
+    glDrawArraysInstanced(GL_TRIANGLES, 0, numVerts, numInstances);
+    m_frameTriangles+=static_cast<std::uint64_t>(numVerts/3)*numInstances;
+    m_frameDrawCalls++;
+    m_totalDrawCalls++;
+}
+
+void RenderManager::drawArraysIndirect(GLintptr offset, std::uint64_t triangles) {
+    glDrawArraysIndirect(GL_TRIANGLES, (const void*)offset);
+    m_frameTriangles+=triangles;
+    m_frameDrawCalls++;
+    m_totalDrawCalls++;
+}
+
+void RenderManager::addCullingStats(std::size_t visible, std::size_t culled,
+                                    std::size_t occluded) {
+    m_frameVisibleObjects+=visible;
+    m_frameCulledObjects+=culled;
+    m_frameOccludedObjects+=occluded;
+    m_totalCulledObjects+=culled;
+    m_totalOccludedObjects+=occluded;
+}
+
+void RenderManager::addOcclusionQueryStats(std::size_t queries, std::size_t hidden) {
+    m_frameOcclusionQueries+=queries;
+    m_frameQueryHidden+=hidden;
+    m_totalOcclusionQueries+=queries;
+    m_totalQueryHidden+=hidden;
+}
+
 void RenderManager::destroyMesh(GLuint &vao, GLuint &vbo) {
+    if(hasRenderThread()) {
+        GLuint vaoName = vao;
+        GLuint vboName = vbo;
+        vao = 0;
+        vbo = 0;
+        m_renderThread->defer([this, vaoName, vboName]() {
+            GLuint a = vaoName, b = vboName;
+            releaseMesh(a, b);
+        });
+        return;
+    }
+    releaseMesh(vao, vbo);
+}
+
+void RenderManager::releaseMesh(GLuint &vao, GLuint &vbo) {
     if(!glIsBuffer(vbo)) {
         return;
     }
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    GLint bsize = 0;
-    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bsize);
-    m_memoryUsed-=bsize;
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_gpuMemory.release(GPU_MEM_VERTEX_BUFFER, vbo);
     destroyVAOAndVBO(vao, vbo);
 }
 
@@ -315,13 +628,15 @@ bool RenderManager::createVAOAndVBO(GLuint &vao, GLuint &vbo) {
 
 void RenderManager::destroyVAOAndVBO(GLuint &vao, GLuint &vbo) {
     if(glIsBuffer(vbo)) {
+        m_glState.onDeleteBuffer(vbo);
         glDeleteBuffers(1, &vbo);
         vbo = 0;
     } else {
         m_logManager->logWarn("(RenderManager) Trying to destroy GL object which does not appear to be of Buffer type");
     }
 
-    if(glIsVertexArray(vbo)) {
+    if(glIsVertexArray(vao)) {
+        m_glState.onDeleteVertexArray(vao);
         glDeleteVertexArrays(1, &vao);
         vao = 0;
     } else {
@@ -330,91 +645,227 @@ void RenderManager::destroyVAOAndVBO(GLuint &vao, GLuint &vbo) {
 }
 
 bool RenderManager::createShader(const char *vsSrc, const char *fsSrc,int vsVer,
-                                 int fsVer,const int numOutputs, GLuint &glName) {
+                                 int fsVer,const int numOutputs, GLuint &glName,
+                                 bool withSupport) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() {
+            return createShader(vsSrc, fsSrc, vsVer, fsVer, numOutputs, glName, withSupport);
+        });
+    }
+
+    PendingProgram pending;
+    if(!beginShader(vsSrc, fsSrc, vsVer, fsVer, numOutputs, pending, withSupport)) {
+        return false;
+    }
+    return finishShader(pending, glName);
+}
 
+bool RenderManager::beginShader(const char *vsSrc, const char *fsSrc, int vsVer,
+                                int fsVer, const int numOutputs, PendingProgram &pending,
+                                bool withSupport, const std::string &defines) {
     if(!vsSrc || !fsSrc) {
         m_logManager->logErr("(RenderManager) NULL shader source passed");
         return false;
     }
 
-    GLuint vs = 0, fs = 0;
-
-    auto cleanup = [&] {
-        if(vs) {
-            glDeleteShader(vs);
-            vs = 0;
-        }
-
-        if(fs) {
-            glDeleteShader(fs);
-            fs = 0;
-        }
+    pending = PendingProgram();
+    pending.program = glCreateProgram();
+    if(!pending.program) {
+        m_logManager->logErr("(RenderManager) Failed to create Program Object");
+        return false;
+    }
 
-        if(glName) {
-            glDeleteProgram(glName);
-            glName = 0;
+    if(m_programCache) {
+        const std::string support = withSupport?m_resManager->getShaderSupport():"";
+        pending.cacheKey = m_programCache->makeKey({ std::to_string(vsVer), defines, support, vsSrc,
+                                                     std::to_string(fsVer), defines, support, fsSrc,
+                                                     std::to_string(numOutputs) });
+        if(m_programCache->load(pending.cacheKey, pending.program)) {
+            pending.cached = true;
+            return true;
         }
-    };
+    }
 
-    vs = glCreateShader(GL_VERTEX_SHADER);
-    if(!vs) {
+    pending.vs = glCreateShader(GL_VERTEX_SHADER);
+    if(!pending.vs) {
         m_logManager->logErr("(RenderManager) Failed to create VS Object");
-        cleanup();
+        releasePending(pending);
         return false;
     }
 
-    fs = glCreateShader(GL_FRAGMENT_SHADER);
-    if(!fs) {
+    pending.fs = glCreateShader(GL_FRAGMENT_SHADER);
+    if(!pending.fs) {
         m_logManager->logErr("(RenderManager) Failed to create FS Object");
-        cleanup();
+        releasePending(pending);
         return false;
     }
 
-    if(!compileShader(vs, vsSrc, vsVer)) {
-        cleanup();
+    // Statuses are not queried here, that would wait for the compiler
+    submitShader(pending.vs, vsSrc, vsVer, withSupport, defines);
+    submitShader(pending.fs, fsSrc, fsVer, withSupport, defines);
+
+    // Output locations only take effect on the next link
+    for(int i = 0;i<numOutputs;i++) {
+        glBindFragDataLocation(pending.program, i, std::string("_OUT"+std::to_string(i)).c_str());
+    }
+    if(m_programCache) {
+        ProgramCache::prepare(pending.program);
+    }
+
+    glAttachShader(pending.program, pending.vs);
+    glAttachShader(pending.program, pending.fs);
+    glLinkProgram(pending.program);
+    return true;
+}
+
+bool RenderManager::isShaderReady(const PendingProgram &pending) const {
+    if(pending.cached || !m_parallelCompile) {
+        return true;
+    }
+    GLint done = GL_FALSE;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done==GL_TRUE;
+}
+
+bool RenderManager::finishShader(PendingProgram &pending, GLuint &glName) {
+    glName = 0;
+    if(!pending.program) {
         return false;
     }
+    if(pending.cached) {
+        glName = pending.program;
+        pending = PendingProgram();
+        m_totalShaders++;
+        return true;
+    }
 
-    if(!compileShader(fs, fsSrc, fsVer)) {
-        cleanup();
+    if(!checkCompileStatus(pending.vs) || !checkCompileStatus(pending.fs) ||
+       !checkLinkStatus(pending.program)) {
+        releasePending(pending);
+        return false;
+    }
+
+    glDeleteShader(pending.vs);
+    glDeleteShader(pending.fs);
+
+    if(m_programCache) {
+        m_programCache->store(pending.cacheKey, pending.program);
+    }
+    glName = pending.program;
+    pending = PendingProgram();
+    m_totalShaders++;
+    return true;
+}
+
+void RenderManager::cancelShader(PendingProgram &pending) {
+    if(hasRenderThread()) {
+        PendingProgram p = pending;
+        pending = PendingProgram();
+        m_renderThread->defer([this, p]() { PendingProgram n = p; releasePending(n); });
+        return;
+    }
+    releasePending(pending);
+}
+
+void RenderManager::warmUpProgram(GLuint program) {
+    if(!program || !m_warmUpVao) {
+        return;
+    }
+    m_glState.useProgram(program);
+    m_glState.bindVertexArray(m_warmUpVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void RenderManager::releasePending(PendingProgram &pending) {
+    if(pending.vs) {
+        glDeleteShader(pending.vs);
+    }
+    if(pending.fs) {
+        glDeleteShader(pending.fs);
+    }
+    if(pending.program) {
+        glDeleteProgram(pending.program);
+    }
+    pending = PendingProgram();
+}
+
+bool RenderManager::createComputeShader(const char *src, int ver, GLuint &glName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createComputeShader(src, ver, glName); });
+    }
+    if(!src) {
+        m_logManager->logErr("(RenderManager) NULL shader source passed");
         return false;
     }
 
     glName = glCreateProgram();
     if(!glName) {
         m_logManager->logErr("(RenderManager) Failed to create Program Object");
-        cleanup();
         return false;
     }
 
-    if(!linkProgram(glName, vs, fs)) {
-        cleanup();
+    std::uint64_t cacheKey = 0;
+    if(m_programCache) {
+        cacheKey = m_programCache->makeKey({ "compute", std::to_string(ver), src });
+        if(m_programCache->load(cacheKey, glName)) {
+            m_totalShaders++;
+            return true;
+        }
+        ProgramCache::prepare(glName);
+    }
+
+    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+    if(!cs) {
+        m_logManager->logErr("(RenderManager) Failed to create CS Object");
+        glDeleteProgram(glName);
+        glName = 0;
         return false;
     }
 
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    if(!compileShader(cs, src, ver, false)) {
+        glDeleteShader(cs);
+        glDeleteProgram(glName);
+        glName = 0;
+        return false;
+    }
 
-    for(int i = 0;i<numOutputs;i++) {
-        glBindFragDataLocation(glName, i, std::string("_OUT"+std::to_string(i)).c_str());
+    bool linked = linkProgram(glName, cs);
+    glDeleteShader(cs);
+    if(!linked) {
+        glDeleteProgram(glName);
+        glName = 0;
+        return false;
+    }
+    if(m_programCache) {
+        m_programCache->store(cacheKey, glName);
     }
     m_totalShaders++;
     return true;
 }
 
-bool RenderManager::compileShader(GLuint shader, const char *src, int ver) {
+bool RenderManager::compileShader(GLuint shader, const char *src, int ver, bool withSupport) {
+    submitShader(shader, src, ver, withSupport, "");
+    return checkCompileStatus(shader);
+}
+
+void RenderManager::submitShader(GLuint shader, const char *src, int ver,
+                                 bool withSupport, const std::string &defines) {
 
     std::string versionHeader = "#version "+ std::to_string(ver) + "\n";
+    std::string support = withSupport?m_resManager->getShaderSupport():"";
 
-    const GLchar **source = new const GLchar*[3];
+    const GLchar *source[4];
     source[0] = versionHeader.c_str();
-    source[1] = m_resManager->getShaderSupport().c_str();
-    source[2] = src;
+    source[1] = defines.c_str();
+    source[2] = support.c_str();
+    source[3] = src;
 
-    glShaderSource(shader, 3, source, nullptr);
+    glShaderSource(shader, 4, source, nullptr);
 
     glCompileShader(shader);
+}
 
+bool RenderManager::checkCompileStatus(GLuint shader) {
     GLint compileStatus, shaderType;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
     glGetShaderiv(shader, GL_SHADER_TYPE, &shaderType);
@@ -426,6 +877,9 @@ bool RenderManager::compileShader(GLuint shader, const char *src, int ver) {
         case GL_FRAGMENT_SHADER:
             strType = "fragment";
             break;
+        case GL_COMPUTE_SHADER:
+            strType = "compute";
+            break;
         default:
             strType = "";
             break;
@@ -446,11 +900,13 @@ bool RenderManager::compileShader(GLuint shader, const char *src, int ver) {
     return true;
 }
 
-bool RenderManager::linkProgram(GLuint program, GLuint vs, GLuint fs) {
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-
+bool RenderManager::linkProgram(GLuint program, GLuint cs) {
+    glAttachShader(program, cs);
     glLinkProgram(program);
+    return checkLinkStatus(program);
+}
+
+bool RenderManager::checkLinkStatus(GLuint program) {
     GLint linkStatus;
     glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
     if(linkStatus!=GL_TRUE) {
@@ -470,57 +926,450 @@ bool RenderManager::linkProgram(GLuint program, GLuint vs, GLuint fs) {
 }
 
 void RenderManager::destroyShader(GLuint &progId) {
+    if(hasRenderThread()) {
+        GLuint name = progId;
+        progId = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseShader(n); });
+        return;
+    }
+    releaseShader(progId);
+}
+
+void RenderManager::releaseShader(GLuint &progId) {
     if(progId && glIsProgram(progId)) {
+        m_glState.onDeleteProgram(progId);
         glDeleteProgram(progId);
         progId = 0;
     }
 }
 
+bool RenderManager::createUniformBuffer(std::size_t size, GLuint &bufferName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createUniformBuffer(size, bufferName); });
+    }
+    bufferName = 0;
+    glGenBuffers(1, &bufferName);
+    if(!bufferName) {
+        m_logManager->logErr("(RenderManager) Failed to create uniform buffer");
+        return false;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferName);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_gpuMemory.allocate(GPU_MEM_UNIFORM_BUFFER, bufferName, size);
+    return true;
+}
+
+void RenderManager::updateUniformBuffer(GLuint buffer, std::size_t offset,
+                                        std::size_t size, const void *data) {
+    if(!buffer || !size) {
+        return;
+    }
+    if(isOffGLThread()) {
+        callOnGLThread([&]() { updateUniformBuffer(buffer, offset, size, data); return true; });
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+bool RenderManager::createStorageBuffer(std::size_t size, const void *data, GLuint &bufferName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createStorageBuffer(size, data, bufferName); });
+    }
+    bufferName = 0;
+    glGenBuffers(1, &bufferName);
+    if(!bufferName) {
+        m_logManager->logErr("(RenderManager) Failed to create storage buffer");
+        return false;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferName);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_gpuMemory.allocate(GPU_MEM_STORAGE_BUFFER, bufferName, size);
+    return true;
+}
+
+void RenderManager::updateStorageBuffer(GLuint buffer, std::size_t offset,
+                                        std::size_t size, const void *data) {
+    if(!buffer || !size) {
+        return;
+    }
+    if(isOffGLThread()) {
+        callOnGLThread([&]() { updateStorageBuffer(buffer, offset, size, data); return true; });
+        return;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void RenderManager::destroyStorageBuffer(GLuint &buffer) {
+    if(hasRenderThread()) {
+        GLuint name = buffer;
+        buffer = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseStorageBuffer(n); });
+        return;
+    }
+    releaseStorageBuffer(buffer);
+}
+
+void RenderManager::releaseStorageBuffer(GLuint &buffer) {
+    if(buffer && glIsBuffer(buffer)) {
+        m_gpuMemory.release(GPU_MEM_STORAGE_BUFFER, buffer);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
+
+bool RenderManager::createTextureBuffer(GLenum internalFormat, std::size_t size,
+                                        GLuint &bufferName, GLuint &texName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() {
+            return createTextureBuffer(internalFormat, size, bufferName, texName);
+        });
+    }
+    bufferName = 0;
+    texName = 0;
+    glGenBuffers(1, &bufferName);
+    glGenTextures(1, &texName);
+    if(!bufferName || !texName) {
+        m_logManager->logErr("(RenderManager) Failed to create texture buffer");
+        releaseTextureBuffer(bufferName, texName);
+        return false;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, bufferName);
+    glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    m_glState.bindTexture(0, GL_TEXTURE_BUFFER, texName);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, bufferName);
+    m_gpuMemory.allocate(GPU_MEM_TEXTURE_BUFFER, bufferName, size);
+    return true;
+}
+
+void RenderManager::updateTextureBuffer(GLuint buffer, std::size_t offset,
+                                        std::size_t size, const void *data) {
+    if(!buffer || !size) {
+        return;
+    }
+    if(isOffGLThread()) {
+        callOnGLThread([&]() { updateTextureBuffer(buffer, offset, size, data); return true; });
+        return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, offset, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void RenderManager::destroyTextureBuffer(GLuint &buffer, GLuint &texName) {
+    if(hasRenderThread()) {
+        GLuint bufferName = buffer;
+        GLuint tex = texName;
+        buffer = 0;
+        texName = 0;
+        m_renderThread->defer([this, bufferName, tex]() {
+            GLuint b = bufferName, t = tex;
+            releaseTextureBuffer(b, t);
+        });
+        return;
+    }
+    releaseTextureBuffer(buffer, texName);
+}
+
+void RenderManager::releaseTextureBuffer(GLuint &buffer, GLuint &texName) {
+    if(texName) {
+        m_glState.onDeleteTexture(texName);
+        glDeleteTextures(1, &texName);
+        texName = 0;
+    }
+    if(buffer && glIsBuffer(buffer)) {
+        m_gpuMemory.release(GPU_MEM_TEXTURE_BUFFER, buffer);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
+
+void RenderManager::destroyUniformBuffer(GLuint &buffer) {
+    if(hasRenderThread()) {
+        GLuint name = buffer;
+        buffer = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseUniformBuffer(n); });
+        return;
+    }
+    releaseUniformBuffer(buffer);
+}
+
+void RenderManager::releaseUniformBuffer(GLuint &buffer) {
+    if(buffer && glIsBuffer(buffer)) {
+        m_gpuMemory.release(GPU_MEM_UNIFORM_BUFFER, buffer);
+        m_glState.onDeleteBuffer(buffer);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
+
+bool RenderManager::createQuery(GLuint &queryName) {
+    if(isOffGLThread()) {
+        return callOnGLThread([&]() { return createQuery(queryName); });
+    }
+    queryName = 0;
+    glGenQueries(1, &queryName);
+    if(!queryName) {
+        m_logManager->logErr("(RenderManager) Failed to create query object");
+        return false;
+    }
+    return true;
+}
+
+void RenderManager::destroyQuery(GLuint &query) {
+    if(hasRenderThread()) {
+        GLuint name = query;
+        query = 0;
+        m_renderThread->defer([this, name]() { GLuint n = name; releaseQuery(n); });
+        return;
+    }
+    releaseQuery(query);
+}
+
+void RenderManager::releaseQuery(GLuint &query) {
+    if(query) {
+        glDeleteQueries(1, &query);
+        query = 0;
+    }
+}
+
+void RenderManager::releaseMaterial(const Material *mat) {
+    if(hasRenderThread()) {
+        // Frames in flight may still bind the slot
+        m_renderThread->defer([this, mat]() {
+            if(m_uniformBuffers) {
+                m_uniformBuffers->releaseMaterial(mat);
+            }
+        });
+        return;
+    }
+    if(m_uniformBuffers) {
+        m_uniformBuffers->releaseMaterial(mat);
+    }
+}
+
 void RenderManager::setupGL() {
-    glEnable(GL_DEPTH_TEST);
+    m_glState.invalidate();
+    m_glState.setDepthTest(true);
     glClearColor(0.1f,0.1f,0.1f,1.0f);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_CULL_FACE);
+    m_glState.setBlend(true);
+    m_glState.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_glState.setCullFace(true);
 }
 
 void RenderManager::render() {
+    prepareFrame(m_framePackets[0]);
+    renderFrame(m_framePackets[0]);
+}
+
+void RenderManager::prepareFrame(FramePacket &packet) {
+    packet.frame = m_preparedFrames++;
+    if(m_renderTechnique) {
+        m_renderTechnique->prepare(packet);
+    } else {
+        packet.valid = false;
+    }
+}
+
+void RenderManager::renderFrame(const FramePacket &packet) {
     using namespace std::chrono;
-    milliseconds cur, last = duration_cast<milliseconds>(
-                        system_clock::now().time_since_epoch());
+    steady_clock::time_point start = steady_clock::now();
     beginFrame();
+    addCullingStats(packet.numVisible, packet.numCulled, packet.numOccluded);
     if(m_renderTechnique) {
-        m_renderTechnique->render();
+        m_renderTechnique->submit(packet);
     }
     endFrame();
-    cur = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-    int t = cur.count()-last.count();
-    m_totalFrames++;
-    m_averageFrameTime = m_averageFrameTime*(1-1.f/m_totalFrames)+(float)t/(m_totalFrames);
+    m_cpuFrameTimes.add(duration<double, std::milli>(steady_clock::now()-start).count());
+}
+
+FramePacket &RenderManager::getFramePacket(int i) {
+    return m_framePackets[i];
+}
+
+bool RenderManager::startRenderThread() {
+    if(m_renderThread) {
+        return true;
+    }
+    m_renderThread = new RenderThread([this](const FramePacket &packet) { renderFrame(packet); });
+    if(!m_renderThread) {
+        m_logManager->logErr("(RenderManager) Memory error");
+        return false;
+    }
+
+    // A context is current on one thread at a time
+    releaseContext();
+    auto bind = [this]() {
+        if(!makeContextCurrent()) {
+            m_logManager->logErr("(RenderManager) Failed to bind GL context on render thread");
+        }
+        m_glState.invalidate();
+    };
+    auto release = [this]() {
+        releaseContext();
+    };
+    if(!m_renderThread->start(bind, release)) {
+        m_logManager->logErr("(RenderManager) Failed to start render thread");
+        delete m_renderThread;
+        m_renderThread = nullptr;
+        makeContextCurrent();
+        return false;
+    }
+    m_queuedPacket = 0;
+    m_logManager->logInfo("(RenderManager) GL context moved to render thread");
+    return true;
+}
+
+void RenderManager::stopRenderThread() {
+    if(!m_renderThread) {
+        return;
+    }
+    m_renderThread->stop();
+    delete m_renderThread;
+    m_renderThread = nullptr;
+    makeContextCurrent();
+    m_glState.invalidate();
+}
+
+bool RenderManager::hasRenderThread() const {
+    return m_renderThread && m_renderThread->isRunning();
+}
+
+std::uint64_t RenderManager::getSubmittedFrames() const {
+    return hasRenderThread()?m_renderThread->getSubmittedFrames():0;
+}
+
+std::uint64_t RenderManager::getCompletedFrames() const {
+    return hasRenderThread()?m_renderThread->getCompletedFrames():0;
+}
+
+bool RenderManager::isOffGLThread() const {
+    return hasRenderThread() && !m_renderThread->isCurrent();
+}
+
+void RenderManager::queueFrame() {
+    if(!hasRenderThread()) {
+        render();
+        return;
+    }
+    // The slot was last drawn FRAME_PACKETS frames ago
+    m_renderThread->waitForSlot();
+    FramePacket &packet = m_framePackets[m_queuedPacket];
+    m_queuedPacket = (m_queuedPacket+1)%FRAME_PACKETS;
+    prepareFrame(packet);
+    m_renderThread->submitFrame(&packet);
+}
+
+bool RenderManager::callOnGLThread(const std::function<bool ()> &fn) {
+    if(!hasRenderThread()) {
+        return fn();
+    }
+    return m_renderThread->call(fn);
 }
 
 void RenderManager::beginFrame() {
     // TODO: do we need beginFrame() at all ?
     // glClear should be called by RenderTechinque
     //glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+
+    m_frameDrawCalls = 0;
+    m_frameTriangles = 0;
+    m_frameVisibleObjects = 0;
+    m_frameCulledObjects = 0;
+    m_frameOccludedObjects = 0;
+    m_frameOcclusionQueries = 0;
+    m_frameQueryHidden = 0;
+    m_glState.beginFrame();
+    m_gpuProfiler->beginFrame();
+    m_glState.bindFramebuffer(GL_FRAMEBUFFER, m_offscreenFbo);
+
+    orphanInstanceBuffer();
 }
 
 void RenderManager::endFrame() {
-    SDL_GL_SwapWindow(m_winManager->getSDLWindow());
+    m_gpuProfiler->beginPass("swap");
+    if(m_headless) {
+        // Nothing to present, the flush keeps frames from piling up
+        glFlush();
+    } else {
+        SDL_GL_SwapWindow(m_winManager->getSDLWindow());
+    }
+    m_gpuProfiler->endPass();
+    m_gpuProfiler->endFrame();
 }
 
 void RenderManager::destroy() {
-    SDL_GL_DeleteContext(m_context);
+    if(m_programCache) {
+        delete m_programCache;
+        m_programCache = nullptr;
+    }
+    if(m_gpuProfiler) {
+        delete m_gpuProfiler;
+        m_gpuProfiler = nullptr;
+    }
+    if(m_uniformBuffers) {
+        delete m_uniformBuffers;
+        m_uniformBuffers = nullptr;
+    }
+    destroyInstanceBuffer();
+    if(m_warmUpVao) {
+        m_glState.onDeleteVertexArray(m_warmUpVao);
+        glDeleteVertexArrays(1, &m_warmUpVao);
+        m_warmUpVao = 0;
+    }
+    destroyOffscreenTarget();
+    if(m_headless) {
+        delete m_headless;
+        m_headless = nullptr;
+    } else if(m_context) {
+        SDL_GL_DeleteContext(m_context);
+        m_context = nullptr;
+    }
 }
 
 void RenderManager::logStats() {
     m_logManager->logInfo("(RenderManager) STATS:");
     m_logManager->logInfo("\t Total draw calls: "+std::to_string(m_totalDrawCalls));
+    m_logManager->logInfo("\t GL state changes issued: "+std::to_string(m_glState.getTotalIssued())
+                          +", skipped: "+std::to_string(m_glState.getTotalSkipped()));
+    m_logManager->logInfo("\t Objects culled: "+std::to_string(m_totalCulledObjects)
+                          +" total, "+std::to_string(m_frameCulledObjects)+" of "
+                          +std::to_string(m_frameVisibleObjects+m_frameCulledObjects
+                                          +m_frameOccludedObjects)
+                          +" last frame");
+    m_logManager->logInfo("\t Objects occluded: "+std::to_string(m_totalOccludedObjects)
+                          +" total, "+std::to_string(m_frameOccludedObjects)+" last frame");
+    m_logManager->logInfo("\t Occlusion queries: "+std::to_string(m_totalOcclusionQueries)
+                          +" total, "+std::to_string(m_frameOcclusionQueries)+" last frame");
+    m_logManager->logInfo("\t Conditionally rendered: "+std::to_string(m_totalQueryHidden)
+                          +" total, "+std::to_string(m_frameQueryHidden)+" last frame");
     m_logManager->logInfo("\t Total GL textures: "+std::to_string(m_totalTextures));
     m_logManager->logInfo("\t Total shaders: "+std::to_string(m_totalShaders));
     m_logManager->logInfo("\t Total meshes: "+std::to_string(m_totalMeshes));
-    m_logManager->logInfo("\t Average render time: "+std::to_string(m_averageFrameTime)+"(ms)");
-    m_logManager->logInfo("\t Memory used: "+std::to_string((float)m_memoryUsed/(2<<20))+"MB");
+    m_logManager->logInfo("\t CPU render time: "+m_cpuFrameTimes.describe());
+    if(m_gpuProfiler) {
+        m_gpuProfiler->logStats();
+    }
+    if(m_programCache) {
+        m_programCache->logStats();
+    }
+    m_logManager->logInfo("\t GPU memory used: "+toMegabytes(m_gpuMemory.getTotalUsed())
+                          +"MB (peak "+toMegabytes(m_gpuMemory.getPeakUsed())+"MB)");
+    for(int i = 0;i<GPU_MEM_NUM_CATEGORIES;i++) {
+        GpuMemoryCategory c = static_cast<GpuMemoryCategory>(i);
+        m_logManager->logInfo("\t\t "+std::string(GpuMemoryTracker::getCategoryName(c))+": "
+                              +toMegabytes(m_gpuMemory.getUsed(c))+"MB in "
+                              +std::to_string(m_gpuMemory.getResourceCount(c))+" objects");
+    }
 }
 
 } // namespace splitspace
@@ -0,0 +1,121 @@
+#include <splitspace/RenderQueue.hpp>
+#include <splitspace/Object.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+static const int PROGRAM_BITS = 10;
+static const int MATERIAL_BITS = 14;
+static const int MESH_BITS = 14;
+static const int DEPTH_BITS = 24;
+
+static const std::uint64_t PROGRAM_MASK = (1ull<<PROGRAM_BITS)-1;
+static const std::uint64_t MATERIAL_MASK = (1ull<<MATERIAL_BITS)-1;
+static const std::uint64_t MESH_MASK = (1ull<<MESH_BITS)-1;
+static const std::uint64_t DEPTH_MASK = (1ull<<DEPTH_BITS)-1;
+
+RenderQueue::RenderQueue()
+{}
+
+void RenderQueue::clear() {
+    m_items.clear();
+    // Ids only need to be unique within a frame, restarting keeps them in their key bits
+    m_programIds.clear();
+    m_materialIds.clear();
+    m_meshIds.clear();
+}
+
+template<class T>
+std::uint32_t RenderQueue::getId(std::unordered_map<T, std::uint32_t> &ids, T key) {
+    auto it = ids.find(key);
+    if(it!=ids.end()) {
+        return it->second;
+    }
+    std::uint32_t id = ids.size();
+    ids[key] = id;
+    return id;
+}
+
+std::uint64_t RenderQueue::makeKey(RenderPass pass, std::uint32_t program, std::uint32_t material,
+                                   std::uint32_t mesh, float depth) {
+    depth = std::min(std::max(depth, 0.f), 1.f);
+    std::uint64_t d = static_cast<std::uint64_t>(depth*DEPTH_MASK)&DEPTH_MASK;
+    std::uint64_t state = ((program&PROGRAM_MASK)<<(MATERIAL_BITS+MESH_BITS))
+                        | ((material&MATERIAL_MASK)<<MESH_BITS)
+                        | (mesh&MESH_MASK);
+    std::uint64_t key = static_cast<std::uint64_t>(pass)<<62;
+
+    if(pass == RENDER_PASS_TRANSPARENT) {
+        key|=((DEPTH_MASK-d)<<(PROGRAM_BITS+MATERIAL_BITS+MESH_BITS)) | state;
+    } else {
+        key|=(state<<DEPTH_BITS) | d;
+    }
+    return key;
+}
+
+void RenderQueue::push(RenderPass pass, std::uint32_t program, const Object *o, float depth,
+                       const glm::mat4 *world, ShaderVariantKey variant) {
+    if(!o) {
+        return;
+    }
+
+    RenderItem item;
+    item.object = o;
+    item.material = o->getMaterial();
+    item.mesh = o->getMesh();
+    item.world = world?world:&o->getWorldMat();
+    item.variant = variant;
+    std::uint64_t programKey = (static_cast<std::uint64_t>(program)<<32)|variant;
+    item.key = makeKey(pass, getId(m_programIds, programKey),
+                       getId(m_materialIds, item.material),
+                       getId(m_meshIds, item.mesh), depth);
+    m_items.push_back(item);
+}
+
+void RenderQueue::sort() {
+    const std::size_t n = m_items.size();
+    if(n<2) {
+        return;
+    }
+
+    m_entries.resize(n);
+    m_scratch.resize(n);
+    for(std::size_t i = 0;i<n;i++) {
+        m_entries[i].key = m_items[i].key;
+        m_entries[i].index = i;
+    }
+
+    // LSD radix sort, 8 bits per pass
+    for(int shift = 0;shift<64;shift+=8) {
+        std::size_t count[256] = {0};
+        for(const auto &e : m_entries) {
+            count[(e.key>>shift)&0xFF]++;
+        }
+
+        // all keys share this digit, nothing to reorder
+        if(count[(m_entries[0].key>>shift)&0xFF] == n) {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for(int i = 0;i<256;i++) {
+            std::size_t c = count[i];
+            count[i] = offset;
+            offset+=c;
+        }
+
+        for(const auto &e : m_entries) {
+            m_scratch[count[(e.key>>shift)&0xFF]++] = e;
+        }
+        m_entries.swap(m_scratch);
+    }
+
+    m_sorted.resize(n);
+    for(std::size_t i = 0;i<n;i++) {
+        m_sorted[i] = m_items[m_entries[i].index];
+    }
+    m_items.swap(m_sorted);
+}
+
+} // namespace splitspace
@@ -0,0 +1,188 @@
+#include <splitspace/RenderTargetPool.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/LogManager.hpp>
+
+#include <algorithm>
+
+namespace splitspace {
+
+RenderTargetPool::RenderTargetPool(RenderManager *rm, LogManager *lm): m_renderManager(rm),
+                                                                      m_logManager(lm)
+{}
+
+RenderTargetPool::~RenderTargetPool() {
+    destroy();
+}
+
+bool RenderTargetPool::allocate(const std::vector<GraphTarget> &targets, int w, int h) {
+    // Attachments may change below
+    destroyFramebuffers();
+    for(auto &t : m_textures) {
+        t.used = false;
+    }
+
+    m_targetTextures.assign(targets.size(), -1);
+    for(std::size_t i = 0;i<targets.size();i++) {
+        int tw = std::max(1, int(w*targets[i].scale));
+        int th = std::max(1, int(h*targets[i].scale));
+        int t = findTexture(targets[i].internalFormat, tw, th);
+        if(t<0) {
+            if(!createTexture(targets[i].internalFormat, tw, th)) {
+                m_logManager->logErr("(RenderTargetPool) Failed to create "+std::to_string(tw)
+                                     +"x"+std::to_string(th)+" target");
+                return false;
+            }
+            t = m_textures.size()-1;
+        }
+        m_textures[t].used = true;
+        m_targetTextures[i] = t;
+    }
+
+    std::vector<PoolTexture> kept;
+    std::vector<int> remap(m_textures.size(), -1);
+    for(std::size_t i = 0;i<m_textures.size();i++) {
+        if(m_textures[i].used) {
+            remap[i] = kept.size();
+            kept.push_back(m_textures[i]);
+        } else {
+            destroyTexture(m_textures[i]);
+        }
+    }
+    m_textures = kept;
+    for(auto &t : m_targetTextures) {
+        t = remap[t];
+    }
+    return true;
+}
+
+void RenderTargetPool::destroy() {
+    destroyFramebuffers();
+    for(auto &t : m_textures) {
+        destroyTexture(t);
+    }
+    m_textures.clear();
+    m_targetTextures.clear();
+}
+
+GLuint RenderTargetPool::getTexture(int target) const {
+    if(target<0 || std::size_t(target)>=m_targetTextures.size()) {
+        return 0;
+    }
+    return m_textures[m_targetTextures[target]].texture;
+}
+
+int RenderTargetPool::getWidth(int target) const {
+    if(target<0 || std::size_t(target)>=m_targetTextures.size()) {
+        return 0;
+    }
+    return m_textures[m_targetTextures[target]].width;
+}
+
+int RenderTargetPool::getHeight(int target) const {
+    if(target<0 || std::size_t(target)>=m_targetTextures.size()) {
+        return 0;
+    }
+    return m_textures[m_targetTextures[target]].height;
+}
+
+GLuint RenderTargetPool::getFramebuffer(const std::vector<int> &colors, int depth) {
+    std::vector<int> key = colors;
+    key.push_back(depth);
+    auto it = m_framebuffers.find(key);
+    if(it!=m_framebuffers.end()) {
+        return it->second;
+    }
+
+    GLStateCache &state = m_renderManager->getGLState();
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    std::vector<GLenum> drawBuffers;
+    for(std::size_t i = 0;i<colors.size();i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0+i, GL_TEXTURE_2D,
+                               getTexture(colors[i]), 0);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0+i);
+    }
+    if(drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    } else {
+        glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    }
+    if(depth>=0) {
+        GLenum format = m_textures[m_targetTextures[depth]].internalFormat;
+        GLenum attachment = format == GL_DEPTH24_STENCIL8?GL_DEPTH_STENCIL_ATTACHMENT:GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, getTexture(depth), 0);
+    }
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_renderManager->getDefaultFramebuffer());
+    if(!complete) {
+        m_logManager->logErr("(RenderTargetPool) Incomplete framebuffer");
+        state.onDeleteFramebuffer(fbo);
+        glDeleteFramebuffers(1, &fbo);
+        return 0;
+    }
+    m_framebuffers[key] = fbo;
+    return fbo;
+}
+
+int RenderTargetPool::findTexture(GLenum internalFormat, int w, int h) const {
+    for(std::size_t i = 0;i<m_textures.size();i++) {
+        const PoolTexture &t = m_textures[i];
+        if(!t.used && t.internalFormat == internalFormat && t.width == w && t.height == h) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RenderTargetPool::createTexture(GLenum internalFormat, int w, int h) {
+    const RenderGraphFormat *format = RenderGraph::findFormat(internalFormat);
+    if(!format) {
+        return false;
+    }
+    PoolTexture t;
+    t.internalFormat = internalFormat;
+    t.width = w;
+    t.height = h;
+    t.used = false;
+    glGenTextures(1, &t.texture);
+    if(!t.texture) {
+        return false;
+    }
+
+    // Color targets are sampled by later passes, possibly at another scale
+    GLint filter = RenderGraph::isDepthFormat(internalFormat)?GL_NEAREST:GL_LINEAR;
+    m_renderManager->getGLState().bindTexture(0, GL_TEXTURE_2D, t.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format->format, format->type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    m_renderManager->getGpuMemory().allocate(GPU_MEM_RENDERTARGET, t.texture,
+                                             GpuMemoryTracker::getTextureSize(internalFormat, w, h));
+    m_textures.push_back(t);
+    return true;
+}
+
+void RenderTargetPool::destroyTexture(PoolTexture &t) {
+    if(!t.texture) {
+        return;
+    }
+    m_renderManager->getGpuMemory().release(GPU_MEM_RENDERTARGET, t.texture);
+    m_renderManager->getGLState().onDeleteTexture(t.texture);
+    glDeleteTextures(1, &t.texture);
+    t.texture = 0;
+}
+
+void RenderTargetPool::destroyFramebuffers() {
+    GLStateCache &state = m_renderManager->getGLState();
+    for(auto &f : m_framebuffers) {
+        state.onDeleteFramebuffer(f.second);
+        glDeleteFramebuffers(1, &f.second);
+    }
+    m_framebuffers.clear();
+}
+
+} // namespace splitspace
@@ -3,12 +3,28 @@
 #include <splitspace/Material.hpp>
 #include <splitspace/Mesh.hpp>
 #include <splitspace/Shader.hpp>
+#include <splitspace/Scene.hpp>
+#include <splitspace/Camera.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/UniformBuffers.hpp>
+#include <splitspace/JobManager.hpp>
+#include <splitspace/OcclusionQueries.hpp>
+#include <splitspace/GpuCuller.hpp>
+#include <splitspace/GpuProfiler.hpp>
+#include <splitspace/DynamicResolution.hpp>
+#include <splitspace/Upscaler.hpp>
+#include <splitspace/Config.hpp>
 
 #include <GL/glew.h>
 #include <GL/gl.h>
 
+#include <algorithm>
+
 namespace splitspace {
 
+// GPU time of everything a technique draws, what the resolution adapts to
+static const char *RESOLUTION_PASS = "scene";
+
 bool RenderTechnique::setupMaterial(Shader *shader, const Material *m) {
     if(!shader || !m) {
         return false;
@@ -22,12 +38,627 @@ bool RenderTechnique::setupMesh(Shader *shader, const Mesh *m) {
         return false;
     }
 
-    glBindVertexArray(m->getVAO());
+    m_renderManager->getGLState().bindVertexArray(m->getVAO());
+    return true;
+}
+
+void RenderTechnique::prepare(FramePacket &packet) {
+    packet.valid = false;
+    packet.queue.clear();
+    packet.lights.clear();
+    packet.numVisible = 0;
+    packet.numCulled = 0;
+    packet.numOccluded = 0;
+    if(!m_scene || !m_viewCamera) {
+        return;
+    }
+
+    FrameView &view = packet.view;
+    view.view = m_viewCamera->getView();
+    view.proj = m_viewCamera->getProj();
+    view.viewProj = m_viewCamera->getVP();
+    view.frustum = m_viewCamera->getFrustum();
+    view.position = m_viewCamera->getPosition();
+    view.near = m_viewCamera->getNear();
+    view.far = m_viewCamera->getFar();
+
+    const LightList &lights = m_scene->getLightList();
+    packet.lights.resize(lights.size());
+    for(std::size_t i = 0;i<lights.size();i++) {
+        UniformBuffers::packLight(packet.lights[i], lights[i]);
+    }
+
+    const RenderList &renderList = m_scene->getRenderList();
+    packet.worlds.resize(renderList.size());
+    for(std::size_t i = 0;i<renderList.size();i++) {
+        packet.worlds[i] = renderList[i]->getWorldMat();
+    }
+    packet.valid = true;
+
+    buildRenderQueue(getSceneShader(), packet);
+}
+
+void RenderTechnique::submit(const FramePacket &packet) {
+    Shader *shader = getSceneShader();
+    if(shader) {
+        shader->pollVariants();
+    }
+    m_packet = &packet;
+    if(m_resolution) {
+        updateResolution();
+        m_renderManager->getGpuProfiler()->beginPass(RESOLUTION_PASS);
+        render();
+        m_renderManager->getGpuProfiler()->endPass();
+    } else {
+        render();
+    }
+    m_packet = nullptr;
+}
+
+void RenderTechnique::updateUniformBuffers(bool batchedLights) {
+    UniformBuffers *ubo = m_renderManager->getUniformBuffers();
+    if(!ubo || !m_packet->valid) {
+        return;
+    }
+
+    ubo->updateFrame(m_packet->view.viewProj, m_packet->view.position);
+    if(batchedLights) {
+        ubo->updateLightBatch(m_packet->lights, 0);
+    } else {
+        ubo->updateLights(m_packet->lights);
+    }
+}
+
+void RenderTechnique::buildRenderQueue(Shader *shader, FramePacket &packet) {
+    if(!shader) {
+        return;
+    }
+
+    const FrameView &view = packet.view;
+    const glm::mat4 &vp = view.viewProj;
+    const float near = view.near;
+    const float range = view.far-near;
+    const GLuint program = shader->getProgramId();
+    const RenderList &renderList = m_scene->getRenderList();
+
+    const Frustum &frustum = view.frustum;
+
+    // BVH accepts or rejects whole subtrees, only objects in leaves
+    // crossing the frustum are tested one by one
+    m_visibleItems.clear();
+    m_partialItems.clear();
+    const bool gpuCulled = useGpuCulling(shader);
+    const Bvh *bvh = m_scene->getBvh();
+    if(gpuCulled) {
+        // Opaque objects are culled and drawn from GPU buffers,
+        // transparent ones still need back-to-front order
+        m_gpuCuller->update(renderList);
+        m_gpuCuller->cull(frustum);
+        m_renderManager->getGLState().useProgram(program);
+        m_partialItems = m_gpuCuller->getTransparentItems();
+    } else if(bvh && bvh->getNumItems() == renderList.size()) {
+        bvh->cullFrustum(frustum, m_visibleItems, m_partialItems);
+    } else {
+        for(std::size_t i = 0;i<renderList.size();i++) {
+            m_partialItems.push_back(i);
+        }
+    }
+
+    m_frustumCuller.clear();
+    for(auto i : m_partialItems) {
+        m_frustumCuller.add(renderList[i]->getWorldBoundingSphere());
+    }
+    m_frustumCuller.cull(frustum);
+    for(std::size_t i = 0;i<m_partialItems.size();i++) {
+        if(m_frustumCuller.isVisible(i)) {
+            m_visibleItems.push_back(m_partialItems[i]);
+        }
+    }
+    if(gpuCulled) {
+        // Opaque counts come from the GPU a few frames late
+        packet.numVisible = m_gpuCuller->getNumVisible()+m_visibleItems.size();
+        packet.numCulled = m_gpuCuller->getNumCulled()+m_partialItems.size()-m_visibleItems.size();
+    } else {
+        std::size_t numInFrustum = m_visibleItems.size();
+        cullOccluded(packet);
+        packet.numVisible = m_visibleItems.size();
+        packet.numCulled = renderList.size()-numInFrustum;
+        packet.numOccluded = numInFrustum-m_visibleItems.size();
+    }
+
+    for(auto i : m_visibleItems) {
+        const Object *o = renderList[i];
+        // w of the clip-space origin is the view depth of the object
+        const glm::vec4 &origin = packet.worlds[i][3];
+        float w = vp[0][3]*origin.x+vp[1][3]*origin.y+vp[2][3]*origin.z+vp[3][3]*origin.w;
+        float depth = (w-near)/range;
+
+        const Material *m = o->getMaterial();
+        RenderPass pass = (m && m->isTransparent())?RENDER_PASS_TRANSPARENT:RENDER_PASS_OPAQUE;
+        ShaderVariantKey variant = shader->selectVariant(m, packet.lights.size());
+        packet.queue.push(pass, program, o, depth, &packet.worlds[i], variant);
+    }
+
+    packet.queue.sort();
+}
+
+void RenderTechnique::cullOccluded(const FramePacket &packet) {
+    const RenderList &renderList = m_scene->getRenderList();
+
+    bool hasOccluders = false;
+    for(auto i : m_visibleItems) {
+        const Object *o = renderList[i];
+        if(o->isOccluder() && o->getMesh() && !o->getMesh()->getPositions().empty()) {
+            if(!hasOccluders) {
+                m_occlusionCuller.beginFrame(packet.view.viewProj);
+                hasOccluders = true;
+            }
+            const std::vector<glm::vec3> &pos = o->getMesh()->getPositions();
+            m_occlusionCuller.addOccluder(pos.data(), pos.size(), sizeof(glm::vec3),
+                                          packet.worlds[i]);
+        }
+    }
+    if(!hasOccluders) {
+        return;
+    }
+    m_occlusionCuller.rasterize(m_engine->jobManager);
+
+    // Occluders are kept, they would hide themselves
+    std::size_t numVisible = 0;
+    for(auto i : m_visibleItems) {
+        const Object *o = renderList[i];
+        if(o->isOccluder() || m_occlusionCuller.isVisible(o->getWorldAABB())) {
+            m_visibleItems[numVisible++] = i;
+        }
+    }
+    m_visibleItems.resize(numVisible);
+}
+
+void RenderTechnique::setScene(Scene *scene) {
+    if(scene!=m_scene && m_occlusionQueries) {
+        m_occlusionQueries->reset();
+    }
+    m_scene = scene;
+}
+
+bool RenderTechnique::initOcclusionQueries() {
+    if(!m_engine->config->render.occlusionQueries) {
+        return true;
+    }
+    if(m_engine->config->loop.pipelined || m_engine->config->render.renderThread) {
+        // Queries test live object bounds while the next frame is simulated
+        m_logManager->logWarn("(RenderTechnique) Occlusion queries are disabled with overlapped frames");
+        return true;
+    }
+
+    m_occlusionQueries = new OcclusionQueries(m_engine);
+    if(!m_occlusionQueries->init()) {
+        m_logManager->logErr("(RenderTechnique) Failed to initialise occlusion queries");
+        destroyOcclusionQueries();
+        return false;
+    }
+    return true;
+}
+
+void RenderTechnique::destroyOcclusionQueries() {
+    if(m_occlusionQueries) {
+        delete m_occlusionQueries;
+        m_occlusionQueries = nullptr;
+    }
+}
+
+bool RenderTechnique::initGpuCulling() {
+    if(!m_engine->config->render.gpuCulling || !GpuCuller::isSupported()) {
+        return true;
+    }
+    if(m_engine->config->loop.pipelined || m_engine->config->render.renderThread) {
+        // Culling dispatches GL work while the render queue is built
+        m_logManager->logWarn("(RenderTechnique) GPU culling is disabled with overlapped frames");
+        return true;
+    }
+
+    m_gpuCuller = new GpuCuller(m_engine);
+    if(!m_gpuCuller->init()) {
+        // Not fatal, the CPU path handles everything
+        m_logManager->logWarn("(RenderTechnique) GPU culling unavailable, culling on the CPU");
+        destroyGpuCulling();
+    }
+    return true;
+}
+
+bool RenderTechnique::initDynamicResolution() {
+    const Config *config = m_engine->config;
+    m_maxWidth = m_renderWidth = config->window.width;
+    m_maxHeight = m_renderHeight = config->window.height;
+    if(!config->render.dynamicResolution) {
+        return true;
+    }
+
+    UpscaleFilter filter = Upscaler::getFilterFromName(config->render.upscaleFilter);
+    if(filter == UPSCALE_UNKNOWN) {
+        m_logManager->logWarn("(RenderTechnique) Unknown upscale filter \""
+                              +config->render.upscaleFilter+"\", using bilinear");
+        filter = UPSCALE_BILINEAR;
+    }
+    m_upscaler = new Upscaler(m_renderManager, m_logManager);
+    if(!m_upscaler->init(filter)) {
+        m_logManager->logErr("(RenderTechnique) Failed to initialise upscaler");
+        destroyDynamicResolution();
+        return false;
+    }
+
+    // A change shows in GPU times only after the frames in flight
+    m_resolution = new DynamicResolution(config->render.minResolutionScale,
+                                         config->render.maxResolutionScale,
+                                         config->render.targetFrameTime, GPU_PROFILER_FRAMES);
+    m_resolution->getMaxSize(config->window.width, config->window.height, m_maxWidth, m_maxHeight);
+    m_resolution->getSize(config->window.width, config->window.height,
+                          m_renderWidth, m_renderHeight);
+    m_resolutionFrames = m_renderManager->getGpuProfiler()->getCollectedFrames();
     return true;
 }
 
+void RenderTechnique::destroyDynamicResolution() {
+    if(m_upscaler) {
+        delete m_upscaler;
+        m_upscaler = nullptr;
+    }
+    if(m_resolution) {
+        delete m_resolution;
+        m_resolution = nullptr;
+    }
+}
+
+float RenderTechnique::getResolutionScale() const {
+    return m_resolution?m_resolution->getScale():1.f;
+}
+
+void RenderTechnique::updateResolution() {
+    GpuProfiler *profiler = m_renderManager->getGpuProfiler();
+    if(profiler->getCollectedFrames()!=m_resolutionFrames) {
+        m_resolutionFrames = profiler->getCollectedFrames();
+        const TimingHistory *times = profiler->findPassTimes(RESOLUTION_PASS);
+        if(times && times->size()) {
+            m_resolution->addFrameTime(times->getLast());
+        }
+    }
+    const WindowConfig &window = m_engine->config->window;
+    m_resolution->getSize(window.width, window.height, m_renderWidth, m_renderHeight);
+    glViewport(0, 0, m_renderWidth, m_renderHeight);
+}
+
+void RenderTechnique::upscale(GLuint texture) {
+    if(!m_upscaler) {
+        return;
+    }
+    const WindowConfig &window = m_engine->config->window;
+    m_renderManager->getGLState().bindFramebuffer(GL_DRAW_FRAMEBUFFER,
+                                                  m_renderManager->getDefaultFramebuffer());
+    m_upscaler->draw(texture, m_renderWidth, m_renderHeight, m_maxWidth, m_maxHeight,
+                     window.width, window.height);
+}
+
+void RenderTechnique::destroyGpuCulling() {
+    if(m_gpuCuller) {
+        delete m_gpuCuller;
+        m_gpuCuller = nullptr;
+    }
+}
+
+bool RenderTechnique::useGpuCulling(const Shader *shader) const {
+    // Transforms reach the shader as instance attributes
+    return m_gpuCuller && shader->isInstanced();
+}
+
+void RenderTechnique::drawGpuCulled(Shader *shader) {
+    shader->setVP(m_packet->view.viewProj);
+
+    const Material *curMaterial = nullptr;
+    for(std::size_t b = 0;b<m_gpuCuller->getNumBuckets();b++) {
+        const Material *material = m_gpuCuller->getBucketMaterial(b);
+        if(material!=curMaterial) {
+            if(material && !setupMaterial(shader, material)) {
+                m_logManager->logErr("Failed to setup material");
+                continue;
+            }
+            curMaterial = material;
+        }
+        m_gpuCuller->drawBucket(b);
+    }
+}
+
+bool RenderTechnique::drawItem(Shader *shader, const RenderItem &item, Shader *&curShader,
+                               const Material *&curMaterial, const Mesh *&curMesh) {
+    shader = shader->getVariant(item.variant);
+    if(shader!=curShader) {
+        // Material uniforms belong to the program
+        m_renderManager->getGLState().useProgram(shader->getProgramId());
+        curShader = shader;
+        curMaterial = nullptr;
+    }
+    if(item.material!=curMaterial) {
+        if(item.material && !setupMaterial(shader, item.material)) {
+            m_logManager->logErr("Failed to setup material");
+            return false;
+        }
+        curMaterial = item.material;
+    }
+
+    shader->setMVP(m_packet->view.viewProj*(*item.world));
+    if(item.mesh!=curMesh) {
+        if(!setupMesh(shader, item.mesh)) {
+            m_logManager->logErr("Failed to setup mesh");
+            return false;
+        }
+        curMesh = item.mesh;
+    }
+    drawCall(item.mesh->getNumVerts());
+    return true;
+}
+
+void RenderTechnique::drawRenderQueue(Shader *shader) {
+    if(useGpuCulling(shader)) {
+        drawGpuCulled(shader);
+    }
+    if(shader->isInstanced()) {
+        drawRenderQueueInstanced(shader);
+        return;
+    }
+    if(m_occlusionQueries) {
+        drawRenderQueueQueried(shader);
+        return;
+    }
+
+    // Slices are recorded on worker threads, GL calls only happen on replay
+    const std::size_t numItems = m_packet->queue.size();
+    const std::size_t numSlices = (numItems+RENDER_RECORD_SLICE-1)/RENDER_RECORD_SLICE;
+    if(m_commandBuffers.size()<numSlices) {
+        m_commandBuffers.resize(numSlices);
+    }
+    JobManager::RangeFunc record = [&](std::size_t begin, std::size_t end) {
+        for(std::size_t s = begin;s<end;s++) {
+            std::size_t first = s*RENDER_RECORD_SLICE;
+            std::size_t last = std::min(first+RENDER_RECORD_SLICE, numItems);
+            recordRenderQueue(first, last, m_commandBuffers[s]);
+        }
+    };
+    if(m_engine->jobManager) {
+        m_engine->jobManager->parallelFor(numSlices, 1, record);
+    } else {
+        record(0, numSlices);
+    }
+
+    for(std::size_t s = 0;s<numSlices;s++) {
+        executeCommands(shader, m_commandBuffers[s]);
+    }
+    m_renderManager->getGLState().setDepthMask(true);
+}
+
+void RenderTechnique::recordRenderQueue(std::size_t begin, std::size_t end,
+                                        CommandBuffer &cb) {
+    cb.clear();
+    if(begin>=end) {
+        return;
+    }
+
+    const auto &items = m_packet->queue.getItems();
+    const glm::mat4 &vp = m_packet->view.viewProj;
+    const Material *curMaterial = nullptr;
+    const Mesh *curMesh = nullptr;
+    RenderPass curPass = RenderQueue::getPass(items[begin].key);
+    ShaderVariantKey curVariant = items[begin].variant;
+
+    // Each slice starts from unknown state, the state cache
+    // drops what is repeated across slice boundaries
+    cb.bindProgram(curVariant);
+    cb.setDepthWrite(curPass == RENDER_PASS_OPAQUE);
+    for(std::size_t i = begin;i<end;i++) {
+        const RenderItem &item = items[i];
+        if(!item.mesh) {
+            continue;
+        }
+
+        RenderPass pass = RenderQueue::getPass(item.key);
+        if(pass!=curPass) {
+            curPass = pass;
+            cb.setDepthWrite(pass == RENDER_PASS_OPAQUE);
+        }
+        if(item.variant!=curVariant) {
+            cb.bindProgram(item.variant);
+            curVariant = item.variant;
+            curMaterial = nullptr;
+        }
+        if(item.material!=curMaterial) {
+            cb.setMaterial(item.material);
+            curMaterial = item.material;
+        }
+        cb.setMatrix(UNIFORM_MVP_MAT, vp*(*item.world));
+        if(item.mesh!=curMesh) {
+            cb.bindVertexArray(item.mesh->getVAO());
+            curMesh = item.mesh;
+        }
+        cb.draw(item.mesh->getNumVerts());
+    }
+}
+
+void RenderTechnique::executeCommands(Shader *shader, const CommandBuffer &cb) {
+    GLStateCache &state = m_renderManager->getGLState();
+    Shader *variant = shader;
+    bool skipDraws = false;
+
+    for(const auto &c : cb.getCommands()) {
+        switch(c.type) {
+            case CMD_BIND_PROGRAM:
+                variant = shader->getVariant(c.arg0);
+                state.useProgram(variant->getProgramId());
+                break;
+            case CMD_BIND_VERTEX_ARRAY:
+                state.bindVertexArray(c.arg0);
+                break;
+            case CMD_SET_MATERIAL:
+                // Draws with a broken material are dropped, as before
+                skipDraws = c.material && !setupMaterial(variant, c.material);
+                if(skipDraws) {
+                    m_logManager->logErr("Failed to setup material");
+                }
+                break;
+            case CMD_SET_MATRIX:
+                if(c.arg0 == UNIFORM_MVP_MAT) {
+                    variant->setMVP(cb.getMatrix(c.arg1));
+                } else if(c.arg0 == UNIFORM_VP_MAT) {
+                    variant->setVP(cb.getMatrix(c.arg1));
+                }
+                break;
+            case CMD_SET_DEPTH_WRITE:
+                state.setDepthMask(c.arg0!=0);
+                break;
+            case CMD_DRAW:
+                if(!skipDraws) {
+                    drawCall(c.arg0);
+                }
+                break;
+            case CMD_DRAW_INSTANCED:
+                if(!skipDraws) {
+                    drawCallInstanced(c.arg0, c.arg1);
+                }
+                break;
+        }
+    }
+}
+
+void RenderTechnique::drawRenderQueueQueried(Shader *shader) {
+    m_occlusionQueries->beginFrame();
+
+    Shader *curShader = shader;
+    const Material *curMaterial = nullptr;
+    const Mesh *curMesh = nullptr;
+    const auto &items = m_packet->queue.getItems();
+
+    // Opaque objects visible last frame go first and fill the depth buffer,
+    // each draw is queried to find out if it is still visible next frame
+    m_hiddenItems.clear();
+    std::size_t i = 0;
+    for(;i<items.size() && RenderQueue::getPass(items[i].key) == RENDER_PASS_OPAQUE;i++) {
+        const RenderItem &item = items[i];
+        if(m_occlusionQueries->isHidden(item.object)) {
+            m_hiddenItems.push_back(i);
+            continue;
+        }
+        bool queried = m_occlusionQueries->beginQuery(item.object);
+        drawItem(shader, item, curShader, curMaterial, curMesh);
+        if(queried) {
+            m_occlusionQueries->endQuery();
+        }
+    }
+
+    // Objects hidden last frame are tested with their bounds against
+    // that depth, the GPU skips them if the boxes stay hidden
+    if(!m_hiddenItems.empty()) {
+        m_queriedItems.clear();
+        m_occlusionQueries->beginBoundsPass(m_packet->view.viewProj, m_packet->view.position);
+        for(auto idx : m_hiddenItems) {
+            m_queriedItems.push_back(m_occlusionQueries->queryBounds(items[idx].object));
+        }
+        m_occlusionQueries->endBoundsPass();
+
+        m_renderManager->getGLState().useProgram(curShader->getProgramId());
+        curMesh = nullptr;
+        for(std::size_t j = 0;j<m_hiddenItems.size();j++) {
+            const RenderItem &item = items[m_hiddenItems[j]];
+            if(m_queriedItems[j]) {
+                m_occlusionQueries->beginConditionalRender(item.object);
+                drawItem(shader, item, curShader, curMaterial, curMesh);
+                m_occlusionQueries->endConditionalRender();
+            } else {
+                drawItem(shader, item, curShader, curMaterial, curMesh);
+            }
+        }
+    }
+    m_renderManager->addOcclusionQueryStats(m_occlusionQueries->getFrameQueries(),
+                                            m_hiddenItems.size());
+
+    if(i<items.size()) {
+        m_renderManager->getGLState().setDepthMask(false);
+        for(;i<items.size();i++) {
+            drawItem(shader, items[i], curShader, curMaterial, curMesh);
+        }
+        m_renderManager->getGLState().setDepthMask(true);
+    }
+}
+
+void RenderTechnique::drawRenderQueueInstanced(Shader *shader) {
+    shader->setVP(m_packet->view.viewProj);
+
+    Shader *curShader = shader;
+    const Material *curMaterial = nullptr;
+    RenderPass curPass = RENDER_PASS_OPAQUE;
+    const auto &items = m_packet->queue.getItems();
+    std::size_t i = 0;
+
+    while(i<items.size()) {
+        const RenderItem &first = items[i];
+
+        // Sorted keys keep draws sharing material and mesh adjacent
+        std::size_t end = i+1;
+        while(end<items.size() && items[end].material == first.material &&
+              items[end].mesh == first.mesh && items[end].variant == first.variant &&
+              RenderQueue::getPass(items[end].key) == RenderQueue::getPass(first.key)) {
+            end++;
+        }
+
+        RenderPass pass = RenderQueue::getPass(first.key);
+        if(pass!=curPass) {
+            curPass = pass;
+            m_renderManager->getGLState().setDepthMask(pass == RENDER_PASS_OPAQUE);
+        }
+
+        Shader *variant = shader->getVariant(first.variant);
+        if(variant!=curShader) {
+            m_renderManager->getGLState().useProgram(variant->getProgramId());
+            variant->setVP(m_packet->view.viewProj);
+            curShader = variant;
+            curMaterial = nullptr;
+        }
+
+        if(first.material!=curMaterial) {
+            if(first.material && !setupMaterial(variant, first.material)) {
+                m_logManager->logErr("Failed to setup material");
+                i = end;
+                continue;
+            }
+            curMaterial = first.material;
+        }
+
+        if(!first.mesh) {
+            m_logManager->logErr("Failed to setup mesh");
+            i = end;
+            continue;
+        }
+
+        m_instanceData.clear();
+        for(std::size_t j = i;j<end;j++) {
+            m_instanceData.push_back(*items[j].world);
+        }
+
+        GLintptr offset = m_renderManager->pushInstanceData(m_instanceData.data(),
+                                                            m_instanceData.size());
+        m_renderManager->bindInstanceData(first.mesh->getVAO(), offset);
+        drawCallInstanced(first.mesh->getNumVerts(), m_instanceData.size());
+        m_renderManager->unbindInstanceData(first.mesh->getVAO());
+        i = end;
+    }
+
+    if(curPass!=RENDER_PASS_OPAQUE) {
+        m_renderManager->getGLState().setDepthMask(true);
+    }
+}
+
 void RenderTechnique::drawCall(std::size_t numVerts) {
-    glDrawArrays(GL_TRIANGLES, 0, numVerts);
+    m_renderManager->drawArrays(numVerts);
+}
+
+void RenderTechnique::drawCallInstanced(std::size_t numVerts, std::size_t numInstances) {
+    m_renderManager->drawArraysInstanced(numVerts, numInstances);
 }
 
 } //namespace splitspace
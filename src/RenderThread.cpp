@@ -0,0 +1,160 @@
+#include <splitspace/RenderThread.hpp>
+
+namespace splitspace {
+
+RenderThread::RenderThread(const FrameFunc &drawFrame, int maxFrames): m_drawFrame(drawFrame),
+                                                                       m_maxFrames(maxFrames),
+                                                                       m_quit(false),
+                                                                       m_submittedFrames(0),
+                                                                       m_completedFrames(0)
+{
+    if(m_maxFrames<1) {
+        m_maxFrames = 1;
+    }
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+bool RenderThread::start(const Task &onStart, const Task &onStop) {
+    if(isRunning()) {
+        return false;
+    }
+    m_quit = false;
+    m_thread = std::thread(&RenderThread::run, this, onStart, onStop);
+    return true;
+}
+
+void RenderThread::stop() {
+    if(!isRunning()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wakeCond.notify_all();
+    m_thread.join();
+}
+
+void RenderThread::waitForSlot() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_frameDoneCond.wait(lock, [&] {
+        return m_submittedFrames-m_completedFrames<static_cast<std::uint64_t>(m_maxFrames);
+    });
+}
+
+void RenderThread::submitFrame(const FramePacket *packet) {
+    waitForSlot();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.push_back(packet);
+        m_submittedFrames++;
+    }
+    m_wakeCond.notify_all();
+}
+
+std::future<bool> RenderThread::post(const Call &call) {
+    std::packaged_task<bool ()> task(call);
+    std::future<bool> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_calls.push_back(std::move(task));
+    }
+    m_wakeCond.notify_all();
+    return result;
+}
+
+bool RenderThread::call(const Call &call) {
+    if(!isRunning() || isCurrent()) {
+        return call();
+    }
+    return post(call).get();
+}
+
+void RenderThread::defer(const Task &task) {
+    if(!isRunning()) {
+        task();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deferred.push_back(std::make_pair(m_submittedFrames, task));
+}
+
+std::uint64_t RenderThread::getSubmittedFrames() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_submittedFrames;
+}
+
+std::uint64_t RenderThread::getCompletedFrames() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_completedFrames;
+}
+
+void RenderThread::runDeferred(std::unique_lock<std::mutex> &lock, bool all) {
+    std::vector<Task> ready;
+    std::size_t kept = 0;
+    for(auto &d : m_deferred) {
+        if(all || d.first<=m_completedFrames) {
+            ready.push_back(d.second);
+        } else {
+            m_deferred[kept++] = d;
+        }
+    }
+    m_deferred.resize(kept);
+    if(ready.empty()) {
+        return;
+    }
+
+    lock.unlock();
+    for(auto &t : ready) {
+        t();
+    }
+    lock.lock();
+}
+
+void RenderThread::run(Task onStart, Task onStop) {
+    if(onStart) {
+        onStart();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for(;;) {
+        m_wakeCond.wait(lock, [&] {
+            return m_quit || !m_calls.empty() || !m_frames.empty();
+        });
+
+        // Resources a frame uses are created before it is drawn
+        while(!m_calls.empty()) {
+            std::packaged_task<bool ()> task = std::move(m_calls.front());
+            m_calls.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+
+        if(!m_frames.empty()) {
+            const FramePacket *packet = m_frames.front();
+            m_frames.pop_front();
+            lock.unlock();
+            m_drawFrame(*packet);
+            lock.lock();
+            m_completedFrames++;
+            m_frameDoneCond.notify_all();
+        }
+
+        runDeferred(lock, false);
+        if(m_quit && m_calls.empty() && m_frames.empty()) {
+            break;
+        }
+    }
+    runDeferred(lock, true);
+    lock.unlock();
+
+    if(onStop) {
+        onStop();
+    }
+}
+
+} // namespace splitspace
@@ -9,6 +9,7 @@
 #include <splitspace/Light.hpp>
 #include <splitspace/RenderManager.hpp>
 #include <splitspace/Shader.hpp>
+#include <splitspace/RenderGraph.hpp>
 
 #include <algorithm>
 #include <fstream>
@@ -121,8 +122,11 @@ bool ResourceManager::loadMaterialLib(const std::string &name) {
                 m_logMan->logWarn("(ResourceManager) at "+path+" in "+mm->name+": ambient should contain 3 elements");
             }
 
-            if(!readVec(mm->diffuse, (*it)["diffuse"])) {
-                m_logMan->logWarn("(ResourceManager) at "+path+" in "+mm->name+": diffuse should contain 3 elements");
+            glm::vec3 diffuseRGB;
+            if(readVec(diffuseRGB, (*it)["diffuse"])) {
+                mm->diffuse = glm::vec4(diffuseRGB, 1.f);
+            } else if(!readVec(mm->diffuse, (*it)["diffuse"])) {
+                m_logMan->logWarn("(ResourceManager) at "+path+" in "+mm->name+": diffuse should contain 3 or 4 elements");
             }
 
             if(!readVec(mm->specular, (*it)["specular"])) {
@@ -216,6 +220,7 @@ bool ResourceManager::loadShaderLib(const std::string &name) {
     }
 
     json jshaders;
+    json jgraphs;
 
     try {
         jshaders << f;
@@ -224,6 +229,7 @@ bool ResourceManager::loadShaderLib(const std::string &name) {
             return false;
         }
         m_defaultShader = jshaders["_DEFAULT_SHADER_"];
+        jgraphs = jshaders["renderGraphs"];
         jshaders = jshaders["shaders"];
     } catch(std::domain_error e) {
         m_logMan->logErr("ResourceManager) Failed to parse shader library "+path);
@@ -244,11 +250,35 @@ bool ResourceManager::loadShaderLib(const std::string &name) {
             sm->fsVersion = shader["fsVersion"];
             sm->inputFormat = Shader::getInputFormatFromString(shader["inputFormat"]);
             sm->numOutputs = shader["numOutputs"];
+            if(!shader["instanced"].is_null()) {
+                sm->instanced = shader["instanced"];
+            }
             for( auto &uniform : shader["uniforms"]) {
                 for(json::iterator u = uniform.begin();u!=uniform.end();u++) {
                     sm->uniformMapping[u.value()] = Shader::getUniformTypeFromString(u.key());
                 }
             }
+            for(auto &keyword : shader["keywords"]) {
+                std::string k = keyword;
+                sm->keywords.push_back(k);
+            }
+            if(sm->keywords.size()>SHADER_MAX_KEYWORDS) {
+                m_logMan->logWarn("(ResourceManager) "+sm->name+": keywords past "+
+                                  std::to_string(SHADER_MAX_KEYWORDS)+" are ignored");
+            }
+            for(auto &count : shader["lightCounts"]) {
+                sm->lightCounts.push_back(count);
+            }
+            for(auto &variant : shader["variants"]) {
+                std::vector<std::string> names;
+                for(auto &keyword : variant["keywords"]) {
+                    std::string k = keyword;
+                    names.push_back(k);
+                }
+                int lights = variant["lights"].is_null()?0:int(variant["lights"]);
+                sm->precompile.push_back(ShaderVariant::makeKey(
+                        ShaderVariant::getFeatureMask(sm->keywords, names), lights));
+            }
             addManifest(sm);
         } catch(std::domain_error e) {
             m_logMan->logErr("(ResourceManager): "+path+":");
@@ -257,6 +287,52 @@ bool ResourceManager::loadShaderLib(const std::string &name) {
         }
     }
 
+    for(auto &graph : jgraphs) {
+        try {
+            RenderGraphManifest *gm = new RenderGraphManifest;
+            if(!gm) {
+                m_logMan->logErr("(ResourceManager) Out of memory");
+                return false;
+            }
+            gm->name = graph["name"];
+            for(auto &texture : graph["textures"]) {
+                GraphTextureDesc t;
+                t.name = texture["name"];
+                std::string format = texture["format"];
+                const RenderGraphFormat *rf = RenderGraph::findFormat(format);
+                if(!rf) {
+                    m_logMan->logErr("(ResourceManager) "+gm->name+": unknown format "+format);
+                    delete gm;
+                    return false;
+                }
+                t.internalFormat = rf->internalFormat;
+                t.scale = texture["scale"].is_null()?1.f:float(texture["scale"]);
+                gm->textures.push_back(t);
+            }
+            for(auto &pass : graph["passes"]) {
+                GraphPassDesc p;
+                p.name = pass["name"];
+                p.type = RenderGraph::getPassTypeFromName(pass["type"]);
+                p.shader = pass["shader"];
+                for(auto &input : pass["inputs"]) {
+                    std::string in = input;
+                    p.inputs.push_back(in);
+                }
+                for(auto &output : pass["outputs"]) {
+                    std::string out = output;
+                    p.outputs.push_back(out);
+                }
+                p.clear = pass["clear"].is_null()?true:bool(pass["clear"]);
+                gm->passes.push_back(p);
+            }
+            addManifest(gm);
+        } catch(std::domain_error e) {
+            m_logMan->logErr("(ResourceManager): "+path+":");
+            m_logMan->logErr("(ResorceManager): "+std::string(e.what()));
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -334,6 +410,12 @@ bool ResourceManager::createScene(const std::string &name) {
                 objMan->meshManifest->name = jo["mesh"];
                 addManifest(objMan->meshManifest);
             }
+            if(!jo["occluder"].is_null()) {
+                objMan->occluder = jo["occluder"];
+                if(objMan->occluder) {
+                    objMan->meshManifest->keepPositions = true;
+                }
+            }
             if(jo["material"].is_null()) {
                 objMan->materialManifest = nullptr;
                 objMan->meshManifest->loadMaterial = true;
@@ -546,9 +628,26 @@ Material *ResourceManager::loadDefaultMaterial() {
     return static_cast<Material *>(loadResource("__default_material__"));
 }
 
+Mesh *ResourceManager::loadPrimitive(const std::string &name) {
+    if(!getManifest(name)) {
+        MeshManifest *mm = new MeshManifest;
+        if(!mm) {
+            m_logMan->logErr("(ResourceManager) Out of memory");
+            return nullptr;
+        }
+        mm->name = name;
+        mm->loadMaterial = false;
+        addManifest(mm);
+    }
+    return static_cast<Mesh *>(loadResource(name));
+}
+
 void ResourceManager::destroy() {
     for(auto &resource : m_resourceCache) {
         unloadResource(resource.first);
+    }
+    releaseUnloaded(true);
+    for(auto &resource : m_resourceCache) {
         delete resource.second;
     }
 
@@ -586,6 +685,9 @@ std::string ResourceManager::printResources() const {
             case RES_MATERIAL:
                 outStr+="Material";
             break;
+            case RES_RENDER_GRAPH:
+                outStr+="RenderGraph";
+            break;
             case RES_UNKNOWN:
                 outStr+="Unknown";
             break;
@@ -624,6 +726,9 @@ std::string ResourceManager::printManifests() const {
             case RES_MATERIAL:
                 outStr+="Material";
             break;
+            case RES_RENDER_GRAPH:
+                outStr+="RenderGraph";
+            break;
             case RES_UNKNOWN:
                 outStr+="Unknown";
         }
@@ -653,7 +758,7 @@ bool ResourceManager::unloadResource(const std::string &name) {
         }
     }
     
-    it->second->unload();
+    deferUnload(it->second);
     it->second->decRefCount();
     return true;
 }
@@ -663,7 +768,7 @@ int ResourceManager::collectGarbage() {
 
     for( auto res : m_resourceCache ) {
         if(res.second->getRefCount() == 0) {
-            res.second->unload();
+            deferUnload(res.second);
             numGarbageCoollected++;
         }
     }
@@ -671,6 +776,37 @@ int ResourceManager::collectGarbage() {
     return numGarbageCoollected;
 }
 
+void ResourceManager::deferUnload(Resource *res) {
+    for(const auto &p : m_pendingUnloads) {
+        if(p.second == res) {
+            return;
+        }
+    }
+    RenderManager *rm = m_engine->renderManager;
+    m_pendingUnloads.push_back(std::make_pair(rm?rm->getSubmittedFrames():0, res));
+}
+
+void ResourceManager::releaseUnloaded(bool all) {
+    if(m_pendingUnloads.empty()) {
+        return;
+    }
+    RenderManager *rm = m_engine->renderManager;
+    std::uint64_t completed = rm?rm->getCompletedFrames():0;
+    std::vector<Resource *> ready;
+    std::size_t kept = 0;
+    for(auto &p : m_pendingUnloads) {
+        if(all || p.first<=completed) {
+            ready.push_back(p.second);
+        } else {
+            m_pendingUnloads[kept++] = p;
+        }
+    }
+    m_pendingUnloads.resize(kept);
+    for(auto res : ready) {
+        res->unload();
+    }
+}
+
 void ResourceManager::logStats() {
     m_logMan->logInfo("(ResourceManager) STATS:");
     m_logMan->logInfo("\t Total resources created: "+std::to_string(m_totalResLoaded));
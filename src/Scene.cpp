@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <chrono>
 
 namespace splitspace {
 
@@ -15,7 +16,8 @@ Scene::Scene(Engine *e, SceneManifest *manifest):
                         Resource(e, manifest),
                         m_rootNode(nullptr),
                         m_resManager(e->resManager),
-                        m_engine(e)
+                        m_engine(e),
+                        m_bvh(nullptr)
 {}
 
 bool Scene::load() {
@@ -64,37 +66,105 @@ bool Scene::load() {
         m_lightList.push_back(l);
     }
 
-    updateRenderMap();
+    updateRenderList();
+    buildBvh();
 
     m_isLoaded = true;
     return true;
 }
 
-void Scene::updateRenderMap() {
-    std::function<void (RenderMap&, Entity*)> addObjectRecursive = [&](RenderMap &rm, Entity *e) {
+void Scene::updateRenderList() {
+    std::function<void (RenderList&, Entity*)> addObjectRecursive = [&](RenderList &rl, Entity *e) {
         if(!e) {
             return;
         }
         if(e->getType() == RES_OBJECT) {
             Object *o = static_cast<Object *>(e);
-            rm[o->getMaterial()].push_back(o);
+            rl.push_back(o);
         }
 
         for(auto &it : e->getChildren()) {
-            addObjectRecursive(rm, it);
+            addObjectRecursive(rl, it);
         }
     };
 
-    m_renderMap.clear();
-    addObjectRecursive(m_renderMap, m_rootNode);
+    m_renderList.clear();
+    addObjectRecursive(m_renderList, m_rootNode);
+}
+
+void Scene::buildBvh() {
+    std::vector<AABB> bounds;
+    bounds.reserve(m_renderList.size());
+    m_boundsVersions.clear();
+    for(const auto o : m_renderList) {
+        bounds.push_back(o->getWorldAABB());
+        m_boundsVersions.push_back(o->getBoundsVersion());
+    }
+
+    if(!m_bvh) {
+        m_bvh = new Bvh;
+    }
+    m_bvh->build(bounds);
+}
+
+void Scene::updateBvh() {
+    if(!m_bvh) {
+        return;
+    }
+
+    for(std::size_t i = 0;i<m_renderList.size();i++) {
+        const Object *o = m_renderList[i];
+        if(o->getBoundsVersion()!=m_boundsVersions[i]) {
+            m_boundsVersions[i] = o->getBoundsVersion();
+            m_bvh->update(i, o->getWorldAABB());
+        }
+    }
+    m_bvh->refit();
+
+    if(m_bvhRebuild.valid()) {
+        if(m_bvhRebuild.wait_for(std::chrono::seconds(0))!=std::future_status::ready) {
+            return;
+        }
+
+        // Bring the new tree up to date with what moved during the build
+        Bvh *bvh = m_bvhRebuild.get();
+        for(std::size_t i = 0;i<m_renderList.size();i++) {
+            const AABB &bounds = m_renderList[i]->getWorldAABB();
+            if(bounds!=m_rebuildBounds[i]) {
+                bvh->update(i, bounds);
+            }
+        }
+        bvh->refit();
+        delete m_bvh;
+        m_bvh = bvh;
+        m_logMan->logInfo("(Scene) Rebuilt BVH of "+m_manifest->name);
+    } else if(m_bvh->needsRebuild()) {
+        m_rebuildBounds.clear();
+        for(const auto o : m_renderList) {
+            m_rebuildBounds.push_back(o->getWorldAABB());
+        }
+        m_bvhRebuild = std::async(std::launch::async, [](std::vector<AABB> bounds) {
+            Bvh *bvh = new Bvh;
+            bvh->build(bounds);
+            return bvh;
+        }, m_rebuildBounds);
+    }
 }
 
 void Scene::unload() {
+    if(m_bvhRebuild.valid()) {
+        delete m_bvhRebuild.get();
+    }
+    if(m_bvh) {
+        delete m_bvh;
+        m_bvh = nullptr;
+    }
     m_isLoaded = false;
 }
 
 void Scene::update(float dt) {
     m_rootNode->update(dt);
+    updateBvh();
 }
 
 } // namespace splitspace
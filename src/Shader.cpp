@@ -8,13 +8,22 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <fstream>
+#include <algorithm>
+#include <cstdlib>
 
 namespace splitspace {
 
-Shader::Shader(Engine *e, ShaderManifest *manifest):
+Shader::Shader(Engine *e, ShaderManifest *manifest, ShaderVariantKey variant):
                                           Resource(e, manifest),
-                                          m_programId(0)
-{}
+                                          m_engine(e),
+                                          m_programId(0),
+                                          m_uniformBlocks(0),
+                                          m_numLightSlots(0),
+                                          m_hasMaterialStruct(false),
+                                          m_variant(variant)
+{
+    resetUniforms();
+}
 
 bool Shader::load() {
     if(!m_manifest) {
@@ -22,6 +31,36 @@ bool Shader::load() {
         return false;
     }
 
+    if(!readSources()) {
+        return false;
+    }
+
+    // Uniform lookups need the context as well
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
+    m_materialFeatures = ShaderVariant::getMaterialFeatureBits(sm->keywords);
+    m_isLoaded = m_renderMan->callOnGLThread([&]() {
+        if(!beginLoad(m_vsSrc, m_fsSrc)) {
+            return false;
+        }
+
+        // Variants keep compiling after the base program is done,
+        // they are picked up by pollVariants() in later frames
+        for(auto key : sm->precompile) {
+            if(key && !m_variants.count(key)) {
+                beginVariant(key);
+            }
+        }
+
+        if(!finishLoad()) {
+            destroyVariants();
+            return false;
+        }
+        return true;
+    });
+    return m_isLoaded;
+}
+
+bool Shader::readSources() {
     auto loadShader = [this](std::string &src, std::string name) -> bool {
         std::ifstream in(m_resMan->getResPath()+"shaders/"+name);
         if(!in.is_open()) {
@@ -37,28 +76,118 @@ bool Shader::load() {
         return true;
     };
 
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
+    return loadShader(m_vsSrc, sm->vsName) && loadShader(m_fsSrc, sm->fsName);
+}
 
+bool Shader::beginLoad(const std::string &vsSrc, const std::string &fsSrc) {
     ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
-    std::string vsSrc;
-    std::string fsSrc;
-    if(!loadShader(vsSrc, sm->vsName)) {
-        return false;
-    }
-    if(!loadShader(fsSrc, sm->fsName)) {
-        return false;
-    }
+    return m_renderMan->beginShader(vsSrc.c_str(), fsSrc.c_str(), sm->vsVersion,
+                                    sm->fsVersion, sm->numOutputs, m_pending, true,
+                                    ShaderVariant::getDefines(sm->keywords, m_variant));
+}
 
-    if(!m_renderMan->createShader(vsSrc.c_str(), fsSrc.c_str(), sm->vsVersion,
-                                  sm->fsVersion, sm->numOutputs, m_programId)) {
+bool Shader::finishLoad() {
+    if(!m_renderMan->finishShader(m_pending, m_programId)) {
         return false;
     }
 
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
     initUniforms(sm->uniformMapping);
+    initUniformBlocks();
 
+    if(usesClusteredLights()) {
+        m_renderMan->getGLState().useProgram(m_programId);
+        setUniform(m_uniforms[UNIFORM_CLUSTER_LIGHTS], CLUSTER_UNIT_LIGHTS);
+        setUniform(m_uniforms[UNIFORM_CLUSTER_GRID], CLUSTER_UNIT_GRID);
+        setUniform(m_uniforms[UNIFORM_CLUSTER_INDICES], CLUSTER_UNIT_INDICES);
+    }
+    m_renderMan->warmUpProgram(m_programId);
     m_isLoaded = true;
     return true;
 }
 
+ShaderVariantKey Shader::selectVariant(const Material *mat, int numLights) const {
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
+    if(!sm || (sm->keywords.empty() && sm->lightCounts.empty())) {
+        return 0;
+    }
+    // Legacy light uniforms are only set on the base program
+    if(!hasUniformBlock(UBO_LIGHTS) && (m_numLightSlots>0 || hasUniform(UNIFORM_NUM_LIGHTS))) {
+        return 0;
+    }
+    // Clustered and legacy light paths take their counts from uniforms
+    int lights = 0;
+    if(hasUniformBlock(UBO_LIGHTS) && !usesClusteredLights()) {
+        lights = ShaderVariant::pickLightCount(sm->lightCounts, numLights);
+    }
+    return ShaderVariant::makeKey(ShaderVariant::getMaterialFeatures(m_materialFeatures, mat), lights);
+}
+
+Shader *Shader::getVariant(ShaderVariantKey key) {
+    if(key == m_variant || !m_isLoaded) {
+        return this;
+    }
+    auto it = m_variants.find(key);
+    if(it == m_variants.end()) {
+        beginVariant(key);
+        return this;
+    }
+    // Still compiling or broken, this shader is the fallback
+    Shader *variant = it->second;
+    return variant && variant->m_isLoaded?variant:this;
+}
+
+void Shader::beginVariant(ShaderVariantKey key) {
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
+    Shader *variant = new Shader(m_engine, sm, key);
+    if(!variant->beginLoad(m_vsSrc, m_fsSrc)) {
+        m_logMan->logWarn("(Shader) "+sm->name+": variant "+
+                          ShaderVariant::describe(sm->keywords, key)+" failed to compile");
+        delete variant;
+        variant = nullptr;
+    }
+    m_variants[key] = variant;
+}
+
+void Shader::pollVariants() {
+    ShaderManifest *sm = static_cast<ShaderManifest *>(m_manifest);
+    // Without parallel compilation the status query itself blocks
+    const bool oneAtATime = !m_renderMan->hasParallelCompile();
+    for(auto &v : m_variants) {
+        Shader *variant = v.second;
+        if(!variant || variant->m_isLoaded || !m_renderMan->isShaderReady(variant->m_pending)) {
+            continue;
+        }
+        std::string name = ShaderVariant::describe(sm->keywords, v.first);
+        if(variant->finishLoad()) {
+            m_logMan->logInfo("(Shader) "+sm->name+": variant "+name+" ready");
+        } else {
+            m_logMan->logWarn("(Shader) "+sm->name+": variant "+name+" failed to compile");
+            delete variant;
+            v.second = nullptr;
+        }
+        if(oneAtATime) {
+            break;
+        }
+    }
+}
+
+void Shader::destroyVariants() {
+    for(auto &v : m_variants) {
+        if(!v.second) {
+            continue;
+        }
+        if(v.second->m_isLoaded) {
+            v.second->unload();
+        } else {
+            m_renderMan->cancelShader(v.second->m_pending);
+        }
+        delete v.second;
+    }
+    m_variants.clear();
+}
+
 VertexFormat Shader::getInputFormatFromString(const std::string &f) {
     if(f == "VERTEX_3DN") {
         return VERTEX_3DN;
@@ -74,161 +203,294 @@ VertexFormat Shader::getInputFormatFromString(const std::string &f) {
 UniformType Shader::getUniformTypeFromString(const std::string &u) {
     if(u == "_MVP_") {
         return UNIFORM_MVP_MAT;
+    } else if(u == "_VP_") {
+        return UNIFORM_VP_MAT;
     } else if(u == "_TEX_DIFFUSE_") {
         return UNIFORM_TEX_DIFFUSE;
+    } else if(u == "_TEX_NORMAL_") {
+        return UNIFORM_TEX_NORMAL;
     } else if(u == "_LIGHT_STRUCT_") {
         return UNIFORM_LIGHT_STRUCT;
     } else if(u == "_MATERIAL_STRUCT_") {
         return UNIFORM_MATERIAL_STRUCT;
     } else if(u == "_NUM_LIGHTS_") {
         return UNIFORM_NUM_LIGHTS;
+    } else if(u == "_CLUSTER_LIGHTS_") {
+        return UNIFORM_CLUSTER_LIGHTS;
+    } else if(u == "_CLUSTER_GRID_") {
+        return UNIFORM_CLUSTER_GRID;
+    } else if(u == "_CLUSTER_INDICES_") {
+        return UNIFORM_CLUSTER_INDICES;
     } else {
         return UNIFORM_UNKNOWN;
     }
 }
 
+LightProperty Shader::getLightPropertyFromString(const std::string &p) {
+    if(p == "position") {
+        return LIGHT_PROP_POSITION;
+    } else if(p == "rotation") {
+        return LIGHT_PROP_ROTATION;
+    } else if(p == "diffuse") {
+        return LIGHT_PROP_DIFFUSE;
+    } else if(p == "specular") {
+        return LIGHT_PROP_SPECULAR;
+    } else if(p == "spotLightCutoff") {
+        return LIGHT_PROP_SPOT_CUTOFF;
+    } else if(p == "power") {
+        return LIGHT_PROP_POWER;
+    } else if(p == "attenuation") {
+        return LIGHT_PROP_ATTENUATION;
+    } else if(p == "type") {
+        return LIGHT_PROP_TYPE;
+    } else {
+        return LIGHT_PROP_NUM;
+    }
+}
+
+MaterialProperty Shader::getMaterialPropertyFromString(const std::string &p) {
+    if(p == "ambient") {
+        return MAT_PROP_AMBIENT;
+    } else if(p == "diffuse") {
+        return MAT_PROP_DIFFUSE;
+    } else if(p == "specular") {
+        return MAT_PROP_SPECULAR;
+    } else if(p == "isTextured") {
+        return MAT_PROP_IS_TEXTURED;
+    } else if(p == "technique") {
+        return MAT_PROP_TECHNIQUE;
+    } else {
+        return MAT_PROP_NUM;
+    }
+}
+
+void Shader::resetUniforms() {
+    static const UniformInfo none = { -1, GL_NONE };
+    std::fill(m_uniforms, m_uniforms+UNIFORM_NUM_TYPES, none);
+    std::fill(m_materialUniforms, m_materialUniforms+MAT_PROP_NUM, none);
+    for(auto &light : m_lightUniforms) {
+        std::fill(light, light+LIGHT_PROP_NUM, none);
+    }
+    m_numLightSlots = 0;
+    m_hasMaterialStruct = false;
+}
+
 void Shader::initUniforms(const std::map<std::string, UniformType> &mapping) {
-    static const std::string matProps[] = {
-        "ambient",
-        "diffuse",
-        "specular",
-        "isTextured",
-        "technique"
-    };
+    resetUniforms();
 
-    static const std::string lightProps[] = {
-        "position",
-        "rotation",
-        "diffuse",
-        "specular",
-        "spotLightCutoff",
-        "power",
-        "attenuation",
-        "type"
-    };
-    for(const auto &u : mapping) {
-        switch(u.second) {
-            case UNIFORM_MATERIAL_STRUCT: {
-                m_materialUniform.name = u.first;
-                for(const auto &prop : matProps) {
-                    std::string name = u.first+"."+prop;
-                    m_materialUniform.locations[prop] = glGetUniformLocation(m_programId, name.c_str());
+    GLint numUniforms = 0, maxNameLen = 0;
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLen);
+    std::vector<GLchar> nameBuf(maxNameLen+1);
+
+    for(GLint i = 0;i<numUniforms;i++) {
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(m_programId, i, nameBuf.size(), nullptr, &size, &type, nameBuf.data());
+        std::string name(nameBuf.data());
+
+        // uniforms inside blocks have no location
+        GLint location = glGetUniformLocation(m_programId, name.c_str());
+        if(location<0) {
+            continue;
+        }
+
+        // split "base[index].member"
+        std::string base = name, member;
+        std::size_t dot = name.find('.');
+        if(dot!=std::string::npos) {
+            base = name.substr(0, dot);
+            member = name.substr(dot+1);
+        }
+        int index = 0;
+        std::size_t bracket = base.find('[');
+        if(bracket!=std::string::npos) {
+            index = std::atoi(base.c_str()+bracket+1);
+            base = base.substr(0, bracket);
+        }
+
+        auto mapped = mapping.find(base);
+        UniformType ut = mapped!=mapping.end()?mapped->second:getUniformTypeFromString(base);
+        UniformInfo info = { location, type };
+
+        switch(ut) {
+            case UNIFORM_LIGHT_STRUCT: {
+                LightProperty lp = getLightPropertyFromString(member);
+                if(lp == LIGHT_PROP_NUM || index>=SHADER_MAX_LIGHTS) {
+                    break;
                 }
+                m_lightUniforms[index][lp] = info;
+                m_numLightSlots = std::max(m_numLightSlots, index+1);
                 break;
             }
-            case UNIFORM_LIGHT_STRUCT: {
-                m_lightUniform.name = u.first;
-                //TODO Eliminate magic numbers and unify MAX_LIGHTS in GLSL and C++
-                for(int i = 0;i<8;i++) {
-                    std::map<std::string, GLint> mp;
-                    for(const auto &prop : lightProps) {
-                        std::string name = u.first+"["+std::to_string(i)+"]."+prop;
-                        mp[prop] = glGetUniformLocation(m_programId, name.c_str());
-                    }
-                    m_lightUniform.locations.push_back(mp);
+            case UNIFORM_MATERIAL_STRUCT: {
+                MaterialProperty mp = getMaterialPropertyFromString(member);
+                if(mp == MAT_PROP_NUM) {
+                    break;
                 }
+                m_materialUniforms[mp] = info;
+                m_hasMaterialStruct = true;
                 break;
             }
+            case UNIFORM_UNKNOWN:
+                break;
             default:
-                m_genericUniforms[u.second] = GenericUniform{u.first,
-                                              glGetUniformLocation(m_programId, u.first.c_str())};
+                m_uniforms[ut] = info;
                 break;
         }
     }
+
+    const GLenum expected[][2] = {
+        { UNIFORM_MVP_MAT, GL_FLOAT_MAT4 },
+        { UNIFORM_VP_MAT, GL_FLOAT_MAT4 },
+        { UNIFORM_TEX_DIFFUSE, GL_SAMPLER_2D },
+        { UNIFORM_TEX_NORMAL, GL_SAMPLER_2D },
+        { UNIFORM_NUM_LIGHTS, GL_INT },
+        { UNIFORM_CLUSTER_LIGHTS, GL_SAMPLER_BUFFER },
+        { UNIFORM_CLUSTER_GRID, GL_UNSIGNED_INT_SAMPLER_BUFFER },
+        { UNIFORM_CLUSTER_INDICES, GL_UNSIGNED_INT_SAMPLER_BUFFER }
+    };
+    for(const auto &e : expected) {
+        const UniformInfo &u = m_uniforms[e[0]];
+        if(u.location>=0 && u.type!=e[1]) {
+            m_logMan->logWarn("(Shader) "+m_manifest->name+": unexpected GLSL type of uniform "
+                              +std::to_string(e[0]));
+        }
+    }
+}
+
+void Shader::initUniformBlocks() {
+    m_uniformBlocks = 0;
+    for(int i = 0;i<UBO_NUM_BINDINGS;i++) {
+        UniformBlockBinding b = static_cast<UniformBlockBinding>(i);
+        GLuint index = glGetUniformBlockIndex(m_programId, UniformBuffers::getBlockName(b));
+        if(index == GL_INVALID_INDEX) {
+            continue;
+        }
+        glUniformBlockBinding(m_programId, index, b);
+        m_uniformBlocks|=1<<b;
+    }
 }
 
 void Shader::setNumLights(int numLights) {
-    setUniform(m_genericUniforms[UNIFORM_NUM_LIGHTS].location,
-                                                    numLights);
+    setUniform(m_uniforms[UNIFORM_NUM_LIGHTS], numLights);
 }
 
-void Shader::setLight(int lightId, const Light *l) {
-    if(m_lightUniform.name.empty()) {
+void Shader::setLight(int lightId, const LightUniforms &l) {
+    if(lightId<0 || lightId>=m_numLightSlots) {
         return;
     }
-    auto &light = m_lightUniform.locations[lightId];
-    setUniform(light["position"], l->getPos());
-    setUniform(light["rotation"], l->getRot());
-    setUniform(light["diffuse"], l->getDiffuse());
-    setUniform(light["specular"], l->getSpecular());
-    if(l->getType() == LIGHT_SPOT) {
-        setUniform(light["spotLightCutoff"], l->getSpotLightCutoff());
+    const UniformInfo *light = m_lightUniforms[lightId];
+    LightType type = UniformBuffers::getLightType(l);
+    setUniform(light[LIGHT_PROP_POSITION], glm::vec3(l.position));
+    setUniform(light[LIGHT_PROP_ROTATION], glm::vec3(l.rotation));
+    setUniform(light[LIGHT_PROP_DIFFUSE], glm::vec3(l.diffuse));
+    setUniform(light[LIGHT_PROP_SPECULAR], glm::vec3(l.specular));
+    if(type == LIGHT_SPOT) {
+        setUniform(light[LIGHT_PROP_SPOT_CUTOFF], l.rotation.w);
     }
-    setUniform(light["power"], l->getPower());
-    setUniform(light["attenuation"], l->getAttenuation());
-    setUniform(light["type"], (int)l->getType());
+    setUniform(light[LIGHT_PROP_POWER], l.diffuse.w);
+    setUniform(light[LIGHT_PROP_ATTENUATION], glm::vec3(l.attenuation));
+    setUniform(light[LIGHT_PROP_TYPE], (int)type);
 }
 
 void Shader::setMaterial(const Material *mat) {
-    if(m_materialUniform.name.empty()) {
+    bool useBlock = hasUniformBlock(UBO_MATERIAL);
+    if(!m_hasMaterialStruct && !useBlock) {
         return;
     }
     MaterialManifest *mm = static_cast<MaterialManifest *>(mat->getManifest());
     if(!mm) {
         return;
     }
-    setUniform(m_materialUniform.locations["ambient"], mm->ambient);
-    setUniform(m_materialUniform.locations["diffuse"], mm->diffuse);
-    setUniform(m_materialUniform.locations["specular"], mm->specular);
-    setUniform(m_materialUniform.locations["technique"], 1);
+    if(useBlock) {
+        m_renderMan->getUniformBuffers()->bindMaterial(mat);
+    } else {
+        setUniform(m_materialUniforms[MAT_PROP_AMBIENT], mm->ambient);
+        setUniform(m_materialUniforms[MAT_PROP_DIFFUSE], mm->diffuse);
+        setUniform(m_materialUniforms[MAT_PROP_SPECULAR], mm->specular);
+        setUniform(m_materialUniforms[MAT_PROP_TECHNIQUE], 1);
+    }
     Texture *diffuseMap = mat->getDiffuseMap();
     Texture *normalMap = mat->getNormalMap();
-    if(diffuseMap && m_genericUniforms.find(UNIFORM_TEX_DIFFUSE)!=m_genericUniforms.end()) {
-        setUniform(m_materialUniform.locations["isTextured"], true);
-        //TODO:
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap->getGLName());
-        setUniform(m_genericUniforms[UNIFORM_TEX_DIFFUSE].location, 0);
-    } else {
-        setUniform(m_materialUniform.locations["isTextured"], false);
+    if(diffuseMap && hasUniform(UNIFORM_TEX_DIFFUSE)) {
+        if(!useBlock) {
+            setUniform(m_materialUniforms[MAT_PROP_IS_TEXTURED], 1);
+        }
+        GLStateCache &state = m_renderMan->getGLState();
+        state.bindTexture(0, GL_TEXTURE_2D, diffuseMap->getGLName());
+        state.bindSampler(0, mat->getSampler());
+        setUniform(m_uniforms[UNIFORM_TEX_DIFFUSE], 0);
+    } else if(!useBlock) {
+        setUniform(m_materialUniforms[MAT_PROP_IS_TEXTURED], 0);
     }
 
-    if(normalMap && m_genericUniforms.find(UNIFORM_TEX_NORMAL)!=m_genericUniforms.end()) {
-        //TODO:
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap->getGLName());
-        setUniform(m_genericUniforms[UNIFORM_TEX_NORMAL].location, 1);
+    if(normalMap && hasUniform(UNIFORM_TEX_NORMAL)) {
+        GLStateCache &state = m_renderMan->getGLState();
+        state.bindTexture(1, GL_TEXTURE_2D, normalMap->getGLName());
+        state.bindSampler(1, mat->getSampler());
+        setUniform(m_uniforms[UNIFORM_TEX_NORMAL], 1);
     }
 }
 
 void Shader::setMVP(const glm::mat4 &mvp) {
-    setUniform(m_genericUniforms[UNIFORM_MVP_MAT].location, mvp);
+    setUniform(m_uniforms[UNIFORM_MVP_MAT], mvp);
+}
+
+void Shader::setVP(const glm::mat4 &vp) {
+    setUniform(m_uniforms[UNIFORM_VP_MAT], vp);
+}
+
+bool Shader::usesClusteredLights() const {
+    return hasUniformBlock(UBO_CLUSTERS) && hasUniform(UNIFORM_CLUSTER_LIGHTS) &&
+           hasUniform(UNIFORM_CLUSTER_GRID) && hasUniform(UNIFORM_CLUSTER_INDICES);
 }
 
-void Shader::setUniform(GLint id, float val) {
-    if(id>=0) {
-        glUniform1f(id, val);
+bool Shader::isInstanced() const {
+    return m_manifest && static_cast<ShaderManifest *>(m_manifest)->instanced;
+}
+
+void Shader::setUniform(const UniformInfo &u, float val) {
+    if(u.location>=0) {
+        glUniform1f(u.location, val);
     }
 }
 
-void Shader::setUniform(GLint id, int val) {
-    if(id>=0) {
-        glUniform1i(id, val);
+void Shader::setUniform(const UniformInfo &u, int val) {
+    if(u.location>=0) {
+        glUniform1i(u.location, val);
     }
 }
 
-void Shader::setUniform(GLint id, const glm::vec3 &val) {
-    if(id>=0) {
-        glUniform3f(id, val.x, val.y, val.z);
+void Shader::setUniform(const UniformInfo &u, const glm::vec3 &val) {
+    if(u.location>=0) {
+        glUniform3f(u.location, val.x, val.y, val.z);
     }
 }
 
-void Shader::setUniform(GLint id, const glm::vec4 &val) {
-    if(id>=0) {
-        glUniform4f(id, val.x, val.y, val.z, val.w);
+void Shader::setUniform(const UniformInfo &u, const glm::vec4 &val) {
+    if(u.location>=0) {
+        glUniform4f(u.location, val.x, val.y, val.z, val.w);
     }
 }
 
-void Shader::setUniform(GLint id, const glm::mat4 &val) {
-    if(id>=0) {
-        glUniformMatrix4fv(id, 1, GL_FALSE, (const GLfloat*)glm::value_ptr(val));
+void Shader::setUniform(const UniformInfo &u, const glm::mat4 &val) {
+    if(u.location>=0) {
+        glUniformMatrix4fv(u.location, 1, GL_FALSE, (const GLfloat*)glm::value_ptr(val));
     }
 }
 
 
 void Shader::unload() {
-    m_logMan->logInfo("(Shader) Unloading "+m_manifest->name);
+    if(!m_variant) {
+        m_logMan->logInfo("(Shader) Unloading "+m_manifest->name);
+    }
+    destroyVariants();
     m_renderMan->destroyShader(m_programId);
+    m_vsSrc.clear();
+    m_fsSrc.clear();
+    resetUniforms();
+    m_uniformBlocks = 0;
     m_isLoaded = false;
 }
 
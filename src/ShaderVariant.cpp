@@ -0,0 +1,91 @@
+#include <splitspace/ShaderVariant.hpp>
+#include <splitspace/Material.hpp>
+
+namespace splitspace {
+
+ShaderVariantKey ShaderVariant::makeKey(std::uint32_t features, int numLights) {
+    if(numLights<0) {
+        numLights = 0;
+    } else if(numLights>SHADER_VARIANT_MAX_LIGHTS) {
+        numLights = SHADER_VARIANT_MAX_LIGHTS;
+    }
+    return getFeatures(features) | (static_cast<std::uint32_t>(numLights)<<SHADER_VARIANT_LIGHTS_SHIFT);
+}
+
+std::uint32_t ShaderVariant::getFeatureMask(const std::vector<std::string> &keywords,
+                                            const std::vector<std::string> &names) {
+    std::uint32_t mask = 0;
+    for(const auto &name : names) {
+        for(std::size_t i = 0;i<keywords.size() && i<SHADER_MAX_KEYWORDS;i++) {
+            if(keywords[i] == name) {
+                mask|=1u<<i;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+MaterialFeatureBits ShaderVariant::getMaterialFeatureBits(const std::vector<std::string> &keywords) {
+    MaterialFeatureBits bits;
+    bits.textured = getFeatureMask(keywords, { SHADER_KEYWORD_TEXTURED });
+    bits.normalMap = getFeatureMask(keywords, { SHADER_KEYWORD_NORMAL_MAP });
+    return bits;
+}
+
+std::uint32_t ShaderVariant::getMaterialFeatures(const MaterialFeatureBits &bits,
+                                                 const Material *material) {
+    if(!material) {
+        return 0;
+    }
+    std::uint32_t features = 0;
+    if(material->getDiffuseMap()) {
+        features|=bits.textured;
+    }
+    if(material->getNormalMap()) {
+        features|=bits.normalMap;
+    }
+    return features;
+}
+
+int ShaderVariant::pickLightCount(const std::vector<int> &counts, int numLights) {
+    int best = 0;
+    for(auto c : counts) {
+        if(c>=numLights && c<=SHADER_VARIANT_MAX_LIGHTS && (!best || c<best)) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+std::string ShaderVariant::getDefines(const std::vector<std::string> &keywords,
+                                      ShaderVariantKey key) {
+    std::string defines;
+    std::uint32_t features = getFeatures(key);
+    for(std::size_t i = 0;i<keywords.size() && i<SHADER_MAX_KEYWORDS;i++) {
+        if(features&(1u<<i)) {
+            defines+="#define "+keywords[i]+" 1\n";
+        }
+    }
+    if(getNumLights(key)) {
+        defines+="#define NUM_LIGHTS "+std::to_string(getNumLights(key))+"\n";
+    }
+    return defines;
+}
+
+std::string ShaderVariant::describe(const std::vector<std::string> &keywords,
+                                    ShaderVariantKey key) {
+    std::string out;
+    std::uint32_t features = getFeatures(key);
+    for(std::size_t i = 0;i<keywords.size() && i<SHADER_MAX_KEYWORDS;i++) {
+        if(features&(1u<<i)) {
+            out+=(out.empty()?"":"+")+keywords[i];
+        }
+    }
+    if(getNumLights(key)) {
+        out+=(out.empty()?"":"+")+std::to_string(getNumLights(key))+" lights";
+    }
+    return out.empty()?"base":out;
+}
+
+} // namespace splitspace
@@ -0,0 +1,84 @@
+#include <splitspace/Timing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace splitspace {
+
+TimingHistory::TimingHistory(std::size_t capacity): m_capacity(std::max<std::size_t>(capacity, 1)),
+                                                    m_next(0),
+                                                    m_last(0)
+{}
+
+void TimingHistory::add(double ms) {
+    if(m_samples.size()<m_capacity) {
+        m_samples.push_back(ms);
+    } else {
+        m_samples[m_next] = ms;
+    }
+    m_next = (m_next+1)%m_capacity;
+    m_last = ms;
+}
+
+void TimingHistory::clear() {
+    m_samples.clear();
+    m_next = 0;
+    m_last = 0;
+}
+
+double TimingHistory::getAverage() const {
+    if(m_samples.empty()) {
+        return 0;
+    }
+    double sum = 0;
+    for(double s : m_samples) {
+        sum+=s;
+    }
+    return sum/m_samples.size();
+}
+
+double TimingHistory::getPercentile(double p) const {
+    if(m_samples.empty()) {
+        return 0;
+    }
+    std::vector<double> sorted(m_samples);
+    p = std::min(std::max(p, 0.0), 100.0);
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p/100.0*sorted.size()));
+    std::size_t i = rank>0?rank-1:0;
+    std::nth_element(sorted.begin(), sorted.begin()+i, sorted.end());
+    return sorted[i];
+}
+
+double TimingHistory::getMin() const {
+    return m_samples.empty()?0:*std::min_element(m_samples.begin(), m_samples.end());
+}
+
+double TimingHistory::getMax() const {
+    return m_samples.empty()?0:*std::max_element(m_samples.begin(), m_samples.end());
+}
+
+std::string TimingHistory::describe() const {
+    return "min "+std::to_string(getMin())+"ms, avg "+std::to_string(getAverage())
+           +"ms, max "+std::to_string(getMax())+"ms, p50 "+std::to_string(getPercentile(50))
+           +"ms, p95 "+std::to_string(getPercentile(95))+"ms, p99 "
+           +std::to_string(getPercentile(99))+"ms";
+}
+
+FixedTimestep::FixedTimestep(double step, int maxSteps): m_step(step>0?step:1.0/60.0),
+                                                         m_maxSteps(std::max(maxSteps, 1)),
+                                                         m_accumulator(0),
+                                                         m_droppedSteps(0)
+{}
+
+int FixedTimestep::advance(double frameTime) {
+    m_accumulator+=std::max(frameTime, 0.0);
+    int steps = static_cast<int>(m_accumulator/m_step);
+    m_accumulator-=steps*m_step;
+    if(steps>m_maxSteps) {
+        m_droppedSteps+=steps-m_maxSteps;
+        steps = m_maxSteps;
+    }
+    return steps;
+}
+
+} // namespace splitspace
@@ -0,0 +1,220 @@
+#include <splitspace/UniformBuffers.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/LogManager.hpp>
+#include <splitspace/Light.hpp>
+#include <splitspace/Material.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace splitspace {
+
+UniformBuffers::UniformBuffers(RenderManager *rm, LogManager *lm): m_renderManager(rm),
+                                                                   m_logManager(lm),
+                                                                   m_buffers(),
+                                                                   m_lightData(),
+                                                                   m_lightsValid(false),
+                                                                   m_truncatedLights(0),
+                                                                   m_numMaterialSlots(0),
+                                                                   m_materialStride(0),
+                                                                   m_materialCapacity(0)
+{}
+
+UniformBuffers::~UniformBuffers() {
+    destroy();
+}
+
+bool UniformBuffers::init() {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if(alignment<=0) {
+        alignment = 256;
+    }
+    m_materialStride = (sizeof(MaterialUniforms)+alignment-1)/alignment*alignment;
+    m_materialCapacity = 64;
+
+    const std::size_t sizes[UBO_NUM_BINDINGS] = {
+        sizeof(FrameUniforms),
+        sizeof(LightBlockUniforms),
+        m_materialCapacity*m_materialStride,
+        sizeof(ClusterUniforms)
+    };
+
+    for(int i = 0;i<UBO_NUM_BINDINGS;i++) {
+        if(!m_renderManager->createUniformBuffer(sizes[i], m_buffers[i])) {
+            m_logManager->logErr("(UniformBuffers) Failed to create "+
+                    std::string(getBlockName(static_cast<UniformBlockBinding>(i))));
+            return false;
+        }
+    }
+
+    GLStateCache &state = m_renderManager->getGLState();
+    state.bindUniformBuffer(UBO_FRAME, m_buffers[UBO_FRAME]);
+    state.bindUniformBuffer(UBO_LIGHTS, m_buffers[UBO_LIGHTS]);
+    state.bindUniformBuffer(UBO_CLUSTERS, m_buffers[UBO_CLUSTERS]);
+    m_materialData.resize(m_materialCapacity*m_materialStride);
+    return true;
+}
+
+void UniformBuffers::destroy() {
+    for(int i = 0;i<UBO_NUM_BINDINGS;i++) {
+        if(m_buffers[i]) {
+            m_renderManager->destroyUniformBuffer(m_buffers[i]);
+        }
+    }
+    m_materialSlots.clear();
+    m_freeMaterialSlots.clear();
+    m_numMaterialSlots = 0;
+    m_lightsValid = false;
+}
+
+const char *UniformBuffers::getBlockName(UniformBlockBinding b) {
+    switch(b) {
+        case UBO_FRAME:
+            return "FrameBlock";
+        case UBO_LIGHTS:
+            return "LightBlock";
+        case UBO_MATERIAL:
+            return "MaterialBlock";
+        case UBO_CLUSTERS:
+            return "ClusterBlock";
+        default:
+            return "";
+    }
+}
+
+void UniformBuffers::updateFrame(const glm::mat4 &viewProj, const glm::vec3 &cameraPos) {
+    FrameUniforms frame;
+    frame.viewProj = viewProj;
+    frame.cameraPos = glm::vec4(cameraPos, 1.f);
+    m_renderManager->updateUniformBuffer(m_buffers[UBO_FRAME], 0, sizeof(frame), &frame);
+}
+
+void UniformBuffers::packLight(LightUniforms &dst, const Light *l) {
+    dst.position = glm::vec4(l->getPos(), static_cast<float>(l->getType()));
+    dst.rotation = glm::vec4(l->getRot(), l->getSpotLightCutoff());
+    dst.diffuse = glm::vec4(l->getDiffuse(), l->getPower());
+    dst.specular = glm::vec4(l->getSpecular(), 0.f);
+    dst.attenuation = glm::vec4(l->getAttenuation(), 0.f);
+}
+
+float UniformBuffers::getLightRange(const LightUniforms &l) {
+    return Light::getRange(glm::vec3(l.diffuse), l.diffuse.w, glm::vec3(l.attenuation));
+}
+
+void UniformBuffers::updateLights(const std::vector<LightUniforms> &lights) {
+    if(lights.size()>std::size_t(UBO_MAX_LIGHTS)) {
+        // Logged when the count changes, not every frame
+        if(lights.size()!=m_truncatedLights) {
+            m_logManager->logWarn("(UniformBuffers) "+std::to_string(lights.size())+" lights, only "
+                                  +std::to_string(UBO_MAX_LIGHTS)+" are drawn");
+        }
+        m_truncatedLights = lights.size();
+    } else {
+        m_truncatedLights = 0;
+    }
+    updateLightBatch(lights, 0);
+}
+
+void UniformBuffers::updateLightBatch(const std::vector<LightUniforms> &lights, std::size_t first) {
+    GLint numLights = first<lights.size()?std::min<std::size_t>(lights.size()-first, UBO_MAX_LIGHTS):0;
+
+    GLuint buffer = m_buffers[UBO_LIGHTS];
+    if(!m_lightsValid || m_lightData.numLights!=numLights) {
+        m_lightData.numLights = numLights;
+        m_renderManager->updateUniformBuffer(buffer, 0, sizeof(GLint), &m_lightData.numLights);
+    }
+
+    for(GLint i = 0;i<numLights;i++) {
+        const LightUniforms &packed = lights[first+i];
+        if(m_lightsValid && !std::memcmp(&packed, &m_lightData.lights[i], sizeof(packed))) {
+            continue;
+        }
+        m_lightData.lights[i] = packed;
+        m_renderManager->updateUniformBuffer(buffer, offsetof(LightBlockUniforms, lights)
+                                             +i*sizeof(LightUniforms),
+                                             sizeof(LightUniforms), &packed);
+    }
+    m_lightsValid = true;
+}
+
+void UniformBuffers::updateClusters(const ClusterUniforms &clusters) {
+    m_renderManager->updateUniformBuffer(m_buffers[UBO_CLUSTERS], 0, sizeof(clusters), &clusters);
+}
+
+void UniformBuffers::packMaterial(MaterialUniforms &dst, const Material *mat) {
+    dst = MaterialUniforms();
+    MaterialManifest *mm = static_cast<MaterialManifest *>(mat->getManifest());
+    if(mm) {
+        dst.ambient = glm::vec4(mm->ambient, 1.f);
+        dst.diffuse = mm->diffuse;
+        dst.specular = glm::vec4(mm->specular, 1.f);
+    }
+    dst.isTextured = mat->getDiffuseMap()?1:0;
+    dst.technique = 1;
+}
+
+std::size_t UniformBuffers::addMaterial(const Material *mat) {
+    std::size_t slot = 0;
+    if(!m_freeMaterialSlots.empty()) {
+        slot = m_freeMaterialSlots.back();
+        m_freeMaterialSlots.pop_back();
+    } else {
+        slot = m_numMaterialSlots++;
+    }
+    if(slot>=m_materialCapacity) {
+        m_materialCapacity*=2;
+        m_materialData.resize(m_materialCapacity*m_materialStride);
+        m_renderManager->destroyUniformBuffer(m_buffers[UBO_MATERIAL]);
+        if(!m_renderManager->createUniformBuffer(m_materialData.size(), m_buffers[UBO_MATERIAL])) {
+            m_logManager->logErr("(UniformBuffers) Failed to grow material table");
+        }
+        m_renderManager->updateUniformBuffer(m_buffers[UBO_MATERIAL], 0,
+                                             slot*m_materialStride, m_materialData.data());
+    }
+
+    MaterialUniforms packed;
+    packMaterial(packed, mat);
+    std::memcpy(&m_materialData[slot*m_materialStride], &packed, sizeof(packed));
+    m_renderManager->updateUniformBuffer(m_buffers[UBO_MATERIAL], slot*m_materialStride,
+                                         sizeof(packed), &packed);
+    m_materialSlots[mat] = slot;
+    return slot;
+}
+
+void UniformBuffers::bindMaterial(const Material *mat) {
+    if(!mat) {
+        return;
+    }
+
+    std::size_t slot = 0;
+    auto it = m_materialSlots.find(mat);
+    if(it == m_materialSlots.end()) {
+        slot = addMaterial(mat);
+    } else {
+        // Repacking is cheaper than tracking every parameter change
+        slot = it->second;
+        MaterialUniforms packed;
+        packMaterial(packed, mat);
+        unsigned char *cached = &m_materialData[slot*m_materialStride];
+        if(std::memcmp(cached, &packed, sizeof(packed))) {
+            std::memcpy(cached, &packed, sizeof(packed));
+            m_renderManager->updateUniformBuffer(m_buffers[UBO_MATERIAL], slot*m_materialStride,
+                                                 sizeof(packed), &packed);
+        }
+    }
+    m_renderManager->getGLState().bindUniformBufferRange(UBO_MATERIAL, m_buffers[UBO_MATERIAL],
+                                                         slot*m_materialStride,
+                                                         sizeof(MaterialUniforms));
+}
+
+void UniformBuffers::releaseMaterial(const Material *mat) {
+    auto it = m_materialSlots.find(mat);
+    if(it == m_materialSlots.end()) {
+        return;
+    }
+    m_freeMaterialSlots.push_back(it->second);
+    m_materialSlots.erase(it);
+}
+
+} // namespace splitspace
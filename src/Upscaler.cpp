@@ -0,0 +1,136 @@
+#include <splitspace/Upscaler.hpp>
+#include <splitspace/RenderManager.hpp>
+#include <splitspace/LogManager.hpp>
+
+namespace splitspace {
+
+// Screen triangle texcoords span [0; 2], uvScale maps them to the rendered area
+static const char *UPSCALE_VS =
+    "layout(location = 0) in vec3 inPos;\n"
+    "layout(location = 1) in vec2 inTexcoord;\n"
+    "uniform vec2 uvScale;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    uv = inTexcoord*uvScale;\n"
+    "    gl_Position = vec4(inPos, 1.0);\n"
+    "}\n";
+
+static const std::string UPSCALE_COMMON =
+    "uniform sampler2D source;\n"
+    "uniform vec2 uvMax;\n"
+    "uniform vec2 texelSize;\n"
+    "in vec2 uv;\n"
+    "layout(location = 0) out vec4 color;\n"
+    "vec3 fetch(vec2 p) {\n"
+    "    return texture(source, clamp(p, 0.5*texelSize, uvMax)).rgb;\n"
+    "}\n";
+
+static const std::string BILINEAR_FS = UPSCALE_COMMON+
+    "void main() {\n"
+    "    color = vec4(fetch(uv), 1.0);\n"
+    "}\n";
+
+// Clamping to the cross of source texels keeps edges from ringing
+static const std::string SHARPEN_FS = UPSCALE_COMMON+
+    "const float sharpness = 0.5;\n"
+    "void main() {\n"
+    "    vec3 c = fetch(uv);\n"
+    "    vec3 n = fetch(uv+vec2(0.0, texelSize.y));\n"
+    "    vec3 s = fetch(uv-vec2(0.0, texelSize.y));\n"
+    "    vec3 e = fetch(uv+vec2(texelSize.x, 0.0));\n"
+    "    vec3 w = fetch(uv-vec2(texelSize.x, 0.0));\n"
+    "    vec3 lo = min(c, min(min(n, s), min(e, w)));\n"
+    "    vec3 hi = max(c, max(max(n, s), max(e, w)));\n"
+    "    vec3 sharp = c+sharpness*(c-0.25*(n+s+e+w));\n"
+    "    color = vec4(clamp(sharp, lo, hi), 1.0);\n"
+    "}\n";
+
+Upscaler::Upscaler(RenderManager *rm, LogManager *lm): m_renderManager(rm),
+                                                       m_logManager(lm),
+                                                       m_filter(UPSCALE_UNKNOWN),
+                                                       m_program(0),
+                                                       m_uvScale(-1),
+                                                       m_uvMax(-1),
+                                                       m_texelSize(-1),
+                                                       m_sampler(0),
+                                                       m_screenVao(0),
+                                                       m_screenVbo(0)
+{}
+
+Upscaler::~Upscaler() {
+    destroy();
+}
+
+bool Upscaler::init(UpscaleFilter filter) {
+    m_filter = filter==UPSCALE_SHARPEN?UPSCALE_SHARPEN:UPSCALE_BILINEAR;
+    const std::string &fs = m_filter==UPSCALE_SHARPEN?SHARPEN_FS:BILINEAR_FS;
+    if(!m_renderManager->createShader(UPSCALE_VS, fs.c_str(), 330, 330, 1, m_program, false)) {
+        m_logManager->logErr("(Upscaler) Failed to create upscale shader");
+        return false;
+    }
+    m_renderManager->getGLState().useProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "source"), 0);
+    m_uvScale = glGetUniformLocation(m_program, "uvScale");
+    m_uvMax = glGetUniformLocation(m_program, "uvMax");
+    m_texelSize = glGetUniformLocation(m_program, "texelSize");
+
+    // Targets are created with nearest filtering, the sampler overrides it
+    if(!m_renderManager->createSampler(false, TEX_FILTER_LINEAR, m_sampler)) {
+        m_logManager->logErr("(Upscaler) Failed to create sampler");
+        return false;
+    }
+
+    static const Vertex3DT screenTriangle[] = {
+        { glm::vec3(-1,-1,0), glm::vec2(0,0) },
+        { glm::vec3(3,-1,0), glm::vec2(2,0) },
+        { glm::vec3(-1,3,0), glm::vec2(0,2) }
+    };
+    if(!m_renderManager->createMesh(screenTriangle, VERTEX_3DT, 3, m_screenVbo, m_screenVao)) {
+        m_logManager->logErr("(Upscaler) Failed to create screen triangle");
+        return false;
+    }
+    return true;
+}
+
+void Upscaler::destroy() {
+    m_renderManager->destroyShader(m_program);
+    if(m_sampler) {
+        m_renderManager->destroySampler(m_sampler);
+    }
+    if(m_screenVao) {
+        m_renderManager->destroyMesh(m_screenVao, m_screenVbo);
+    }
+}
+
+void Upscaler::draw(GLuint texture, int w, int h, int texW, int texH, int dstW, int dstH) {
+    GLStateCache &state = m_renderManager->getGLState();
+    glViewport(0, 0, dstW, dstH);
+    state.setDepthTest(false);
+    state.setBlend(false);
+    state.setCullFace(false);
+
+    state.useProgram(m_program);
+    glUniform2f(m_uvScale, float(w)/texW, float(h)/texH);
+    glUniform2f(m_uvMax, (w-0.5f)/texW, (h-0.5f)/texH);
+    glUniform2f(m_texelSize, 1.f/texW, 1.f/texH);
+    state.bindTexture(0, GL_TEXTURE_2D, texture);
+    state.bindSampler(0, m_sampler);
+    state.bindVertexArray(m_screenVao);
+    m_renderManager->drawArrays(3);
+
+    state.setCullFace(true);
+    state.setBlend(true);
+    state.setDepthTest(true);
+}
+
+UpscaleFilter Upscaler::getFilterFromName(const std::string &name) {
+    if(name == "bilinear") {
+        return UPSCALE_BILINEAR;
+    } else if(name == "sharpen") {
+        return UPSCALE_SHARPEN;
+    } else {
+        return UPSCALE_UNKNOWN;
+    }
+}
+
+} // namespace splitspace
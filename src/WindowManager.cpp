@@ -9,6 +9,9 @@ namespace splitspace {
 WindowManager::WindowManager(Engine *e): m_evtMan(e->eventManager),
                                          m_logMan(e->logManager),
                                          m_window(nullptr),
+                                         m_headless(false),
+                                         m_width(0),
+                                         m_height(0),
                                          m_leftButtonDown(false),
                                          m_rightButtonDown(false),
                                          m_middleButtonDown(false)
@@ -18,11 +21,25 @@ WindowManager::~WindowManager() {
     destroy();
 }
 
-bool WindowManager::init(const char *caption, int w, int h, bool fs) {
+bool WindowManager::init(const char *caption, int w, int h, bool fs, bool headless) {
     if(w<=0 || h<=0) {
         m_logMan->logErr("(WindowManager) Invalid window size given");
         return false;
     }
+    m_width = w;
+    m_height = h;
+
+    if(headless) {
+        if(SDL_Init(SDL_INIT_EVENTS)) {
+            m_logMan->logErr("(WindowManager) Couldn't initialise SDL events: "
+                             +std::string(SDL_GetError()));
+            return false;
+        }
+        m_headless = true;
+        m_logMan->logInfo("(WindowManager) Headless mode, rendering "
+                          +std::to_string(w)+"x"+std::to_string(h)+" offscreen");
+        return true;
+    }
 
     Uint32 flags = SDL_WINDOW_OPENGL | (fs & SDL_WINDOW_FULLSCREEN);
     m_window = SDL_CreateWindow(caption, SDL_WINDOWPOS_CENTERED,
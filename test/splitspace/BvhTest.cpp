@@ -0,0 +1,119 @@
+#include <catch/catch.hpp>
+#include <splitspace/Bvh.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+using namespace splitspace;
+
+static std::vector<AABB> makeGrid(int n) {
+    std::vector<AABB> boxes;
+    for(int x = 0;x<n;x++) {
+        for(int z = 0;z<n;z++) {
+            glm::vec3 c(x*4.f-n*2.f, 0, z*4.f-n*2.f);
+            boxes.push_back(AABB(c-glm::vec3(1), c+glm::vec3(1)));
+        }
+    }
+    return boxes;
+}
+
+TEST_CASE( "Bvh test", "[Bvh]") {
+    std::vector<AABB> boxes = makeGrid(20);
+    Bvh bvh;
+    bvh.build(boxes);
+
+    SECTION( "Build" ) {
+        REQUIRE( bvh.getNumItems() == boxes.size() );
+        REQUIRE( bvh.getNumNodes()<2*boxes.size() );
+        REQUIRE( bvh.getCost() == Approx(bvh.getBuildCost()) );
+        REQUIRE( !bvh.needsRebuild() );
+
+        const auto &nodes = bvh.getNodes();
+        std::size_t items = 0;
+        for(const auto &n : nodes) {
+            if(n.isLeaf()) {
+                items+=n.count;
+            } else {
+                AABB children = nodes[n.first].bounds;
+                children.merge(nodes[n.first+1].bounds);
+                REQUIRE( children == n.bounds );
+            }
+        }
+        REQUIRE( items == boxes.size() );
+    }
+
+    SECTION( "Box query matches brute force" ) {
+        AABB box(glm::vec3(-10, -1, -5), glm::vec3(3, 1, 7));
+        std::vector<std::uint32_t> found;
+        bvh.query(box, found);
+        std::sort(found.begin(), found.end());
+
+        std::vector<std::uint32_t> expected;
+        for(std::uint32_t i = 0;i<boxes.size();i++) {
+            if(boxes[i].intersects(box)) {
+                expected.push_back(i);
+            }
+        }
+        REQUIRE( !expected.empty() );
+        REQUIRE( found == expected );
+    }
+
+    SECTION( "Frustum culling" ) {
+        Frustum f;
+        f.extract(glm::perspective(glm::radians(60.f), 1.f, 1.f, 30.f));
+
+        std::vector<std::uint32_t> inside, partial;
+        bvh.cullFrustum(f, inside, partial);
+        REQUIRE( !inside.empty() );
+        REQUIRE( inside.size()+partial.size()<boxes.size() );
+
+        for(auto i : inside) {
+            REQUIRE( f.intersects(boxes[i]) );
+        }
+        std::vector<std::uint32_t> all(inside);
+        all.insert(all.end(), partial.begin(), partial.end());
+        for(std::uint32_t i = 0;i<boxes.size();i++) {
+            if(f.intersects(boxes[i])) {
+                REQUIRE( std::find(all.begin(), all.end(), i)!=all.end() );
+            }
+        }
+    }
+
+    SECTION( "Refit" ) {
+        AABB moved(glm::vec3(100, 0, 100), glm::vec3(102, 2, 102));
+        bvh.update(7, moved);
+        REQUIRE( bvh.refit()>0 );
+        REQUIRE( bvh.refit() == 0 );
+        REQUIRE( bvh.getItemBounds(7) == moved );
+        REQUIRE( bvh.getNodes()[0].bounds.max == glm::vec3(102, 2, 102) );
+
+        std::vector<std::uint32_t> found;
+        bvh.query(moved, found);
+        REQUIRE( found.size() == 1 );
+        REQUIRE( found[0] == 7 );
+    }
+
+    SECTION( "Quality degrades when objects scatter" ) {
+        for(std::uint32_t i = 0;i<boxes.size();i+=2) {
+            glm::vec3 c(float(i%13)*30.f, float(i%7)*30.f, float(i%11)*-30.f);
+            bvh.update(i, AABB(c-glm::vec3(1), c+glm::vec3(1)));
+        }
+        bvh.refit();
+        REQUIRE( bvh.needsRebuild() );
+    }
+
+    SECTION( "Degenerate input" ) {
+        Bvh same;
+        same.build(std::vector<AABB>(50, AABB(glm::vec3(0), glm::vec3(1))));
+        std::vector<std::uint32_t> found;
+        same.query(AABB(glm::vec3(0), glm::vec3(1)), found);
+        REQUIRE( found.size() == 50 );
+
+        Bvh none;
+        none.build(std::vector<AABB>());
+        REQUIRE( none.empty() );
+        none.query(AABB(glm::vec3(0), glm::vec3(1)), found);
+        REQUIRE( found.size() == 50 );
+    }
+}
@@ -0,0 +1,77 @@
+#include <catch/catch.hpp>
+#include <splitspace/CommandBuffer.hpp>
+#include <splitspace/JobManager.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "CommandBuffer test", "[CommandBuffer]") {
+
+    SECTION( "Recording" ) {
+        CommandBuffer cb;
+        const Material *material = reinterpret_cast<const Material *>(0x10);
+        glm::mat4 m(2.f);
+
+        cb.bindProgram(3);
+        cb.setMaterial(material);
+        cb.bindVertexArray(7);
+        cb.setMatrix(1, m);
+        cb.setDepthWrite(false);
+        cb.draw(36);
+        cb.drawInstanced(6, 10);
+
+        const auto &cmds = cb.getCommands();
+        REQUIRE( cb.size() == 7 );
+        REQUIRE( cmds[0].type == CMD_BIND_PROGRAM );
+        REQUIRE( cmds[0].arg0 == 3 );
+        REQUIRE( cmds[1].type == CMD_SET_MATERIAL );
+        REQUIRE( cmds[1].material == material );
+        REQUIRE( cmds[2].type == CMD_BIND_VERTEX_ARRAY );
+        REQUIRE( cmds[2].arg0 == 7 );
+        REQUIRE( cmds[3].type == CMD_SET_MATRIX );
+        REQUIRE( cmds[3].arg0 == 1 );
+        REQUIRE( cb.getMatrix(cmds[3].arg1) == m );
+        REQUIRE( cmds[4].type == CMD_SET_DEPTH_WRITE );
+        REQUIRE( cmds[4].arg0 == 0 );
+        REQUIRE( cmds[5].type == CMD_DRAW );
+        REQUIRE( cmds[5].arg0 == 36 );
+        REQUIRE( cmds[6].type == CMD_DRAW_INSTANCED );
+        REQUIRE( cmds[6].arg0 == 6 );
+        REQUIRE( cmds[6].arg1 == 10 );
+
+        cb.clear();
+        REQUIRE( cb.empty() == true );
+    }
+
+    SECTION( "Parallel recording keeps slice order" ) {
+        JobManager jobs(nullptr);
+        REQUIRE( jobs.init(3) == true );
+
+        const std::size_t numSlices = 16;
+        const std::uint32_t perSlice = 100;
+        std::vector<CommandBuffer> buffers(numSlices);
+        jobs.parallelFor(numSlices, 1, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t s = begin;s<end;s++) {
+                for(std::uint32_t i = 0;i<perSlice;i++) {
+                    std::uint32_t id = s*perSlice+i;
+                    buffers[s].setMatrix(0, glm::mat4(float(id)));
+                    buffers[s].draw(id);
+                }
+            }
+        });
+
+        std::uint32_t expected = 0;
+        bool ordered = true;
+        for(const auto &cb : buffers) {
+            for(const auto &c : cb.getCommands()) {
+                if(c.type == CMD_SET_MATRIX) {
+                    ordered = ordered && cb.getMatrix(c.arg1) == glm::mat4(float(expected));
+                } else {
+                    ordered = ordered && c.arg0 == expected++;
+                }
+            }
+        }
+        REQUIRE( ordered == true );
+        REQUIRE( expected == numSlices*perSlice );
+        jobs.destroy();
+    }
+}
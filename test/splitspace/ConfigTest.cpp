@@ -12,12 +12,34 @@ TEST_CASE( "Configuration test", "[Config]") {
         REQUIRE( config.window.height == 480 );
         REQUIRE( config.window.fullscreen == false );
         REQUIRE( config.window.caption.empty() == true );
+        REQUIRE( config.window.headless == false );
 
         REQUIRE( config.log.logFile.empty() == true );
         REQUIRE( config.log.level == splitspace::LOG_WARN );
 
+        REQUIRE( config.render.occlusionQueries == false );
+        REQUIRE( config.render.gpuCulling == true );
+        REQUIRE( config.render.clusteredLights == true );
+        REQUIRE( config.render.renderThread == false );
+        REQUIRE( config.render.programCache == "cache/programs" );
+        REQUIRE( config.render.dynamicResolution == false );
+        REQUIRE( config.render.minResolutionScale == Approx(0.5f) );
+        REQUIRE( config.render.maxResolutionScale == Approx(1.f) );
+        REQUIRE( config.render.targetFrameTime == Approx(16.f) );
+        REQUIRE( config.render.upscaleFilter == "bilinear" );
+
+        REQUIRE( config.loop.timestep == Approx(1.f/60.f) );
+        REQUIRE( config.loop.maxSteps == 5 );
+        REQUIRE( config.loop.pipelined == false );
+
         REQUIRE( config.scenes.empty() == true );
         REQUIRE( config.matLibs.empty() == true );
         
     }
+
+    SECTION( "Non-positive timestep" ) {
+        splitspace::Config config;
+
+        REQUIRE( config.parse("test_data/zero_timestep.json") == false );
+    }
 }
@@ -0,0 +1,78 @@
+#include <catch/catch.hpp>
+#include <splitspace/Culling.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "Bounds test", "[Culling]") {
+
+    SECTION( "AABB and sphere of points" ) {
+        const glm::vec3 points[] = {
+            glm::vec3(-1, 0, 0), glm::vec3(1, 2, 0), glm::vec3(0, 1, 3)
+        };
+        AABB box = computeAABB(points, 3, sizeof(glm::vec3));
+        REQUIRE( box.min == glm::vec3(-1, 0, 0) );
+        REQUIRE( box.max == glm::vec3(1, 2, 3) );
+
+        BoundingSphere s = computeBoundingSphere(points, 3, sizeof(glm::vec3));
+        REQUIRE( s.center == glm::vec3(0, 1, 1.5f) );
+        REQUIRE( s.radius == Approx(std::sqrt(1.f+1.f+2.25f)) );
+    }
+
+    SECTION( "Transformed bounds" ) {
+        glm::mat4 world = glm::translate(glm::mat4(1), glm::vec3(10, 0, 0));
+        world = glm::scale(world, glm::vec3(2));
+
+        AABB box = AABB(glm::vec3(-1), glm::vec3(1)).transform(world);
+        REQUIRE( box.min == glm::vec3(8, -2, -2) );
+        REQUIRE( box.max == glm::vec3(12, 2, 2) );
+
+        BoundingSphere s = BoundingSphere(glm::vec3(0), 1).transform(world);
+        REQUIRE( s.center == glm::vec3(10, 0, 0) );
+        REQUIRE( s.radius == Approx(2) );
+    }
+}
+
+TEST_CASE( "Frustum culling test", "[Culling]") {
+    // Camera at origin looking down -z
+    Frustum f;
+    f.extract(glm::perspective(glm::radians(90.f), 1.f, 1.f, 100.f));
+
+    SECTION( "Frustum planes" ) {
+        REQUIRE( f.intersects(BoundingSphere(glm::vec3(0, 0, -10), 1)) );
+        REQUIRE( !f.intersects(BoundingSphere(glm::vec3(0, 0, 10), 1)) );
+        REQUIRE( !f.intersects(BoundingSphere(glm::vec3(0, 0, -200), 1)) );
+        REQUIRE( f.intersects(BoundingSphere(glm::vec3(0, 0, -101), 2)) );
+        REQUIRE( !f.intersects(BoundingSphere(glm::vec3(-30, 0, -10), 1)) );
+        REQUIRE( f.intersects(AABB(glm::vec3(-30, -1, -11), glm::vec3(-9, 1, -9))) );
+        REQUIRE( !f.intersects(AABB(glm::vec3(-30, -1, -11), glm::vec3(-12, 1, -9))) );
+    }
+
+    SECTION( "Batched kernel matches scalar test" ) {
+        FrustumCuller culler;
+        std::vector<BoundingSphere> spheres;
+        // Enough spheres for full batches and a tail
+        for(int i = 0;i<37;i++) {
+            float x = (i%7-3)*10.f;
+            float z = -(i%5)*30.f+20.f;
+            spheres.push_back(BoundingSphere(glm::vec3(x, 0, z), 1.f+i%3));
+            REQUIRE( culler.add(spheres.back()) == std::size_t(i) );
+        }
+
+        std::size_t expected = 0;
+        for(const auto &s : spheres) {
+            expected+=f.intersects(s);
+        }
+        REQUIRE( culler.cull(f) == expected );
+        REQUIRE( expected>0 );
+        REQUIRE( expected<spheres.size() );
+        for(std::size_t i = 0;i<spheres.size();i++) {
+            REQUIRE( culler.isVisible(i) == f.intersects(spheres[i]) );
+        }
+
+        culler.clear();
+        REQUIRE( culler.size() == 0 );
+        REQUIRE( culler.cull(f) == 0 );
+    }
+}
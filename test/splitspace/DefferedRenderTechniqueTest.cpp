@@ -0,0 +1,35 @@
+#include <catch/catch.hpp>
+#include <splitspace/DefferedRenderTechnique.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "DefferedRenderTechnique test", "[DefferedRenderTechnique]") {
+    const glm::mat4 viewProj = glm::perspective(glm::radians(60.f), 4.f/3.f, 1.f, 100.f)*
+                               glm::lookAt(glm::vec3(0, 2, 10), glm::vec3(0), glm::vec3(0, 1, 0));
+    const glm::mat4 invViewProj = glm::inverse(viewProj);
+    const glm::vec3 world(3, 1, -2);
+
+    // Where the geometry pass wrote the point at a render scale of 0.5
+    const glm::vec2 gbufferSize(800, 600);
+    const glm::vec2 viewportSize = gbufferSize*0.5f;
+    glm::vec4 clip = viewProj*glm::vec4(world, 1);
+    glm::vec3 ndc = glm::vec3(clip)/clip.w;
+    glm::vec2 fragCoord = (glm::vec2(ndc)*0.5f+0.5f)*viewportSize;
+    float depth = ndc.z*0.5f+0.5f;
+
+    SECTION( "Positions follow the viewport at a lower scale" ) {
+        glm::vec3 p = DefferedRenderTechnique::reconstructPosition(invViewProj, fragCoord,
+                                                                    depth, viewportSize);
+        REQUIRE( p.x == Approx(world.x).epsilon(0.001) );
+        REQUIRE( p.y == Approx(world.y).epsilon(0.001) );
+        REQUIRE( p.z == Approx(world.z).epsilon(0.001) );
+    }
+
+    SECTION( "G-buffer coordinates do not give positions" ) {
+        glm::vec3 p = DefferedRenderTechnique::reconstructPosition(invViewProj, fragCoord,
+                                                                    depth, gbufferSize);
+        REQUIRE( glm::length(p-world)>0.5f );
+    }
+}
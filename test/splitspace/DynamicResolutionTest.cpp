@@ -0,0 +1,73 @@
+#include <catch/catch.hpp>
+#include <splitspace/DynamicResolution.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "DynamicResolution test", "[DynamicResolution]") {
+    DynamicResolution res(0.5f, 1.f, 16.f, 2);
+
+    SECTION( "Sizes" ) {
+        int w = 0, h = 0;
+        REQUIRE( res.getScale() == Approx(1.f) );
+        res.getSize(1280, 720, w, h);
+        REQUIRE( w == 1280 );
+        REQUIRE( h == 720 );
+
+        DynamicResolution super(0.5f, 2.f, 16.f);
+        super.getMaxSize(640, 480, w, h);
+        REQUIRE( w == 1280 );
+        REQUIRE( h == 960 );
+
+        // Bounds are kept sane
+        DynamicResolution bad(0.f, 0.f, 16.f);
+        REQUIRE( bad.getMinScale() == Approx(RESOLUTION_SCALE_STEP) );
+        REQUIRE( bad.getMaxScale() == Approx(RESOLUTION_SCALE_STEP) );
+        bad.getSize(10, 10, w, h);
+        REQUIRE( w == 1 );
+        REQUIRE( h == 1 );
+    }
+
+    SECTION( "Spikes lower the scale at once" ) {
+        // Pixels to cut: 16*0.9/32 of them, rounded down to a step
+        res.addFrameTime(32);
+        REQUIRE( res.getScale() == Approx(0.65f) );
+        REQUIRE( res.getNumChanges() == 1 );
+
+        // Frames drawn before the change are still in flight
+        res.addFrameTime(100);
+        res.addFrameTime(100);
+        REQUIRE( res.getScale() == Approx(0.65f) );
+
+        res.addFrameTime(100);
+        REQUIRE( res.getScale() == Approx(0.5f) );
+        res.addFrameTime(16);
+        res.addFrameTime(16);
+        res.addFrameTime(1000);
+        REQUIRE( res.getScale() == Approx(0.5f) );
+    }
+
+    SECTION( "Scale goes up one step at a time" ) {
+        res.addFrameTime(1000);
+        REQUIRE( res.getScale() == Approx(0.5f) );
+        res.addFrameTime(5);
+        res.addFrameTime(5);
+
+        res.addFrameTime(5);
+        REQUIRE( res.getScale() == Approx(0.55f) );
+        for(int i = 0;i<100;i++) {
+            res.addFrameTime(5);
+        }
+        REQUIRE( res.getScale() == Approx(1.f) );
+    }
+
+    SECTION( "Scale holds near the target" ) {
+        res.addFrameTime(20);
+        float scale = res.getScale();
+        REQUIRE( scale < 1.f );
+        for(int i = 0;i<100;i++) {
+            // The next step would go past the headroom
+            res.addFrameTime(13.5);
+        }
+        REQUIRE( res.getScale() == Approx(scale) );
+    }
+}
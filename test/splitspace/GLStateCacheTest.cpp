@@ -0,0 +1,72 @@
+#include <catch/catch.hpp>
+#include <splitspace/GLStateCache.hpp>
+
+using namespace splitspace;
+
+// Only GL 1.1 state is set here, libGL turns those calls
+// into no-ops while no context is current
+TEST_CASE( "GLStateCache test", "[GLStateCache]") {
+    GLStateCache state;
+
+    SECTION( "Redundant calls are skipped" ) {
+        state.setDepthTest(true);
+        state.setDepthTest(true);
+        state.setDepthFunc(GL_LESS);
+        state.setDepthFunc(GL_LESS);
+        state.setDepthFunc(GL_LEQUAL);
+        REQUIRE( state.getFrameIssued() == 3 );
+        REQUIRE( state.getFrameSkipped() == 2 );
+
+        // Both factors make up the state
+        state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.setBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        state.setBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        REQUIRE( state.getFrameIssued() == 5 );
+        REQUIRE( state.getFrameSkipped() == 3 );
+
+        // Caps are cached apart
+        state.setCullFace(true);
+        state.setBlend(true);
+        state.setStencilTest(false);
+        state.setDepthMask(false);
+        state.setColorMask(true);
+        REQUIRE( state.getFrameIssued() == 10 );
+        state.setDepthTest(false);
+        state.setDepthTest(true);
+        REQUIRE( state.getFrameIssued() == 12 );
+        REQUIRE( state.getFrameSkipped() == 3 );
+    }
+
+    SECTION( "Frame counters" ) {
+        state.setCullFaceMode(GL_BACK);
+        state.setCullFaceMode(GL_BACK);
+        state.beginFrame();
+        REQUIRE( state.getFrameIssued() == 0 );
+        REQUIRE( state.getFrameSkipped() == 0 );
+        REQUIRE( state.getTotalIssued() == 1 );
+        REQUIRE( state.getTotalSkipped() == 1 );
+
+        state.setCullFaceMode(GL_BACK);
+        REQUIRE( state.getFrameSkipped() == 1 );
+        REQUIRE( state.getTotalSkipped() == 2 );
+    }
+
+    SECTION( "Invalidation" ) {
+        state.setDepthMask(true);
+        state.setBlendFunc(GL_ONE, GL_ZERO);
+        state.beginFrame();
+
+        // State changed behind the cache's back is sent again
+        state.invalidate();
+        state.setDepthMask(true);
+        state.setBlendFunc(GL_ONE, GL_ZERO);
+        REQUIRE( state.getFrameIssued() == 2 );
+        REQUIRE( state.getFrameSkipped() == 0 );
+
+        // Deleting names only forgets bindings of those names
+        state.onDeleteTexture(1);
+        state.onDeleteProgram(1);
+        state.setDepthMask(true);
+        REQUIRE( state.getFrameSkipped() == 1 );
+    }
+}
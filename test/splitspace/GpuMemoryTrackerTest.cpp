@@ -0,0 +1,48 @@
+#include <catch/catch.hpp>
+#include <splitspace/GpuMemoryTracker.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "GpuMemoryTracker test", "[GpuMemoryTracker]") {
+
+    SECTION( "Texture sizes" ) {
+        REQUIRE( GpuMemoryTracker::getMipLevels(1, 1) == 1 );
+        REQUIRE( GpuMemoryTracker::getMipLevels(256, 64) == 9 );
+        REQUIRE( GpuMemoryTracker::getTextureSize(GL_RGBA8, 4, 4) == 64 );
+        REQUIRE( GpuMemoryTracker::getTextureSize(GL_RGBA8, 4, 4, 3) == 64+16+4 );
+        REQUIRE( GpuMemoryTracker::getTextureSize(GL_R8, 4, 2, 3) == 8+2+1 );
+        REQUIRE( GpuMemoryTracker::getTextureSize(GL_RGBA8, 0, 4) == 0 );
+    }
+
+    SECTION( "Allocate and release" ) {
+        GpuMemoryTracker tracker;
+
+        tracker.allocate(GPU_MEM_TEXTURE, 1, 100);
+        tracker.allocate(GPU_MEM_TEXTURE, 2, 50);
+        tracker.allocate(GPU_MEM_VERTEX_BUFFER, 1, 10);
+
+        REQUIRE( tracker.getUsed(GPU_MEM_TEXTURE) == 150 );
+        REQUIRE( tracker.getUsed(GPU_MEM_VERTEX_BUFFER) == 10 );
+        REQUIRE( tracker.getTotalUsed() == 160 );
+        REQUIRE( tracker.getResourceSize(GPU_MEM_TEXTURE, 2) == 50 );
+        REQUIRE( tracker.getResourceCount(GPU_MEM_TEXTURE) == 2 );
+
+        tracker.allocate(GPU_MEM_TEXTURE, 1, 20);
+        REQUIRE( tracker.getUsed(GPU_MEM_TEXTURE) == 70 );
+
+        tracker.release(GPU_MEM_TEXTURE, 1);
+        tracker.release(GPU_MEM_TEXTURE, 1);
+        REQUIRE( tracker.getUsed(GPU_MEM_TEXTURE) == 50 );
+        REQUIRE( tracker.getTotalUsed() == 60 );
+        REQUIRE( tracker.getPeakUsed() == 160 );
+    }
+
+    SECTION( "Large allocations do not overflow" ) {
+        GpuMemoryTracker tracker;
+        std::uint64_t big = std::uint64_t(3)<<30;
+
+        tracker.allocate(GPU_MEM_RENDERTARGET, 1, big);
+        tracker.allocate(GPU_MEM_RENDERTARGET, 2, big);
+        REQUIRE( tracker.getTotalUsed() == 2*big );
+    }
+}
@@ -0,0 +1,63 @@
+#include <catch/catch.hpp>
+#include <splitspace/JobManager.hpp>
+
+#include <atomic>
+#include <vector>
+
+using namespace splitspace;
+
+TEST_CASE( "JobManager test", "[JobManager]") {
+    JobManager jobs(nullptr);
+    REQUIRE( jobs.init(3) );
+    REQUIRE( jobs.getNumThreads() == 4 );
+
+    SECTION( "Every item is visited once" ) {
+        std::vector<int> visits(1000, 0);
+        for(int run = 0;run<50;run++) {
+            jobs.parallelFor(visits.size(), 7, [&](std::size_t begin, std::size_t end) {
+                for(std::size_t i = begin;i<end;i++) {
+                    visits[i]++;
+                }
+            });
+        }
+        for(auto v : visits) {
+            REQUIRE( v == 50 );
+        }
+    }
+
+    SECTION( "Nested loops run inline" ) {
+        std::atomic<int> sum(0);
+        jobs.parallelFor(8, 1, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin;i<end;i++) {
+                jobs.parallelFor(10, 2, [&](std::size_t b, std::size_t e) {
+                    sum+=e-b;
+                });
+            }
+        });
+        REQUIRE( sum == 80 );
+    }
+
+    SECTION( "Async task runs next to the caller" ) {
+        std::atomic<int> sum(0);
+        for(int run = 0;run<20;run++) {
+            jobs.runAsync([&]() {
+                jobs.parallelFor(10, 2, [&](std::size_t b, std::size_t e) {
+                    sum+=e-b;
+                });
+            });
+            jobs.parallelFor(10, 1, [&](std::size_t b, std::size_t e) {
+                sum+=e-b;
+            });
+            jobs.waitAsync();
+        }
+        REQUIRE( sum == 400 );
+    }
+
+    SECTION( "Empty range" ) {
+        bool called = false;
+        jobs.parallelFor(0, 1, [&](std::size_t, std::size_t) { called = true; });
+        REQUIRE( !called );
+    }
+
+    jobs.destroy();
+}
@@ -0,0 +1,95 @@
+#include <catch/catch.hpp>
+#include <splitspace/LightClusters.hpp>
+#include <splitspace/JobManager.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+using namespace splitspace;
+
+static bool hasLight(const LightClusterer &c, int cluster, std::uint32_t light) {
+    const auto &indices = c.getIndices();
+    auto begin = indices.begin()+c.getOffset(cluster);
+    auto end = begin+c.getCount(cluster);
+    return std::find(begin, end, light)!=end;
+}
+
+TEST_CASE( "LightClusterer test", "[LightClusterer]") {
+    glm::mat4 proj = glm::perspective(glm::radians(60.f), 16.f/9.f, 1.f, 100.f);
+
+    LightClusterer clusters;
+    clusters.setProjection(proj, 1.f, 100.f);
+    REQUIRE( clusters.getNumClusters() == CLUSTER_DIM_X*CLUSTER_DIM_Y*CLUSTER_DIM_Z );
+
+    SECTION( "Cluster lookup" ) {
+        REQUIRE( clusters.getClusterIndex(glm::vec3(0, 0, 1)) == -1 );
+        REQUIRE( clusters.getClusterIndex(glm::vec3(0, 0, -200)) == -1 );
+        REQUIRE( clusters.getClusterIndex(glm::vec3(1000, 0, -10)) == -1 );
+
+        int near = clusters.getClusterIndex(glm::vec3(0, 0, -1.01f));
+        int far = clusters.getClusterIndex(glm::vec3(0, 0, -99.f));
+        REQUIRE( near/(CLUSTER_DIM_X*CLUSTER_DIM_Y) == 0 );
+        REQUIRE( far/(CLUSTER_DIM_X*CLUSTER_DIM_Y) == CLUSTER_DIM_Z-1 );
+
+        glm::vec3 p(2, -1, -20);
+        const AABB &b = clusters.getClusterBounds(clusters.getClusterIndex(p));
+        REQUIRE( p.x>=b.min.x );
+        REQUIRE( p.x<=b.max.x );
+        REQUIRE( p.y>=b.min.y );
+        REQUIRE( p.y<=b.max.y );
+        REQUIRE( p.z>=b.min.z );
+        REQUIRE( p.z<=b.max.z );
+    }
+
+    SECTION( "Point lights" ) {
+        std::uint32_t a = clusters.addPointLight(glm::vec3(0, 0, -10), 1.f);
+        std::uint32_t b = clusters.addPointLight(glm::vec3(5, 2, -50), 3.f);
+        clusters.bin(nullptr);
+
+        int atA = clusters.getClusterIndex(glm::vec3(0, 0, -10));
+        int atB = clusters.getClusterIndex(glm::vec3(5, 2, -50));
+        REQUIRE( hasLight(clusters, atA, a) );
+        REQUIRE( !hasLight(clusters, atA, b) );
+        REQUIRE( hasLight(clusters, atB, b) );
+        REQUIRE( !hasLight(clusters, atB, a) );
+        REQUIRE( clusters.getCount(clusters.getClusterIndex(glm::vec3(0, 0, -90))) == 0 );
+    }
+
+    SECTION( "Spot lights" ) {
+        std::uint32_t s = clusters.addSpotLight(glm::vec3(0, 0, -20), 15.f,
+                                                glm::vec3(0, 0, -1), 0.95f);
+        clusters.bin(nullptr);
+
+        REQUIRE( hasLight(clusters, clusters.getClusterIndex(glm::vec3(0, 0, -30)), s) );
+        // Inside the range, but behind the cone
+        REQUIRE( !hasLight(clusters, clusters.getClusterIndex(glm::vec3(0, 0, -10)), s) );
+    }
+
+    SECTION( "Parallel binning matches serial" ) {
+        for(int i = 0;i<500;i++) {
+            glm::vec3 p((i%20)-10.f, (i%7)-3.f, -2.f-(i%97));
+            clusters.addPointLight(p, 0.5f+(i%5));
+        }
+        clusters.bin(nullptr);
+        std::vector<std::uint32_t> grid = clusters.getGrid();
+        std::vector<std::uint32_t> indices = clusters.getIndices();
+        REQUIRE( indices.empty() == false );
+
+        JobManager jobs(nullptr);
+        REQUIRE( jobs.init(3) == true );
+        clusters.bin(&jobs);
+        REQUIRE( clusters.getGrid() == grid );
+        REQUIRE( clusters.getIndices() == indices );
+        jobs.destroy();
+
+        clusters.setMaxIndices(100);
+        clusters.bin(nullptr);
+        REQUIRE( clusters.getIndices().size() == 100 );
+        bool inRange = true;
+        for(int c = 0;c<clusters.getNumClusters();c++) {
+            inRange = inRange && clusters.getOffset(c)+clusters.getCount(c)<=100;
+        }
+        REQUIRE( inRange == true );
+    }
+}
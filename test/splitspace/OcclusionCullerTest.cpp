@@ -0,0 +1,84 @@
+#include <catch/catch.hpp>
+#include <splitspace/OcclusionCuller.hpp>
+#include <splitspace/JobManager.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace splitspace;
+
+// Two triangles of a 10x10 wall facing +z
+static const glm::vec3 wall[] = {
+    glm::vec3(-5, -5, 0), glm::vec3(5, -5, 0), glm::vec3(5, 5, 0),
+    glm::vec3(-5, -5, 0), glm::vec3(5, 5, 0), glm::vec3(-5, 5, 0)
+};
+
+static AABB box(const glm::vec3 &c, float r) {
+    return AABB(c-glm::vec3(r), c+glm::vec3(r));
+}
+
+TEST_CASE( "OcclusionCuller test", "[OcclusionCuller]") {
+    // Camera at origin looking down -z, wall 10 units away
+    glm::mat4 vp = glm::perspective(glm::radians(60.f), 2.f, 1.f, 100.f);
+    glm::mat4 world = glm::translate(glm::mat4(1), glm::vec3(0, 0, -10));
+
+    OcclusionCuller culler(100, 50);
+    REQUIRE( culler.getWidth() == 128 );
+    REQUIRE( culler.getHeight() == 64 );
+
+    SECTION( "Empty buffer occludes nothing" ) {
+        culler.beginFrame(vp);
+        culler.rasterize(nullptr);
+        REQUIRE( culler.isVisible(box(glm::vec3(0, 0, -50), 1)) );
+    }
+
+    SECTION( "Objects behind the wall are occluded" ) {
+        culler.beginFrame(vp);
+        culler.addOccluder(wall, 6, sizeof(glm::vec3), world);
+        REQUIRE( culler.getNumTriangles() == 2 );
+        culler.rasterize(nullptr);
+
+        REQUIRE( culler.getDepth(64, 32)<1.f );
+        REQUIRE( culler.getDepth(0, 0) == 1.f );
+
+        REQUIRE( !culler.isVisible(box(glm::vec3(0, 0, -20), 1)) );
+        REQUIRE( !culler.isVisible(box(glm::vec3(1, -1, -50), 3)) );
+        REQUIRE( culler.isVisible(box(glm::vec3(0, 0, -5), 1)) );
+        REQUIRE( culler.isVisible(box(glm::vec3(12, 0, -20), 1)) );
+        // Straddling the wall
+        REQUIRE( culler.isVisible(box(glm::vec3(0, 0, -10), 1)) );
+        // Crossing the near plane
+        REQUIRE( culler.isVisible(box(glm::vec3(0, 0, 0), 2)) );
+    }
+
+    SECTION( "Back faces occlude" ) {
+        // Mirroring reverses the winding
+        glm::mat4 flipped = glm::scale(world, glm::vec3(-1, 1, 1));
+        culler.beginFrame(vp);
+        culler.addOccluder(wall, 6, sizeof(glm::vec3), flipped);
+        culler.rasterize(nullptr);
+        REQUIRE( !culler.isVisible(box(glm::vec3(0, 0, -20), 1)) );
+    }
+
+    SECTION( "Threaded rasterization matches serial" ) {
+        OcclusionCuller serial(100, 50);
+        serial.beginFrame(vp);
+        culler.beginFrame(vp);
+        for(int i = 0;i<20;i++) {
+            glm::mat4 w = glm::translate(glm::mat4(1), glm::vec3(i%5*6.f-12.f, i/5*4.f-6.f, -15.f-i));
+            serial.addOccluder(wall, 6, sizeof(glm::vec3), w);
+            culler.addOccluder(wall, 6, sizeof(glm::vec3), w);
+        }
+        serial.rasterize(nullptr);
+
+        JobManager jobs(nullptr);
+        jobs.init(3);
+        culler.rasterize(&jobs);
+        jobs.destroy();
+
+        for(int y = 0;y<culler.getHeight();y++) {
+            for(int x = 0;x<culler.getWidth();x++) {
+                REQUIRE( culler.getDepth(x, y) == serial.getDepth(x, y) );
+            }
+        }
+    }
+}
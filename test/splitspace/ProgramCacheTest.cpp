@@ -0,0 +1,65 @@
+#include <catch/catch.hpp>
+#include <splitspace/ProgramCache.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <cstdio>
+
+using namespace splitspace;
+
+TEST_CASE( "ProgramCache test", "[ProgramCache]") {
+    ProgramCache cache(nullptr, "test_program_cache/entries");
+
+    SECTION( "Keys" ) {
+        REQUIRE( ProgramCache::hash("") == PROGRAM_HASH_SEED );
+        REQUIRE( ProgramCache::hash("a") != ProgramCache::hash("b") );
+
+        std::uint64_t key = cache.makeKey({ "330", "void main() {}", "1" });
+        REQUIRE( key == cache.makeKey({ "330", "void main() {}", "1" }) );
+        REQUIRE( key != cache.makeKey({ "330", "void main() {}", "2" }) );
+        REQUIRE( cache.makeKey({ "ab", "c" }) != cache.makeKey({ "a", "bc" }) );
+    }
+
+    SECTION( "Entries" ) {
+        REQUIRE( ProgramCache::makeDirs("test_program_cache/entries/") == true );
+
+        std::vector<char> binary = { 1, 2, 3, 4, 5 };
+        std::uint64_t key = cache.makeKey({ "entry" });
+        std::string path = cache.getEntryPath(key);
+        REQUIRE( ProgramCache::writeEntry(path, key, 0x1234, binary) == true );
+
+        GLenum format = 0;
+        std::vector<char> read;
+        REQUIRE( ProgramCache::readEntry(path, key, format, read) == true );
+        REQUIRE( format == 0x1234 );
+        REQUIRE( read == binary );
+
+        // Entry written for another key is not picked up
+        REQUIRE( ProgramCache::readEntry(path, key+1, format, read) == false );
+
+        // Sizes past the end of the file are rejected before allocating
+        {
+            std::ifstream in(path, std::ios::binary);
+            std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size()-2);
+        }
+        read.clear();
+        REQUIRE( ProgramCache::readEntry(path, key, format, read) == false );
+        REQUIRE( read.empty() );
+
+        // Truncated entries are rejected
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write("SSPB", 4);
+        }
+        REQUIRE( ProgramCache::readEntry(path, key, format, read) == false );
+        REQUIRE( ProgramCache::readEntry(path+".missing", key, format, read) == false );
+
+        std::remove(path.c_str());
+        std::remove("test_program_cache/entries");
+        std::remove("test_program_cache");
+    }
+}
@@ -0,0 +1,160 @@
+#include <catch/catch.hpp>
+#include <splitspace/RenderGraph.hpp>
+#include <splitspace/LogManager.hpp>
+
+using namespace splitspace;
+
+static void addTexture(RenderGraphManifest &m, const std::string &name,
+                       const std::string &format, float scale = 1.f) {
+    GraphTextureDesc t;
+    t.name = name;
+    t.internalFormat = RenderGraph::findFormat(format)->internalFormat;
+    t.scale = scale;
+    m.textures.push_back(t);
+}
+
+static void addPass(RenderGraphManifest &m, const std::string &name,
+                    const std::vector<std::string> &inputs,
+                    const std::vector<std::string> &outputs, bool clear = true) {
+    GraphPassDesc p;
+    p.name = name;
+    p.type = inputs.empty()?GRAPH_PASS_SCENE:GRAPH_PASS_FULLSCREEN;
+    p.shader = name;
+    p.inputs = inputs;
+    p.outputs = outputs;
+    p.clear = clear;
+    m.passes.push_back(p);
+}
+
+TEST_CASE( "RenderGraph test", "[RenderGraph]") {
+    LogManager *lm = new LogManager();
+    RenderGraph graph(lm);
+    RenderGraphManifest m;
+    m.name = "test";
+
+    SECTION( "Formats" ) {
+        REQUIRE( RenderGraph::findFormat("rgba16f")->internalFormat == GL_RGBA16F );
+        REQUIRE( RenderGraph::findFormat("nope") == nullptr );
+        REQUIRE( RenderGraph::isDepthFormat(GL_DEPTH24_STENCIL8) );
+        REQUIRE( !RenderGraph::isDepthFormat(GL_RGBA8) );
+        REQUIRE( RenderGraph::getPassTypeFromName("scene") == GRAPH_PASS_SCENE );
+        REQUIRE( RenderGraph::getPassTypeFromName("fullscreen") == GRAPH_PASS_FULLSCREEN );
+        REQUIRE( RenderGraph::getPassTypeFromName("x") == GRAPH_PASS_UNKNOWN );
+    }
+
+    SECTION( "Culling" ) {
+        addTexture(m, "color", "rgba8");
+        addTexture(m, "depth", "depth24stencil8");
+        addTexture(m, "debug", "rgba8");
+        addPass(m, "scene", {}, {"color", "depth"});
+        addPass(m, "debug", {"depth"}, {"debug"});
+        addPass(m, "present", {"color"}, {RENDER_GRAPH_BACKBUFFER});
+
+        REQUIRE( graph.compile(&m) );
+        REQUIRE( graph.getNumCulled() == 1 );
+        const auto &passes = graph.getPasses();
+        REQUIRE( passes.size() == 2 );
+        REQUIRE( passes[0].desc == 0 );
+        REQUIRE( passes[0].colorOutputs.size() == 1 );
+        REQUIRE( passes[0].depthOutput == graph.getTarget("depth") );
+        REQUIRE( passes[1].desc == 2 );
+        REQUIRE( passes[1].toBackbuffer );
+        REQUIRE( passes[1].inputs[0] == graph.getTarget("color") );
+        REQUIRE( graph.getTarget("debug") == -1 );
+        REQUIRE( graph.getNumScenePasses() == 1 );
+    }
+
+    SECTION( "Kept contents keep their writers" ) {
+        addTexture(m, "color", "rgba8");
+        addPass(m, "scene", {}, {"color"});
+        addPass(m, "overlay", {}, {"color"}, false);
+        addPass(m, "present", {"color"}, {RENDER_GRAPH_BACKBUFFER});
+        REQUIRE( graph.compile(&m) );
+        REQUIRE( graph.getNumCulled() == 0 );
+        REQUIRE( graph.getNumScenePasses() == 2 );
+
+        m.passes[1].clear = true;
+        REQUIRE( graph.compile(&m) );
+        REQUIRE( graph.getNumCulled() == 1 );
+        REQUIRE( graph.getPasses()[0].desc == 1 );
+        REQUIRE( graph.getNumScenePasses() == 1 );
+    }
+
+    SECTION( "Aliasing" ) {
+        addTexture(m, "a", "rgba16f");
+        addTexture(m, "b", "rgba16f");
+        addTexture(m, "c", "rgba16f");
+        addTexture(m, "half", "rgba16f", 0.5f);
+        addPass(m, "scene", {}, {"a"});
+        addPass(m, "blur", {"a"}, {"b"});
+        addPass(m, "down", {"b"}, {"half"});
+        addPass(m, "tonemap", {"half"}, {"c"});
+        addPass(m, "present", {"c"}, {RENDER_GRAPH_BACKBUFFER});
+
+        REQUIRE( graph.compile(&m) );
+        // a dies when b is written, c is written after b dies
+        REQUIRE( graph.getTarget("a") != graph.getTarget("b") );
+        REQUIRE( graph.getTarget("c") == graph.getTarget("a") );
+        // Different scale never aliases
+        REQUIRE( graph.getTarget("half") != graph.getTarget("a") );
+        REQUIRE( graph.getTarget("half") != graph.getTarget("b") );
+        REQUIRE( graph.getTargets().size() == 3 );
+    }
+
+    SECTION( "Overlapping lifetimes" ) {
+        addTexture(m, "a", "rgba8");
+        addTexture(m, "b", "rgba8");
+        addTexture(m, "c", "rgba8");
+        addPass(m, "first", {}, {"a"});
+        addPass(m, "second", {}, {"b"});
+        addPass(m, "combine", {"a", "b"}, {"c"});
+        addPass(m, "present", {"c"}, {RENDER_GRAPH_BACKBUFFER});
+
+        REQUIRE( graph.compile(&m) );
+        REQUIRE( graph.getTarget("a") != graph.getTarget("b") );
+        REQUIRE( graph.getTarget("c") != graph.getTarget("a") );
+        REQUIRE( graph.getTarget("c") != graph.getTarget("b") );
+        REQUIRE( graph.getTargets().size() == 3 );
+    }
+
+    SECTION( "Errors" ) {
+        addTexture(m, "color", "rgba8");
+        addTexture(m, "depth", "depth24stencil8");
+        addTexture(m, "depth2", "depth32f");
+
+        SECTION( "Read before write" ) {
+            addPass(m, "present", {"color"}, {RENDER_GRAPH_BACKBUFFER});
+            addPass(m, "scene", {}, {"color"});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Unknown texture" ) {
+            addPass(m, "scene", {}, {"nope"});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Nothing on screen" ) {
+            addPass(m, "scene", {}, {"color"});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Read and write" ) {
+            addPass(m, "scene", {}, {"color"});
+            addPass(m, "feedback", {"color"}, {"color"});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Two depth outputs" ) {
+            addPass(m, "scene", {}, {"depth", "depth2"});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Backbuffer with other outputs" ) {
+            addPass(m, "scene", {}, {"color", RENDER_GRAPH_BACKBUFFER});
+            REQUIRE( !graph.compile(&m) );
+        }
+        SECTION( "Reserved name" ) {
+            addTexture(m, RENDER_GRAPH_BACKBUFFER, "rgba8");
+            addPass(m, "scene", {}, {RENDER_GRAPH_BACKBUFFER});
+            REQUIRE( !graph.compile(&m) );
+        }
+        REQUIRE( graph.getPasses().empty() );
+    }
+
+    delete lm;
+}
@@ -0,0 +1,73 @@
+#include <catch/catch.hpp>
+#include <splitspace/RenderQueue.hpp>
+#include <splitspace/Object.hpp>
+#include <splitspace/Engine.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "RenderQueue test", "[RenderQueue]") {
+
+    SECTION( "Key ordering" ) {
+        std::uint64_t near = RenderQueue::makeKey(RENDER_PASS_OPAQUE, 1, 1, 1, 0.1f);
+        std::uint64_t far = RenderQueue::makeKey(RENDER_PASS_OPAQUE, 1, 1, 1, 0.9f);
+        std::uint64_t otherProgram = RenderQueue::makeKey(RENDER_PASS_OPAQUE, 2, 0, 0, 0.f);
+        std::uint64_t transpNear = RenderQueue::makeKey(RENDER_PASS_TRANSPARENT, 0, 0, 0, 0.1f);
+        std::uint64_t transpFar = RenderQueue::makeKey(RENDER_PASS_TRANSPARENT, 0, 0, 0, 0.9f);
+
+        REQUIRE( near < far );
+        REQUIRE( far < otherProgram );
+        REQUIRE( otherProgram < transpFar );
+        REQUIRE( transpFar < transpNear );
+
+        REQUIRE( RenderQueue::getPass(far) == RENDER_PASS_OPAQUE );
+        REQUIRE( RenderQueue::getPass(transpNear) == RENDER_PASS_TRANSPARENT );
+    }
+
+    SECTION( "Sorting" ) {
+        Engine *engine = new Engine();
+        ObjectManifest *manifest = new ObjectManifest();
+        Object *objects[4];
+        for(int i = 0;i<4;i++) {
+            objects[i] = new Object(engine, manifest);
+        }
+
+        RenderQueue queue;
+        queue.push(RENDER_PASS_TRANSPARENT, 0, objects[0], 0.2f);
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[1], 0.7f);
+        queue.push(RENDER_PASS_TRANSPARENT, 0, objects[2], 0.8f);
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[3], 0.1f);
+        queue.sort();
+
+        const auto &items = queue.getItems();
+        REQUIRE( items.size() == 4 );
+        REQUIRE( items[0].object == objects[3] );
+        REQUIRE( items[1].object == objects[1] );
+        REQUIRE( items[2].object == objects[2] );
+        REQUIRE( items[3].object == objects[0] );
+
+        REQUIRE( items[0].world == &objects[3]->getWorldMat() );
+
+        queue.clear();
+        REQUIRE( queue.empty() == true );
+
+        // Snapshot transforms stay with the item
+        glm::mat4 snapshot(2.f);
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[0], 0.5f, &snapshot);
+        REQUIRE( queue.getItems()[0].world == &snapshot );
+
+        // Variants of one program are kept in separate groups
+        queue.clear();
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[0], 0.1f, nullptr, 0);
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[1], 0.2f, nullptr, 1);
+        queue.push(RENDER_PASS_OPAQUE, 0, objects[2], 0.3f, nullptr, 0);
+        queue.sort();
+        REQUIRE( queue.getItems()[0].variant == 0 );
+        REQUIRE( queue.getItems()[1].variant == 0 );
+        REQUIRE( queue.getItems()[2].variant == 1 );
+
+        // Ids restart every frame, a new program gets the first id again
+        queue.clear();
+        queue.push(RENDER_PASS_OPAQUE, 7, objects[0], 0.f);
+        REQUIRE( queue.getItems()[0].key == RenderQueue::makeKey(RENDER_PASS_OPAQUE, 0, 0, 0, 0.f) );
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch/catch.hpp>
+#include <splitspace/RenderThread.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace splitspace;
+
+TEST_CASE( "RenderThread test", "[RenderThread]") {
+    std::vector<std::uint64_t> drawn;
+    std::thread::id drawThread;
+    RenderThread rt([&](const FramePacket &p) {
+        drawn.push_back(p.frame);
+        drawThread = std::this_thread::get_id();
+    });
+
+    SECTION( "Frames are drawn in order on the thread" ) {
+        bool started = false;
+        bool stopped = false;
+        REQUIRE( rt.start([&]() { started = true; }, [&]() { stopped = true; }) == true );
+        REQUIRE( rt.isRunning() == true );
+        REQUIRE( rt.isCurrent() == false );
+
+        FramePacket packets[FRAME_PACKETS];
+        for(std::uint64_t f = 0;f<10;f++) {
+            rt.waitForSlot();
+            FramePacket &p = packets[f%FRAME_PACKETS];
+            p.frame = f;
+            rt.submitFrame(&p);
+            REQUIRE( rt.getSubmittedFrames()-rt.getCompletedFrames()<=FRAME_PACKETS );
+        }
+        rt.stop();
+
+        REQUIRE( started == true );
+        REQUIRE( stopped == true );
+        REQUIRE( rt.getCompletedFrames() == 10 );
+        REQUIRE( drawn.size() == 10 );
+        bool ordered = true;
+        for(std::size_t i = 0;i<drawn.size();i++) {
+            ordered = ordered && drawn[i] == i;
+        }
+        REQUIRE( ordered == true );
+        REQUIRE( drawThread!=std::this_thread::get_id() );
+    }
+
+    SECTION( "Calls run on the thread" ) {
+        REQUIRE( rt.call([]() { return true; }) == true );
+        rt.start();
+        std::thread::id callThread;
+        bool onThread = false;
+        REQUIRE( rt.call([&]() {
+            callThread = std::this_thread::get_id();
+            onThread = rt.isCurrent();
+            // Nested calls do not wait for themselves
+            return rt.call([]() { return true; });
+        }) == true );
+        REQUIRE( onThread == true );
+        REQUIRE( callThread!=std::this_thread::get_id() );
+
+        std::future<bool> result = rt.post([]() { return false; });
+        REQUIRE( result.get() == false );
+        rt.stop();
+    }
+
+    SECTION( "Deferred tasks wait for submitted frames" ) {
+        rt.start();
+        FramePacket packet;
+        packet.frame = 7;
+        bool destroyed = false;
+        std::uint64_t drawnBefore = 0;
+        rt.submitFrame(&packet);
+        rt.defer([&]() {
+            destroyed = true;
+            drawnBefore = drawn.size();
+        });
+        rt.stop();
+        REQUIRE( destroyed == true );
+        REQUIRE( drawnBefore == 1 );
+
+        // Without a thread there is nothing in flight
+        bool ranInline = false;
+        rt.defer([&]() { ranInline = true; });
+        REQUIRE( ranInline == true );
+    }
+}
@@ -0,0 +1,48 @@
+#include <catch/catch.hpp>
+#include <splitspace/ShaderVariant.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "ShaderVariant test", "[ShaderVariant]") {
+    const std::vector<std::string> keywords = { "TEXTURED", "NORMAL_MAP", "SHADOWS" };
+
+    SECTION( "Keys" ) {
+        ShaderVariantKey key = ShaderVariant::makeKey(0x5, 4);
+        REQUIRE( ShaderVariant::getFeatures(key) == 0x5 );
+        REQUIRE( ShaderVariant::getNumLights(key) == 4 );
+        REQUIRE( ShaderVariant::makeKey(0, 0) == 0 );
+        REQUIRE( ShaderVariant::getNumLights(ShaderVariant::makeKey(0, 1000)) == SHADER_VARIANT_MAX_LIGHTS );
+
+        REQUIRE( ShaderVariant::getFeatureMask(keywords, { "NORMAL_MAP" }) == 0x2 );
+        REQUIRE( ShaderVariant::getFeatureMask(keywords, { "SHADOWS", "TEXTURED" }) == 0x5 );
+        // Undeclared keywords have no bit
+        REQUIRE( ShaderVariant::getFeatureMask(keywords, { "FOG" }) == 0 );
+    }
+
+    SECTION( "Material feature bits" ) {
+        MaterialFeatureBits bits = ShaderVariant::getMaterialFeatureBits(keywords);
+        REQUIRE( bits.textured == 0x1 );
+        REQUIRE( bits.normalMap == 0x2 );
+        bits = ShaderVariant::getMaterialFeatureBits({ "SHADOWS", "NORMAL_MAP" });
+        REQUIRE( bits.textured == 0 );
+        REQUIRE( bits.normalMap == 0x2 );
+        REQUIRE( ShaderVariant::getMaterialFeatures(bits, nullptr) == 0 );
+    }
+
+    SECTION( "Light counts" ) {
+        const std::vector<int> counts = { 8, 1, 4 };
+        REQUIRE( ShaderVariant::pickLightCount(counts, 1) == 1 );
+        REQUIRE( ShaderVariant::pickLightCount(counts, 3) == 4 );
+        REQUIRE( ShaderVariant::pickLightCount(counts, 8) == 8 );
+        REQUIRE( ShaderVariant::pickLightCount(counts, 9) == 0 );
+        REQUIRE( ShaderVariant::pickLightCount({}, 2) == 0 );
+    }
+
+    SECTION( "Defines" ) {
+        REQUIRE( ShaderVariant::getDefines(keywords, 0) == "" );
+        REQUIRE( ShaderVariant::getDefines(keywords, ShaderVariant::makeKey(0x3, 2)) ==
+                 "#define TEXTURED 1\n#define NORMAL_MAP 1\n#define NUM_LIGHTS 2\n" );
+        REQUIRE( ShaderVariant::describe(keywords, 0) == "base" );
+        REQUIRE( ShaderVariant::describe(keywords, ShaderVariant::makeKey(0x4, 1)) == "SHADOWS+1 lights" );
+    }
+}
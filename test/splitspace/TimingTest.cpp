@@ -0,0 +1,70 @@
+#include <catch/catch.hpp>
+#include <splitspace/Timing.hpp>
+
+using namespace splitspace;
+
+TEST_CASE( "TimingHistory test", "[Timing]") {
+
+    SECTION( "Empty history" ) {
+        TimingHistory h;
+        REQUIRE( h.size() == 0 );
+        REQUIRE( h.getAverage() == 0 );
+        REQUIRE( h.getPercentile(50) == 0 );
+    }
+
+    SECTION( "Average and percentiles" ) {
+        TimingHistory h;
+        for(int i = 100;i>=1;i--) {
+            h.add(i);
+        }
+        REQUIRE( h.size() == 100 );
+        REQUIRE( h.getLast() == 1 );
+        REQUIRE( h.getAverage() == Approx(50.5) );
+        REQUIRE( h.getPercentile(0) == 1 );
+        REQUIRE( h.getPercentile(50) == 50 );
+        REQUIRE( h.getPercentile(95) == 95 );
+        REQUIRE( h.getPercentile(100) == 100 );
+        REQUIRE( h.getMin() == 1 );
+        REQUIRE( h.getMax() == 100 );
+    }
+
+    SECTION( "Old samples are dropped" ) {
+        TimingHistory h(4);
+        for(int i = 0;i<10;i++) {
+            h.add(i);
+        }
+        REQUIRE( h.size() == 4 );
+        REQUIRE( h.getAverage() == Approx(7.5) );
+        REQUIRE( h.getPercentile(0) == 6 );
+        h.clear();
+        REQUIRE( h.size() == 0 );
+    }
+}
+
+TEST_CASE( "FixedTimestep test", "[Timing]") {
+    FixedTimestep timestep(0.01, 4);
+
+    SECTION( "Accumulates partial steps" ) {
+        REQUIRE( timestep.advance(0.004) == 0 );
+        REQUIRE( timestep.getAlpha() == Approx(0.4) );
+        REQUIRE( timestep.advance(0.008) == 1 );
+        REQUIRE( timestep.getAlpha() == Approx(0.2) );
+        REQUIRE( timestep.advance(0.025) == 2 );
+        REQUIRE( timestep.getAlpha() == Approx(0.7) );
+        REQUIRE( timestep.getDroppedSteps() == 0 );
+    }
+
+    SECTION( "Catch-up is capped" ) {
+        REQUIRE( timestep.advance(0.1) == 4 );
+        REQUIRE( timestep.getDroppedSteps() == 6 );
+        REQUIRE( timestep.advance(0.0) == 0 );
+        REQUIRE( timestep.advance(-1.0) == 0 );
+    }
+
+    SECTION( "Non-positive step falls back to default" ) {
+        FixedTimestep zero(0.0, 4);
+        REQUIRE( zero.getStep() == Approx(1.0/60.0) );
+        REQUIRE( zero.advance(0.04) == 2 );
+        REQUIRE( FixedTimestep(-1.0).getStep() == Approx(1.0/60.0) );
+    }
+}